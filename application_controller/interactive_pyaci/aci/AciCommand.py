@@ -4,6 +4,10 @@ def AciCommandLookUp(CommandOpCode):
     commandNameLUT = {
         AciEcho.OpCode: "Echo",
         AciRadioReset.OpCode: "RadioReset",
+        AciTimeSyncRootSet.OpCode: "TimeSyncRootSet",
+        AciTimeGet.OpCode: "TimeGet",
+        AciTraceRead.OpCode: "TraceRead",
+        AciLatencyGet.OpCode: "LatencyGet",
         AciInit.OpCode: "Init",
         AciValueSet.OpCode: "ValueSet",
         AciValueEnable.OpCode: "ValueEnable",
@@ -13,10 +17,12 @@ def AciCommandLookUp(CommandOpCode):
         AciFlagSet.OpCode: "FlagSet",
         AciFlagGet.OpCode: "FlagGet",
         AciDfuData.OpCode: "DfuData",
+        AciTrickleProfileSet.OpCode: "TrickleProfileSet",
         AciValueGet.OpCode: "ValueGet",
         AciBuildVersionGet.OpCode: "BuildVersionGet",
         AciAccessAddressGet.OpCode: "AccessAddressGet",
         AciChannelGet.OpCode: "ChannelGet",
+        AciStatsGet.OpCode: "StatsGet",
         AciIntervalMinMsGet.OpCode: "IntervalMinMsGet",
     }
 
@@ -64,6 +70,35 @@ class AciRadioReset(AciCommandPkt):
     def __init__(self):
         super(AciRadioReset, self).__init__(length=self.Length,OpCode=self.OpCode)
 
+class AciTimeSyncRootSet(AciCommandPkt):
+    OpCode = 0x60
+    Length = 2
+    def __init__(self, is_root):
+        payload = valueToByteArray(int(is_root),1)
+        super(AciTimeSyncRootSet, self).__init__(length=self.Length,OpCode=self.OpCode, data=payload)
+
+class AciTimeGet(AciCommandPkt):
+    OpCode = 0x61
+    Length = 1
+    def __init__(self):
+        super(AciTimeGet, self).__init__(length=self.Length,OpCode=self.OpCode)
+
+class AciTraceRead(AciCommandPkt):
+    OpCode = 0x62
+    Length = 1
+    def __init__(self):
+        super(AciTraceRead, self).__init__(length=self.Length,OpCode=self.OpCode)
+
+# Keep in sync with latency_stage_t in rbc_mesh/include/latency.h
+LATENCY_STAGE_NAMES = ["rx_cb", "dispatch", "tc", "vh_rx", "event_push", "event_get"]
+
+class AciLatencyGet(AciCommandPkt):
+    OpCode = 0x63
+    Length = 3
+    def __init__(self, stage=0, offset=0):
+        payload = valueToByteArray(stage,1) + valueToByteArray(offset,1)
+        super(AciLatencyGet, self).__init__(length=self.Length,OpCode=self.OpCode, data=payload)
+
 class AciInit(AciCommandPkt):
     OpCode = 0x70
     Length = 10
@@ -136,6 +171,16 @@ class AciDfuData(AciCommandPkt):
         else:
             super(AciDfuData, self).__init__(length=length,OpCode=self.OpCode, data = data)
 
+class AciTrickleProfileSet(AciCommandPkt):
+    OpCode = 0x79
+    Length = 11
+    def __init__(self, profile, interval_min_ms, interval_max_ms, redundancy_constant):
+        payload = valueToByteArray(profile,1)
+        payload.extend(valueToByteArray(interval_min_ms,4))
+        payload.extend(valueToByteArray(interval_max_ms,4))
+        payload.extend(valueToByteArray(redundancy_constant,1))
+        super(AciTrickleProfileSet, self).__init__(length=self.Length,OpCode=self.OpCode, data=payload)
+
 class AciValueGet(AciCommandPkt):
     OpCode = 0x7A
     Length = 3
@@ -161,6 +206,30 @@ class AciChannelGet(AciCommandPkt):
     def __init__(self):
         super(AciChannelGet, self).__init__(length=self.Length,OpCode=self.OpCode)
 
+# Keep in sync with rbc_mesh_stats_t in rbc_mesh.h, one name per 32 bit word
+STATS_WORD_NAMES = [
+    "rx_ok", "rx_crc_fail", "rx_queue_drop",
+    "events_timer", "events_timer_sch", "events_generic", "events_packet",
+    "events_set_flag", "events_set_trickle_profile",
+    "event_queue_drop", "event_queue_max_depth_generic", "event_queue_max_depth_timer",
+    "event_queue_max_depth_packet", "event_queue_max_depth_timeslot",
+    "event_max_latency_us", "event_coalesced",
+    "app_events_new_val", "app_events_update_val", "app_events_conflicting_val", "app_events_tx",
+    "app_event_queue_drop", "app_event_queue_max_depth",
+    "packet_pool_in_use", "packet_pool_max_in_use", "packet_pool_exhausted",
+    "data_cache_in_use", "data_cache_evictions",
+    "trickle_tx", "trickle_suppressed",
+    "digest_tx", "digest_bucket_resets",
+    "snapshot_records", "snapshot_bank_erases",
+]
+
+class AciStatsGet(AciCommandPkt):
+    OpCode = 0x7E
+    Length = 2
+    def __init__(self, offset=0):
+        payload = valueToByteArray(offset,1)
+        super(AciStatsGet, self).__init__(length=self.Length,OpCode=self.OpCode, data=payload)
+
 class AciIntervalMinMsGet(AciCommandPkt):
     OpCode = 0x7F
     Length = 1
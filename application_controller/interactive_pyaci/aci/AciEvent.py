@@ -88,6 +88,33 @@ class AciCmdRsp(AciEventPkt):
             self.CommandOpCode = pkt[2]
             self.StatusCode = pkt[3]
             self.Data = pkt[4:]
+            if self.CommandOpCode == AciCommand.AciTraceRead.OpCode and self.StatusCode == 0 and len(self.Data) >= 3:
+                # count, dropped, and 8 byte entries of timestamp, id, arg0 and arg1
+                self.TraceDropped = self.Data[1] | (self.Data[2] << 8)
+                self.TraceEntries = []
+                for i in range(self.Data[0]):
+                    entry = self.Data[3 + 8*i : 3 + 8*(i+1)]
+                    timestamp = entry[0] | (entry[1] << 8) | (entry[2] << 16) | (entry[3] << 24)
+                    self.TraceEntries.append((timestamp, entry[4], entry[5], entry[6] | (entry[7] << 8)))
+            if self.CommandOpCode == AciCommand.AciLatencyGet.OpCode and self.StatusCode == 0 and len(self.Data) >= 3:
+                # stage, offset of the first bucket, total number of buckets, and little endian 32 bit bucket counters
+                self.LatencyStage = self.Data[0]
+                self.LatencyOffset = self.Data[1]
+                self.LatencyBucketCount = self.Data[2]
+                self.LatencyBuckets = []
+                for i in range((len(self.Data) - 3) // 4):
+                    word = self.Data[3 + 4*i : 3 + 4*(i+1)]
+                    self.LatencyBuckets.append(word[0] | (word[1] << 8) | (word[2] << 16) | (word[3] << 24))
+            if self.CommandOpCode == AciCommand.AciStatsGet.OpCode and self.StatusCode == 0 and len(self.Data) >= 2:
+                # offset of the first word, total number of words, and little endian 32 bit words
+                self.StatsOffset = self.Data[0]
+                self.StatsWordCount = self.Data[1]
+                self.Stats = {}
+                for i in range((len(self.Data) - 2) // 4):
+                    word = self.Data[2 + 4*i : 2 + 4*(i+1)]
+                    index = self.StatsOffset + i
+                    name = AciCommand.STATS_WORD_NAMES[index] if index < len(AciCommand.STATS_WORD_NAMES) else "word_%d" % index
+                    self.Stats[name] = word[0] | (word[1] << 8) | (word[2] << 16) | (word[3] << 24)
 
     def __repr__(self):
         return str.format("I am %s and my Lenght is %d, OpCode is 0x%02x, CommandOpCode is %s, StatusCode is %s, and Data is %s" %(self.__class__.__name__, self.Len, self.OpCode, AciCommand.AciCommandLookUp(self.CommandOpCode), AciStatusLookUp(self.StatusCode), self.Data))
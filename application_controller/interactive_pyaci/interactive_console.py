@@ -55,6 +55,15 @@ class Interactive(object):
     def DFUData(self, Data):
         self.acidev.write_aci_cmd(AciCommand.AciDfuData(data=Data, length=(len(Data)+1)))
 
+    def TraceRead(self):
+        self.acidev.write_aci_cmd(AciCommand.AciTraceRead())
+
+    def StatsGet(self, Offset=0):
+        self.acidev.write_aci_cmd(AciCommand.AciStatsGet(offset=Offset))
+
+    def LatencyGet(self, Stage, Offset=0):
+        self.acidev.write_aci_cmd(AciCommand.AciLatencyGet(stage=Stage, offset=Offset))
+
     def BuildVersionGet(self):
         self.acidev.write_aci_cmd(AciCommand.AciBuildVersionGet())
 
@@ -244,6 +244,99 @@ bool rbc_mesh_persistent_flag_get(uint16_t handle)
     return hal_aci_tl_send(&msg_for_mesh);
 }
 
+bool rbc_mesh_trickle_profile_set(uint8_t profile, uint32_t interval_min_ms, uint32_t interval_max_ms, uint8_t redundancy_constant)
+{
+    hal_aci_data_t msg_for_mesh;
+    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    p_cmd->length = 11;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_TRICKLE_PROFILE_SET;
+    p_cmd->params.trickle_profile_set.profile = profile;
+    p_cmd->params.trickle_profile_set.interval_min_ms = interval_min_ms;
+    p_cmd->params.trickle_profile_set.interval_max_ms = interval_max_ms;
+    p_cmd->params.trickle_profile_set.redundancy_constant = redundancy_constant;
+
+    return hal_aci_tl_send(&msg_for_mesh);
+}
+
+bool rbc_mesh_trickle_profile_flag_set(uint16_t handle, uint8_t profile)
+{
+    hal_aci_data_t msg_for_mesh;
+    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    p_cmd->length = 5;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_FLAG_SET;
+    p_cmd->params.flag_set.handle = handle;
+    p_cmd->params.flag_set.flag = ACI_FLAG_TRICKLE_PROFILE;
+    p_cmd->params.flag_set.value = profile;
+
+    return hal_aci_tl_send(&msg_for_mesh);
+}
+
+bool rbc_mesh_trickle_profile_flag_get(uint16_t handle)
+{
+    hal_aci_data_t msg_for_mesh;
+    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    p_cmd->length = 4;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_FLAG_GET;
+    p_cmd->params.flag_get.handle = handle;
+    p_cmd->params.flag_get.flag = ACI_FLAG_TRICKLE_PROFILE;
+
+    return hal_aci_tl_send(&msg_for_mesh);
+}
+
+bool rbc_mesh_time_sync_root_set(bool is_root)
+{
+    hal_aci_data_t msg_for_mesh;
+    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    p_cmd->length = 2;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_TIME_SYNC_ROOT_SET;
+    p_cmd->params.time_sync_root_set.is_root = is_root;
+
+    return hal_aci_tl_send(&msg_for_mesh);
+}
+
+bool rbc_mesh_time_get()
+{
+    hal_aci_data_t msg_for_mesh;
+    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    p_cmd->length = 1;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_TIME_GET;
+
+    return hal_aci_tl_send(&msg_for_mesh);
+}
+
+bool rbc_mesh_trace_read()
+{
+    hal_aci_data_t msg_for_mesh;
+    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    p_cmd->length = 1;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_TRACE_READ;
+
+    return hal_aci_tl_send(&msg_for_mesh);
+}
+
+bool rbc_mesh_stats_get(uint8_t offset)
+{
+    hal_aci_data_t msg_for_mesh;
+    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    p_cmd->length = 2;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_STATS_GET;
+    p_cmd->params.stats_get.offset = offset;
+
+    return hal_aci_tl_send(&msg_for_mesh);
+}
+
+bool rbc_mesh_latency_get(uint8_t stage, uint8_t offset)
+{
+    hal_aci_data_t msg_for_mesh;
+    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    p_cmd->length = 3;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_LATENCY_GET;
+    p_cmd->params.latency_get.stage = stage;
+    p_cmd->params.latency_get.offset = offset;
+
+    return hal_aci_tl_send(&msg_for_mesh);
+}
+
 bool rbc_mesh_evt_get(serial_evt_t* p_evt){
     hal_aci_data_t msg;
     bool status = hal_aci_tl_event_get(&msg);
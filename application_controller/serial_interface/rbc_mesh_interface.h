@@ -173,6 +173,82 @@ bool rbc_mesh_tx_event_flag_get(uint16_t handle);
  */
 bool rbc_mesh_persistent_flag_get(uint16_t handle);
 
+/** @brief set the parameters of a trickle profile
+ *  @details
+ *  sets the retransmit intervals and redundancy constant of one of the
+ *  slave's trickle profiles. Profile 0 is the default for all handles.
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_trickle_profile_set(uint8_t profile, uint32_t interval_min_ms, uint32_t interval_max_ms, uint8_t redundancy_constant);
+
+/** @brief set the trickle profile of a handle
+ *  @details
+ *  makes the slave retransmit the given handle with the given trickle profile
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_trickle_profile_flag_set(uint16_t handle, uint8_t profile);
+
+/** @brief read the trickle profile of a handle
+ *  @details
+ *  promts the slave to return the trickle profile of the given handle
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_trickle_profile_flag_get(uint16_t handle);
+
+/** @brief make the slave the time synchronization root
+ *  @details
+ *  makes the slave broadcast its own clock as the mesh time, or stop doing so.
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_time_sync_root_set(bool is_root);
+
+/** @brief read the mesh time
+ *  @details
+ *  promts the slave to return its mesh time and its hop count to the time
+ *  synchronization root
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_time_get();
+
+/** @brief read the slave's trace
+ *  @details
+ *  promts the slave to return its oldest trace entries, and the number of
+ *  entries it dropped since the last read. The slave must be built with
+ *  RBC_MESH_TRACE.
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_trace_read();
+
+/** @brief read the slave's framework statistics
+ *  @details
+ *  promts the slave to return the words of its rbc_mesh_stats_t structure,
+ *  starting at the given word offset, as many as fit in one response. The
+ *  response also holds the total number of words, read the rest by asking
+ *  again from the offset past the last word returned.
+ *  @param offset index of the first 32 bit word to return
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_stats_get(uint8_t offset);
+
+/** @brief read one of the slave's receive path latency histograms
+ *  @details
+ *  promts the slave to return the buckets of the latency histogram of the
+ *  given stage, starting at the given bucket, as many as fit in one
+ *  response. The slave must be built with RBC_MESH_LATENCY_HISTOGRAMS.
+ *  @param stage receive path stage, as latency_stage_t on the slave
+ *  @param offset index of the first bucket to return
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_latency_get(uint8_t stage, uint8_t offset);
+
 /** @brief checkes if new events arrived
  *  @details
  *  checks for new events and takes them off the queue
@@ -30,6 +30,11 @@ typedef enum
     SERIAL_CMD_OPCODE_ECHO                  = 0x02,
     SERIAL_CMD_OPCODE_RADIO_RESET           = 0x0E,
     
+    SERIAL_CMD_OPCODE_TIME_SYNC_ROOT_SET    = 0x60,
+    SERIAL_CMD_OPCODE_TIME_GET              = 0x61,
+    SERIAL_CMD_OPCODE_TRACE_READ            = 0x62,
+    SERIAL_CMD_OPCODE_LATENCY_GET           = 0x63,
+
     SERIAL_CMD_OPCODE_INIT                  = 0x70,
     SERIAL_CMD_OPCODE_VALUE_SET             = 0x71,
     SERIAL_CMD_OPCODE_VALUE_ENABLE          = 0x72,
@@ -38,11 +43,13 @@ typedef enum
     SERIAL_CMD_OPCODE_STOP                  = 0x75,
     SERIAL_CMD_OPCODE_FLAG_SET              = 0x76,
     SERIAL_CMD_OPCODE_FLAG_GET              = 0x77,
+    SERIAL_CMD_OPCODE_TRICKLE_PROFILE_SET   = 0x79,
 
     SERIAL_CMD_OPCODE_VALUE_GET             = 0x7A,
     SERIAL_CMD_OPCODE_BUILD_VERSION_GET     = 0x7B,
     SERIAL_CMD_OPCODE_ACCESS_ADDR_GET       = 0x7C,
     SERIAL_CMD_OPCODE_CHANNEL_GET           = 0x7D,
+    SERIAL_CMD_OPCODE_STATS_GET             = 0x7E,
     SERIAL_CMD_OPCODE_INTERVAL_GET          = 0x7F,
 } __packed serial_cmd_opcode_t;
 
@@ -94,6 +101,30 @@ typedef struct
     uint16_t handle;
 } __packed serial_cmd_params_value_get_t;
 
+typedef struct 
+{
+    uint8_t profile;
+    uint32_t interval_min_ms;
+    uint32_t interval_max_ms;
+    uint8_t redundancy_constant;
+} __packed serial_cmd_params_trickle_profile_set_t;
+
+typedef struct 
+{
+    uint8_t is_root;
+} __packed serial_cmd_params_time_sync_root_set_t;
+
+typedef struct 
+{
+    uint8_t offset;
+} __packed serial_cmd_params_stats_get_t;
+
+typedef struct 
+{
+    uint8_t stage;
+    uint8_t offset;
+} __packed serial_cmd_params_latency_get_t;
+
 
 typedef struct 
 {
@@ -109,6 +140,10 @@ typedef struct
         serial_cmd_params_value_enable_t    value_enable;
         serial_cmd_params_value_disable_t   value_disable;
         serial_cmd_params_value_get_t       value_get;
+        serial_cmd_params_trickle_profile_set_t trickle_profile_set;
+        serial_cmd_params_time_sync_root_set_t time_sync_root_set;
+        serial_cmd_params_stats_get_t stats_get;
+        serial_cmd_params_latency_get_t latency_get;
     } __packed params;
 } __packed  serial_cmd_t;
 
@@ -82,6 +82,48 @@ typedef struct
     uint8_t data[RBC_MESH_VALUE_MAX_LEN];
 } __packed serial_evt_cmd_rsp_params_val_get_t;
 
+typedef struct
+{
+    uint32_t mesh_time;
+    uint8_t hops;
+} __packed serial_evt_cmd_rsp_params_time_get_t;
+
+typedef struct
+{
+    uint32_t timestamp;
+    uint8_t id;
+    uint8_t arg0;
+    uint16_t arg1;
+} __packed trace_entry_t;
+
+#define SERIAL_EVT_TRACE_ENTRIES_MAX    ((RBC_MESH_VALUE_MAX_LEN + 2 - 3) / sizeof(trace_entry_t))
+
+typedef struct
+{
+    uint8_t count;
+    uint16_t dropped;
+    trace_entry_t entries[SERIAL_EVT_TRACE_ENTRIES_MAX];
+} __packed serial_evt_cmd_rsp_params_trace_read_t;
+
+#define SERIAL_EVT_STATS_WORDS_MAX      ((RBC_MESH_VALUE_MAX_LEN + 2 - 2) / sizeof(uint32_t))
+
+typedef struct
+{
+    uint8_t offset;
+    uint8_t total_word_count;
+    uint32_t words[SERIAL_EVT_STATS_WORDS_MAX];
+} __packed serial_evt_cmd_rsp_params_stats_get_t;
+
+#define SERIAL_EVT_LATENCY_BUCKETS_MAX  ((RBC_MESH_VALUE_MAX_LEN + 2 - 3) / sizeof(uint32_t))
+
+typedef struct
+{
+    uint8_t stage;
+    uint8_t offset;
+    uint8_t bucket_count;
+    uint32_t buckets[SERIAL_EVT_LATENCY_BUCKETS_MAX];
+} __packed serial_evt_cmd_rsp_params_latency_get_t;
+
 
 /****** EVT PARAMS ******/
 typedef struct
@@ -101,6 +143,10 @@ typedef struct
         serial_evt_cmd_rsp_params_flag_get_t flag;
         serial_evt_cmd_rsp_params_adv_int_t adv_int;
         serial_evt_cmd_rsp_params_val_get_t val_get;
+        serial_evt_cmd_rsp_params_time_get_t time_get;
+        serial_evt_cmd_rsp_params_trace_read_t trace_read;
+        serial_evt_cmd_rsp_params_stats_get_t stats_get;
+        serial_evt_cmd_rsp_params_latency_get_t latency_get;
     } __packed response;        
 } __packed serial_evt_params_cmd_rsp_t;
 
@@ -28,12 +28,16 @@
 
 typedef __packed enum
 {
-    ACI_FLAG_PERSISTENT = 0x00,
-    ACI_FLAG_TX_EVENT   = 0x01
+    ACI_FLAG_PERSISTENT         = 0x00,
+    ACI_FLAG_TX_EVENT           = 0x01,
+    ACI_FLAG_TRICKLE_PROFILE    = 0x02
 } aci_flag_t;
 
 
+/* must match the framework, 241 when it's built with RBC_MESH_LONG_VALUES */
+#ifndef RBC_MESH_VALUE_MAX_LEN
 #define RBC_MESH_VALUE_MAX_LEN (23)
+#endif
 
 #endif /* _SERIAL_INTERNAL_H__ */
 
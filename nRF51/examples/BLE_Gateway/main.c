@@ -244,6 +244,7 @@ int main(void)
     
     
     rbc_mesh_init_params_t init_params;
+    memset(&init_params, 0, sizeof(init_params));
 
     init_params.access_addr = MESH_ACCESS_ADDR;
     init_params.interval_min_ms = MESH_INTERVAL_MIN_MS;
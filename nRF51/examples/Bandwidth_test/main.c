@@ -64,6 +64,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define NODE_NUMBER  105
 #define SLAVE_NUMBER (NODE_NUMBER-1)
 
+/* The master keeps a value for every node, in caches carved from this arena.
+   The target builds it with RBC_MESH_STATIC_ARENA=0, so the default caches
+   take no RAM. */
+#define MESH_CACHE_ENTRIES      (NODE_NUMBER)
+#define MESH_ARENA_SIZE         (13 * 1024)
+static uint32_t mesh_arena[MESH_ARENA_SIZE / sizeof(uint32_t)];
+
 static char UpBuffer0[BUFFER_SIZE_UP];
 static uint8_t packet_array [300] ;
 static uint16_t packet_index = 0 ;
@@ -432,12 +439,19 @@ int main(void)
     #endif
         
     rbc_mesh_init_params_t init_params;
+    memset(&init_params, 0, sizeof(init_params));
 
     init_params.access_addr = MESH_ACCESS_ADDR;
     init_params.interval_min_ms = MESH_INTERVAL_MIN_MS;
     init_params.channel = MESH_CHANNEL;
     init_params.lfclksrc = MESH_CLOCK_SOURCE;
     init_params.tx_power = RBC_MESH_TXPOWER_0dBm;
+#if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)
+    init_params.p_arena = mesh_arena;
+    init_params.arena_size = sizeof(mesh_arena);
+    init_params.handle_cache_entries = MESH_CACHE_ENTRIES;
+    init_params.data_cache_entries = MESH_CACHE_ENTRIES;
+#endif
 		
     uint32_t error_code = rbc_mesh_init(init_params);
     APP_ERROR_CHECK(error_code);
@@ -126,6 +126,7 @@ int main(void)
 
     /* Initialize mesh. */
     rbc_mesh_init_params_t init_params;
+    memset(&init_params, 0, sizeof(init_params));
     init_params.access_addr = MESH_ACCESS_ADDR;
     init_params.interval_min_ms = MESH_INTERVAL_MIN_MS;
     init_params.channel = MESH_CHANNEL;
@@ -0,0 +1,136 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+/**
+* @file Host benchmark of handle cache lookups. Built once per cache size,
+*   with and without RBC_MESH_HANDLE_CACHE_HASH_INDEX, see the host Makefile.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "handle_storage.h"
+#include "event_handler.h"
+#include "timer.h"
+#include "rand.h"
+#include "app_error.h"
+
+#define BENCH_LOOKUPS           (1000000)
+#define BENCH_CHURN_INSERTS     (100000)
+#define BENCH_HANDLE_OFFSET     (0x100)
+
+/*****************************************************************************
+* Framework stubs
+*****************************************************************************/
+void event_handler_critical_section_begin(void)
+{
+}
+
+void event_handler_critical_section_end(void)
+{
+}
+
+uint32_t event_handler_push(async_event_t* p_evt)
+{
+    return NRF_ERROR_NO_MEM;
+}
+
+timestamp_t timer_now(void)
+{
+    return 0;
+}
+
+/*****************************************************************************
+* Static Functions
+*****************************************************************************/
+static uint64_t time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double lookup_ns(prng_t* p_prng, uint16_t handle_base, uint16_t handle_count)
+{
+    uint32_t found = 0;
+    bool value;
+    uint64_t start = time_ns();
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        uint16_t handle = handle_base + (rand_prng_get(p_prng) % handle_count);
+        if (handle_storage_flag_get(handle, HANDLE_FLAG_TX_EVENT, &value) == NRF_SUCCESS)
+        {
+            found++;
+        }
+    }
+    uint64_t duration = time_ns() - start;
+    /* keep the compiler from dropping the loop */
+    if (found == UINT32_MAX)
+    {
+        printf("!");
+    }
+    return (double) duration / BENCH_LOOKUPS;
+}
+
+/*****************************************************************************
+* Main
+*****************************************************************************/
+int main(void)
+{
+    prng_t prng;
+    APP_ERROR_CHECK(rand_prng_seed(&prng));
+    mesh_packet_init();
+    APP_ERROR_CHECK(handle_storage_init(100000));
+
+    for (uint32_t i = 0; i < RBC_MESH_HANDLE_CACHE_ENTRIES; ++i)
+    {
+        APP_ERROR_CHECK(handle_storage_flag_set(BENCH_HANDLE_OFFSET + i, HANDLE_FLAG_TX_EVENT, true));
+    }
+
+    double hit = lookup_ns(&prng, BENCH_HANDLE_OFFSET, RBC_MESH_HANDLE_CACHE_ENTRIES);
+    double miss = lookup_ns(&prng, BENCH_HANDLE_OFFSET + RBC_MESH_HANDLE_CACHE_ENTRIES, 0x1000);
+
+    /* new handles push the least recently used out of the cache */
+    uint64_t start = time_ns();
+    for (uint32_t i = 0; i < BENCH_CHURN_INSERTS; ++i)
+    {
+        uint16_t handle = BENCH_HANDLE_OFFSET + (rand_prng_get(&prng) % (2 * RBC_MESH_HANDLE_CACHE_ENTRIES));
+        APP_ERROR_CHECK(handle_storage_flag_set(handle, HANDLE_FLAG_TX_EVENT, true));
+    }
+    double churn = (double) (time_ns() - start) / BENCH_CHURN_INSERTS;
+
+    printf("%-6s entries: %5u  hit: %8.1f ns  miss: %8.1f ns  churn: %8.1f ns\n",
+            (RBC_MESH_HANDLE_CACHE_HASH_INDEX ? "hash" : "walk"),
+            RBC_MESH_HANDLE_CACHE_ENTRIES,
+            hit, miss, churn);
+
+    return 0;
+}
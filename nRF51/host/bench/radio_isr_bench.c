@@ -0,0 +1,301 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+/**
+* @file Host benchmark of the radio ISR path: the radio END event handling in
+*   radio_control, and the packet event from the radio ISR through the event
+*   handler queue to the APP_LOW dispatcher, and a packet sent on all three
+*   advertising channels. Timed with the DWT cycle counter, which the host
+*   build mocks.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "radio_control.h"
+#include "event_handler.h"
+#include "handle_storage.h"
+#include "timer.h"
+#include "nrf.h"
+#include "app_error.h"
+
+#define BENCH_ITERATIONS        (1000000)
+#define BENCH_CHANNEL           (38)
+#define BENCH_TX_COPIES         (3)
+
+/* the event handler IRQ, dispatching the event queues */
+void QDEC_IRQHandler(void);
+
+typedef struct
+{
+    uint64_t total;
+    uint32_t min;
+} bench_cycles_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static uint8_t          m_packet[64];
+static uint32_t         m_rx_count;
+static uint32_t         m_packet_count;
+static uint32_t         m_tx_count;
+static bool             m_tx_restarted;
+static uint32_t         m_tx_cb_cycles;
+
+/*****************************************************************************
+* Framework stubs
+*****************************************************************************/
+bool timeslot_is_in_ts(void)
+{
+    return true;
+}
+
+timestamp_t timer_now(void)
+{
+    return 0;
+}
+
+void tc_packet_batch_handler(packet_event_t** pp_packets, uint32_t count)
+{
+    m_packet_count += count;
+}
+
+uint32_t handle_storage_flag_set(rbc_mesh_value_handle_t handle, handle_flag_t flag, bool value)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t handle_storage_trickle_profile_set(rbc_mesh_value_handle_t handle, uint8_t profile)
+{
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+* Static Functions
+*****************************************************************************/
+/* keep searching, like transport_control does when the radio goes idle */
+static void radio_idle_cb(void)
+{
+    radio_event_t evt;
+    memset(&evt, 0, sizeof(evt));
+    evt.event_type = RADIO_EVENT_TYPE_RX_PREEMPTABLE;
+    evt.channel = BENCH_CHANNEL;
+    evt.packet_ptr = m_packet;
+    APP_ERROR_CHECK(radio_order(&evt));
+}
+
+static void radio_rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi, uint8_t channel)
+{
+    m_rx_count++;
+}
+
+static void radio_tx_cb(uint8_t* p_data, uint8_t channel)
+{
+    /* note whether the next copy was started before the callback */
+    m_tx_cb_cycles = DWT->CYCCNT;
+    m_tx_restarted = NRF_RADIO->TASKS_TXEN;
+    m_tx_count++;
+}
+
+/* leave the radio idle between packets in the TX benchmark */
+static void radio_tx_idle_cb(void)
+{
+}
+
+static void cycles_add(bench_cycles_t* p_cycles, uint32_t cycles)
+{
+    p_cycles->total += cycles;
+    if (cycles < p_cycles->min)
+    {
+        p_cycles->min = cycles;
+    }
+}
+
+static void cycles_print(const char* p_name, const bench_cycles_t* p_cycles)
+{
+    printf("%-28s avg: %8.1f cycles  min: %6u cycles\n",
+            p_name, (double) p_cycles->total / BENCH_ITERATIONS, p_cycles->min);
+}
+
+/** A received packet ends, is handed to the rx callback, and the radio is set up for the next search. */
+static void bench_radio_end(void)
+{
+    bench_cycles_t cycles = {0, UINT32_MAX};
+    radio_init(radio_idle_cb, radio_rx_cb, radio_tx_cb);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+        NRF_RADIO->EVENTS_END = 1;
+        uint32_t start = DWT->CYCCNT;
+        radio_event_handler();
+        cycles_add(&cycles, DWT->CYCCNT - start);
+    }
+    if (m_rx_count != BENCH_ITERATIONS)
+    {
+        printf("%u of %u packets received\n", m_rx_count, BENCH_ITERATIONS);
+        exit(1);
+    }
+    cycles_print("radio END:", &cycles);
+}
+
+/** A packet is sent on all advertising channels. Measures the ISR cycles for
+  each packet, and the cycles from the end of a copy to the start of the next. */
+static void bench_tx_copies(void)
+{
+    bench_cycles_t isr_cycles = {0, UINT32_MAX};
+    bench_cycles_t restart_cycles = {0, UINT32_MAX};
+    radio_init(radio_tx_idle_cb, radio_rx_cb, radio_tx_cb);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+        for (uint32_t j = 0; j < BENCH_TX_COPIES; ++j)
+        {
+            radio_event_t evt;
+            memset(&evt, 0, sizeof(evt));
+            evt.event_type = RADIO_EVENT_TYPE_TX;
+            evt.channel = 37 + j;
+            evt.packet_ptr = m_packet;
+            APP_ERROR_CHECK(radio_order(&evt));
+        }
+
+        uint32_t start = DWT->CYCCNT;
+        radio_event_handler();
+        uint32_t cycles = DWT->CYCCNT - start;
+
+        for (uint32_t j = 0; j < BENCH_TX_COPIES; ++j)
+        {
+            NRF_RADIO->TASKS_TXEN = 0;
+            NRF_RADIO->EVENTS_END = 1;
+            NRF_RADIO->EVENTS_DISABLED = 1;
+            start = DWT->CYCCNT;
+            radio_event_handler();
+            uint32_t end = DWT->CYCCNT;
+            cycles += end - start;
+            if (j + 1 < BENCH_TX_COPIES)
+            {
+                /* unless started before the callback, the next copy starts at the end of the ISR */
+                cycles_add(&restart_cycles, (m_tx_restarted ? m_tx_cb_cycles : end) - start);
+            }
+        }
+        cycles_add(&isr_cycles, cycles);
+    }
+    if (m_tx_count != BENCH_ITERATIONS * BENCH_TX_COPIES)
+    {
+        printf("%u of %u copies sent\n", m_tx_count, BENCH_ITERATIONS * BENCH_TX_COPIES);
+        exit(1);
+    }
+    cycles_print("3 channel TX, per packet:", &isr_cycles);
+    /* two restarts per packet */
+    restart_cycles.total /= BENCH_TX_COPIES - 1;
+    cycles_print("3 channel TX, next copy:", &restart_cycles);
+}
+
+/** The radio ISR queues a packet event, and the APP_LOW dispatcher executes it. */
+static void bench_packet_event(void)
+{
+    bench_cycles_t push_cycles = {0, UINT32_MAX};
+    bench_cycles_t dispatch_cycles = {0, UINT32_MAX};
+    event_handler_init();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+        async_event_t evt;
+        evt.type = EVENT_TYPE_PACKET;
+        evt.callback.packet.payload = m_packet;
+        evt.callback.packet.crc = i;
+        evt.callback.packet.timestamp = 0;
+        evt.callback.packet.rssi = 100;
+
+        uint32_t start = DWT->CYCCNT;
+        uint32_t error_code = event_handler_push(&evt);
+        uint32_t pushed = DWT->CYCCNT;
+        QDEC_IRQHandler();
+        uint32_t dispatched = DWT->CYCCNT;
+
+        APP_ERROR_CHECK(error_code);
+        cycles_add(&push_cycles, pushed - start);
+        cycles_add(&dispatch_cycles, dispatched - pushed);
+    }
+    if (m_packet_count != BENCH_ITERATIONS)
+    {
+        printf("%u of %u packet events executed\n", m_packet_count, BENCH_ITERATIONS);
+        exit(1);
+    }
+    cycles_print("packet event push:", &push_cycles);
+    cycles_print("packet event dispatch:", &dispatch_cycles);
+}
+
+/** Packets arrive back to back, and the dispatcher takes them all in one batch. */
+static void bench_packet_burst(void)
+{
+    bench_cycles_t dispatch_cycles = {0, UINT32_MAX};
+    m_packet_count = 0;
+    event_handler_init();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i += RBC_MESH_RX_BATCH_MAX)
+    {
+        for (uint32_t j = 0; j < RBC_MESH_RX_BATCH_MAX; ++j)
+        {
+            async_event_t evt;
+            evt.type = EVENT_TYPE_PACKET;
+            evt.callback.packet.payload = m_packet;
+            evt.callback.packet.crc = i + j;
+            evt.callback.packet.timestamp = 0;
+            evt.callback.packet.rssi = 100;
+            APP_ERROR_CHECK(event_handler_push(&evt));
+        }
+
+        uint32_t start = DWT->CYCCNT;
+        QDEC_IRQHandler();
+        uint32_t cycles = (DWT->CYCCNT - start) / RBC_MESH_RX_BATCH_MAX;
+        for (uint32_t j = 0; j < RBC_MESH_RX_BATCH_MAX; ++j)
+        {
+            cycles_add(&dispatch_cycles, cycles);
+        }
+    }
+    if (m_packet_count != BENCH_ITERATIONS)
+    {
+        printf("%u of %u packet events executed\n", m_packet_count, BENCH_ITERATIONS);
+        exit(1);
+    }
+    cycles_print("packet burst dispatch:", &dispatch_cycles);
+}
+
+/*****************************************************************************
+* Main
+*****************************************************************************/
+int main(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    bench_tx_copies();
+    bench_radio_end();
+    bench_packet_event();
+    bench_packet_burst();
+    return 0;
+}
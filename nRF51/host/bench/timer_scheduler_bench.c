@@ -0,0 +1,257 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+/**
+* @file Host benchmark of the timer scheduler, with a growing number of
+*   concurrent timers. Asynchronous scheduler operations are executed right
+*   away, and time is moved forward by the benchmark.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "timer_scheduler.h"
+#include "event_handler.h"
+#include "timer.h"
+#include "rand.h"
+#include "app_error.h"
+
+#define BENCH_RESCHEDULES       (200000)
+#define BENCH_RUN_TIME_US       (600000000)
+#define BENCH_TIMEOUT_MAX_US    (10000000)
+#define BENCH_STEP_MAX_US       (2000)
+#define BENCH_MARGIN_US         (100) /* same as TIMER_MARGIN in the scheduler */
+#define BENCH_TIMERS_MAX        (512)
+#define BENCH_GENERIC_QUEUE_LEN  (4)
+
+typedef struct
+{
+    timer_event_t evt;
+    timestamp_t deadline;
+    bool fired;
+} bench_timer_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static const uint32_t   m_timer_counts[] = {8, 64, 512};
+static bench_timer_t    m_timers[BENCH_TIMERS_MAX];
+static bench_timer_t*   mp_fired[BENCH_TIMERS_MAX];
+static uint32_t         m_fired_count;
+static async_event_t    m_generic_queue[BENCH_GENERIC_QUEUE_LEN];
+static uint32_t         m_generic_count;
+static timestamp_t      m_time;
+static timestamp_t      m_timeout;
+static timer_callback_t m_timeout_cb;
+static prng_t           m_prng;
+
+/*****************************************************************************
+* Framework stubs
+*****************************************************************************/
+uint32_t event_handler_push(async_event_t* p_evt)
+{
+    switch (p_evt->type)
+    {
+        case EVENT_TYPE_GENERIC:
+            /* executed by generic_events_run(), like the event handler would */
+            if (m_generic_count == BENCH_GENERIC_QUEUE_LEN)
+            {
+                return NRF_ERROR_NO_MEM;
+            }
+            m_generic_queue[m_generic_count++] = *p_evt;
+            return NRF_SUCCESS;
+        case EVENT_TYPE_TIMER_SCH:
+            if (m_fired_count == BENCH_TIMERS_MAX)
+            {
+                return NRF_ERROR_NO_MEM;
+            }
+            mp_fired[m_fired_count++] = (bench_timer_t*) p_evt->callback.timer_sch.p_context;
+            return NRF_SUCCESS;
+        default:
+            return NRF_ERROR_INVALID_PARAM;
+    }
+}
+
+timestamp_t timer_now(void)
+{
+    return m_time;
+}
+
+uint32_t timer_order_cb(uint8_t timer, timestamp_t time, timer_callback_t callback, timer_attr_t attributes)
+{
+    m_timeout = time;
+    m_timeout_cb = callback;
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+* Static Functions
+*****************************************************************************/
+static uint64_t time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void generic_events_run(void)
+{
+    for (uint32_t i = 0; i < m_generic_count; ++i)
+    {
+        m_generic_queue[i].callback.generic.cb(m_generic_queue[i].callback.generic.p_context);
+    }
+    m_generic_count = 0;
+}
+
+static void timer_sch_cb(timestamp_t timestamp, void* p_context)
+{
+    /* never called, the stub collects the fired timers instead */
+}
+
+static void bench_reschedule(bench_timer_t* p_timer)
+{
+    p_timer->deadline = m_time + BENCH_MARGIN_US + 1 + (rand_prng_get(&m_prng) % BENCH_TIMEOUT_MAX_US);
+    p_timer->fired = false;
+    APP_ERROR_CHECK(timer_sch_reschedule(&p_timer->evt, p_timer->deadline));
+    generic_events_run();
+}
+
+/** Move time forward, and check that every timer fires on time. Returns the
+  number of timers fired, and the time spent in the scheduler. */
+static uint32_t bench_run(uint32_t timer_count, uint64_t* p_duration_ns)
+{
+    uint32_t fired = 0;
+    *p_duration_ns = 0;
+    const timestamp_t end = m_time + BENCH_RUN_TIME_US;
+    while (TIMER_OLDER_THAN(m_time, end))
+    {
+        m_time += 1 + (rand_prng_get(&m_prng) % BENCH_STEP_MAX_US);
+        if (m_timeout_cb == NULL || TIMER_OLDER_THAN(m_time, m_timeout))
+        {
+            continue;
+        }
+        timer_callback_t cb = m_timeout_cb;
+        m_timeout_cb = NULL;
+        uint64_t start = time_ns();
+        cb(m_time);
+        *p_duration_ns += time_ns() - start;
+
+        for (uint32_t i = 0; i < m_fired_count; ++i)
+        {
+            bench_timer_t* p_timer = mp_fired[i];
+            if (p_timer->fired ||
+                !TIMER_OLDER_THAN(p_timer->deadline, m_time + BENCH_MARGIN_US) ||
+                TIMER_OLDER_THAN(p_timer->deadline + BENCH_STEP_MAX_US, m_time))
+            {
+                printf("timer %u fired at %u, deadline %u\n",
+                        (uint32_t) (p_timer - m_timers), m_time, p_timer->deadline);
+                exit(1);
+            }
+            p_timer->fired = true;
+            fired++;
+        }
+        /* rescheduling may fire more timers, which are checked next round */
+        bench_timer_t* p_fired[BENCH_TIMERS_MAX];
+        uint32_t count = m_fired_count;
+        memcpy(p_fired, mp_fired, count * sizeof(bench_timer_t*));
+        m_fired_count = 0;
+        start = time_ns();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            bench_reschedule(p_fired[i]);
+        }
+        *p_duration_ns += time_ns() - start;
+    }
+
+    /* no timer may be left behind */
+    for (uint32_t i = 0; i < timer_count; ++i)
+    {
+        if (!m_timers[i].fired && TIMER_OLDER_THAN(m_timers[i].deadline + BENCH_STEP_MAX_US, m_time))
+        {
+            printf("timer %u missed deadline %u, time %u\n", i, m_timers[i].deadline, m_time);
+            exit(1);
+        }
+    }
+    return fired;
+}
+
+/*****************************************************************************
+* Main
+*****************************************************************************/
+int main(void)
+{
+    APP_ERROR_CHECK(rand_prng_seed(&m_prng));
+
+    for (uint32_t c = 0; c < sizeof(m_timer_counts) / sizeof(m_timer_counts[0]); ++c)
+    {
+        const uint32_t timer_count = m_timer_counts[c];
+        m_time = 0;
+        m_timeout_cb = NULL;
+        m_fired_count = 0;
+        memset(m_timers, 0, sizeof(m_timers));
+        APP_ERROR_CHECK(timer_sch_init());
+
+        for (uint32_t i = 0; i < timer_count; ++i)
+        {
+            m_timers[i].evt.cb = timer_sch_cb;
+            m_timers[i].evt.p_context = &m_timers[i];
+            m_timers[i].evt.interval = TIMER_EVENT_INTERVAL_SINGLE_SHOT;
+            bench_reschedule(&m_timers[i]);
+        }
+
+        uint64_t start = time_ns();
+        for (uint32_t i = 0; i < BENCH_RESCHEDULES; ++i)
+        {
+            bench_reschedule(&m_timers[rand_prng_get(&m_prng) % timer_count]);
+        }
+        double reschedule = (double) (time_ns() - start) / BENCH_RESCHEDULES;
+
+        start = time_ns();
+        for (uint32_t i = 0; i < BENCH_RESCHEDULES; ++i)
+        {
+            bench_timer_t* p_timer = &m_timers[rand_prng_get(&m_prng) % timer_count];
+            APP_ERROR_CHECK(timer_sch_abort(&p_timer->evt));
+            generic_events_run();
+            bench_reschedule(p_timer);
+        }
+        double abort_schedule = (double) (time_ns() - start) / BENCH_RESCHEDULES;
+
+        uint64_t duration;
+        uint32_t fired = bench_run(timer_count, &duration);
+        double fire = (double) duration / fired;
+
+        printf("timers: %4u  reschedule: %8.1f ns  abort+reschedule: %8.1f ns  fire+reschedule: %8.1f ns (%u fired)\n",
+                timer_count, reschedule, abort_schedule, fire, fired);
+    }
+
+    return 0;
+}
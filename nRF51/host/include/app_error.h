@@ -0,0 +1,71 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef APP_ERROR_H__
+#define APP_ERROR_H__
+
+/**
+* @file Host replacement for the SDK error module. Errors are fatal, and
+*   terminate the host process.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_error.h"
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t* p_file_name);
+
+#define APP_ERROR_HANDLER(ERR_CODE)                                     \
+    do                                                                  \
+    {                                                                   \
+        app_error_handler((ERR_CODE), __LINE__, (uint8_t*) __FILE__);   \
+    } while (0)
+
+#define APP_ERROR_CHECK(ERR_CODE)                                       \
+    do                                                                  \
+    {                                                                   \
+        const uint32_t LOCAL_ERR_CODE = (ERR_CODE);                     \
+        if (LOCAL_ERR_CODE != NRF_SUCCESS)                              \
+        {                                                               \
+            APP_ERROR_HANDLER(LOCAL_ERR_CODE);                          \
+        }                                                               \
+    } while (0)
+
+#define APP_ERROR_CHECK_BOOL(BOOLEAN_VALUE)                             \
+    do                                                                  \
+    {                                                                   \
+        const uint32_t LOCAL_BOOLEAN_VALUE = (BOOLEAN_VALUE);           \
+        if (!LOCAL_BOOLEAN_VALUE)                                       \
+        {                                                               \
+            APP_ERROR_HANDLER(0);                                       \
+        }                                                               \
+    } while (0)
+
+#endif /* APP_ERROR_H__ */
@@ -0,0 +1,260 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef NRF51_H
+#define NRF51_H
+
+#include <stdint.h>
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+
+typedef enum
+{
+    POWER_CLOCK_IRQn    = 0,
+    RADIO_IRQn          = 1,
+    UART0_IRQn          = 2,
+    SPI0_TWI0_IRQn      = 3,
+    SPI1_TWI1_IRQn      = 4,
+    GPIOTE_IRQn         = 6,
+    ADC_IRQn            = 7,
+    TIMER0_IRQn         = 8,
+    TIMER1_IRQn         = 9,
+    TIMER2_IRQn         = 10,
+    RTC0_IRQn           = 11,
+    TEMP_IRQn           = 12,
+    RNG_IRQn            = 13,
+    ECB_IRQn            = 14,
+    CCM_AAR_IRQn        = 15,
+    WDT_IRQn            = 16,
+    RTC1_IRQn           = 17,
+    QDEC_IRQn           = 18,
+    LPCOMP_IRQn         = 19,
+    SWI0_IRQn           = 20,
+    SWI1_IRQn           = 21,
+    SWI2_IRQn           = 22,
+    SWI3_IRQn           = 23,
+    SWI4_IRQn           = 24,
+    SWI5_IRQn           = 25
+} IRQn_Type;
+
+typedef struct
+{
+    __I  uint32_t DEVICEADDRTYPE;
+    __I  uint32_t DEVICEADDR[2];
+} NRF_FICR_Type;
+
+/** Register layout of the peripherals the framework drives directly. The
+    order follows the nRF51 register maps, but reserved gaps are left out, as
+    no code depends on the absolute offsets. */
+typedef struct
+{
+    __O  uint32_t TASKS_TXEN;
+    __O  uint32_t TASKS_RXEN;
+    __O  uint32_t TASKS_START;
+    __O  uint32_t TASKS_STOP;
+    __O  uint32_t TASKS_DISABLE;
+    __O  uint32_t TASKS_RSSISTART;
+    __O  uint32_t TASKS_RSSISTOP;
+    __O  uint32_t TASKS_BCSTART;
+    __O  uint32_t TASKS_BCSTOP;
+    __IO uint32_t EVENTS_READY;
+    __IO uint32_t EVENTS_ADDRESS;
+    __IO uint32_t EVENTS_PAYLOAD;
+    __IO uint32_t EVENTS_END;
+    __IO uint32_t EVENTS_DISABLED;
+    __IO uint32_t EVENTS_DEVMATCH;
+    __IO uint32_t EVENTS_DEVMISS;
+    __IO uint32_t EVENTS_RSSIEND;
+    __IO uint32_t EVENTS_BCMATCH;
+    __IO uint32_t SHORTS;
+    __IO uint32_t INTENSET;
+    __IO uint32_t INTENCLR;
+    __I  uint32_t CRCSTATUS;
+    __I  uint32_t RXMATCH;
+    __I  uint32_t RXCRC;
+    __I  uint32_t DAI;
+    __IO uint32_t PACKETPTR;
+    __IO uint32_t FREQUENCY;
+    __IO uint32_t TXPOWER;
+    __IO uint32_t MODE;
+    __IO uint32_t PCNF0;
+    __IO uint32_t PCNF1;
+    __IO uint32_t BASE0;
+    __IO uint32_t BASE1;
+    __IO uint32_t PREFIX0;
+    __IO uint32_t PREFIX1;
+    __IO uint32_t TXADDRESS;
+    __IO uint32_t RXADDRESSES;
+    __IO uint32_t CRCCNF;
+    __IO uint32_t CRCPOLY;
+    __IO uint32_t CRCINIT;
+    __IO uint32_t TEST;
+    __IO uint32_t TIFS;
+    __I  uint32_t RSSISAMPLE;
+    __I  uint32_t STATE;
+    __IO uint32_t DATAWHITEIV;
+    __IO uint32_t BCC;
+    __IO uint32_t DAB[8];
+    __IO uint32_t DAP[8];
+    __IO uint32_t DACNF;
+    __IO uint32_t OVERRIDE0;
+    __IO uint32_t OVERRIDE1;
+    __IO uint32_t OVERRIDE2;
+    __IO uint32_t OVERRIDE3;
+    __IO uint32_t OVERRIDE4;
+    __IO uint32_t POWER;
+} NRF_RADIO_Type;
+
+typedef struct
+{
+    __O  uint32_t TASKS_START;
+    __O  uint32_t TASKS_STOP;
+    __O  uint32_t TASKS_COUNT;
+    __O  uint32_t TASKS_CLEAR;
+    __O  uint32_t TASKS_SHUTDOWN;
+    __O  uint32_t TASKS_CAPTURE[4];
+    __IO uint32_t EVENTS_COMPARE[4];
+    __IO uint32_t SHORTS;
+    __IO uint32_t INTENSET;
+    __IO uint32_t INTENCLR;
+    __IO uint32_t MODE;
+    __IO uint32_t BITMODE;
+    __IO uint32_t PRESCALER;
+    __IO uint32_t CC[4];
+    __IO uint32_t POWER;
+} NRF_TIMER_Type;
+
+typedef struct
+{
+    __IO uint32_t EN;
+    __IO uint32_t DIS;
+} PPI_TASKS_CHG_Type;
+
+typedef struct
+{
+    __IO uint32_t EEP;
+    __IO uint32_t TEP;
+} PPI_CH_Type;
+
+typedef struct
+{
+    PPI_TASKS_CHG_Type TASKS_CHG[4];
+    __IO uint32_t CHEN;
+    __IO uint32_t CHENSET;
+    __IO uint32_t CHENCLR;
+    PPI_CH_Type CH[16];
+    __IO uint32_t CHG[4];
+} NRF_PPI_Type;
+
+typedef struct
+{
+    __O  uint32_t TASKS_START;
+    __O  uint32_t TASKS_STOP;
+    __O  uint32_t TASKS_CLEAR;
+    __O  uint32_t TASKS_TRIGOVRFLW;
+    __IO uint32_t EVENTS_TICK;
+    __IO uint32_t EVENTS_OVRFLW;
+    __IO uint32_t EVENTS_COMPARE[4];
+    __IO uint32_t INTENSET;
+    __IO uint32_t INTENCLR;
+    __IO uint32_t EVTEN;
+    __IO uint32_t EVTENSET;
+    __IO uint32_t EVTENCLR;
+    __I  uint32_t COUNTER;
+    __IO uint32_t PRESCALER;
+    __IO uint32_t CC[4];
+    __IO uint32_t POWER;
+} NRF_RTC_Type;
+
+extern NRF_FICR_Type    g_host_ficr;
+extern NRF_RADIO_Type   g_host_radio;
+extern NRF_TIMER_Type   g_host_timer0;
+extern NRF_PPI_Type     g_host_ppi;
+extern NRF_RTC_Type     g_host_rtc0;
+
+#define NRF_FICR    (&g_host_ficr)
+#define NRF_RADIO   (&g_host_radio)
+#define NRF_TIMER0  (&g_host_timer0)
+#define NRF_PPI     (&g_host_ppi)
+#define NRF_RTC0    (&g_host_rtc0)
+
+/** Code flash for the framework's flash users, written through the host
+    nrf_flash_erase() and nrf_flash_store() with the semantics of the NVMC:
+    erasing sets all bits of whole pages, storing can only clear bits. */
+#define HOST_FLASH_PAGE_SIZE    (1024)
+#define HOST_FLASH_SIZE         (16 * HOST_FLASH_PAGE_SIZE)
+
+extern uint8_t g_host_flash[HOST_FLASH_SIZE];
+
+/** Cycle counter of the Cortex-M4 data watchpoint and trace unit, for timing
+    code paths. On the host, CYCCNT follows the processor time stamp counter
+    while enabled, and is brought up to date every time DWT is dereferenced. */
+typedef struct
+{
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct
+{
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+
+extern CoreDebug_Type   g_host_core_debug;
+
+DWT_Type* host_dwt_get(void);
+
+#define CoreDebug   (&g_host_core_debug)
+#define DWT         (host_dwt_get())
+
+/** Interrupt controller state, one bit per IRQn. The host decides when
+    pending and enabled interrupts get to run. */
+typedef struct
+{
+    uint32_t enabled;
+    uint32_t pending;
+    uint8_t  priority[32];
+} host_nvic_t;
+
+extern host_nvic_t g_host_nvic;
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn);
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+
+#endif /* NRF51_H */
@@ -0,0 +1,171 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef NRF51_BITFIELDS_H
+#define NRF51_BITFIELDS_H
+
+/* Subset of the nRF51 register bitfields used by the framework. */
+
+/* Peripheral: RADIO */
+#define RADIO_SHORTS_READY_START_Pos        (0UL)
+#define RADIO_SHORTS_READY_START_Msk        (0x1UL << RADIO_SHORTS_READY_START_Pos)
+#define RADIO_SHORTS_END_DISABLE_Pos        (1UL)
+#define RADIO_SHORTS_END_DISABLE_Msk        (0x1UL << RADIO_SHORTS_END_DISABLE_Pos)
+#define RADIO_SHORTS_DISABLED_TXEN_Pos      (2UL)
+#define RADIO_SHORTS_DISABLED_TXEN_Msk      (0x1UL << RADIO_SHORTS_DISABLED_TXEN_Pos)
+#define RADIO_SHORTS_DISABLED_RXEN_Pos      (3UL)
+#define RADIO_SHORTS_DISABLED_RXEN_Msk      (0x1UL << RADIO_SHORTS_DISABLED_RXEN_Pos)
+#define RADIO_SHORTS_ADDRESS_RSSISTART_Pos  (4UL)
+#define RADIO_SHORTS_ADDRESS_RSSISTART_Msk  (0x1UL << RADIO_SHORTS_ADDRESS_RSSISTART_Pos)
+#define RADIO_SHORTS_END_START_Pos          (5UL)
+#define RADIO_SHORTS_END_START_Msk          (0x1UL << RADIO_SHORTS_END_START_Pos)
+#define RADIO_SHORTS_ADDRESS_BCSTART_Pos    (6UL)
+#define RADIO_SHORTS_ADDRESS_BCSTART_Msk    (0x1UL << RADIO_SHORTS_ADDRESS_BCSTART_Pos)
+#define RADIO_SHORTS_DISABLED_RSSISTOP_Pos  (8UL)
+#define RADIO_SHORTS_DISABLED_RSSISTOP_Msk  (0x1UL << RADIO_SHORTS_DISABLED_RSSISTOP_Pos)
+
+#define RADIO_INTENSET_READY_Pos            (0UL)
+#define RADIO_INTENSET_READY_Msk            (0x1UL << RADIO_INTENSET_READY_Pos)
+#define RADIO_INTENSET_ADDRESS_Pos          (1UL)
+#define RADIO_INTENSET_ADDRESS_Msk          (0x1UL << RADIO_INTENSET_ADDRESS_Pos)
+#define RADIO_INTENSET_PAYLOAD_Pos          (2UL)
+#define RADIO_INTENSET_PAYLOAD_Msk          (0x1UL << RADIO_INTENSET_PAYLOAD_Pos)
+#define RADIO_INTENSET_END_Pos              (3UL)
+#define RADIO_INTENSET_END_Msk              (0x1UL << RADIO_INTENSET_END_Pos)
+#define RADIO_INTENSET_DISABLED_Pos         (4UL)
+#define RADIO_INTENSET_DISABLED_Msk         (0x1UL << RADIO_INTENSET_DISABLED_Pos)
+#define RADIO_INTENSET_RSSIEND_Pos          (7UL)
+#define RADIO_INTENSET_RSSIEND_Msk          (0x1UL << RADIO_INTENSET_RSSIEND_Pos)
+
+#define RADIO_INTENCLR_END_Pos              (3UL)
+#define RADIO_INTENCLR_END_Msk              (0x1UL << RADIO_INTENCLR_END_Pos)
+#define RADIO_INTENCLR_DISABLED_Pos         (4UL)
+#define RADIO_INTENCLR_DISABLED_Msk         (0x1UL << RADIO_INTENCLR_DISABLED_Pos)
+
+#define RADIO_CRCSTATUS_CRCSTATUS_Pos       (0UL)
+#define RADIO_CRCSTATUS_CRCSTATUS_Msk       (0x1UL << RADIO_CRCSTATUS_CRCSTATUS_Pos)
+#define RADIO_CRCSTATUS_CRCSTATUS_CRCError  (0UL)
+#define RADIO_CRCSTATUS_CRCSTATUS_CRCOk     (1UL)
+
+#define RADIO_TXPOWER_TXPOWER_Pos           (0UL)
+#define RADIO_TXPOWER_TXPOWER_Msk           (0xFFUL << RADIO_TXPOWER_TXPOWER_Pos)
+#define RADIO_TXPOWER_TXPOWER_0dBm          (0x00UL)
+#define RADIO_TXPOWER_TXPOWER_Pos4dBm       (0x04UL)
+#define RADIO_TXPOWER_TXPOWER_Neg30dBm      (0xD8UL)
+#define RADIO_TXPOWER_TXPOWER_Neg20dBm      (0xECUL)
+#define RADIO_TXPOWER_TXPOWER_Neg16dBm      (0xF0UL)
+#define RADIO_TXPOWER_TXPOWER_Neg12dBm      (0xF4UL)
+#define RADIO_TXPOWER_TXPOWER_Neg8dBm       (0xF8UL)
+#define RADIO_TXPOWER_TXPOWER_Neg4dBm       (0xFCUL)
+
+#define RADIO_MODE_MODE_Pos                 (0UL)
+/* the nRF52 width of the MODE field, the host radio models BLE 2 Mbit as well */
+#define RADIO_MODE_MODE_Msk                 (0xFUL << RADIO_MODE_MODE_Pos)
+#define RADIO_MODE_MODE_Nrf_1Mbit           (0x00UL)
+#define RADIO_MODE_MODE_Nrf_2Mbit           (0x01UL)
+#define RADIO_MODE_MODE_Nrf_250Kbit         (0x02UL)
+#define RADIO_MODE_MODE_Ble_1Mbit           (0x03UL)
+#define RADIO_MODE_MODE_Ble_2Mbit           (0x04UL)
+
+/* PLEN and S1INCL are nRF52 only, the host radio models them */
+#define RADIO_PCNF0_PLEN_Pos                (24UL)
+#define RADIO_PCNF0_PLEN_Msk                (0x1UL << RADIO_PCNF0_PLEN_Pos)
+#define RADIO_PCNF0_PLEN_8bit               (0x00UL)
+#define RADIO_PCNF0_PLEN_16bit              (0x01UL)
+#define RADIO_PCNF0_S1INCL_Pos              (20UL)
+#define RADIO_PCNF0_S1INCL_Msk              (0x1UL << RADIO_PCNF0_S1INCL_Pos)
+#define RADIO_PCNF0_S1INCL_Automatic        (0x00UL)
+#define RADIO_PCNF0_S1INCL_Include          (0x01UL)
+#define RADIO_PCNF0_S1LEN_Pos               (16UL)
+#define RADIO_PCNF0_S1LEN_Msk               (0xFUL << RADIO_PCNF0_S1LEN_Pos)
+#define RADIO_PCNF0_S0LEN_Pos               (8UL)
+#define RADIO_PCNF0_S0LEN_Msk               (0x1UL << RADIO_PCNF0_S0LEN_Pos)
+#define RADIO_PCNF0_LFLEN_Pos               (0UL)
+#define RADIO_PCNF0_LFLEN_Msk               (0xFUL << RADIO_PCNF0_LFLEN_Pos)
+
+#define RADIO_PCNF1_WHITEEN_Pos             (25UL)
+#define RADIO_PCNF1_WHITEEN_Msk             (0x1UL << RADIO_PCNF1_WHITEEN_Pos)
+#define RADIO_PCNF1_WHITEEN_Disabled        (0UL)
+#define RADIO_PCNF1_WHITEEN_Enabled         (1UL)
+#define RADIO_PCNF1_ENDIAN_Pos              (24UL)
+#define RADIO_PCNF1_ENDIAN_Msk              (0x1UL << RADIO_PCNF1_ENDIAN_Pos)
+#define RADIO_PCNF1_ENDIAN_Little           (0UL)
+#define RADIO_PCNF1_ENDIAN_Big              (1UL)
+#define RADIO_PCNF1_BALEN_Pos               (16UL)
+#define RADIO_PCNF1_BALEN_Msk               (0x7UL << RADIO_PCNF1_BALEN_Pos)
+#define RADIO_PCNF1_STATLEN_Pos             (8UL)
+#define RADIO_PCNF1_STATLEN_Msk             (0xFFUL << RADIO_PCNF1_STATLEN_Pos)
+#define RADIO_PCNF1_MAXLEN_Pos              (0UL)
+#define RADIO_PCNF1_MAXLEN_Msk              (0xFFUL << RADIO_PCNF1_MAXLEN_Pos)
+
+#define RADIO_CRCCNF_SKIPADDR_Pos           (8UL)
+#define RADIO_CRCCNF_SKIPADDR_Msk           (0x1UL << RADIO_CRCCNF_SKIPADDR_Pos)
+#define RADIO_CRCCNF_SKIPADDR_Include       (0UL)
+#define RADIO_CRCCNF_SKIPADDR_Skip          (1UL)
+#define RADIO_CRCCNF_LEN_Pos                (0UL)
+#define RADIO_CRCCNF_LEN_Msk                (0x3UL << RADIO_CRCCNF_LEN_Pos)
+#define RADIO_CRCCNF_LEN_Disabled           (0UL)
+#define RADIO_CRCCNF_LEN_One                (1UL)
+#define RADIO_CRCCNF_LEN_Two                (2UL)
+#define RADIO_CRCCNF_LEN_Three              (3UL)
+
+#define RADIO_CRCPOLY_CRCPOLY_Pos           (0UL)
+#define RADIO_CRCPOLY_CRCPOLY_Msk           (0xFFFFFFUL << RADIO_CRCPOLY_CRCPOLY_Pos)
+
+#define RADIO_CRCINIT_CRCINIT_Pos           (0UL)
+#define RADIO_CRCINIT_CRCINIT_Msk           (0xFFFFFFUL << RADIO_CRCINIT_CRCINIT_Pos)
+
+#define RADIO_STATE_STATE_Pos               (0UL)
+#define RADIO_STATE_STATE_Msk               (0xFUL << RADIO_STATE_STATE_Pos)
+#define RADIO_STATE_STATE_Disabled          (0x00UL)
+#define RADIO_STATE_STATE_RxRu              (0x01UL)
+#define RADIO_STATE_STATE_RxIdle            (0x02UL)
+#define RADIO_STATE_STATE_Rx                (0x03UL)
+#define RADIO_STATE_STATE_RxDisable         (0x04UL)
+#define RADIO_STATE_STATE_TxRu              (0x09UL)
+#define RADIO_STATE_STATE_TxIdle            (0x0AUL)
+#define RADIO_STATE_STATE_Tx                (0x0BUL)
+#define RADIO_STATE_STATE_TxDisable         (0x0CUL)
+
+#define RADIO_DATAWHITEIV_DATAWHITEIV_Pos   (0UL)
+#define RADIO_DATAWHITEIV_DATAWHITEIV_Msk   (0x7FUL << RADIO_DATAWHITEIV_DATAWHITEIV_Pos)
+
+#define RADIO_POWER_POWER_Pos               (0UL)
+#define RADIO_POWER_POWER_Msk               (0x1UL << RADIO_POWER_POWER_Pos)
+#define RADIO_POWER_POWER_Disabled          (0UL)
+#define RADIO_POWER_POWER_Enabled           (1UL)
+
+/* Peripheral: TIMER */
+#define TIMER_INTENSET_COMPARE0_Pos         (16UL)
+#define TIMER_INTENSET_COMPARE0_Msk         (0x1UL << TIMER_INTENSET_COMPARE0_Pos)
+#define TIMER_INTENCLR_COMPARE0_Pos         (16UL)
+#define TIMER_INTENCLR_COMPARE0_Msk         (0x1UL << TIMER_INTENCLR_COMPARE0_Pos)
+
+#endif /* NRF51_BITFIELDS_H */
@@ -0,0 +1,1337 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+/**
+* @file Multi-node mesh simulator. Runs a set of simulated nRF51 nodes in one
+*   discrete event loop, connected through a shared radio medium with a
+*   configurable topology, per-link loss and collisions, and measures how long
+*   it takes for value updates to reach every node.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <dlfcn.h>
+#include <libgen.h>
+#include <limits.h>
+
+#include "sim_node.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define SIM_ACCESS_ADDR             (0x8E89BED6)    /**< BLE advertising access address */
+#define SIM_CHANNEL                 (38)
+#define SIM_RSSI_DEFAULT            (60)            /**< RSSISAMPLE of a link in the fixed topologies, -dBm */
+#define SIM_RSSI_MIN                (40)            /**< RSSISAMPLE of the strongest link in the random topology */
+#define SIM_RSSI_RANGE              (50)            /**< RSSISAMPLE span in the random topology */
+#define SIM_BOOT_SPREAD_US          (10000)         /**< Nodes boot at a random time within this window */
+#define SIM_VALUE_LEN_MIN           (4)
+#define SIM_VALUE_LEN_MAX           (255)
+#define SIM_TIME_SYNC_SAMPLE_US     (100000)        /**< Interval between mesh clock samples */
+
+/*****************************************************************************
+* Local typedefs
+*****************************************************************************/
+typedef enum
+{
+    TOPOLOGY_FULL,
+    TOPOLOGY_LINE,
+    TOPOLOGY_GRID,
+    TOPOLOGY_RANDOM
+} topology_t;
+
+typedef struct
+{
+    uint32_t    node_count;
+    topology_t  topology;
+    double      radius;             /**< Link range in the random topology, unit square */
+    double      loss;               /**< Packet loss probability per link */
+    double      jam_loss[SIM_ADV_CHANNEL_COUNT]; /**< Additional loss probability on advertisement channels 37 to 39 */
+    bool        collisions;
+    uint32_t    handle_count;
+    uint32_t    update_count;       /**< Updates per handle */
+    uint32_t    value_len;          /**< Length of every value set */
+    uint32_t    update_spacing_ms;
+    uint32_t    interval_min_ms;
+    uint32_t    phy_mbit;           /**< Radio PHY, 1 or 2 Mbit */
+    uint32_t    cache_entries;      /**< Cache entries per node, 0 for the compile-time sizes */
+    uint32_t    fast_interval_min_ms; /**< Imin of the trickle profile given to handle 0, or 0 for none */
+    uint32_t    ts_latency_us;
+    uint32_t    warmup_ms;
+    uint32_t    duration_ms;        /**< Run time limit after the last update */
+    uint32_t    rejoin_ms;          /**< Time the last node is off the air after the last update, or 0 */
+    bool        reboot;             /**< The last node reboots from its flash when it returns */
+    uint32_t    time_sync_ms;       /**< Minimum run time with node 0 as time sync root, or 0 for no time sync */
+    uint32_t    clock_ppm;          /**< Largest node clock error */
+    uint32_t    run_count;
+    uint32_t    seed;
+    bool        verbose;
+    bool        latency;            /**< Print the receive path latency histograms */
+    const char* p_lib_path;
+    const char* p_trace_path;       /**< File to write node 0's trace to, or NULL */
+} options_t;
+
+typedef struct
+{
+    void*                     p_lib;
+    sim_node_init_t           init;
+    sim_node_next_event_get_t next_event_get;
+    sim_node_run_t            run;
+    sim_node_rx_start_t       rx_start;
+    sim_node_rx_end_t         rx_end;
+    sim_node_value_set_t      value_set;
+    sim_node_stats_get_t      stats_get;
+    sim_node_time_get_t       time_get;
+    sim_node_trace_read_t     trace_read;
+    sim_node_latency_get_t    latency_get;
+    sim_node_value_get_t      value_get;
+    sim_node_flash_read_t     flash_read;
+    const uint8_t*            p_flash;      /**< Flash image to boot with, or NULL */
+    bool                      booted;
+    uint64_t                  boot_time;
+    uint64_t                  next_event;
+} node_t;
+
+typedef struct
+{
+    uint32_t node;
+    bool     collided;
+    bool     lost;
+} tx_rx_t;
+
+typedef struct
+{
+    uint32_t id;
+    uint32_t src;
+    uint64_t end;
+    uint8_t  frequency;
+    bool     aborted;
+    uint32_t rx_count;
+    tx_rx_t* p_rx;
+} tx_t;
+
+typedef struct
+{
+    uint64_t converged_time;        /**< Time from last update until all nodes had all values, or SIM_TIME_NEVER */
+    uint64_t first_converged_time;  /**< Time from last update of handle 0 until all nodes had it, or SIM_TIME_NEVER */
+    uint32_t packets;
+    uint32_t delivered;
+    uint32_t collided;
+    uint32_t lost;
+    uint32_t aborted;
+    sim_node_stats_t nodes;         /**< Sum over all nodes */
+    uint32_t pool_high_water_mark;  /**< Max over all nodes */
+    uint32_t restored;              /**< Values the rebooted node got back from its flash */
+} run_stats_t;
+
+/** Mesh clock error of the nodes at one hop distance from the root, over all runs. */
+typedef struct
+{
+    uint32_t samples;               /**< Samples of a node in a timeslot */
+    uint32_t synced;                /**< Samples of a node with a mesh clock */
+    uint64_t error_sum;             /**< Sum of the absolute errors of the synced samples, microseconds */
+    uint32_t error_max;
+} sync_stats_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static options_t    m_opts =
+{
+    .node_count = 10,
+    .topology = TOPOLOGY_LINE,
+    .radius = 0.3,
+    .loss = 0.0,
+    .collisions = true,
+    .handle_count = 1,
+    .update_count = 1,
+    .value_len = SIM_VALUE_LEN_MIN,
+    .update_spacing_ms = 1000,
+    .interval_min_ms = 100,
+    .phy_mbit = 1,
+    .cache_entries = 0,
+    .fast_interval_min_ms = 0,
+    .ts_latency_us = 200,
+    .warmup_ms = 500,
+    .duration_ms = 60000,
+    .rejoin_ms = 0,
+    .reboot = false,
+    .time_sync_ms = 0,
+    .clock_ppm = 0,
+    .run_count = 1,
+    .seed = 1,
+    .verbose = false,
+    .latency = false,
+    .p_lib_path = NULL,
+    .p_trace_path = NULL
+};
+
+static node_t*      mp_nodes;
+static uint8_t*     mp_links;       /**< RSSI of each link, node_count x node_count, 0 if out of range */
+static tx_t*        mp_txs;         /**< Packets on air, at most one per node */
+static uint32_t     m_tx_count;
+static uint32_t     m_tx_id;
+static uint64_t     m_now;
+static uint64_t     m_rand_state;
+static run_stats_t  m_run;
+
+static uint32_t*    mp_hops;        /**< Hops from node 0 */
+static sync_stats_t* mp_sync_stats; /**< Indexed by hops from node 0 */
+static uint32_t*    mp_values;      /**< Latest value each node has seen, node_count x handle_count */
+static uint32_t*    mp_latest;      /**< Latest value set for each handle */
+static uint32_t     m_up_to_date;   /**< Number of node/handle pairs with the latest value */
+static uint32_t     m_first_up_to_date; /**< Number of nodes with the latest value of handle 0 */
+static bool         m_offline;      /**< The last node is off the air */
+static uint8_t      m_flash[SIM_FLASH_SIZE]; /**< Flash image of the rebooting node */
+static char         m_lib_dir[PATH_MAX];
+static FILE*        mp_trace_file;  /**< Node 0's trace of the first run, if requested */
+static uint32_t     m_trace_entries;
+static uint32_t     m_trace_dropped;
+static uint64_t     m_latency[SIM_LATENCY_STAGE_COUNT][SIM_LATENCY_BUCKET_COUNT]; /**< Sum over all nodes and runs */
+static bool         m_latency_supported = true;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint32_t rand_u32(void)
+{
+    /* xorshift64* */
+    m_rand_state ^= m_rand_state >> 12;
+    m_rand_state ^= m_rand_state << 25;
+    m_rand_state ^= m_rand_state >> 27;
+    return (uint32_t) ((m_rand_state * 2685821657736338717ULL) >> 32);
+}
+
+static double rand_unit(void)
+{
+    return rand_u32() / 4294967296.0;
+}
+
+static uint8_t* link_get(uint32_t from, uint32_t to)
+{
+    return &mp_links[from * m_opts.node_count + to];
+}
+
+static void topology_build(void)
+{
+    uint32_t n = m_opts.node_count;
+    uint32_t columns = (uint32_t) ceil(sqrt(n));
+    double* p_x = calloc(n, sizeof(double));
+    double* p_y = calloc(n, sizeof(double));
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        p_x[i] = rand_unit();
+        p_y[i] = rand_unit();
+    }
+
+    memset(mp_links, 0, n * n);
+    for (uint32_t a = 0; a < n; ++a)
+    {
+        for (uint32_t b = 0; b < n; ++b)
+        {
+            if (a == b)
+            {
+                continue;
+            }
+            switch (m_opts.topology)
+            {
+                case TOPOLOGY_FULL:
+                    *link_get(a, b) = SIM_RSSI_DEFAULT;
+                    break;
+                case TOPOLOGY_LINE:
+                    if (a + 1 == b || b + 1 == a)
+                    {
+                        *link_get(a, b) = SIM_RSSI_DEFAULT;
+                    }
+                    break;
+                case TOPOLOGY_GRID:
+                {
+                    uint32_t dx = abs((int) (a % columns) - (int) (b % columns));
+                    uint32_t dy = abs((int) (a / columns) - (int) (b / columns));
+                    if (dx + dy == 1)
+                    {
+                        *link_get(a, b) = SIM_RSSI_DEFAULT;
+                    }
+                    break;
+                }
+                case TOPOLOGY_RANDOM:
+                {
+                    double dist = hypot(p_x[a] - p_x[b], p_y[a] - p_y[b]);
+                    if (dist < m_opts.radius)
+                    {
+                        *link_get(a, b) = SIM_RSSI_MIN + (uint8_t) (SIM_RSSI_RANGE * dist / m_opts.radius);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    free(p_x);
+    free(p_y);
+}
+
+/** Find the hop distance of every node to node 0. Unreachable nodes get node_count. */
+static void hops_find(void)
+{
+    uint32_t n = m_opts.node_count;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        mp_hops[i] = n;
+    }
+    mp_hops[0] = 0;
+    for (uint32_t hops = 0; hops < n; ++hops)
+    {
+        for (uint32_t a = 0; a < n; ++a)
+        {
+            for (uint32_t b = 0; b < n && mp_hops[a] == hops; ++b)
+            {
+                if (*link_get(a, b) && mp_hops[b] == n)
+                {
+                    mp_hops[b] = hops + 1;
+                }
+            }
+        }
+    }
+}
+
+/** Compare the mesh clock of every node to the root's. */
+static void time_sync_sample(void)
+{
+    uint32_t root_time;
+    uint8_t root_hops;
+    if (!mp_nodes[0].booted || !mp_nodes[0].time_get(m_now, &root_time, &root_hops))
+    {
+        return; /* no reference */
+    }
+    for (uint32_t i = 1; i < m_opts.node_count; ++i)
+    {
+        uint32_t time;
+        uint8_t hops;
+        if (!mp_nodes[i].booted || mp_hops[i] == m_opts.node_count)
+        {
+            continue;
+        }
+        sync_stats_t* p_stats = &mp_sync_stats[mp_hops[i]];
+        if (mp_nodes[i].time_get(m_now, &time, &hops))
+        {
+            uint32_t error = abs((int32_t) (time - root_time));
+            p_stats->synced++;
+            p_stats->error_sum += error;
+            p_stats->error_max = (error > p_stats->error_max) ? error : p_stats->error_max;
+        }
+        p_stats->samples++;
+    }
+}
+
+/** Move node 0's trace entries to the trace file. */
+static void trace_drain(void)
+{
+    uint8_t buffer[64 * SIM_TRACE_ENTRY_LEN];
+    uint32_t count;
+    while ((count = mp_nodes[0].trace_read(buffer, 64, &m_trace_dropped)) > 0)
+    {
+        fwrite(buffer, SIM_TRACE_ENTRY_LEN, count, mp_trace_file);
+        m_trace_entries += count;
+    }
+}
+
+/** Update the node's next event time, after it has run. */
+static void node_refresh(uint32_t node)
+{
+    node_t* p_node = &mp_nodes[node];
+    if (node == 0 && p_node->booted && mp_trace_file != NULL)
+    {
+        trace_drain();
+    }
+    p_node->next_event = p_node->booted ? p_node->next_event_get() : p_node->boot_time;
+}
+
+static tx_t* tx_find(uint32_t src)
+{
+    for (uint32_t i = 0; i < m_tx_count; ++i)
+    {
+        if (mp_txs[i].src == src)
+        {
+            return &mp_txs[i];
+        }
+    }
+    return NULL;
+}
+
+/** Index of the advertisement channel on the given RADIO FREQUENCY, or -1. */
+static int32_t adv_channel_index(uint8_t frequency)
+{
+    switch (frequency)
+    {
+        case 2:  return 0;
+        case 26: return 1;
+        case 80: return 2;
+        default: return -1;
+    }
+}
+
+/*****************************************************************************
+* Node callbacks
+*****************************************************************************/
+static void core_tx_start(uint32_t node_id, const sim_air_packet_t* p_packet, uint32_t duration_us)
+{
+    if (tx_find(node_id) != NULL)
+    {
+        fprintf(stderr, "node %u started a second transmission\n", node_id);
+        abort();
+    }
+
+    tx_t* p_tx = &mp_txs[m_tx_count++];
+    p_tx->id = ++m_tx_id;
+    p_tx->src = node_id;
+    p_tx->end = m_now + duration_us;
+    p_tx->frequency = p_packet->frequency;
+    p_tx->aborted = false;
+    p_tx->rx_count = 0;
+    m_run.packets++;
+    if (m_offline && node_id == m_opts.node_count - 1)
+    {
+        return; /* nobody hears it */
+    }
+
+    double loss = m_opts.loss;
+    int32_t adv_channel = adv_channel_index(p_tx->frequency);
+    if (adv_channel >= 0 && m_opts.jam_loss[adv_channel] > 0.0)
+    {
+        loss = 1.0 - (1.0 - loss) * (1.0 - m_opts.jam_loss[adv_channel]);
+    }
+
+    /* the new packet destroys the ones already on air at the receivers it reaches */
+    for (uint32_t i = 0; i + 1 < m_tx_count && m_opts.collisions; ++i)
+    {
+        if (mp_txs[i].frequency == p_tx->frequency)
+        {
+            for (uint32_t r = 0; r < mp_txs[i].rx_count; ++r)
+            {
+                if (*link_get(node_id, mp_txs[i].p_rx[r].node))
+                {
+                    mp_txs[i].p_rx[r].collided = true;
+                }
+            }
+        }
+    }
+
+    for (uint32_t node = 0; node < m_opts.node_count; ++node)
+    {
+        uint8_t rssi = *link_get(node_id, node);
+        if (rssi == 0 || !mp_nodes[node].booted || (m_offline && node == m_opts.node_count - 1))
+        {
+            continue;
+        }
+
+        bool collided = false;
+        for (uint32_t i = 0; i + 1 < m_tx_count && m_opts.collisions; ++i)
+        {
+            if (mp_txs[i].frequency == p_tx->frequency &&
+                *link_get(mp_txs[i].src, node))
+            {
+                collided = true;
+            }
+        }
+
+        if (mp_nodes[node].rx_start(m_now, p_tx->id, p_packet, rssi))
+        {
+            tx_rx_t* p_rx = &p_tx->p_rx[p_tx->rx_count++];
+            p_rx->node = node;
+            p_rx->collided = collided;
+            p_rx->lost = (loss > 0.0 && rand_unit() < loss);
+            node_refresh(node);
+        }
+    }
+}
+
+static void core_tx_abort(uint32_t node_id)
+{
+    tx_t* p_tx = tx_find(node_id);
+    if (p_tx != NULL)
+    {
+        p_tx->aborted = true;
+    }
+}
+
+/** Value data: the update number, followed by bytes derived from it. */
+static void value_data_fill(uint8_t* p_data, uint32_t value)
+{
+    memcpy(p_data, &value, sizeof(value));
+    for (uint32_t i = sizeof(value); i < m_opts.value_len; ++i)
+    {
+        p_data[i] = (uint8_t) (value * 31 + i);
+    }
+}
+
+static void core_value_update(uint32_t node_id, uint16_t handle, const uint8_t* p_data, uint8_t length)
+{
+    if (handle >= m_opts.handle_count || length != m_opts.value_len)
+    {
+        return;
+    }
+    uint32_t value;
+    memcpy(&value, p_data, sizeof(value));
+    uint8_t expected[SIM_VALUE_LEN_MAX];
+    value_data_fill(expected, value);
+    if (memcmp(p_data, expected, length) != 0)
+    {
+        return;
+    }
+
+    uint32_t* p_value = &mp_values[node_id * m_opts.handle_count + handle];
+    if (*p_value == mp_latest[handle])
+    {
+        m_up_to_date--;
+        m_first_up_to_date -= (handle == 0);
+    }
+    *p_value = value;
+    if (*p_value == mp_latest[handle])
+    {
+        m_up_to_date++;
+        m_first_up_to_date += (handle == 0);
+    }
+}
+
+static const sim_core_cb_t m_core_cb =
+{
+    .tx_start = core_tx_start,
+    .tx_abort = core_tx_abort,
+    .value_update = core_value_update
+};
+
+/*****************************************************************************
+* Run control
+*****************************************************************************/
+static void tx_end(tx_t* p_tx)
+{
+    for (uint32_t r = 0; r < p_tx->rx_count; ++r)
+    {
+        tx_rx_t* p_rx = &p_tx->p_rx[r];
+        bool corrupted = (p_rx->collided || p_rx->lost || p_tx->aborted);
+        if (p_tx->aborted)
+        {
+            m_run.aborted++;
+        }
+        else if (p_rx->collided)
+        {
+            m_run.collided++;
+        }
+        else if (p_rx->lost)
+        {
+            m_run.lost++;
+        }
+        else
+        {
+            m_run.delivered++;
+        }
+        mp_nodes[p_rx->node].rx_end(m_now, p_tx->id, corrupted);
+        node_refresh(p_rx->node);
+    }
+
+    /* keep the receiver array with the slot */
+    tx_t last = mp_txs[--m_tx_count];
+    mp_txs[m_tx_count] = *p_tx;
+    *p_tx = last;
+}
+
+static void value_set(uint32_t handle, uint32_t value)
+{
+    uint8_t data[SIM_VALUE_LEN_MAX];
+    value_data_fill(data, value);
+
+    for (uint32_t node = 0; node < m_opts.node_count; ++node)
+    {
+        if (mp_values[node * m_opts.handle_count + handle] == mp_latest[handle])
+        {
+            m_up_to_date--;
+            m_first_up_to_date -= (handle == 0);
+        }
+    }
+    mp_latest[handle] = value;
+
+    uint32_t error_code = mp_nodes[0].value_set(m_now, handle, data, m_opts.value_len);
+    if (error_code != 0)
+    {
+        fprintf(stderr, "value set on handle %u failed with error 0x%x\n", handle, error_code);
+        exit(EXIT_FAILURE);
+    }
+    node_refresh(0);
+    core_value_update(0, handle, data, m_opts.value_len);
+}
+
+static bool node_load(uint32_t i)
+{
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/node_%u.so", m_lib_dir, i);
+    node_t* p_node = &mp_nodes[i];
+    memset(p_node, 0, sizeof(node_t));
+    p_node->p_lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (p_node->p_lib == NULL)
+    {
+        fprintf(stderr, "%s\n", dlerror());
+        return false;
+    }
+    p_node->init            = (sim_node_init_t)           dlsym(p_node->p_lib, SIM_NODE_SYMBOL_INIT);
+    p_node->next_event_get  = (sim_node_next_event_get_t) dlsym(p_node->p_lib, SIM_NODE_SYMBOL_NEXT_EVENT_GET);
+    p_node->run             = (sim_node_run_t)            dlsym(p_node->p_lib, SIM_NODE_SYMBOL_RUN);
+    p_node->rx_start        = (sim_node_rx_start_t)       dlsym(p_node->p_lib, SIM_NODE_SYMBOL_RX_START);
+    p_node->rx_end          = (sim_node_rx_end_t)         dlsym(p_node->p_lib, SIM_NODE_SYMBOL_RX_END);
+    p_node->value_set       = (sim_node_value_set_t)      dlsym(p_node->p_lib, SIM_NODE_SYMBOL_VALUE_SET);
+    p_node->stats_get       = (sim_node_stats_get_t)      dlsym(p_node->p_lib, SIM_NODE_SYMBOL_STATS_GET);
+    p_node->time_get        = (sim_node_time_get_t)       dlsym(p_node->p_lib, SIM_NODE_SYMBOL_TIME_GET);
+    p_node->trace_read      = (sim_node_trace_read_t)     dlsym(p_node->p_lib, SIM_NODE_SYMBOL_TRACE_READ);
+    p_node->latency_get     = (sim_node_latency_get_t)    dlsym(p_node->p_lib, SIM_NODE_SYMBOL_LATENCY_GET);
+    p_node->value_get       = (sim_node_value_get_t)      dlsym(p_node->p_lib, SIM_NODE_SYMBOL_VALUE_GET);
+    p_node->flash_read      = (sim_node_flash_read_t)     dlsym(p_node->p_lib, SIM_NODE_SYMBOL_FLASH_READ);
+    if (!p_node->init || !p_node->next_event_get || !p_node->run ||
+        !p_node->rx_start || !p_node->rx_end || !p_node->value_set || !p_node->stats_get ||
+        !p_node->time_get || !p_node->trace_read || !p_node->latency_get ||
+        !p_node->value_get || !p_node->flash_read)
+    {
+        fprintf(stderr, "%s: missing node symbols\n", path);
+        return false;
+    }
+    return true;
+}
+
+static bool nodes_load(void)
+{
+    for (uint32_t i = 0; i < m_opts.node_count; ++i)
+    {
+        if (!node_load(i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Power cycle a node: everything but its flash is lost, and it boots again right away. */
+static void node_reboot(uint32_t node)
+{
+    mp_nodes[node].flash_read(m_flash);
+    dlclose(mp_nodes[node].p_lib);
+    if (!node_load(node))
+    {
+        exit(EXIT_FAILURE);
+    }
+    mp_nodes[node].p_flash = m_flash;
+    mp_nodes[node].boot_time = m_now;
+    for (uint32_t handle = 0; handle < m_opts.handle_count; ++handle)
+    {
+        uint32_t* p_value = &mp_values[node * m_opts.handle_count + handle];
+        if (*p_value == mp_latest[handle])
+        {
+            m_up_to_date--;
+            m_first_up_to_date -= (handle == 0);
+        }
+        *p_value = 0;
+    }
+    node_refresh(node);
+}
+
+/** Let the core know about the values a node has from its flash at boot. */
+static void node_values_restore(uint32_t node)
+{
+    for (uint32_t handle = 0; handle < m_opts.handle_count; ++handle)
+    {
+        uint8_t data[SIM_AIR_PACKET_MAX_LEN];
+        uint16_t length = sizeof(data);
+        if (mp_nodes[node].value_get(handle, data, &length) == 0)
+        {
+            core_value_update(node, handle, data, length);
+            m_run.restored++;
+        }
+    }
+}
+
+static void nodes_unload(void)
+{
+    for (uint32_t i = 0; i < m_opts.node_count; ++i)
+    {
+        dlclose(mp_nodes[i].p_lib);
+    }
+}
+
+/** Run one simulation. Returns false if the run could not be set up. */
+static bool run(uint32_t run_index)
+{
+    uint32_t n = m_opts.node_count;
+    m_rand_state = ((uint64_t) m_opts.seed << 32) ^ (run_index + 1) ^ 0x9E3779B97F4A7C15ULL;
+    m_now = 0;
+    m_tx_count = 0;
+    m_tx_id = 0;
+    m_up_to_date = n * m_opts.handle_count;
+    m_first_up_to_date = n;
+    m_offline = false;
+    memset(&m_run, 0, sizeof(m_run));
+    memset(mp_values, 0, n * m_opts.handle_count * sizeof(uint32_t));
+    memset(mp_latest, 0, m_opts.handle_count * sizeof(uint32_t));
+
+    if (!nodes_load())
+    {
+        return false;
+    }
+    topology_build();
+    hops_find();
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        mp_nodes[i].boot_time = rand_u32() % SIM_BOOT_SPREAD_US;
+        node_refresh(i);
+    }
+
+    /* the mesh clocks are sampled over the second half of the time sync run */
+    uint64_t time_sync_end = (uint64_t) m_opts.time_sync_ms * 1000;
+    uint64_t next_sample = (m_opts.time_sync_ms != 0) ? time_sync_end / 2 : SIM_TIME_NEVER;
+
+    uint64_t update_start = (uint64_t) m_opts.warmup_ms * 1000;
+    uint32_t update_total = m_opts.handle_count * m_opts.update_count;
+    uint32_t updates_done = 0;
+    uint64_t last_update_time = 0;
+    uint64_t measure_start = 0;     /**< Time convergence is measured from: the last update, or the rejoin */
+    uint64_t last_first_update_time = 0;
+    m_run.converged_time = SIM_TIME_NEVER;
+    m_run.first_converged_time = SIM_TIME_NEVER;
+
+    while (true)
+    {
+        uint64_t next = SIM_TIME_NEVER;
+        tx_t* p_next_tx = NULL;
+        for (uint32_t i = 0; i < m_tx_count; ++i)
+        {
+            if (mp_txs[i].end < next)
+            {
+                next = mp_txs[i].end;
+                p_next_tx = &mp_txs[i];
+            }
+        }
+
+        uint64_t next_update = SIM_TIME_NEVER;
+        if (updates_done < update_total)
+        {
+            next_update = update_start +
+                (uint64_t) (updates_done / m_opts.handle_count) * m_opts.update_spacing_ms * 1000;
+        }
+
+        uint64_t next_node = SIM_TIME_NEVER;
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            if (mp_nodes[i].next_event < next_node)
+            {
+                next_node = mp_nodes[i].next_event;
+            }
+        }
+
+        uint64_t next_rejoin = SIM_TIME_NEVER;
+        if (m_offline && updates_done == update_total)
+        {
+            next_rejoin = last_update_time + (uint64_t) m_opts.rejoin_ms * 1000;
+        }
+
+        if (next_update < next)
+        {
+            next = next_update;
+        }
+        if (next_rejoin < next)
+        {
+            next = next_rejoin;
+        }
+        if (next_sample < next)
+        {
+            next = next_sample;
+        }
+        if (next_node < next)
+        {
+            next = next_node;
+        }
+
+        if (updates_done == update_total && !m_offline &&
+            next > measure_start + (uint64_t) m_opts.duration_ms * 1000)
+        {
+            break;
+        }
+        m_now = next;
+
+        /* packet ends first, then the application, then the nodes */
+        if (p_next_tx != NULL && p_next_tx->end == m_now)
+        {
+            tx_end(p_next_tx);
+        }
+        else if (next_sample == m_now)
+        {
+            time_sync_sample();
+            next_sample = (m_now + SIM_TIME_SYNC_SAMPLE_US <= time_sync_end) ? m_now + SIM_TIME_SYNC_SAMPLE_US : SIM_TIME_NEVER;
+        }
+        else if (next_rejoin == m_now)
+        {
+            m_offline = false;
+            measure_start = m_now;
+            if (m_opts.reboot)
+            {
+                node_reboot(n - 1);
+            }
+        }
+        else if (next_update == m_now)
+        {
+            if (m_opts.rejoin_ms != 0 && updates_done == update_total - m_opts.handle_count)
+            {
+                /* the last node misses the last round of updates */
+                m_offline = true;
+            }
+            if (updates_done % m_opts.handle_count == 0)
+            {
+                last_first_update_time = m_now;
+            }
+            value_set(updates_done % m_opts.handle_count, updates_done / m_opts.handle_count + 1);
+            updates_done++;
+            last_update_time = m_now;
+            measure_start = m_now;
+        }
+        else
+        {
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                node_t* p_node = &mp_nodes[i];
+                if (p_node->next_event != m_now)
+                {
+                    continue;
+                }
+                if (!p_node->booted)
+                {
+                    sim_node_config_t config =
+                    {
+                        .id = i,
+                        .seed = rand_u32(),
+                        .rtc_offset_ticks = rand_u32(),
+                        .ts_latency_us = m_opts.ts_latency_us,
+                        .access_address = SIM_ACCESS_ADDR,
+                        .channel = SIM_CHANNEL,
+                        .interval_min_ms = m_opts.interval_min_ms,
+                        .phy_mbit = m_opts.phy_mbit,
+                        .cache_entries = m_opts.cache_entries,
+                        .fast_interval_min_ms = m_opts.fast_interval_min_ms,
+                        .clock_ppm = 0,
+                        .time_sync_root = (i == 0 && m_opts.time_sync_ms != 0),
+                        .persistent_handle_count = m_opts.reboot ? m_opts.handle_count : 0,
+                        .p_flash = p_node->p_flash,
+                        .p_core = &m_core_cb
+                    };
+                    if (m_opts.clock_ppm != 0)
+                    {
+                        config.clock_ppm = (int32_t) (rand_u32() % (2 * m_opts.clock_ppm + 1)) - (int32_t) m_opts.clock_ppm;
+                    }
+                    p_node->booted = true;
+                    uint32_t error_code = p_node->init(&config, m_now);
+                    if (error_code != 0)
+                    {
+                        fprintf(stderr, "node %u: mesh init failed with error 0x%x\n", i, error_code);
+                        exit(EXIT_FAILURE);
+                    }
+                    if (p_node->p_flash != NULL)
+                    {
+                        node_values_restore(i);
+                    }
+                }
+                else
+                {
+                    p_node->run(m_now);
+                }
+                node_refresh(i);
+            }
+        }
+
+        if (m_run.first_converged_time == SIM_TIME_NEVER &&
+            updates_done > update_total - m_opts.handle_count &&
+            m_first_up_to_date == n)
+        {
+            m_run.first_converged_time = m_now - last_first_update_time;
+        }
+        if (m_run.converged_time == SIM_TIME_NEVER &&
+            updates_done == update_total && !m_offline && m_up_to_date == n * m_opts.handle_count)
+        {
+            m_run.converged_time = m_now - measure_start;
+        }
+        if (m_run.converged_time != SIM_TIME_NEVER && m_now >= time_sync_end)
+        {
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        sim_node_stats_t stats;
+        mp_nodes[i].stats_get(&stats);
+        m_run.nodes.timeslots           += stats.timeslots;
+        m_run.nodes.tx                  += stats.tx;
+        m_run.nodes.rx_ok               += stats.rx_ok;
+        m_run.nodes.rx_crc_fail         += stats.rx_crc_fail;
+        for (uint32_t c = 0; c < SIM_ADV_CHANNEL_COUNT; ++c)
+        {
+            m_run.nodes.channel_rx_ok[c]       += stats.channel_rx_ok[c];
+            m_run.nodes.channel_rx_crc_fail[c] += stats.channel_rx_crc_fail[c];
+        }
+        m_run.nodes.event_queue_drops   += stats.event_queue_drops;
+        m_run.nodes.radio_queue_drops   += stats.radio_queue_drops;
+        m_run.nodes.app_event_drops     += stats.app_event_drops;
+        m_run.nodes.pool_exhausted      += stats.pool_exhausted;
+        m_run.nodes.trickle_tx          += stats.trickle_tx;
+        m_run.nodes.trickle_suppressed  += stats.trickle_suppressed;
+        m_run.nodes.digest_tx           += stats.digest_tx;
+        m_run.nodes.digest_bucket_resets += stats.digest_bucket_resets;
+        m_run.nodes.snapshot_records    += stats.snapshot_records;
+        m_run.nodes.snapshot_bank_erases += stats.snapshot_bank_erases;
+        if (stats.pool_high_water_mark > m_run.pool_high_water_mark)
+        {
+            m_run.pool_high_water_mark = stats.pool_high_water_mark;
+        }
+        if (m_opts.verbose)
+        {
+            printf("  node %3u: ts %u, tx %u, rx %u ok %u crc fail, drops %u event %u radio %u app, event latency %u us, coalesced %u, pool exhausted %u, pool hwm %u, trickle tx %u suppressed %u\n",
+                    i, stats.timeslots, stats.tx, stats.rx_ok, stats.rx_crc_fail,
+                    stats.event_queue_drops, stats.radio_queue_drops, stats.app_event_drops,
+                    stats.event_max_latency_us, stats.event_coalesced,
+                    stats.pool_exhausted, stats.pool_high_water_mark,
+                    stats.trickle_tx, stats.trickle_suppressed);
+        }
+        for (uint32_t stage = 0; stage < SIM_LATENCY_STAGE_COUNT && m_opts.latency; ++stage)
+        {
+            uint32_t buckets[SIM_LATENCY_BUCKET_COUNT];
+            if (!mp_nodes[i].latency_get(stage, buckets))
+            {
+                m_latency_supported = false;
+                break;
+            }
+            for (uint32_t b = 0; b < SIM_LATENCY_BUCKET_COUNT; ++b)
+            {
+                m_latency[stage][b] += buckets[b];
+            }
+        }
+    }
+    nodes_unload();
+    return true;
+}
+
+/** Bucket a percentile of a latency histogram falls in. */
+static uint32_t latency_percentile_bucket(const uint64_t* p_buckets, uint64_t count, uint32_t percent)
+{
+    uint64_t target = (count * percent + 99) / 100;
+    uint64_t sum = 0;
+    for (uint32_t b = 0; b < SIM_LATENCY_BUCKET_COUNT; ++b)
+    {
+        sum += p_buckets[b];
+        if (sum >= target)
+        {
+            return b;
+        }
+    }
+    return SIM_LATENCY_BUCKET_COUNT - 1;
+}
+
+/** Upper bound of a latency bucket, in microseconds. */
+static uint32_t latency_bucket_high(uint32_t bucket)
+{
+    return (bucket == 0) ? 0 : (1u << bucket) - 1;
+}
+
+/** Print the receive path latency histograms, summed over all nodes and runs. */
+static void latency_report(void)
+{
+    static const char* stage_names[SIM_LATENCY_STAGE_COUNT] =
+    {
+        "rx cb", "dispatch", "tc", "vh rx", "event push", "event get"
+    };
+
+    if (!m_latency_supported)
+    {
+        printf("latency: node library built without RBC_MESH_LATENCY_HISTOGRAMS\n");
+        return;
+    }
+    for (uint32_t stage = 0; stage < SIM_LATENCY_STAGE_COUNT; ++stage)
+    {
+        const uint64_t* p_buckets = m_latency[stage];
+        uint64_t count = 0;
+        uint64_t peak = 0;
+        for (uint32_t b = 0; b < SIM_LATENCY_BUCKET_COUNT; ++b)
+        {
+            count += p_buckets[b];
+            peak = (p_buckets[b] > peak) ? p_buckets[b] : peak;
+        }
+        printf("latency %-10s: %llu samples", stage_names[stage], (unsigned long long) count);
+        if (count == 0)
+        {
+            printf("\n");
+            continue;
+        }
+        printf(", p50 <= %u us, p99 <= %u us\n",
+                latency_bucket_high(latency_percentile_bucket(p_buckets, count, 50)),
+                latency_bucket_high(latency_percentile_bucket(p_buckets, count, 99)));
+        for (uint32_t b = 0; b < SIM_LATENCY_BUCKET_COUNT; ++b)
+        {
+            if (p_buckets[b] == 0)
+            {
+                continue;
+            }
+            uint32_t low = (b == 0) ? 0 : (1u << (b - 1));
+            uint32_t bar = (uint32_t) ((p_buckets[b] * 50 + peak - 1) / peak);
+            if (b == SIM_LATENCY_BUCKET_COUNT - 1)
+            {
+                printf("  %7u -         us %9llu ", low, (unsigned long long) p_buckets[b]);
+            }
+            else
+            {
+                printf("  %7u - %7u us %9llu ", low, latency_bucket_high(b), (unsigned long long) p_buckets[b]);
+            }
+            for (uint32_t j = 0; j < bar; ++j)
+            {
+                putchar('#');
+            }
+            printf("\n");
+        }
+    }
+}
+
+static void run_report(uint32_t run_index)
+{
+    if (m_run.converged_time == SIM_TIME_NEVER)
+    {
+        printf("run %u: not converged after %u ms", run_index, m_opts.duration_ms);
+    }
+    else
+    {
+        printf("run %u: converged in %.3f ms", run_index, m_run.converged_time / 1000.0);
+    }
+    if (m_opts.rejoin_ms != 0)
+    {
+        printf(" from node %u %s", m_opts.node_count - 1, m_opts.reboot ? "rebooting" : "rejoining");
+    }
+    if (m_opts.fast_interval_min_ms != 0 && m_run.first_converged_time != SIM_TIME_NEVER)
+    {
+        printf(" (handle 0 in %.3f ms)", m_run.first_converged_time / 1000.0);
+    }
+    uint32_t queue_drops = m_run.nodes.event_queue_drops + m_run.nodes.radio_queue_drops + m_run.nodes.app_event_drops;
+    printf(", packets on air %u, delivered %u, collided %u, lost %u, aborted %u, "
+           "queue drops %u (event %u, radio %u, app %u), pool exhausted %u, pool hwm %u\n",
+           m_run.packets, m_run.delivered, m_run.collided, m_run.lost, m_run.aborted,
+           queue_drops, m_run.nodes.event_queue_drops, m_run.nodes.radio_queue_drops,
+           m_run.nodes.app_event_drops, m_run.nodes.pool_exhausted, m_run.pool_high_water_mark);
+    if (m_run.nodes.trickle_tx + m_run.nodes.trickle_suppressed > 0)
+    {
+        printf("  trickle: tx %u, suppressed %u (%.1f%%)\n",
+                m_run.nodes.trickle_tx, m_run.nodes.trickle_suppressed,
+                100.0 * m_run.nodes.trickle_suppressed / (m_run.nodes.trickle_tx + m_run.nodes.trickle_suppressed));
+    }
+    if (m_run.nodes.digest_tx > 0)
+    {
+        printf("  digest: tx %u, bucket resets %u\n", m_run.nodes.digest_tx, m_run.nodes.digest_bucket_resets);
+    }
+    if (m_opts.reboot)
+    {
+        printf("  snapshot: records %u, bank erases %u, values restored at reboot %u\n",
+                m_run.nodes.snapshot_records, m_run.nodes.snapshot_bank_erases, m_run.restored);
+    }
+    for (uint32_t c = 0; c < SIM_ADV_CHANNEL_COUNT; ++c)
+    {
+        if (m_run.nodes.channel_rx_ok[c] + m_run.nodes.channel_rx_crc_fail[c] > 0)
+        {
+            printf("  channel %u: rx %u ok %u crc fail\n",
+                    37 + c, m_run.nodes.channel_rx_ok[c], m_run.nodes.channel_rx_crc_fail[c]);
+        }
+    }
+}
+
+/** Give every node a private copy of the node library, so that each gets its own globals when loaded. */
+static bool lib_copies_create(const char* p_lib_path)
+{
+    FILE* p_src = fopen(p_lib_path, "rb");
+    if (p_src == NULL)
+    {
+        perror(p_lib_path);
+        return false;
+    }
+    fseek(p_src, 0, SEEK_END);
+    long size = ftell(p_src);
+    fseek(p_src, 0, SEEK_SET);
+    uint8_t* p_buf = malloc(size);
+    bool success = (fread(p_buf, 1, size, p_src) == (size_t) size);
+    fclose(p_src);
+
+    snprintf(m_lib_dir, sizeof(m_lib_dir), "/tmp/mesh_sim_XXXXXX");
+    success = success && (mkdtemp(m_lib_dir) != NULL);
+    for (uint32_t i = 0; i < m_opts.node_count && success; ++i)
+    {
+        char path[PATH_MAX + 32];
+        snprintf(path, sizeof(path), "%s/node_%u.so", m_lib_dir, i);
+        FILE* p_dst = fopen(path, "wb");
+        success = (p_dst != NULL && fwrite(p_buf, 1, size, p_dst) == (size_t) size);
+        if (p_dst != NULL)
+        {
+            fclose(p_dst);
+        }
+    }
+    free(p_buf);
+    return success;
+}
+
+static void lib_copies_remove(void)
+{
+    for (uint32_t i = 0; i < m_opts.node_count; ++i)
+    {
+        char path[PATH_MAX + 32];
+        snprintf(path, sizeof(path), "%s/node_%u.so", m_lib_dir, i);
+        unlink(path);
+    }
+    rmdir(m_lib_dir);
+}
+
+static void usage(const char* p_name)
+{
+    printf("Usage: %s [options]\n"
+           "  -n <nodes>       number of nodes (default 10)\n"
+           "  -t <topology>    full, line, grid or random (default line)\n"
+           "  -r <radius>      link range for the random topology, in a unit square (default 0.3)\n"
+           "  -l <loss>        packet loss probability per link (default 0)\n"
+           "  -j <ch>:<loss>   additional packet loss on advertisement channel 37, 38 or 39,\n"
+           "                   may be repeated\n"
+           "  -C               disable collisions\n"
+           "  -H <handles>     number of handles updated (default 1)\n"
+           "  -u <updates>     updates per handle (default 1)\n"
+           "  -V <bytes>       length of the values, 4 to 255 (default 4)\n"
+           "  -p <ms>          time between updates (default 1000)\n"
+           "  -i <ms>          mesh interval_min_ms (default 100)\n"
+           "  -P <mbit>        radio PHY, 1 or 2 Mbit (default 1)\n"
+           "  -c <entries>     handle and data cache entries per node, in a runtime arena\n"
+           "                   (default: the compile-time sizes)\n"
+           "  -f <ms>          put handle 0 on a trickle profile with this interval_min_ms\n"
+           "                   (default: all handles on the default profile)\n"
+           "  -g <us>          timeslot request latency (default 200)\n"
+           "  -w <ms>          time from boot to first update (default 500)\n"
+           "  -d <ms>          time limit after the last update (default 60000)\n"
+           "  -O <ms>          keep the last node off the air from the last round of updates\n"
+           "                   until this long after it, and measure convergence from its return\n"
+           "  -B               reboot the last node when it returns, with only its flash left\n"
+           "                   (needs -O, and SIM_CONFIG=-DRBC_MESH_SNAPSHOT=1 to keep values)\n"
+           "  -T <ms>          make node 0 the time sync root, run for at least this long,\n"
+           "                   and measure the mesh clock error over the second half\n"
+           "  -D <ppm>         give each node a random clock error up to this (default 0)\n"
+           "  -R <runs>        number of runs (default 1)\n"
+           "  -s <seed>        random seed (default 1)\n"
+           "  -L <path>        node library (default sim_node.so next to the simulator)\n"
+           "  -X <file>        write node 0's trace of the first run to a file, for\n"
+           "                   tools/trace_decode.py. Needs SIM_CONFIG=-DRBC_MESH_TRACE=1\n"
+           "  -S               print receive path latency histograms over all nodes and runs.\n"
+           "                   Needs SIM_CONFIG=-DRBC_MESH_LATENCY_HISTOGRAMS=1\n"
+           "  -v               print per-node counters\n", p_name);
+}
+
+/*****************************************************************************
+* Main
+*****************************************************************************/
+int main(int argc, char** argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:r:l:j:CH:u:V:p:i:P:c:f:g:w:d:T:D:R:s:L:X:SO:Bvh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': m_opts.node_count = strtoul(optarg, NULL, 0); break;
+            case 't':
+                if      (!strcmp(optarg, "full"))   m_opts.topology = TOPOLOGY_FULL;
+                else if (!strcmp(optarg, "line"))   m_opts.topology = TOPOLOGY_LINE;
+                else if (!strcmp(optarg, "grid"))   m_opts.topology = TOPOLOGY_GRID;
+                else if (!strcmp(optarg, "random")) m_opts.topology = TOPOLOGY_RANDOM;
+                else { usage(argv[0]); return EXIT_FAILURE; }
+                break;
+            case 'r': m_opts.radius = strtod(optarg, NULL); break;
+            case 'l': m_opts.loss = strtod(optarg, NULL); break;
+            case 'j':
+            {
+                char* p_end;
+                uint32_t channel = strtoul(optarg, &p_end, 0);
+                if (channel < 37 || channel >= 37 + SIM_ADV_CHANNEL_COUNT || *p_end != ':')
+                {
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                m_opts.jam_loss[channel - 37] = strtod(p_end + 1, NULL);
+                break;
+            }
+            case 'C': m_opts.collisions = false; break;
+            case 'H': m_opts.handle_count = strtoul(optarg, NULL, 0); break;
+            case 'u': m_opts.update_count = strtoul(optarg, NULL, 0); break;
+            case 'V': m_opts.value_len = strtoul(optarg, NULL, 0); break;
+            case 'p': m_opts.update_spacing_ms = strtoul(optarg, NULL, 0); break;
+            case 'i': m_opts.interval_min_ms = strtoul(optarg, NULL, 0); break;
+            case 'P': m_opts.phy_mbit = strtoul(optarg, NULL, 0); break;
+            case 'c': m_opts.cache_entries = strtoul(optarg, NULL, 0); break;
+            case 'f': m_opts.fast_interval_min_ms = strtoul(optarg, NULL, 0); break;
+            case 'g': m_opts.ts_latency_us = strtoul(optarg, NULL, 0); break;
+            case 'w': m_opts.warmup_ms = strtoul(optarg, NULL, 0); break;
+            case 'd': m_opts.duration_ms = strtoul(optarg, NULL, 0); break;
+            case 'O': m_opts.rejoin_ms = strtoul(optarg, NULL, 0); break;
+            case 'B': m_opts.reboot = true; break;
+            case 'T': m_opts.time_sync_ms = strtoul(optarg, NULL, 0); break;
+            case 'D': m_opts.clock_ppm = strtoul(optarg, NULL, 0); break;
+            case 'R': m_opts.run_count = strtoul(optarg, NULL, 0); break;
+            case 's': m_opts.seed = strtoul(optarg, NULL, 0); break;
+            case 'L': m_opts.p_lib_path = optarg; break;
+            case 'X': m_opts.p_trace_path = optarg; break;
+            case 'S': m_opts.latency = true; break;
+            case 'v': m_opts.verbose = true; break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (m_opts.node_count < 1 || m_opts.handle_count < 1 || m_opts.update_count < 1 ||
+        m_opts.value_len < SIM_VALUE_LEN_MIN || m_opts.value_len > SIM_VALUE_LEN_MAX ||
+        (m_opts.phy_mbit != 1 && m_opts.phy_mbit != 2) ||
+        (m_opts.rejoin_ms != 0 && m_opts.node_count < 2) ||
+        (m_opts.reboot && m_opts.rejoin_ms == 0))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char lib_path[PATH_MAX];
+    if (m_opts.p_lib_path == NULL)
+    {
+        char exe_path[PATH_MAX];
+        ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+        if (len < 0)
+        {
+            perror("readlink");
+            return EXIT_FAILURE;
+        }
+        exe_path[len] = '\0';
+        snprintf(lib_path, sizeof(lib_path), "%s/sim_node.so", dirname(exe_path));
+        m_opts.p_lib_path = lib_path;
+    }
+
+    uint32_t n = m_opts.node_count;
+    mp_nodes = calloc(n, sizeof(node_t));
+    mp_links = calloc(n * n, 1);
+    mp_txs = calloc(n, sizeof(tx_t));
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        mp_txs[i].p_rx = calloc(n, sizeof(tx_rx_t));
+    }
+    mp_hops = calloc(n, sizeof(uint32_t));
+    mp_sync_stats = calloc(n, sizeof(sync_stats_t));
+    mp_values = calloc(n * m_opts.handle_count, sizeof(uint32_t));
+    mp_latest = calloc(m_opts.handle_count, sizeof(uint32_t));
+
+    if (!lib_copies_create(m_opts.p_lib_path))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (m_opts.p_trace_path != NULL)
+    {
+        mp_trace_file = fopen(m_opts.p_trace_path, "wb");
+        if (mp_trace_file == NULL)
+        {
+            perror(m_opts.p_trace_path);
+            lib_copies_remove();
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint32_t converged_runs = 0;
+    uint64_t converged_min = SIM_TIME_NEVER;
+    uint64_t converged_max = 0;
+    uint64_t converged_sum = 0;
+    int result = EXIT_SUCCESS;
+    for (uint32_t i = 0; i < m_opts.run_count; ++i)
+    {
+        if (!run(i))
+        {
+            result = EXIT_FAILURE;
+            break;
+        }
+        run_report(i);
+        if (mp_trace_file != NULL)
+        {
+            fclose(mp_trace_file);
+            mp_trace_file = NULL;
+            printf("trace: %u entries, %u dropped, written to %s\n",
+                    m_trace_entries, m_trace_dropped, m_opts.p_trace_path);
+        }
+        if (m_run.converged_time != SIM_TIME_NEVER)
+        {
+            converged_runs++;
+            converged_sum += m_run.converged_time;
+            converged_min = (m_run.converged_time < converged_min) ? m_run.converged_time : converged_min;
+            converged_max = (m_run.converged_time > converged_max) ? m_run.converged_time : converged_max;
+        }
+    }
+
+    if (m_opts.run_count > 1 && result == EXIT_SUCCESS)
+    {
+        printf("%u/%u runs converged", converged_runs, m_opts.run_count);
+        if (converged_runs > 0)
+        {
+            printf(", convergence min %.3f ms, avg %.3f ms, max %.3f ms",
+                    converged_min / 1000.0, converged_sum / 1000.0 / converged_runs, converged_max / 1000.0);
+        }
+        printf("\n");
+    }
+
+    for (uint32_t hops = 1; hops < n && m_opts.time_sync_ms != 0 && result == EXIT_SUCCESS; ++hops)
+    {
+        sync_stats_t* p_stats = &mp_sync_stats[hops];
+        if (p_stats->samples == 0)
+        {
+            continue;
+        }
+        printf("time sync %2u hops: synced in %.1f%% of %u samples", hops,
+                100.0 * p_stats->synced / p_stats->samples, p_stats->samples);
+        if (p_stats->synced > 0)
+        {
+            printf(", error avg %.1f us, max %u us", (double) p_stats->error_sum / p_stats->synced, p_stats->error_max);
+        }
+        printf("\n");
+    }
+
+    if (m_opts.latency && result == EXIT_SUCCESS)
+    {
+        latency_report();
+    }
+
+    lib_copies_remove();
+    return result;
+}
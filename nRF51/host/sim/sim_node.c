@@ -0,0 +1,1282 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+/**
+* @file Simulated nRF51 node: the softdevice timeslot API and the RADIO, TIMER0,
+*   PPI and RTC0 peripherals, modelled at register level around the unmodified
+*   framework sources.
+*
+*   Simulation time stands still while framework code runs. Task, INTENSET and
+*   INTENCLR writes are therefore collected and acted upon when the code returns
+*   to the simulator, in the order the hardware would need to see them for the
+*   framework's access patterns to make sense: INTENCLR before INTENSET, and
+*   DISABLE before TXEN/RXEN. Disabling the radio is instantaneous, so the
+*   RADIO STATE register always reads Disabled, and TIMER0 CC[3] holds the
+*   current timer value whenever framework code runs, which is what a capture
+*   would have put there.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_node.h"
+
+#include "nrf.h"
+#include "nrf_soc.h"
+#include "nrf_sdm.h"
+#include "ble.h"
+#include "ble_gap.h"
+#include "rbc_mesh.h"
+#include "mesh_gatt.h"
+#include "mesh_packet.h"
+#include "radio_control.h"
+#include "event_handler.h"
+#include "timer.h"
+#include "trace.h"
+#include "latency.h"
+#include "app_error.h"
+
+/* Event handler interrupt, defined in event_handler.c. */
+void QDEC_IRQHandler(void);
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define RADIO_RAMP_UP_US            (140) /**< TXEN/RXEN to READY, nRF51 */
+#define RTC_FREQUENCY               (32768)
+#define RTC_COUNTER_MASK            (0xFFFFFF)
+#define TIMER_CC_COUNT              (4)
+#define PPI_CH_COUNT                (16)
+#define SD_EVT_QUEUE_LENGTH         (8)
+#define RNG_BYTES_AVAILABLE         (64)
+#define ARENA_SIZE                  (256 * 1024) /**< Room for the -c option's caches and packet pool */
+
+#define RADIO_INTEN_EVENTS_MASK     (0x4FF) /**< Events that have an INTEN bit, READY through BCMATCH */
+
+/** Write a register the framework sees as read-only. */
+#define REG_WRITE(reg, value)       (*((volatile uint32_t*) &(reg)) = (value))
+
+/** Truncated register value of a pointer, as the framework writes them to EEP/TEP/PACKETPTR. */
+#define REG_ADDR(p)                 ((uint32_t) (uintptr_t) (p))
+
+#if SIM_FLASH_SIZE != HOST_FLASH_SIZE
+#error "The flash image of the core must match the host flash"
+#endif
+
+/*****************************************************************************
+* Local typedefs
+*****************************************************************************/
+typedef enum
+{
+    SIM_RADIO_DISABLED,
+    SIM_RADIO_RXRU,
+    SIM_RADIO_RXIDLE,
+    SIM_RADIO_RX,
+    SIM_RADIO_TXRU,
+    SIM_RADIO_TXIDLE,
+    SIM_RADIO_TX
+} sim_radio_state_t;
+
+/** Next radio state change, executed at sim_radio_t::action_time. */
+typedef enum
+{
+    SIM_RADIO_ACTION_NONE,
+    SIM_RADIO_ACTION_READY,
+    SIM_RADIO_ACTION_TX_ADDRESS,
+    SIM_RADIO_ACTION_TX_END,
+    SIM_RADIO_ACTION_RX_ADDRESS,
+    SIM_RADIO_ACTION_RX_END
+} sim_radio_action_t;
+
+typedef struct
+{
+    sim_radio_state_t  state;
+    sim_radio_action_t action;
+    uint64_t           action_time;
+    uint32_t           inten;
+    uint64_t           tx_end_time;
+    bool               rx_locked;       /**< Receiving a packet. */
+    bool               rx_corrupted;    /**< The packet being received ended up corrupted on air. */
+    uint32_t           rx_tx_id;
+    uint8_t            rx_rssi;
+    uint8_t            rx_match;
+    uint64_t           address_time;    /**< Time of the last address event, sent or received. */
+    sim_air_packet_t   rx_packet;
+    sim_air_packet_t   tx_packet;
+} sim_radio_t;
+
+typedef struct
+{
+    uint32_t inten;
+    uint32_t cc_shadow[TIMER_CC_COUNT];
+    bool     armed[TIMER_CC_COUNT];
+} sim_timer_t;
+
+typedef struct
+{
+    bool                        session_open;
+    bool                        session_closing;
+    bool                        active;             /**< In timeslot. */
+    bool                        extend_signal;      /**< EXTEND_SUCCEEDED signal is due. */
+    bool                        request_pending;
+    uint64_t                    start;
+    uint64_t                    end;
+    uint32_t                    length;             /**< Granted timeslot length, in node clock microseconds. */
+    uint64_t                    grant_time;
+    uint64_t                    prev_start;
+    nrf_radio_request_t         request;
+    nrf_radio_signal_callback_t signal_cb;
+    uint32_t                    evt_queue[SD_EVT_QUEUE_LENGTH];
+    uint32_t                    evt_head;
+    uint32_t                    evt_tail;
+} sim_sd_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static sim_node_config_t    m_config;
+static uint64_t             m_now;
+static sim_radio_t          m_radio;
+static sim_timer_t          m_timer;
+static uint32_t             m_ppi_chen;
+static sim_sd_t             m_sd;
+static sim_node_stats_t     m_stats;
+static uint32_t             m_rng_state;
+static uint32_t             m_addr_high; /**< Upper half of the node's RAM addresses, for pointers truncated to registers. */
+static uint64_t             m_arena[ARENA_SIZE / sizeof(uint64_t)]; /**< Kept with the node's static memory, to share m_addr_high. */
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void radio_task_disable(void);
+static void radio_task_txen(void);
+static void radio_task_rxen(void);
+static void radio_task_start(void);
+static void radio_task_stop(void);
+
+static void sim_fatal(const char* p_msg)
+{
+    fprintf(stderr, "node %u @ %llu us: %s\n", m_config.id, (unsigned long long) m_now, p_msg);
+    abort();
+}
+
+/** Node clock time that passes over the given simulation time. */
+static uint64_t clock_elapsed(uint64_t duration)
+{
+    return duration + (int64_t) duration * m_config.clock_ppm / 1000000;
+}
+
+/** Simulation time until the node clock has advanced by the given time. */
+static uint64_t clock_duration(uint64_t elapsed)
+{
+    if (m_config.clock_ppm == 0)
+    {
+        return elapsed;
+    }
+    uint64_t duration = elapsed * 1000000 / (1000000 + m_config.clock_ppm);
+    while (clock_elapsed(duration) < elapsed)
+    {
+        duration++;
+    }
+    while (duration > 0 && clock_elapsed(duration - 1) >= elapsed)
+    {
+        duration--;
+    }
+    return duration;
+}
+
+static uint32_t timer_counter(void)
+{
+    return (uint32_t) clock_elapsed(m_now - m_sd.start);
+}
+
+static uint8_t* packetptr_get(void)
+{
+    return (uint8_t*) (uintptr_t) (((uint64_t) m_addr_high << 32) | NRF_RADIO->PACKETPTR);
+}
+
+/** Bits per microsecond for the current RADIO MODE, times two. */
+static uint32_t radio_half_bits_per_us(uint32_t mode)
+{
+    switch (mode & RADIO_MODE_MODE_Msk)
+    {
+        case RADIO_MODE_MODE_Nrf_2Mbit:
+        case RADIO_MODE_MODE_Ble_2Mbit:
+            return 4;
+        case RADIO_MODE_MODE_Nrf_250Kbit:
+            return 1; /* rounded up from 0.5, only used for timing */
+        default:
+            return 2;
+    }
+}
+
+static uint32_t radio_airtime_us(uint32_t bits)
+{
+    uint32_t half_bits_per_us = radio_half_bits_per_us(NRF_RADIO->MODE);
+    return (bits * 2 + half_bits_per_us - 1) / half_bits_per_us;
+}
+
+/** Number of bits from start of preamble to end of address. */
+static uint32_t radio_address_bits(void)
+{
+    uint32_t balen = (NRF_RADIO->PCNF1 & RADIO_PCNF1_BALEN_Msk) >> RADIO_PCNF1_BALEN_Pos;
+    uint32_t preamble_len = ((NRF_RADIO->PCNF0 & RADIO_PCNF0_PLEN_Msk) == 0) ? 1 : 2;
+    return (preamble_len + 1 + balen) * 8;
+}
+
+/** Access address of a logical address, as set up in BASE and PREFIX. */
+static uint32_t radio_logical_address(uint32_t logical)
+{
+    uint32_t balen = (NRF_RADIO->PCNF1 & RADIO_PCNF1_BALEN_Msk) >> RADIO_PCNF1_BALEN_Pos;
+    uint32_t base = (logical == 0) ? NRF_RADIO->BASE0 : NRF_RADIO->BASE1;
+    uint32_t prefixes = (logical < 4) ? NRF_RADIO->PREFIX0 : NRF_RADIO->PREFIX1;
+    uint32_t prefix = (prefixes >> (8 * (logical & 0x03))) & 0xFF;
+    return (prefix << (8 * balen)) | (base >> (32 - 8 * balen));
+}
+
+/** Sizes of the RAM layout of a packet, from PCNF0/PCNF1. */
+static void radio_packet_layout(uint32_t* p_header_len, uint32_t* p_header_bits, uint32_t* p_length_offset)
+{
+    uint32_t s0len = (NRF_RADIO->PCNF0 & RADIO_PCNF0_S0LEN_Msk) >> RADIO_PCNF0_S0LEN_Pos;
+    uint32_t lflen = (NRF_RADIO->PCNF0 & RADIO_PCNF0_LFLEN_Msk) >> RADIO_PCNF0_LFLEN_Pos;
+    uint32_t s1len = (NRF_RADIO->PCNF0 & RADIO_PCNF0_S1LEN_Msk) >> RADIO_PCNF0_S1LEN_Pos;
+    bool s1incl = (NRF_RADIO->PCNF0 & RADIO_PCNF0_S1INCL_Msk);
+    *p_header_len = s0len + (lflen ? 1 : 0) + ((s1len || s1incl) ? 1 : 0);
+    *p_header_bits = s0len * 8 + lflen + s1len;
+    *p_length_offset = s0len;
+}
+
+static uint32_t radio_payload_len(const uint8_t* p_header, uint32_t length_offset)
+{
+    uint32_t lflen = (NRF_RADIO->PCNF0 & RADIO_PCNF0_LFLEN_Msk) >> RADIO_PCNF0_LFLEN_Pos;
+    uint32_t maxlen = (NRF_RADIO->PCNF1 & RADIO_PCNF1_MAXLEN_Msk) >> RADIO_PCNF1_MAXLEN_Pos;
+    uint32_t statlen = (NRF_RADIO->PCNF1 & RADIO_PCNF1_STATLEN_Msk) >> RADIO_PCNF1_STATLEN_Pos;
+    uint32_t length = (lflen ? (p_header[length_offset] & ((1 << lflen) - 1)) : 0) + statlen;
+    return (length > maxlen) ? maxlen : length;
+}
+
+static uint8_t radio_whiteiv(void)
+{
+    if (NRF_RADIO->PCNF1 & RADIO_PCNF1_WHITEEN_Msk)
+    {
+        return NRF_RADIO->DATAWHITEIV & RADIO_DATAWHITEIV_DATAWHITEIV_Msk;
+    }
+    return 0xFF;
+}
+
+/** BLE CRC24, LSB first, over the packet header and payload. */
+static uint32_t radio_crc(const uint8_t* p_data, uint32_t len, uint32_t init)
+{
+    uint32_t crc = init & 0xFFFFFF;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        for (uint32_t bit = 0; bit < 8; ++bit)
+        {
+            uint32_t feedback = ((crc >> 23) ^ (p_data[i] >> bit)) & 0x01;
+            crc = (crc << 1) & 0xFFFFFF;
+            if (feedback)
+            {
+                crc ^= (NRF_RADIO->CRCPOLY & RADIO_CRCPOLY_CRCPOLY_Msk);
+            }
+        }
+    }
+    return crc;
+}
+
+static void radio_action_set(sim_radio_action_t action, uint64_t time)
+{
+    m_radio.action = action;
+    m_radio.action_time = time;
+}
+
+/** Trigger the task a PPI TEP points at. */
+static void ppi_task_trigger(uint32_t task)
+{
+    if (task == REG_ADDR(&NRF_RADIO->TASKS_TXEN))
+    {
+        radio_task_txen();
+    }
+    else if (task == REG_ADDR(&NRF_RADIO->TASKS_RXEN))
+    {
+        radio_task_rxen();
+    }
+    else if (task == REG_ADDR(&NRF_RADIO->TASKS_START))
+    {
+        radio_task_start();
+    }
+    else if (task == REG_ADDR(&NRF_RADIO->TASKS_STOP))
+    {
+        radio_task_stop();
+    }
+    else if (task == REG_ADDR(&NRF_RADIO->TASKS_DISABLE))
+    {
+        radio_task_disable();
+    }
+    else
+    {
+        for (uint32_t i = 0; i < TIMER_CC_COUNT; ++i)
+        {
+            if (task == REG_ADDR(&NRF_TIMER0->TASKS_CAPTURE[i]))
+            {
+                NRF_TIMER0->CC[i] = timer_counter();
+                m_timer.cc_shadow[i] = NRF_TIMER0->CC[i];
+                return;
+            }
+        }
+        sim_fatal("PPI task not simulated");
+    }
+}
+
+/** Generate a peripheral event, and run the PPI channels listening for it. */
+static void event_generate(volatile uint32_t* p_event)
+{
+    *p_event = 1;
+    for (uint32_t ch = 0; ch < PPI_CH_COUNT; ++ch)
+    {
+        if ((m_ppi_chen & (1 << ch)) &&
+            NRF_PPI->CH[ch].EEP == REG_ADDR(p_event))
+        {
+            ppi_task_trigger(NRF_PPI->CH[ch].TEP);
+        }
+    }
+}
+
+static void radio_disabled_enter(void)
+{
+    m_radio.state = SIM_RADIO_DISABLED;
+    radio_action_set(SIM_RADIO_ACTION_NONE, 0);
+    event_generate(&NRF_RADIO->EVENTS_DISABLED);
+    if (NRF_RADIO->SHORTS & RADIO_SHORTS_DISABLED_TXEN_Msk)
+    {
+        radio_task_txen();
+    }
+    else if (NRF_RADIO->SHORTS & RADIO_SHORTS_DISABLED_RXEN_Msk)
+    {
+        radio_task_rxen();
+    }
+}
+
+static void radio_end_enter(void)
+{
+    event_generate(&NRF_RADIO->EVENTS_END);
+    if (NRF_RADIO->SHORTS & RADIO_SHORTS_END_DISABLE_Msk)
+    {
+        radio_disabled_enter();
+    }
+    else if (NRF_RADIO->SHORTS & RADIO_SHORTS_END_START_Msk)
+    {
+        radio_task_start();
+    }
+}
+
+static void radio_task_disable(void)
+{
+    switch (m_radio.state)
+    {
+        case SIM_RADIO_DISABLED:
+            return;
+        case SIM_RADIO_TX:
+            m_config.p_core->tx_abort(m_config.id);
+            break;
+        default:
+            break;
+    }
+    m_radio.rx_locked = false;
+    radio_disabled_enter();
+}
+
+static void radio_task_txen(void)
+{
+    if (m_radio.state == SIM_RADIO_DISABLED)
+    {
+        m_radio.state = SIM_RADIO_TXRU;
+        radio_action_set(SIM_RADIO_ACTION_READY, m_now + RADIO_RAMP_UP_US);
+    }
+}
+
+static void radio_task_rxen(void)
+{
+    if (m_radio.state == SIM_RADIO_DISABLED)
+    {
+        m_radio.state = SIM_RADIO_RXRU;
+        radio_action_set(SIM_RADIO_ACTION_READY, m_now + RADIO_RAMP_UP_US);
+    }
+}
+
+static void radio_task_start(void)
+{
+    if (m_radio.state == SIM_RADIO_TXIDLE)
+    {
+        uint32_t header_len, header_bits, length_offset;
+        radio_packet_layout(&header_len, &header_bits, &length_offset);
+        const uint8_t* p_ram = packetptr_get();
+        uint32_t payload_len = radio_payload_len(p_ram, length_offset);
+        uint32_t crc_len = (NRF_RADIO->CRCCNF & RADIO_CRCCNF_LEN_Msk) >> RADIO_CRCCNF_LEN_Pos;
+
+        sim_air_packet_t* p_packet = &m_radio.tx_packet;
+        p_packet->access_address = radio_logical_address(NRF_RADIO->TXADDRESS);
+        p_packet->frequency = NRF_RADIO->FREQUENCY;
+        p_packet->mode = NRF_RADIO->MODE;
+        p_packet->whiteiv = radio_whiteiv();
+        p_packet->crcinit = NRF_RADIO->CRCINIT & RADIO_CRCINIT_CRCINIT_Msk;
+        p_packet->length = header_len + payload_len;
+        memcpy(p_packet->data, p_ram, p_packet->length);
+
+        uint32_t duration_us = radio_airtime_us(radio_address_bits() + header_bits + (payload_len + crc_len) * 8);
+        m_radio.state = SIM_RADIO_TX;
+        m_radio.tx_end_time = m_now + duration_us;
+        radio_action_set(SIM_RADIO_ACTION_TX_ADDRESS, m_now + radio_airtime_us(radio_address_bits()));
+        m_stats.tx++;
+        m_config.p_core->tx_start(m_config.id, p_packet, duration_us);
+    }
+    else if (m_radio.state == SIM_RADIO_RXIDLE)
+    {
+        m_radio.state = SIM_RADIO_RX;
+        m_radio.rx_locked = false;
+    }
+}
+
+static void radio_task_stop(void)
+{
+    if (m_radio.state == SIM_RADIO_TX)
+    {
+        m_config.p_core->tx_abort(m_config.id);
+        m_radio.state = SIM_RADIO_TXIDLE;
+        radio_action_set(SIM_RADIO_ACTION_NONE, 0);
+    }
+    else if (m_radio.state == SIM_RADIO_RX)
+    {
+        m_radio.state = SIM_RADIO_RXIDLE;
+        m_radio.rx_locked = false;
+        radio_action_set(SIM_RADIO_ACTION_NONE, 0);
+    }
+}
+
+/** Copy a received packet to RAM, and report the result in the registers. */
+static void radio_rx_end(void)
+{
+    uint32_t header_len, header_bits, length_offset;
+    radio_packet_layout(&header_len, &header_bits, &length_offset);
+    sim_air_packet_t* p_packet = &m_radio.rx_packet;
+    uint32_t maxlen = (NRF_RADIO->PCNF1 & RADIO_PCNF1_MAXLEN_Msk) >> RADIO_PCNF1_MAXLEN_Pos;
+    uint32_t payload_len = (p_packet->length > header_len) ? p_packet->length - header_len : 0;
+
+    bool crc_ok = !m_radio.rx_corrupted &&
+                  p_packet->whiteiv == radio_whiteiv() &&
+                  p_packet->crcinit == (NRF_RADIO->CRCINIT & RADIO_CRCINIT_CRCINIT_Msk) &&
+                  payload_len <= maxlen;
+
+    if (payload_len > maxlen)
+    {
+        payload_len = maxlen;
+    }
+    memcpy(packetptr_get(), p_packet->data, header_len + payload_len);
+
+    uint32_t crc = radio_crc(p_packet->data, p_packet->length, p_packet->crcinit);
+    if (!crc_ok)
+    {
+        /* garble the received CRC in a repeatable way */
+        crc = (crc * 2654435761UL + m_radio.rx_tx_id) & 0xFFFFFF;
+        m_stats.rx_crc_fail++;
+    }
+    else
+    {
+        m_stats.rx_ok++;
+    }
+    REG_WRITE(NRF_RADIO->CRCSTATUS, crc_ok ? RADIO_CRCSTATUS_CRCSTATUS_CRCOk : RADIO_CRCSTATUS_CRCSTATUS_CRCError);
+    REG_WRITE(NRF_RADIO->RXCRC, crc);
+
+    m_radio.rx_locked = false;
+    m_radio.state = SIM_RADIO_RXIDLE;
+    radio_end_enter();
+}
+
+static void radio_action_execute(void)
+{
+    sim_radio_action_t action = m_radio.action;
+    radio_action_set(SIM_RADIO_ACTION_NONE, 0);
+
+    switch (action)
+    {
+        case SIM_RADIO_ACTION_READY:
+            m_radio.state = (m_radio.state == SIM_RADIO_TXRU) ? SIM_RADIO_TXIDLE : SIM_RADIO_RXIDLE;
+            event_generate(&NRF_RADIO->EVENTS_READY);
+            if (NRF_RADIO->SHORTS & RADIO_SHORTS_READY_START_Msk)
+            {
+                radio_task_start();
+            }
+            break;
+
+        case SIM_RADIO_ACTION_TX_ADDRESS:
+            m_radio.address_time = m_now;
+            radio_action_set(SIM_RADIO_ACTION_TX_END, m_radio.tx_end_time);
+            event_generate(&NRF_RADIO->EVENTS_ADDRESS);
+            break;
+
+        case SIM_RADIO_ACTION_TX_END:
+            m_radio.state = SIM_RADIO_TXIDLE;
+            radio_end_enter();
+            break;
+
+        case SIM_RADIO_ACTION_RX_ADDRESS:
+            m_radio.address_time = m_now;
+            REG_WRITE(NRF_RADIO->RXMATCH, m_radio.rx_match);
+            event_generate(&NRF_RADIO->EVENTS_ADDRESS);
+            if (NRF_RADIO->SHORTS & RADIO_SHORTS_ADDRESS_RSSISTART_Msk)
+            {
+                REG_WRITE(NRF_RADIO->RSSISAMPLE, m_radio.rx_rssi);
+                event_generate(&NRF_RADIO->EVENTS_RSSIEND);
+            }
+            break;
+
+        case SIM_RADIO_ACTION_RX_END:
+            radio_rx_end();
+            break;
+
+        default:
+            break;
+    }
+}
+
+/** Bring the registers up to date before framework code runs. */
+static void regs_prepare(void)
+{
+    uint64_t rtc = m_config.rtc_offset_ticks + (clock_elapsed(m_now) * RTC_FREQUENCY) / 1000000;
+    REG_WRITE(NRF_RTC0->COUNTER, rtc & RTC_COUNTER_MASK);
+
+    if (m_sd.active)
+    {
+        NRF_TIMER0->CC[3] = timer_counter();
+        m_timer.cc_shadow[3] = NRF_TIMER0->CC[3];
+    }
+}
+
+static void irq_lines_update(void)
+{
+    volatile uint32_t* p_radio_events = &NRF_RADIO->EVENTS_READY;
+    for (uint32_t i = 0; i < 11; ++i)
+    {
+        if ((RADIO_INTEN_EVENTS_MASK & m_radio.inten & (1 << i)) && p_radio_events[i])
+        {
+            NVIC_SetPendingIRQ(RADIO_IRQn);
+        }
+    }
+
+    for (uint32_t i = 0; i < TIMER_CC_COUNT; ++i)
+    {
+        if ((m_timer.inten & (TIMER_INTENSET_COMPARE0_Msk << i)) && NRF_TIMER0->EVENTS_COMPARE[i])
+        {
+            NVIC_SetPendingIRQ(TIMER0_IRQn);
+        }
+    }
+}
+
+/** Act on the register writes framework code made while it ran. */
+static void regs_sync(void)
+{
+    /* PPI */
+    m_ppi_chen = NRF_PPI->CHEN;
+    m_ppi_chen &= ~NRF_PPI->CHENCLR;
+    m_ppi_chen |= NRF_PPI->CHENSET;
+    NRF_PPI->CHENCLR = 0;
+    NRF_PPI->CHENSET = 0;
+    NRF_PPI->CHEN = m_ppi_chen;
+
+    /* TIMER0 */
+    uint32_t intenclr = NRF_TIMER0->INTENCLR;
+    m_timer.inten &= ~intenclr;
+    m_timer.inten |= NRF_TIMER0->INTENSET;
+    NRF_TIMER0->INTENCLR = 0;
+    NRF_TIMER0->INTENSET = 0;
+    for (uint32_t i = 0; i < TIMER_CC_COUNT; ++i)
+    {
+        if (NRF_TIMER0->TASKS_CAPTURE[i])
+        {
+            NRF_TIMER0->TASKS_CAPTURE[i] = 0;
+            if (m_sd.active)
+            {
+                NRF_TIMER0->CC[i] = timer_counter();
+            }
+            m_timer.cc_shadow[i] = NRF_TIMER0->CC[i];
+        }
+        if (NRF_TIMER0->CC[i] != m_timer.cc_shadow[i])
+        {
+            m_timer.cc_shadow[i] = NRF_TIMER0->CC[i];
+            m_timer.armed[i] = (m_sd.active && NRF_TIMER0->CC[i] > timer_counter());
+            /* INTENSET is a plain register here, and only keeps the last of several
+               writes between syncs. The framework enables the interrupt along with
+               every compare value it sets. */
+            if (!(intenclr & (TIMER_INTENSET_COMPARE0_Msk << i)))
+            {
+                m_timer.inten |= (TIMER_INTENSET_COMPARE0_Msk << i);
+            }
+        }
+    }
+    NRF_TIMER0->TASKS_START = 0;
+    NRF_TIMER0->TASKS_STOP = 0;
+    NRF_TIMER0->TASKS_SHUTDOWN = 0;
+    NRF_TIMER0->TASKS_CLEAR = 0;
+
+    /* RADIO */
+    m_radio.inten &= ~NRF_RADIO->INTENCLR;
+    m_radio.inten |= NRF_RADIO->INTENSET;
+    NRF_RADIO->INTENCLR = 0;
+    NRF_RADIO->INTENSET = 0;
+    if (NRF_RADIO->TASKS_DISABLE)
+    {
+        NRF_RADIO->TASKS_DISABLE = 0;
+        radio_task_disable();
+    }
+    if (NRF_RADIO->TASKS_STOP)
+    {
+        NRF_RADIO->TASKS_STOP = 0;
+        radio_task_stop();
+    }
+    if (NRF_RADIO->TASKS_TXEN)
+    {
+        NRF_RADIO->TASKS_TXEN = 0;
+        radio_task_txen();
+    }
+    if (NRF_RADIO->TASKS_RXEN)
+    {
+        NRF_RADIO->TASKS_RXEN = 0;
+        radio_task_rxen();
+    }
+    if (NRF_RADIO->TASKS_START)
+    {
+        NRF_RADIO->TASKS_START = 0;
+        radio_task_start();
+    }
+    NRF_RADIO->TASKS_RSSISTART = 0;
+    NRF_RADIO->TASKS_RSSISTOP = 0;
+    NRF_RADIO->TASKS_BCSTART = 0;
+    NRF_RADIO->TASKS_BCSTOP = 0;
+
+    irq_lines_update();
+}
+
+static void sd_evt_push(uint32_t evt)
+{
+    if (m_sd.evt_head - m_sd.evt_tail >= SD_EVT_QUEUE_LENGTH)
+    {
+        sim_fatal("softdevice event queue overflow");
+    }
+    m_sd.evt_queue[(m_sd.evt_head++) % SD_EVT_QUEUE_LENGTH] = evt;
+}
+
+static void ts_request(nrf_radio_request_t* p_request)
+{
+    m_sd.request = *p_request;
+    m_sd.request_pending = true;
+    if (p_request->request_type == NRF_RADIO_REQ_TYPE_NORMAL &&
+        m_sd.prev_start + clock_duration(p_request->params.normal.distance_us) > m_now + m_config.ts_latency_us)
+    {
+        m_sd.grant_time = m_sd.prev_start + clock_duration(p_request->params.normal.distance_us);
+    }
+    else
+    {
+        m_sd.grant_time = m_now + m_config.ts_latency_us;
+    }
+}
+
+/** End the timeslot, and take the peripherals back from the framework. */
+static void ts_end(void)
+{
+    m_sd.active = false;
+    m_sd.extend_signal = false;
+
+    if (m_radio.state == SIM_RADIO_TX)
+    {
+        m_config.p_core->tx_abort(m_config.id);
+    }
+    m_radio.state = SIM_RADIO_DISABLED;
+    m_radio.rx_locked = false;
+    radio_action_set(SIM_RADIO_ACTION_NONE, 0);
+
+    for (uint32_t i = 0; i < TIMER_CC_COUNT; ++i)
+    {
+        m_timer.armed[i] = false;
+    }
+    NVIC_ClearPendingIRQ(RADIO_IRQn);
+    NVIC_ClearPendingIRQ(TIMER0_IRQn);
+
+    if (m_sd.session_closing)
+    {
+        m_sd.session_closing = false;
+        m_sd.session_open = false;
+        m_sd.request_pending = false;
+        sd_evt_push(NRF_EVT_RADIO_SESSION_CLOSED);
+    }
+    else if (!m_sd.request_pending)
+    {
+        sd_evt_push(NRF_EVT_RADIO_SESSION_IDLE);
+    }
+}
+
+static void ts_signal(uint8_t signal)
+{
+    regs_prepare();
+    nrf_radio_signal_callback_return_param_t* p_ret = m_sd.signal_cb(signal);
+    regs_sync();
+
+    switch (p_ret->callback_action)
+    {
+        case NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE:
+            break;
+        case NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND:
+            /* the simulated softdevice has nothing else to do with the radio */
+            m_sd.length += p_ret->params.extend.length_us;
+            m_sd.end = m_sd.start + clock_duration(m_sd.length);
+            m_sd.extend_signal = true;
+            break;
+        case NRF_RADIO_SIGNAL_CALLBACK_ACTION_END:
+            ts_end();
+            break;
+        case NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END:
+            ts_request(p_ret->params.request.p_next);
+            ts_end();
+            break;
+        default:
+            sim_fatal("invalid signal callback return");
+    }
+}
+
+static void ts_start(void)
+{
+    m_sd.request_pending = false;
+    m_sd.active = true;
+    m_sd.start = m_now;
+    m_sd.prev_start = m_now;
+    m_sd.length = m_sd.request.params.earliest.length_us;
+    if (m_sd.request.request_type == NRF_RADIO_REQ_TYPE_NORMAL)
+    {
+        m_sd.length = m_sd.request.params.normal.length_us;
+    }
+    m_sd.end = m_now + clock_duration(m_sd.length);
+    m_stats.timeslots++;
+
+    /* TIMER0 is reset and started by the softdevice */
+    NRF_TIMER0->INTENSET = 0;
+    NRF_TIMER0->INTENCLR = 0;
+    m_timer.inten = 0;
+    for (uint32_t i = 0; i < TIMER_CC_COUNT; ++i)
+    {
+        NRF_TIMER0->CC[i] = 0;
+        NRF_TIMER0->EVENTS_COMPARE[i] = 0;
+        m_timer.cc_shadow[i] = 0;
+        m_timer.armed[i] = false;
+    }
+    NVIC_ClearPendingIRQ(RADIO_IRQn);
+    NVIC_ClearPendingIRQ(TIMER0_IRQn);
+
+    ts_signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_START);
+}
+
+/** Let the application take the events the framework has for it. */
+static bool app_poll(void)
+{
+    rbc_mesh_event_t evt;
+    if (rbc_mesh_event_get(&evt) != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    switch (evt.type)
+    {
+        case RBC_MESH_EVENT_TYPE_UPDATE_VAL:
+        case RBC_MESH_EVENT_TYPE_NEW_VAL:
+        case RBC_MESH_EVENT_TYPE_CONFLICTING_VAL:
+            m_config.p_core->value_update(m_config.id,
+                    evt.params.rx.value_handle,
+                    evt.params.rx.p_data,
+                    evt.params.rx.data_len);
+            break;
+        default:
+            break;
+    }
+    rbc_mesh_event_release(&evt);
+    return true;
+}
+
+/** Run interrupt handlers and the application until there's nothing left to do. */
+static void dispatch(void)
+{
+    while (true)
+    {
+        if (m_sd.active && m_sd.extend_signal)
+        {
+            m_sd.extend_signal = false;
+            ts_signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_SUCCEEDED);
+        }
+        else if (m_sd.active && NVIC_GetPendingIRQ(RADIO_IRQn))
+        {
+            NVIC_ClearPendingIRQ(RADIO_IRQn);
+            ts_signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_RADIO);
+        }
+        else if (m_sd.active && NVIC_GetPendingIRQ(TIMER0_IRQn))
+        {
+            NVIC_ClearPendingIRQ(TIMER0_IRQn);
+            ts_signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_TIMER0);
+        }
+        else if (NVIC_GetPendingIRQ(QDEC_IRQn) && (g_host_nvic.enabled & (1UL << QDEC_IRQn)))
+        {
+            NVIC_ClearPendingIRQ(QDEC_IRQn);
+            regs_prepare();
+            QDEC_IRQHandler();
+            regs_sync();
+        }
+        else if (m_sd.evt_tail != m_sd.evt_head)
+        {
+            uint32_t evt = m_sd.evt_queue[(m_sd.evt_tail++) % SD_EVT_QUEUE_LENGTH];
+            regs_prepare();
+            rbc_mesh_sd_evt_handler(evt);
+            regs_sync();
+        }
+        else
+        {
+            regs_prepare();
+            bool got_evt = app_poll();
+            regs_sync();
+            if (!got_evt)
+            {
+                break;
+            }
+        }
+    }
+}
+
+/*****************************************************************************
+* Framework event counters
+*****************************************************************************/
+uint32_t __real_radio_order(radio_event_t* p_radio_event);
+uint32_t __real_rbc_mesh_event_push(rbc_mesh_event_t* p_event);
+timestamp_t __real_timer_capture_get(uint8_t timer);
+
+uint32_t __wrap_radio_order(radio_event_t* p_radio_event)
+{
+    uint32_t error_code = __real_radio_order(p_radio_event);
+    if (error_code == NRF_ERROR_NO_MEM)
+    {
+        m_stats.radio_queue_drops++;
+    }
+    return error_code;
+}
+
+uint32_t __wrap_rbc_mesh_event_push(rbc_mesh_event_t* p_event)
+{
+    uint32_t error_code = __real_rbc_mesh_event_push(p_event);
+    if (error_code != NRF_SUCCESS)
+    {
+        m_stats.app_event_drops++;
+    }
+    return error_code;
+}
+
+/** Packet timestamps are captured through PPI, and must match the time the
+  simulated radio generated the address event. */
+timestamp_t __wrap_timer_capture_get(uint8_t timer)
+{
+    timestamp_t time = __real_timer_capture_get(timer);
+    if (m_sd.active &&
+        timer == TIMER_INDEX_RADIO &&
+        time != timer_now() - (timer_counter() - (uint32_t) clock_elapsed(m_radio.address_time - m_sd.start)))
+    {
+        sim_fatal("packet timestamp doesn't match the radio address event");
+    }
+    return time;
+}
+
+/*****************************************************************************
+* Softdevice API
+*****************************************************************************/
+uint32_t sd_softdevice_is_enabled(uint8_t* p_softdevice_enabled)
+{
+    *p_softdevice_enabled = 1;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_enable(ble_enable_params_t* p_ble_enable_params)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t* p_addr)
+{
+    p_addr->addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+    p_addr->addr[0] = (m_config.id >> 0) & 0xFF;
+    p_addr->addr[1] = (m_config.id >> 8) & 0xFF;
+    p_addr->addr[2] = (m_config.id >> 16) & 0xFF;
+    p_addr->addr[3] = (m_config.id >> 24) & 0xFF;
+    p_addr->addr[4] = 0x00;
+    p_addr->addr[5] = 0xC0;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_rand_application_bytes_available_get(uint8_t* p_bytes_available)
+{
+    *p_bytes_available = RNG_BYTES_AVAILABLE;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_rand_application_vector_get(uint8_t* p_buff, uint8_t length)
+{
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        /* xorshift32 */
+        m_rng_state ^= m_rng_state << 13;
+        m_rng_state ^= m_rng_state >> 17;
+        m_rng_state ^= m_rng_state << 5;
+        p_buff[i] = (uint8_t) m_rng_state;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_radio_session_open(nrf_radio_signal_callback_t p_radio_signal_callback)
+{
+    if (m_sd.session_open)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    m_sd.session_open = true;
+    m_sd.session_closing = false;
+    m_sd.signal_cb = p_radio_signal_callback;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_radio_session_close(void)
+{
+    if (!m_sd.session_open)
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+    if (m_sd.active)
+    {
+        /* closed when the timeslot ends */
+        m_sd.session_closing = true;
+    }
+    else
+    {
+        m_sd.session_open = false;
+        m_sd.request_pending = false;
+        sd_evt_push(NRF_EVT_RADIO_SESSION_CLOSED);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_radio_request(nrf_radio_request_t* p_request)
+{
+    if (!m_sd.session_open || m_sd.active || m_sd.request_pending)
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+    ts_request(p_request);
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+* GATT service, not simulated
+*****************************************************************************/
+uint32_t mesh_gatt_init(uint32_t access_address, uint8_t channel, uint32_t interval_min_ms)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_gatt_value_set(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
+{
+    return NRF_SUCCESS;
+}
+
+void mesh_gatt_sd_ble_event_handle(ble_evt_t* p_ble_evt)
+{
+}
+
+/*****************************************************************************
+* Node interface
+*****************************************************************************/
+uint32_t sim_node_init(const sim_node_config_t* p_config, uint64_t now)
+{
+    m_config = *p_config;
+    m_now = now;
+    m_rng_state = p_config->seed ? p_config->seed : 1;
+    if (p_config->p_flash != NULL)
+    {
+        memcpy(g_host_flash, p_config->p_flash, SIM_FLASH_SIZE);
+    }
+    else
+    {
+        memset(g_host_flash, 0xFF, SIM_FLASH_SIZE);
+    }
+
+    /* The framework stores RAM pointers in 32 bit registers. Make sure the
+       upper half can be restored from any of the node's static addresses. */
+    mesh_packet_t* p_packet;
+    mesh_packet_init();
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        sim_fatal("packet pool empty at boot");
+    }
+    m_addr_high = (uint32_t) ((uint64_t) (uintptr_t) &g_host_radio >> 32);
+    if ((uint32_t) ((uint64_t) (uintptr_t) p_packet >> 32) != m_addr_high)
+    {
+        sim_fatal("packet pool and peripherals in different 4GB regions");
+    }
+    mesh_packet_ref_count_dec(p_packet);
+
+    rbc_mesh_init_params_t init_params;
+    memset(&init_params, 0, sizeof(init_params));
+    init_params.access_addr = p_config->access_address;
+    init_params.channel = p_config->channel;
+    init_params.interval_min_ms = p_config->interval_min_ms;
+    init_params.lfclksrc = NRF_CLOCK_LFCLKSRC_XTAL_75_PPM;
+    init_params.tx_power = RBC_MESH_TXPOWER_0dBm;
+    init_params.phy = (p_config->phy_mbit == 2) ? RBC_MESH_PHY_2MBIT : RBC_MESH_PHY_1MBIT;
+    if (p_config->cache_entries != 0)
+    {
+        init_params.p_arena = m_arena;
+        init_params.arena_size = sizeof(m_arena);
+        init_params.handle_cache_entries = p_config->cache_entries;
+        init_params.data_cache_entries = p_config->cache_entries;
+    }
+
+    regs_prepare();
+    uint32_t error_code = rbc_mesh_init(init_params);
+    if (error_code == NRF_SUCCESS && p_config->fast_interval_min_ms != 0)
+    {
+        rbc_mesh_trickle_profile_t profile;
+        rbc_mesh_trickle_profile_get(0, &profile);
+        profile.interval_min_ms = p_config->fast_interval_min_ms;
+        error_code = rbc_mesh_trickle_profile_set(1, &profile);
+        if (error_code == NRF_SUCCESS)
+        {
+            error_code = rbc_mesh_value_trickle_profile_set(0, 1);
+        }
+    }
+    if (error_code == NRF_SUCCESS && p_config->time_sync_root)
+    {
+        error_code = rbc_mesh_time_sync_root_set(true);
+    }
+    regs_sync();
+    dispatch();
+
+    /* the flags are set from the event queue, one at a time */
+    for (uint16_t handle = 0; handle < p_config->persistent_handle_count && error_code == NRF_SUCCESS; ++handle)
+    {
+        regs_prepare();
+        error_code = rbc_mesh_persistence_set(handle, true);
+        regs_sync();
+        dispatch();
+    }
+    return error_code;
+}
+
+uint64_t sim_node_next_event_get(void)
+{
+    uint64_t next = SIM_TIME_NEVER;
+    if (m_sd.request_pending && !m_sd.active)
+    {
+        next = m_sd.grant_time;
+    }
+    if (m_radio.action != SIM_RADIO_ACTION_NONE && m_radio.action_time < next)
+    {
+        next = m_radio.action_time;
+    }
+    if (m_sd.active)
+    {
+        for (uint32_t i = 0; i < TIMER_CC_COUNT; ++i)
+        {
+            if (m_timer.armed[i] && m_sd.start + clock_duration(m_timer.cc_shadow[i]) < next)
+            {
+                next = m_sd.start + clock_duration(m_timer.cc_shadow[i]);
+            }
+        }
+    }
+    return next;
+}
+
+void sim_node_run(uint64_t now)
+{
+    m_now = now;
+    if (m_sd.active && m_now >= m_sd.end)
+    {
+        sim_fatal("timeslot overrun");
+    }
+
+    if (m_sd.request_pending && !m_sd.active && m_sd.grant_time <= m_now)
+    {
+        ts_start();
+    }
+
+    while (m_radio.action != SIM_RADIO_ACTION_NONE && m_radio.action_time <= m_now)
+    {
+        radio_action_execute();
+    }
+
+    if (m_sd.active)
+    {
+        for (uint32_t i = 0; i < TIMER_CC_COUNT; ++i)
+        {
+            if (m_timer.armed[i] && m_sd.start + clock_duration(m_timer.cc_shadow[i]) <= m_now)
+            {
+                m_timer.armed[i] = false;
+                event_generate(&NRF_TIMER0->EVENTS_COMPARE[i]);
+            }
+        }
+    }
+
+    irq_lines_update();
+    dispatch();
+}
+
+bool sim_node_rx_start(uint64_t now, uint32_t tx_id, const sim_air_packet_t* p_packet, uint8_t rssi)
+{
+    m_now = now;
+    if (m_radio.state != SIM_RADIO_RX ||
+        m_radio.rx_locked ||
+        p_packet->frequency != NRF_RADIO->FREQUENCY ||
+        p_packet->mode != NRF_RADIO->MODE)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        if ((NRF_RADIO->RXADDRESSES & (1 << i)) &&
+            radio_logical_address(i) == p_packet->access_address)
+        {
+            m_radio.rx_locked = true;
+            m_radio.rx_corrupted = false;
+            m_radio.rx_tx_id = tx_id;
+            m_radio.rx_rssi = rssi;
+            m_radio.rx_match = i;
+            m_radio.rx_packet = *p_packet;
+            radio_action_set(SIM_RADIO_ACTION_RX_ADDRESS, m_now + radio_airtime_us(radio_address_bits()));
+            return true;
+        }
+    }
+    return false;
+}
+
+void sim_node_rx_end(uint64_t now, uint32_t tx_id, bool corrupted)
+{
+    m_now = now;
+    if (m_radio.state == SIM_RADIO_RX &&
+        m_radio.rx_locked &&
+        m_radio.rx_tx_id == tx_id)
+    {
+        m_radio.rx_corrupted = corrupted;
+        radio_action_set(SIM_RADIO_ACTION_RX_END, m_now);
+    }
+}
+
+uint32_t sim_node_value_set(uint64_t now, uint16_t handle, uint8_t* p_data, uint16_t length)
+{
+    m_now = now;
+    regs_prepare();
+    uint32_t error_code = rbc_mesh_value_set(handle, p_data, length);
+    regs_sync();
+    dispatch();
+    return error_code;
+}
+
+uint32_t sim_node_value_get(uint16_t handle, uint8_t* p_data, uint16_t* p_length)
+{
+    return rbc_mesh_value_get(handle, p_data, p_length);
+}
+
+bool sim_node_time_get(uint64_t now, uint32_t* p_mesh_time, uint8_t* p_hops)
+{
+    m_now = now;
+    if (!m_sd.active)
+    {
+        return false;
+    }
+    regs_prepare();
+    rbc_mesh_time_sync_status_t status;
+    bool is_synced = (rbc_mesh_time_get(p_mesh_time) == NRF_SUCCESS &&
+                      rbc_mesh_time_sync_status_get(&status) == NRF_SUCCESS);
+    *p_hops = status.hops;
+    regs_sync();
+    return is_synced;
+}
+
+void sim_node_stats_get(sim_node_stats_t* p_stats)
+{
+    rbc_mesh_stats_t mesh_stats;
+    if (rbc_mesh_stats_get(&mesh_stats) != NRF_SUCCESS)
+    {
+        memset(&mesh_stats, 0, sizeof(mesh_stats));
+    }
+    m_stats.pool_exhausted = mesh_stats.packet_pool_exhausted;
+    m_stats.pool_high_water_mark = mesh_stats.packet_pool_max_in_use;
+    m_stats.event_queue_drops = mesh_stats.event_queue_drop;
+    m_stats.event_max_latency_us = mesh_stats.event_max_latency_us;
+    m_stats.event_coalesced = mesh_stats.event_coalesced;
+    m_stats.trickle_tx = mesh_stats.trickle_tx;
+    m_stats.trickle_suppressed = mesh_stats.trickle_suppressed;
+    m_stats.digest_tx = mesh_stats.digest_tx;
+    m_stats.digest_bucket_resets = mesh_stats.digest_bucket_resets;
+    m_stats.snapshot_records = mesh_stats.snapshot_records;
+    m_stats.snapshot_bank_erases = mesh_stats.snapshot_bank_erases;
+
+    for (uint32_t i = 0; i < SIM_ADV_CHANNEL_COUNT; ++i)
+    {
+        rbc_mesh_channel_stats_t channel_stats;
+        if (rbc_mesh_channel_stats_get(37 + i, &channel_stats) != NRF_SUCCESS)
+        {
+            memset(&channel_stats, 0, sizeof(channel_stats));
+        }
+        m_stats.channel_rx_ok[i] = channel_stats.rx_ok;
+        m_stats.channel_rx_crc_fail[i] = channel_stats.rx_crc_fail;
+    }
+    *p_stats = m_stats;
+}
+
+uint32_t sim_node_trace_read(uint8_t* p_buffer, uint32_t max_count, uint32_t* p_dropped)
+{
+    uint32_t count = max_count;
+    uint16_t dropped;
+    if (trace_read((trace_entry_t*) p_buffer, &count, &dropped) != NRF_SUCCESS)
+    {
+        return 0;
+    }
+    *p_dropped += dropped;
+    return count;
+}
+
+bool sim_node_latency_get(uint32_t stage, uint32_t* p_buckets)
+{
+    return (latency_histogram_get((latency_stage_t) stage, p_buckets) == NRF_SUCCESS);
+}
+
+void sim_node_flash_read(uint8_t* p_buffer)
+{
+    memcpy(p_buffer, g_host_flash, SIM_FLASH_SIZE);
+}
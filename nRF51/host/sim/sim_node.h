@@ -0,0 +1,189 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef SIM_NODE_H__
+#define SIM_NODE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* @file Interface between the simulator core and a simulated node. Every node
+*   is a private copy of the node library (the mesh framework, the simulated
+*   softdevice and the simulated peripherals), loaded into the simulator
+*   process with its own set of globals. The core owns time and the radio
+*   medium, the node owns everything up to the antenna.
+*/
+
+/** Longest packet a simulated radio may put on air, in bytes (S0 + LENGTH + S1 + payload). */
+#define SIM_AIR_PACKET_MAX_LEN      (3 + 255)
+
+/** Value returned by sim_node_next_event_get() when the node has nothing scheduled. */
+#define SIM_TIME_NEVER              (UINT64_MAX)
+
+/** Symbols the core resolves in each node library. */
+#define SIM_NODE_SYMBOL_INIT            "sim_node_init"
+#define SIM_NODE_SYMBOL_NEXT_EVENT_GET  "sim_node_next_event_get"
+#define SIM_NODE_SYMBOL_RUN             "sim_node_run"
+#define SIM_NODE_SYMBOL_RX_START        "sim_node_rx_start"
+#define SIM_NODE_SYMBOL_RX_END          "sim_node_rx_end"
+#define SIM_NODE_SYMBOL_VALUE_SET       "sim_node_value_set"
+#define SIM_NODE_SYMBOL_STATS_GET       "sim_node_stats_get"
+#define SIM_NODE_SYMBOL_TIME_GET        "sim_node_time_get"
+#define SIM_NODE_SYMBOL_TRACE_READ      "sim_node_trace_read"
+#define SIM_NODE_SYMBOL_LATENCY_GET     "sim_node_latency_get"
+#define SIM_NODE_SYMBOL_VALUE_GET       "sim_node_value_get"
+#define SIM_NODE_SYMBOL_FLASH_READ      "sim_node_flash_read"
+
+#define SIM_TRACE_ENTRY_LEN         (8)
+
+/** Size of a node's flash image, as HOST_FLASH_SIZE. */
+#define SIM_FLASH_SIZE              (16 * 1024)
+
+/** Receive path latency stages and histogram buckets, as in latency.h. */
+#define SIM_LATENCY_STAGE_COUNT     (6)
+#define SIM_LATENCY_BUCKET_COUNT    (16)
+
+/** A packet on air, as seen by the medium. */
+typedef struct
+{
+    uint32_t access_address;            /**< Access address the packet was sent on. */
+    uint8_t  frequency;                 /**< RADIO FREQUENCY register value of the transmitter. */
+    uint8_t  mode;                      /**< RADIO MODE register value of the transmitter. */
+    uint8_t  whiteiv;                   /**< Data whitening IV, or 0xFF if whitening is disabled. */
+    uint32_t crcinit;                   /**< CRC initial value. */
+    uint16_t length;                    /**< Number of bytes in data. */
+    uint8_t  data[SIM_AIR_PACKET_MAX_LEN]; /**< Packet as laid out in RAM by the transmitter. */
+} sim_air_packet_t;
+
+/** Callbacks from a node into the core. */
+typedef struct
+{
+    /** The node started a transmission lasting duration_us. */
+    void (*tx_start)(uint32_t node_id, const sim_air_packet_t* p_packet, uint32_t duration_us);
+    /** The node stopped its ongoing transmission before the end of the packet. */
+    void (*tx_abort)(uint32_t node_id);
+    /** The application on the node got a new value for a handle. */
+    void (*value_update)(uint32_t node_id, uint16_t handle, const uint8_t* p_data, uint8_t length);
+} sim_core_cb_t;
+
+/** Node configuration, given at boot. */
+typedef struct
+{
+    uint32_t             id;                /**< Node index, also used to derive the device address. */
+    uint32_t             seed;              /**< Seed for the softdevice random number generator. */
+    uint32_t             rtc_offset_ticks;  /**< RTC0 value at simulation time 0. */
+    uint32_t             ts_latency_us;     /**< Time from timeslot request to timeslot start. */
+    uint32_t             access_address;    /**< Mesh access address. */
+    uint8_t              channel;           /**< Mesh channel. */
+    uint8_t              phy_mbit;          /**< Radio PHY, 1 or 2 Mbit. */
+    uint32_t             interval_min_ms;   /**< Mesh trickle Imin. */
+    uint16_t             cache_entries;     /**< Handle and data cache entries in a runtime arena, or 0 for the compile-time sizes. */
+    uint32_t             fast_interval_min_ms; /**< Imin of trickle profile 1, which handle 0 is put on, or 0 to keep all handles on the default profile. */
+    int32_t              clock_ppm;         /**< Error of the node's clocks, TIMER0 and RTC0 alike, in parts per million. */
+    bool                 time_sync_root;    /**< Make the node the mesh time synchronization root. */
+    uint16_t             persistent_handle_count; /**< Number of handles, from handle 0, that are made persistent. */
+    const uint8_t*       p_flash;           /**< SIM_FLASH_SIZE byte flash image to boot with, or NULL for erased flash. */
+    const sim_core_cb_t* p_core;            /**< Core callbacks. */
+} sim_node_config_t;
+
+/** Number of BLE advertisement channels, 37 to 39. */
+#define SIM_ADV_CHANNEL_COUNT   (3)
+
+/** Node counters, sampled at the end of a run. */
+typedef struct
+{
+    uint32_t timeslots;             /**< Timeslots started by the simulated softdevice. */
+    uint32_t tx;                    /**< Packets put on air. */
+    uint32_t rx_ok;                 /**< Packets received with valid CRC. */
+    uint32_t rx_crc_fail;           /**< Packets received with invalid CRC. */
+    uint32_t channel_rx_ok[SIM_ADV_CHANNEL_COUNT];       /**< Valid packets per advertisement channel, as counted by the framework. */
+    uint32_t channel_rx_crc_fail[SIM_ADV_CHANNEL_COUNT]; /**< Invalid packets per advertisement channel, as counted by the framework. */
+    uint32_t event_queue_drops;     /**< Events dropped on a full internal event queue, all classes. */
+    uint32_t event_max_latency_us;  /**< Longest internal event queue latency, all classes. */
+    uint32_t event_coalesced;       /**< Internal event pushes folded into an event that was already queued. */
+    uint32_t radio_queue_drops;     /**< Radio events dropped on a full radio queue. */
+    uint32_t app_event_drops;       /**< Application events dropped on a full application event queue. */
+    uint32_t pool_exhausted;        /**< Packet pool acquire attempts that found the pool empty. */
+    uint32_t pool_high_water_mark;  /**< Highest number of packets in use at the same time. */
+    uint32_t trickle_tx;            /**< Trickle timeouts that resulted in a transmission. */
+    uint32_t trickle_suppressed;    /**< Trickle timeouts suppressed by consistent neighbors. */
+    uint32_t digest_tx;             /**< Digest beacons sent. */
+    uint32_t digest_bucket_resets;  /**< Digest buckets that differed from a neighbor's. */
+    uint32_t snapshot_records;      /**< Value records written to the flash snapshot. */
+    uint32_t snapshot_bank_erases;  /**< Flash snapshot compactions started. */
+} sim_node_stats_t;
+
+/** Boot the node and initialize the mesh. Returns the rbc_mesh_init() result. */
+typedef uint32_t (*sim_node_init_t)(const sim_node_config_t* p_config, uint64_t now);
+
+/** Time of the next event the node has scheduled, or SIM_TIME_NEVER. */
+typedef uint64_t (*sim_node_next_event_get_t)(void);
+
+/** Run the node up to and including all its events scheduled at now. */
+typedef void (*sim_node_run_t)(uint64_t now);
+
+/** A packet preamble reaches the node's antenna. Returns true if the node's
+    radio locks on to the packet. */
+typedef bool (*sim_node_rx_start_t)(uint64_t now, uint32_t tx_id, const sim_air_packet_t* p_packet, uint8_t rssi);
+
+/** The end of a packet the node locked on to reaches its antenna. The packet
+    is delivered with a CRC error if corrupted is set. */
+typedef void (*sim_node_rx_end_t)(uint64_t now, uint32_t tx_id, bool corrupted);
+
+/** Set a handle value from the node's application. Returns the rbc_mesh_value_set() result. */
+typedef uint32_t (*sim_node_value_set_t)(uint64_t now, uint16_t handle, uint8_t* p_data, uint16_t length);
+
+/** Get the node counters. */
+typedef void (*sim_node_stats_get_t)(sim_node_stats_t* p_stats);
+
+/** Read the node's mesh clock at now, along with its hops to the time
+    synchronization root. Returns false if the node isn't synchronized, or is
+    between timeslots and has no running clock. */
+typedef bool (*sim_node_time_get_t)(uint64_t now, uint32_t* p_mesh_time, uint8_t* p_hops);
+
+/** Take up to max_count of the oldest entries out of the node's trace ring,
+    as SIM_TRACE_ENTRY_LEN byte records, and add the entries the ring dropped
+    to p_dropped. Returns the number of entries copied, always 0 if the node
+    library is built without RBC_MESH_TRACE. */
+typedef uint32_t (*sim_node_trace_read_t)(uint8_t* p_buffer, uint32_t max_count, uint32_t* p_dropped);
+
+/** Copy the SIM_LATENCY_BUCKET_COUNT bucket latency histogram of a receive
+    path stage. Returns false if the node library is built without
+    RBC_MESH_LATENCY_HISTOGRAMS. */
+typedef bool (*sim_node_latency_get_t)(uint32_t stage, uint32_t* p_buckets);
+
+/** Get a handle value from the node's application. Returns the rbc_mesh_value_get() result. */
+typedef uint32_t (*sim_node_value_get_t)(uint16_t handle, uint8_t* p_data, uint16_t* p_length);
+
+/** Copy the node's SIM_FLASH_SIZE byte flash image, to boot it with later. */
+typedef void (*sim_node_flash_read_t)(uint8_t* p_buffer);
+
+#endif /* SIM_NODE_H__ */
@@ -0,0 +1,152 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "nrf.h"
+#include "nrf_flash.h"
+#include "app_error.h"
+
+/*****************************************************************************
+* Peripheral instances
+*****************************************************************************/
+NRF_FICR_Type g_host_ficr =
+{
+    .DEVICEADDRTYPE = 1,
+    .DEVICEADDR = {0x12345678, 0xC0DE}
+};
+
+NRF_RADIO_Type  g_host_radio;
+NRF_TIMER_Type  g_host_timer0;
+NRF_PPI_Type    g_host_ppi;
+NRF_RTC_Type    g_host_rtc0;
+
+uint8_t         g_host_flash[HOST_FLASH_SIZE] __attribute__((aligned(4096)));
+
+host_nvic_t     g_host_nvic;
+
+CoreDebug_Type  g_host_core_debug;
+static DWT_Type m_host_dwt;
+
+/*****************************************************************************
+* CMSIS replacements
+*****************************************************************************/
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    g_host_nvic.enabled |= (1UL << IRQn);
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    g_host_nvic.enabled &= ~(1UL << IRQn);
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+    g_host_nvic.pending |= (1UL << IRQn);
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    g_host_nvic.pending &= ~(1UL << IRQn);
+}
+
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn)
+{
+    return !!(g_host_nvic.pending & (1UL << IRQn));
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+    g_host_nvic.priority[IRQn] = priority;
+}
+
+DWT_Type* host_dwt_get(void)
+{
+    if ((g_host_core_debug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) &&
+        (m_host_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        m_host_dwt.CYCCNT = (uint32_t) __rdtsc();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        m_host_dwt.CYCCNT = (uint32_t) (ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+    }
+    return &m_host_dwt;
+}
+
+/*****************************************************************************
+* SDK replacements
+*****************************************************************************/
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t* p_file_name)
+{
+    fprintf(stderr, "APP ERROR 0x%x @ %s:%u\n", error_code, (const char*) p_file_name, line_num);
+    abort();
+}
+
+/*****************************************************************************
+* Flash
+*****************************************************************************/
+/** Flash location of an address the framework has kept in 32 bits, as it does
+    on the chip. The upper half is the one of the host flash itself. */
+static uint8_t* host_flash_get(const uint32_t* p_addr, uint32_t size)
+{
+    uintptr_t addr = (uintptr_t) (((uint64_t) (uintptr_t) g_host_flash & 0xFFFFFFFF00000000ULL) |
+                                 (uint32_t) (uintptr_t) p_addr);
+    if (addr < (uintptr_t) g_host_flash || addr + size > (uintptr_t) g_host_flash + HOST_FLASH_SIZE)
+    {
+        fprintf(stderr, "flash access at 0x%08x, %u bytes, is outside the host flash\n",
+                (uint32_t) (uintptr_t) p_addr, size);
+        abort();
+    }
+    return (uint8_t*) addr;
+}
+
+void nrf_flash_erase(uint32_t* page_address, uint32_t size)
+{
+    size = (size + HOST_FLASH_PAGE_SIZE - 1) & ~(HOST_FLASH_PAGE_SIZE - 1);
+    memset(host_flash_get(page_address, size), 0xFF, size);
+}
+
+void nrf_flash_store(uint32_t* p_dest, uint8_t* p_src, uint32_t size, uint32_t offset)
+{
+    uint8_t* p_flash = host_flash_get(p_dest + offset / 4, size);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        p_flash[i] &= p_src[i];
+    }
+}
@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""Decode a binary trace from the mesh framework (RBC_MESH_TRACE).
+
+The input is a sequence of 8 byte little endian entries, as laid out by
+trace_entry_t in rbc_mesh/include/trace.h: a 32 bit timer_now() timestamp in
+microseconds, an 8 bit event id and two arguments of 8 and 16 bits. Such a
+file is written by the simulator (mesh_sim -X), read from the RTT trace
+up-buffer (e.g. with JLinkRTTLogger), or put together from the entries of
+SERIAL_CMD_OPCODE_TRACE_READ responses.
+
+Prints a timeline of the entries with -t, and latency histograms for the
+stages of the framework's hot paths.
+"""
+
+import argparse
+import struct
+import sys
+
+ENTRY = struct.Struct("<IBBH")
+
+# Keep in sync with trace_id_t in rbc_mesh/include/trace.h
+RADIO_TX_START = 0x01
+RADIO_RX_START = 0x02
+RADIO_END = 0x03
+RADIO_DISABLE = 0x04
+TC_TX = 0x10
+RX_BATCH_START = 0x11
+RX_BATCH_END = 0x12
+EVENT_START = 0x20
+EVENT_END = 0x21
+VH_TX_START = 0x30
+VH_TX_END = 0x31
+VH_TX_VALUE = 0x32
+TRICKLE_CONSISTENT = 0x33
+TRICKLE_INCONSISTENT = 0x34
+DATA_ENTRY_ALLOC = 0x35
+TIMER_SCH = 0x40
+TS_SIGNAL_START = 0x50
+TS_SIGNAL_END = 0x51
+TS_START = 0x52
+TS_END = 0x53
+
+EVENT_TYPES = ["timer", "timer_sch", "generic", "packet", "set_flag", "set_trickle_profile"]
+TS_SIGNALS = ["start", "timer0", "radio", "extend_failed", "extend_succeeded"]
+TS_ACTIONS = ["none", "extend", "end", "request_and_end"]
+TIMER_SCH_OPS = ["schedule", "abort", "reschedule"]
+RADIO_RESULTS = ["tx", "rx ok", "rx crc fail"]
+
+
+def lookup(names, index):
+    return names[index] if index < len(names) else str(index)
+
+
+def describe(entry_id, arg0, arg1):
+    if entry_id == RADIO_TX_START:
+        return "radio tx start   ch %u" % arg0
+    if entry_id == RADIO_RX_START:
+        return "radio rx start   ch %u" % arg0
+    if entry_id == RADIO_END:
+        return "radio end        ch %u, %s" % (arg0, lookup(RADIO_RESULTS, arg1))
+    if entry_id == RADIO_DISABLE:
+        return "radio disable"
+    if entry_id == TC_TX:
+        return "tc tx            channel map 0x%02x, length %u" % (arg0, arg1)
+    if entry_id == RX_BATCH_START:
+        return "rx batch start   %u packets" % arg0
+    if entry_id == RX_BATCH_END:
+        return "rx batch end     %u values" % arg0
+    if entry_id == EVENT_START:
+        latency = "unknown" if arg1 == 0xFFFF else "%u us" % arg1
+        return "event start      %s, queued %s" % (lookup(EVENT_TYPES, arg0), latency)
+    if entry_id == EVENT_END:
+        return "event end        %s" % lookup(EVENT_TYPES, arg0)
+    if entry_id == VH_TX_START:
+        return "vh tx start"
+    if entry_id == VH_TX_END:
+        return "vh tx end        %u packets" % arg0
+    if entry_id == VH_TX_VALUE:
+        return "vh tx value      handle 0x%04x" % arg1
+    if entry_id == TRICKLE_CONSISTENT:
+        return "trickle consistent"
+    if entry_id == TRICKLE_INCONSISTENT:
+        return "trickle inconsistent"
+    if entry_id == DATA_ENTRY_ALLOC:
+        return "data entry alloc entry %u%s" % (arg1, ", evicted" if arg0 else "")
+    if entry_id == TIMER_SCH:
+        return "timer sch        %s" % lookup(TIMER_SCH_OPS, arg0)
+    if entry_id == TS_SIGNAL_START:
+        return "ts signal start  %s" % lookup(TS_SIGNALS, arg0)
+    if entry_id == TS_SIGNAL_END:
+        return "ts signal end    %s" % lookup(TS_ACTIONS, arg0)
+    if entry_id == TS_START:
+        return "timeslot start"
+    if entry_id == TS_END:
+        return "timeslot end"
+    return "unknown 0x%02x    %u, %u" % (entry_id, arg0, arg1)
+
+
+def read_entries(files):
+    """Yield (time, id, arg0, arg1), with the 32 bit timestamps unwrapped."""
+    base = 0
+    last = None
+    for f in files:
+        data = f.read()
+        for offset in range(0, len(data) - ENTRY.size + 1, ENTRY.size):
+            timestamp, entry_id, arg0, arg1 = ENTRY.unpack_from(data, offset)
+            if last is not None and timestamp < last and last - timestamp > 0x80000000:
+                base += 1 << 32
+            last = timestamp
+            yield (base + timestamp, entry_id, arg0, arg1)
+
+
+class Histogram(object):
+    def __init__(self, name):
+        self.name = name
+        self.samples = []
+
+    def add(self, value):
+        self.samples.append(value)
+
+    def report(self, out):
+        samples = sorted(self.samples)
+        count = len(samples)
+        out.write("%s: %u samples, min %u us, avg %.1f us, p50 %u us, p99 %u us, max %u us\n" % (
+            self.name, count, samples[0], float(sum(samples)) / count,
+            samples[count // 2], samples[min(count - 1, (count * 99) // 100)], samples[-1]))
+        # power of two buckets
+        buckets = {}
+        for sample in samples:
+            bucket = sample.bit_length()
+            buckets[bucket] = buckets.get(bucket, 0) + 1
+        peak = max(buckets.values())
+        for bucket in range(min(buckets), max(buckets) + 1):
+            low = 0 if bucket == 0 else 1 << (bucket - 1)
+            high = (1 << bucket) - 1
+            n = buckets.get(bucket, 0)
+            out.write("  %7u - %7u us %7u %s\n" % (low, high, n, "#" * ((n * 50 + peak - 1) // peak)))
+
+
+class Stages(object):
+    """Pairs up the start and end of each stage."""
+
+    def __init__(self):
+        self.histograms = {}
+        self.open = {}
+        self.rx_pending = None
+
+    def sample(self, name, value):
+        if name not in self.histograms:
+            self.histograms[name] = Histogram(name)
+        self.histograms[name].add(value)
+
+    def begin(self, key, time):
+        self.open[key] = time
+
+    def end(self, key, name, time):
+        start = self.open.pop(key, None)
+        if start is not None:
+            self.sample(name, time - start)
+
+    def add(self, time, entry_id, arg0, arg1):
+        if entry_id == RADIO_END and arg1 == 1:
+            # the oldest packet waiting for the transport
+            if self.rx_pending is None:
+                self.rx_pending = time
+        elif entry_id == RX_BATCH_START:
+            if self.rx_pending is not None:
+                self.sample("radio rx end -> rx batch start", time - self.rx_pending)
+                self.rx_pending = None
+            self.begin("rx batch", time)
+        elif entry_id == RX_BATCH_END:
+            self.end("rx batch", "rx batch", time)
+        elif entry_id == EVENT_START:
+            if arg1 != 0xFFFF:
+                self.sample("event queue latency", arg1)
+            self.begin(("event", arg0), time)
+        elif entry_id == EVENT_END:
+            self.end(("event", arg0), "event exec %s" % lookup(EVENT_TYPES, arg0), time)
+        elif entry_id == VH_TX_START:
+            self.begin("vh tx", time)
+        elif entry_id == VH_TX_END:
+            self.end("vh tx", "vh tx", time)
+        elif entry_id == TC_TX:
+            if "tc tx" not in self.open:
+                self.begin("tc tx", time)
+        elif entry_id == RADIO_TX_START:
+            self.end("tc tx", "tc tx -> radio tx start", time)
+        elif entry_id == TS_SIGNAL_START:
+            # signals that end the timeslot return without an end entry
+            self.open.pop("ts signal", None)
+            self.begin("ts signal", (time, arg0))
+        elif entry_id == TS_SIGNAL_END:
+            start = self.open.pop("ts signal", None)
+            if start is not None:
+                self.sample("ts signal %s" % lookup(TS_SIGNALS, start[1]), time - start[0])
+        elif entry_id == TS_START:
+            self.begin("timeslot", time)
+        elif entry_id == TS_END:
+            self.end("timeslot", "timeslot", time)
+            # the timer doesn't run between timeslots
+            self.rx_pending = None
+            self.open.pop("tc tx", None)
+
+    def report(self, out):
+        for name in sorted(self.histograms):
+            self.histograms[name].report(out)
+            out.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a mesh framework binary trace.")
+    parser.add_argument("files", nargs="*", help="trace files, in order (default: stdin)")
+    parser.add_argument("-t", "--timeline", action="store_true", help="print every entry")
+    parser.add_argument("-s", "--stage", help="only print histograms whose name contains this")
+    args = parser.parse_args()
+
+    if args.files:
+        files = [open(path, "rb") for path in args.files]
+    else:
+        files = [sys.stdin.buffer if hasattr(sys.stdin, "buffer") else sys.stdin]
+
+    out = sys.stdout
+    stages = Stages()
+    first = None
+    previous = None
+    count = 0
+    for time, entry_id, arg0, arg1 in read_entries(files):
+        if first is None:
+            first = time
+            previous = time
+        if args.timeline:
+            out.write("%12u %+8d  %s\n" % (time - first, time - previous, describe(entry_id, arg0, arg1)))
+        previous = time
+        stages.add(time, entry_id, arg0, arg1)
+        count += 1
+
+    if count == 0:
+        sys.stderr.write("no trace entries\n")
+        return 1
+
+    if args.timeline:
+        out.write("\n")
+    out.write("%u entries over %u us\n\n" % (count, previous - first))
+    if args.stage:
+        stages.histograms = dict((k, v) for k, v in stages.histograms.items() if args.stage in k)
+    stages.report(out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
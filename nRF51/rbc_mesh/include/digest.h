@@ -0,0 +1,66 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _DIGEST_H__
+#define _DIGEST_H__
+#include "rbc_mesh.h"
+#include "mesh_packet.h"
+#include <stdint.h>
+
+/**
+* @file Value version digests. With RBC_MESH_DIGEST, every device broadcasts
+*   beacons on MESH_DIGEST_HANDLE with a trickle timer, each carrying the
+*   digests of some of the buckets the handle storage hashes the handles into.
+*   A device that hears a beacon compares the digests to its own, and resets
+*   the trickle timers of the values in every bucket that differs. Values the
+*   receiver is behind on then get sent by the neighbors that have newer
+*   versions, and values it is ahead on get sent by the receiver itself.
+*   Differences don't speed up the beacons, so the digests keep their pace
+*   while an update propagates.
+*/
+
+/** Digest beacon counters. */
+typedef struct
+{
+    uint32_t tx;                    /**< Beacons sent. */
+    uint32_t bucket_resets;         /**< Buckets that differed from a received beacon's. */
+} digest_stats_t;
+
+void digest_init(void);
+
+/**
+* Process a digest beacon. The caller keeps its reference to the packet.
+*   MUST BE CALLED FROM EVENT HANDLER CONTEXT.
+*/
+void digest_rx(mesh_packet_t* p_packet, uint32_t timestamp);
+
+void digest_stats_get(digest_stats_t* p_stats);
+
+#endif /* _DIGEST_H__ */
@@ -44,12 +44,49 @@ typedef enum
     EVENT_TYPE_TIMER_SCH,
     EVENT_TYPE_GENERIC,
     EVENT_TYPE_PACKET,
-    EVENT_TYPE_SET_FLAG
+    EVENT_TYPE_SET_FLAG,
+    EVENT_TYPE_SET_TRICKLE_PROFILE,
+    EVENT_TYPE__COUNT
 } event_type_t;
 
+/**
+* @brief Event priority classes. Each class has its own queue, and the
+*   dispatcher visits the queues in this order.
+*/
+typedef enum
+{
+    EVENT_CLASS_GENERIC,    /**< EVENT_TYPE_GENERIC, EVENT_TYPE_SET_FLAG and EVENT_TYPE_SET_TRICKLE_PROFILE */
+    EVENT_CLASS_TIMER,      /**< EVENT_TYPE_TIMER_SCH */
+    EVENT_CLASS_PACKET,     /**< EVENT_TYPE_PACKET */
+    EVENT_CLASS_TIMESLOT,   /**< EVENT_TYPE_TIMER, only dispatched inside the timeslot */
+    EVENT_CLASS__COUNT
+} event_class_t;
+
+/** @brief Queue counters for one event class. */
+typedef struct
+{
+    uint32_t pushed;            /**< Number of events queued */
+    uint32_t dropped;           /**< Number of events that didn't fit in the queue */
+    uint32_t flushed;           /**< Number of events discarded at the end of a timeslot */
+    uint32_t coalesced;         /**< Number of pushes folded into an event that was already queued */
+    uint32_t max_latency_us;    /**< Longest time from push to dispatch. Only counts time inside timeslots. */
+    uint16_t depth;             /**< Number of events in the queue right now */
+    uint16_t max_depth;         /**< Highest number of events in the queue at the same time */
+} event_handler_stats_t;
+
 /** @brief callback type for generic asynchronous events */
 typedef void(*generic_cb_t)(void* p_context);
 
+/** @brief Received packet, queued by the radio ISR. */
+typedef struct
+{
+    uint8_t* payload; /* packet to be processed */
+    uint32_t crc;
+    uint32_t timestamp;
+    uint8_t rssi;
+    uint8_t channel;
+} packet_event_t;
+
 /**
 * @brief Asynchronous event type.
 */
@@ -58,13 +95,7 @@ typedef struct
     event_type_t type;
     union
     {
-        struct
-        {
-            uint8_t* payload; /* packet to be processed */
-            uint32_t crc;
-            uint32_t timestamp;
-            uint8_t rssi;
-        } packet;
+        packet_event_t packet;
         struct
         {
             timer_callback_t cb;/*void return */
@@ -87,6 +118,11 @@ typedef struct
             uint8_t flag;
             bool value;
         } set_flag;
+        struct
+        {
+            uint16_t handle;
+            uint8_t profile;
+        } set_trickle_profile;
     } callback;
 } async_event_t;
 
@@ -96,12 +132,26 @@ void event_handler_init(void);
 /** @brief Queue an asynchronous event for execution later */
 uint32_t event_handler_push(async_event_t* evt);
 
+/**
+* @brief Queue a timer scheduler event, unless an event with the same callback
+*   and context is already waiting in the queue. The waiting event is then
+*   dispatched with the earliest timestamp of the requests. Only for
+*   EVENT_TYPE_TIMER_SCH events that are safe to run once for several requests.
+*/
+uint32_t event_handler_push_coalesced(async_event_t* p_evt);
+
 /** @brief called from ts handler upon ts exit */
 void event_handler_on_ts_end(void);
 
 /** @brief called from ts handler upon ts begin */
 void event_handler_on_ts_begin(void);
 
+/** @brief Get a snapshot of the queue counters for the given event class. */
+uint32_t event_handler_stats_get(event_class_t event_class, event_handler_stats_t* p_stats);
+
+/** @brief Get the number of events of the given type executed since init. */
+uint32_t event_handler_executed_count_get(event_type_t event_type);
+
 void event_handler_critical_section_begin(void);
 
 void event_handler_critical_section_end(void);
@@ -36,19 +36,70 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /* specialized function pointer for copying memory between two instances */
 typedef void (*fifo_memcpy)(void* dest, const void* src);
 
+/** Synchronization between the contexts using a fifo. */
+typedef enum
+{
+  FIFO_MODE_LOCKED, /**< Any number of producer and consumer contexts. Interrupts are masked on every access. */
+  FIFO_MODE_SPSC    /**< One producer and one consumer context. Lock-free, the contexts only order their head and tail updates. */
+} fifo_mode_t;
+
 typedef struct
 {
   void* elem_array;
   uint32_t elem_size;
   uint32_t array_len;
-  uint32_t head;
-  uint32_t tail;
+  volatile uint32_t head;
+  volatile uint32_t tail;
   fifo_memcpy memcpy_fptr; /* must be a valid function or NULL */
+  fifo_mode_t mode; /* set before fifo_init. In FIFO_MODE_SPSC, only the consumer may peek or flush. */
 } fifo_t;
 
 void fifo_init(fifo_t* p_fifo);
 uint32_t fifo_push(fifo_t* p_fifo, const void* p_elem);
 uint32_t fifo_pop(fifo_t* p_fifo, void* p_elem);
+
+/**
+* @brief Push an array of elements, either all of them or none.
+*
+* @return NRF_SUCCESS All elements were pushed.
+* @return NRF_ERROR_NULL p_elems was NULL.
+* @return NRF_ERROR_NO_MEM There wasn't room for all elements, nothing was pushed.
+*/
+uint32_t fifo_push_n(fifo_t* p_fifo, const void* p_elems, uint32_t count);
+
+/**
+* @brief Pop up to *p_count elements into an array. Pass a NULL array to
+*   discard the elements.
+*
+* @param[in,out] p_count Max number of elements to pop, set to the number of
+*   elements popped.
+*
+* @return NRF_SUCCESS At least one element was popped.
+* @return NRF_ERROR_NULL The fifo was empty, or p_count was NULL.
+*/
+uint32_t fifo_pop_n(fifo_t* p_fifo, void* p_elems, uint32_t* p_count);
+
+/**
+* @brief Get the free slot at the head of the fifo, to fill in place instead
+*   of copying an element in. The element is pushed by @ref fifo_push_commit.
+*   With several producers, interrupts must stay masked from reserve to commit.
+*
+* @return Pointer to the slot, or NULL if the fifo is full.
+*/
+void* fifo_push_reserve(fifo_t* p_fifo);
+
+/** @brief Push the slot returned by the last @ref fifo_push_reserve. */
+void fifo_push_commit(fifo_t* p_fifo);
+
+/**
+* @brief Get a pointer to an element in the fifo, to use it in place instead of
+*   copying it out. Only the consumer may use it, and only until the element is
+*   popped. Pop with a NULL element to release it without a copy.
+*
+* @return Pointer to the element, or NULL if the fifo holds no more than elem elements.
+*/
+void* fifo_peek_ptr(fifo_t* p_fifo, uint32_t elem);
+
 uint32_t fifo_peek_at(fifo_t* p_fifo, void* p_elem, uint32_t elem);
 uint32_t fifo_peek(fifo_t* p_fifo, void* p_elem);
 void fifo_flush(fifo_t* p_fifo);
@@ -45,6 +45,20 @@ typedef struct
     mesh_packet_t* p_packet;
 } handle_info_t;
 
+/** Entries reserved for a handle by @ref handle_storage_info_reserve. */
+typedef struct
+{
+    uint16_t handle_index;
+    uint16_t data_index;
+} handle_storage_slot_t;
+
+/** Data cache usage counters, for tuning RBC_MESH_DATA_CACHE_ENTRIES. */
+typedef struct
+{
+    uint32_t data_entries_in_use;   /**< Number of data entries holding a value */
+    uint32_t data_entry_evictions;  /**< Number of values dropped from a full data cache to make room for another */
+} handle_storage_stats_t;
+
 typedef enum
 {
     HANDLE_FLAG_PERSISTENT,
@@ -53,6 +67,19 @@ typedef enum
     HANDLE_FLAG__MAX
 } handle_flag_t;
 
+/** Get the number of bytes of memory needed to hold the given number of handle
+  and data cache entries. */
+uint32_t handle_storage_memory_size_get(uint32_t handle_cache_entries, uint32_t data_cache_entries);
+
+/**
+* Place the handle and data caches in the given memory, which must be pointer
+*   aligned and outlive the framework. Must be called before
+*   handle_storage_init. If it isn't, the caches are sized by
+*   RBC_MESH_HANDLE_CACHE_ENTRIES and RBC_MESH_DATA_CACHE_ENTRIES, and kept in
+*   static memory.
+*/
+uint32_t handle_storage_memory_set(void* p_memory, uint32_t memory_size, uint16_t handle_cache_entries, uint16_t data_cache_entries);
+
 uint32_t handle_storage_init(uint32_t min_interval_us);
 
 uint32_t handle_storage_min_interval_set(uint32_t min_interval_us);
@@ -63,9 +90,31 @@ uint32_t handle_storage_min_interval_set(uint32_t min_interval_us);
 */
 uint32_t handle_storage_info_get(uint16_t handle, handle_info_t* p_info);
 
+/**
+* Get version and packet pointer of several handles in one pass over the
+*   handle storage, with repeated handles only looked up once. Handles that
+*   aren't in the storage get a zeroed info, and false in p_found. Each packet
+*   is returned with a reference, like in @ref handle_storage_info_get.
+*/
+uint32_t handle_storage_info_get_n(const uint16_t* p_handles, handle_info_t* p_infos, bool* p_found, uint32_t count);
+
 /** MUST BE CALLED FROM EVENT HANDLER CONTEXT */
 uint32_t handle_storage_info_set(uint16_t handle, handle_info_t* p_info);
 
+/**
+* Allocate the handle and data entries for a handle without changing its
+*   value, so that a following @ref handle_storage_info_commit can't fail for
+*   lack of memory. The slot is only valid until the next call to the handle
+*   storage. MUST BE CALLED FROM EVENT HANDLER CONTEXT.
+*/
+uint32_t handle_storage_info_reserve(uint16_t handle, handle_storage_slot_t* p_slot);
+
+/**
+* Set the version and packet of a handle in a slot from
+*   @ref handle_storage_info_reserve. MUST BE CALLED FROM EVENT HANDLER CONTEXT.
+*/
+uint32_t handle_storage_info_commit(const handle_storage_slot_t* p_slot, handle_info_t* p_info);
+
 uint32_t handle_storage_local_packet_push(mesh_packet_t* p_packet);
 
 /** MUST BE CALLED FROM EVENT HANDLER CONTEXT */
@@ -75,6 +124,13 @@ uint32_t handle_storage_flag_set_async(uint16_t handle, handle_flag_t flag, bool
 
 uint32_t handle_storage_flag_get(uint16_t handle, handle_flag_t flag, bool* p_value);
 
+/** MUST BE CALLED FROM EVENT HANDLER CONTEXT */
+uint32_t handle_storage_trickle_profile_set(uint16_t handle, uint8_t profile);
+
+uint32_t handle_storage_trickle_profile_set_async(uint16_t handle, uint8_t profile);
+
+uint32_t handle_storage_trickle_profile_get(uint16_t handle, uint8_t* p_profile);
+
 uint32_t handle_storage_rx_consistent(uint16_t handle, uint32_t timestamp);
 
 uint32_t handle_storage_rx_inconsistent(uint16_t handle, uint32_t timestamp);
@@ -86,19 +142,59 @@ uint32_t handle_storage_next_timeout_get(bool* p_found_value);
 *   packet is returned with a reference, which must be freed when the packet
 *   goes out of scope.
 *
-* @param[in] time_now Timestamp to compare TX-timeouts against.
+* @param[in] time_now Timestamp to run the trickle timers of the values at.
+* @param[in] horizon Timestamp to compare TX-timeouts against, time_now or
+*   later to take values that are due shortly along.
 * @param[out] pp_tx_packets An array of packet pointers to be filled by the
 *   function.
 * @param[in,out] p_count The maximum number of elements the given array can
 *   hold. When returned, the argument contains the number of packets filled
 *   into the array by the function.
 */
-uint32_t handle_storage_tx_packets_get(uint32_t time_now, mesh_packet_t** pp_packets, uint32_t* p_count);
+uint32_t handle_storage_tx_packets_get(uint32_t time_now, uint32_t horizon, mesh_packet_t** pp_packets, uint32_t* p_count);
 
 /**
 * Report a successful transmit on the given handle at the given timestamp.
 */
 uint32_t handle_storage_transmitted(uint16_t handle, uint32_t timestamp);
 
+/** Get a snapshot of the data cache usage counters. */
+void handle_storage_stats_get(handle_storage_stats_t* p_stats);
+
+/**
+* Get the digests of count of the RBC_MESH_DIGEST_BUCKETS buckets the handles
+*   are hashed into, starting at first_bucket. A digest is a hash of the
+*   handles and versions of the values in the bucket, the same on two devices
+*   that have the same versions of those values. Only with RBC_MESH_DIGEST.
+*/
+uint32_t handle_storage_digest_get(uint32_t first_bucket, uint16_t* p_digests, uint32_t count);
+
+/**
+* Reset the trickle timers of all values in the given digest bucket, as if an
+*   inconsistent version of each of them had been received. Returns the number
+*   of values reset. Only with RBC_MESH_DIGEST. MUST BE CALLED FROM EVENT
+*   HANDLER CONTEXT.
+*/
+uint32_t handle_storage_digest_bucket_reset(uint32_t bucket, uint32_t timestamp);
+
+/**
+* Get the first handle at or after handle cache index *p_index that has
+*   changed since it was last marked as written to the snapshot, or with all
+*   set, that has changed or is persistent. *p_index is set to the handle's
+*   index, to mark it written and to continue the search from the index after
+*   it. The version and packet of a handle without a value are zeroed, and a
+*   packet is returned with a reference, like in @ref handle_storage_info_get.
+*   Returns NRF_ERROR_NOT_FOUND when there are no more such handles. Only with
+*   RBC_MESH_SNAPSHOT. MUST BE CALLED FROM EVENT HANDLER CONTEXT.
+*/
+uint32_t handle_storage_snapshot_next(uint32_t* p_index, bool all, rbc_mesh_value_handle_t* p_handle, handle_info_t* p_info, bool* p_persistent);
+
+/**
+* Mark the handle at the given handle cache index, as found by
+*   @ref handle_storage_snapshot_next, as written to the snapshot. Only with
+*   RBC_MESH_SNAPSHOT. MUST BE CALLED FROM EVENT HANDLER CONTEXT.
+*/
+void handle_storage_snapshot_written(uint32_t index);
+
 
 #endif /* _HANDLE_STORAGE_H__ */
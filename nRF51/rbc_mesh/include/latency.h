@@ -0,0 +1,94 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _LATENCY_H__
+#define _LATENCY_H__
+#include "rbc_mesh.h"
+#include <stdint.h>
+
+/**
+* @file Receive path latency histograms. Each received value is timestamped
+*   in hardware at the end of its access address, and that timestamp follows
+*   the value through the framework. At every stage below, the time since the
+*   access address is counted in a log2 histogram for the stage, so the
+*   difference between two stages is the time spent between them.
+*
+*   Only recorded inside timeslots, where timer_now() runs. Each stage is
+*   recorded from a single interrupt context, and needs no locking.
+*/
+
+/** Receive path stages, in the order a value passes them. */
+typedef enum
+{
+    LATENCY_STAGE_RX_CB,        /**< Radio END interrupt, in the transport rx callback. */
+    LATENCY_STAGE_DISPATCH,     /**< Event handler dispatches the packet event. */
+    LATENCY_STAGE_TC,           /**< Transport packet handler picks up the packet. */
+    LATENCY_STAGE_VH_RX,        /**< Version handler processes the value. */
+    LATENCY_STAGE_EVENT_PUSH,   /**< Value event queued for the application. */
+    LATENCY_STAGE_EVENT_GET,    /**< Value event taken by the application with rbc_mesh_event_get(). */
+    LATENCY_STAGE__COUNT
+} latency_stage_t;
+
+/** Number of buckets per histogram. Bucket 0 counts latencies below 1us,
+  bucket n latencies from 2^(n-1) up to 2^n us, and the last bucket
+  everything above. */
+#define LATENCY_BUCKET_COUNT    (16)
+
+#if RBC_MESH_LATENCY_HISTOGRAMS
+    #define LATENCY_RECORD(stage, timestamp) latency_record((stage), (timestamp))
+#else
+    #define LATENCY_RECORD(stage, timestamp)
+#endif
+
+void latency_init(void);
+
+/**
+* Count the time since the given access address timestamp in the histogram
+*   of a stage. Use the @ref LATENCY_RECORD macro to compile out the
+*   instrumentation when the histograms are disabled.
+*/
+void latency_record(latency_stage_t stage, uint32_t timestamp);
+
+/**
+* Get the histogram of a stage.
+*
+* @param[in] stage Stage to get the histogram of.
+* @param[out] p_buckets Array of LATENCY_BUCKET_COUNT counters to copy the
+*   histogram to.
+*
+* @return NRF_SUCCESS The histogram was copied out.
+* @return NRF_ERROR_NULL Null pointer supplied.
+* @return NRF_ERROR_INVALID_PARAM There is no such stage.
+* @return NRF_ERROR_NOT_SUPPORTED The framework is built without latency
+*   histograms.
+*/
+uint32_t latency_histogram_get(latency_stage_t stage, uint32_t* p_buckets);
+
+#endif /* _LATENCY_H__ */
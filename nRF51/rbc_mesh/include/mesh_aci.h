@@ -54,8 +54,9 @@ typedef __packed_armcc enum
 
 typedef __packed_armcc enum
 {
-    ACI_FLAG_PERSISTENT = 0x00,
-    ACI_FLAG_TX_EVENT   = 0x01
+    ACI_FLAG_PERSISTENT         = 0x00,
+    ACI_FLAG_TX_EVENT           = 0x01,
+    ACI_FLAG_TRICKLE_PROFILE    = 0x02  /**< Not a boolean, the value is the trickle profile of the handle */
 } __packed_gcc aci_flag_t;
 
 
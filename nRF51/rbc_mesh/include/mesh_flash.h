@@ -39,6 +39,14 @@ typedef void(*mesh_flash_op_cb_t)(flash_op_type_t type, void* p_location);
 
 uint32_t mesh_flash_init(mesh_flash_op_cb_t cb);
 uint32_t mesh_flash_op_push(flash_op_type_t type, const flash_op_t* p_op);
+
+/**
+ * Push a flash operation without reporting its end to the callback given to
+ * mesh_flash_init(), for users other than the owner of the callback. Such
+ * users check mesh_flash_in_progress() to know when their operations have
+ * ended.
+ */
+uint32_t mesh_flash_op_push_unreported(flash_op_type_t type, const flash_op_t* p_op);
 uint32_t mesh_flash_op_available_slots(void);
 bool mesh_flash_in_progress(void);
 void mesh_flash_op_execute(timestamp_t available_time);
@@ -44,6 +44,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MESH_PACKET_BLE_OVERHEAD            (BLE_GAP_ADDR_LEN)                                                      /* overhead before advertisement payload */
 #define MESH_PACKET_ADV_OVERHEAD            (1 /* adv_type */ + 2 /* UUID */ + 2 /* handle */ + 2 /* version */)    /* overhead inside adv data */
 #define MESH_PACKET_OVERHEAD                (MESH_PACKET_BLE_OVERHEAD + 1 + MESH_PACKET_ADV_OVERHEAD)               /* mesh packet total overhead */
+#if RBC_MESH_LONG_VALUES
+#define MESH_PACKET_PAYLOAD_MAX_LENGTH      (1 + MESH_PACKET_ADV_OVERHEAD + RBC_MESH_VALUE_MAX_LEN)                 /* long packets fit the longest value */
+#else
+#define MESH_PACKET_PAYLOAD_MAX_LENGTH      (BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH)
+#endif
+#define MESH_PACKET_IS_LONG(p_packet)       ((p_packet)->header.length > MESH_PACKET_BLE_OVERHEAD + BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH) /* doesn't fit a standard advertisement packet */
+
+#define MESH_AGGREGATE_HANDLE               (0xFFF0)                                                                /* reserved handle marking an aggregated mesh adv data */
+#define MESH_AGGREGATE_ADV_OVERHEAD         (1 /* adv_type */ + 2 /* UUID */ + 2 /* handle */)                      /* overhead inside aggregated adv data */
+#define MESH_AGGREGATE_VALUE_OVERHEAD       (2 /* handle */ + 2 /* version */ + 1 /* length */)                     /* overhead per value in aggregated adv data */
+#define MESH_AGGREGATE_VALUES_MAX_LEN       (BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH - 1 - MESH_AGGREGATE_ADV_OVERHEAD)   /* room for values in aggregated adv data */
+#define MESH_AGGREGATE_VALUE_MAX_LEN        (MESH_AGGREGATE_VALUES_MAX_LEN / 2 - MESH_AGGREGATE_VALUE_OVERHEAD)     /* longest value that is guaranteed to share a packet */
+#define MESH_TIME_SYNC_HANDLE               (0xFFF1)                                                                /* reserved handle of time synchronization beacons */
+#define MESH_DIGEST_HANDLE                  (0xFFF2)                                                                /* reserved handle of value version digest beacons */
 /******************************************************************************
 * Public typedefs
 ******************************************************************************/
@@ -74,6 +88,27 @@ typedef __packed_armcc struct
     uint8_t                 data[RBC_MESH_VALUE_MAX_LEN];
 } __packed_gcc mesh_adv_data_t;
 
+/** One value in an aggregated mesh adv data */
+typedef __packed_armcc struct
+{
+    rbc_mesh_value_handle_t handle;
+    uint16_t                version;
+    uint8_t                 length;
+    uint8_t                 data[];
+} __packed_gcc mesh_aggregate_value_t;
+
+/** Mesh adv data carrying several values, identified by MESH_AGGREGATE_HANDLE
+  in the handle field. Nodes that don't know the format treat it as a
+  framework packet, and ignore it. */
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle;
+    uint8_t                 values[]; /* packed mesh_aggregate_value_t entries */
+} __packed_gcc mesh_aggregate_adv_data_t;
+
 typedef __packed_armcc struct
 {
     uint8_t                 adv_data_length;
@@ -86,18 +121,40 @@ typedef __packed_armcc struct
 {
     ble_packet_header_t header;
     uint8_t addr[6];
-    uint8_t payload[BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH];
+    uint8_t payload[MESH_PACKET_PAYLOAD_MAX_LENGTH];
 } __packed_gcc mesh_packet_t;
 
+/** Packet pool usage counters, for tuning RBC_MESH_PACKET_POOL_SIZE. */
+typedef struct
+{
+    uint32_t acquired;          /**< Number of packets handed out by the pool */
+    uint32_t exhausted;         /**< Number of acquire attempts that found the pool empty */
+    uint16_t in_use;            /**< Number of packets currently holding references */
+    uint16_t high_water_mark;   /**< Highest number of packets in use at the same time */
+} mesh_packet_stats_t;
+
 /******************************************************************************
 * Interface functions
 ******************************************************************************/
+/** Get the number of bytes of memory needed for a packet pool of the given size. */
+uint32_t mesh_packet_pool_memory_size_get(uint32_t pool_size);
+
+/** Place the packet pool in the given memory, which must be word aligned and
+  outlive the framework. Must be called before mesh_packet_init. If it isn't,
+  the pool holds RBC_MESH_PACKET_POOL_SIZE packets in static memory. */
+uint32_t mesh_packet_pool_memory_set(void* p_memory, uint32_t memory_size, uint16_t pool_size);
+
 void mesh_packet_init(void);
 
 void mesh_packet_on_ts_begin(void);
 
+/** Take a packet from the pool, with a single reference. Returns false if
+  the pool is empty. */
 bool mesh_packet_acquire(mesh_packet_t** pp_packet);
 
+/** Get a snapshot of the packet pool usage counters. */
+void mesh_packet_stats_get(mesh_packet_stats_t* p_stats);
+
 /** Get pointer to start of packet which p_buf_pointer is pointing into */
 mesh_packet_t* mesh_packet_get_aligned(void* p_buf_pointer);
 
@@ -126,5 +183,21 @@ bool mesh_packet_has_additional_data(mesh_packet_t* p_packet);
 /** Fill address field with local addr, and sanitize adv-data */
 void mesh_packet_take_ownership(mesh_packet_t* p_packet);
 
+/** Build an aggregated mesh packet without any values. */
+uint32_t mesh_packet_aggregate_build(mesh_packet_t* p_packet);
+
+/** Append a value to an aggregated mesh packet. Returns NRF_ERROR_NO_MEM if
+  the value doesn't fit in the remaining space. */
+uint32_t mesh_packet_aggregate_add(mesh_packet_t* p_packet,
+        rbc_mesh_value_handle_t handle,
+        uint16_t version,
+        uint8_t* data,
+        uint8_t length);
+
+/** Iterate the values of an aggregated mesh packet. Pass NULL as p_value to
+  get the first value. Returns NULL after the last value, or if the packet
+  isn't an aggregate, or if the next value is malformed. */
+mesh_aggregate_value_t* mesh_packet_aggregate_value_next(mesh_packet_t* p_packet, mesh_aggregate_value_t* p_value);
+
 #endif /* _MESH_PACKET_H__ */
 
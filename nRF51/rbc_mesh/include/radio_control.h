@@ -32,9 +32,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _RADIO_CONTROL_H__
 #include <stdint.h>
 #include <stdbool.h>
+#include "rbc_mesh.h"
+
+/** Access address index of long packets, see RBC_MESH_LONG_VALUES. Receives
+  and sends on the alternate address with its most significant byte inverted. */
+#define RADIO_ACCESS_ADDRESS_LONG   (2)
+
 /** @brief callbacks for after radio event is complete */
-typedef void (*radio_rx_cb_t)(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi);
-typedef void (*radio_tx_cb_t)(uint8_t* p_data);
+typedef void (*radio_rx_cb_t)(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi, uint8_t channel);
+typedef void (*radio_tx_cb_t)(uint8_t* p_data, uint8_t channel);
 
 /** @brief callback for when the radio is out of things to do */
 typedef void (*radio_idle_cb_t)(void);
@@ -53,7 +59,8 @@ typedef struct
 {
     uint8_t* packet_ptr;            /**< Packet pointer to use. */
 
-    /** Access address index to operate on. Must be either 0 (the default BLE advertisement address) or 1 (the alternate address set through a call to radio_alt_aa_set()).  */
+    /** Access address index to operate on. Must be either 0 (the default BLE advertisement address) or 1 (the alternate address set through a call to radio_alt_aa_set()),
+        or RADIO_ACCESS_ADDRESS_LONG with RBC_MESH_LONG_VALUES. */
     uint8_t access_address;
     radio_event_type_t event_type;  /**< RX/TX */
     uint8_t channel;                /**< Channel to execute event on */
@@ -84,6 +91,16 @@ void radio_init(radio_idle_cb_t idle_cb,
 */
 void radio_alt_aa_set(uint32_t access_address);
 
+/**
+* @brief Set the radio PHY. Takes effect at the next call to radio_init().
+*
+* @param[in] phy The PHY to send and receive on.
+*
+* @return NRF_SUCCESS the PHY will be used from the next radio_init().
+* @return NRF_ERROR_NOT_SUPPORTED the PHY is not available on this chip.
+*/
+uint32_t radio_phy_set(rbc_mesh_phy_t phy);
+
 /**
 * @brief Schedule a radio event (tx/rx)
 *
@@ -37,80 +37,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "SEGGER_RTT.h"
 #endif
 
-#ifndef RBC_MESH_DEBUG
-#define RBC_MESH_DEBUG  (0)
-#endif
-/******************************************************************************
-* Debug related defines
-******************************************************************************/
-#ifdef BOARD_PCA10000
-    #define TICK_PIN(x)
-    #define SET_PIN(x)
-    #define CLEAR_PIN(x)
+#ifdef __linux__
+    #define CHECK_FP(fp)
 #else
-    #if RBC_MESH_DEBUG
-      #define TICK_PIN(x) NRF_GPIO->OUTSET = (1 << (x)); \
-                          __NOP();\
-                          __NOP();\
-                          NRF_GPIO->OUTCLR = (1 << (x))
-
-      #define SET_PIN(x) NRF_GPIO->OUTSET = (1 << (x))
-      #define CLEAR_PIN(x) NRF_GPIO->OUTCLR = (1 << (x))
-    #else
-      #define TICK_PIN(x)
-      #define SET_PIN(x)
-      #define CLEAR_PIN(x)
-    #endif
+    #define CHECK_FP(fp) if ((uint32_t)fp < 0x18000UL || (uint32_t)fp > 0x20000000UL){APP_ERROR_CHECK(NRF_ERROR_INVALID_ADDR);}
 #endif
 
-#define PIN_MESH_TX         (0)
-#define PIN_SD_EVT_HANDLER  (1)
-#define PIN_IN_TS           (2)
-#define PIN_CONSISTENT      (3)
-#define PIN_INCONSISTENT    (4)
-#define PIN_RX              (5)
-#define PIN_SWI0            (6)
-#define PIN_IN_CB           (7)
-
-#define PIN_EXTENSION_OK    (12)
-#define PIN_EXTENSION_FAIL  (13)
-#define PIN_RADIO_SIGNAL    (14)
-#define PIN_TIMER_SIGNAL    (15)
-
-#define PIN_TC_QUEUE_FULL   (19)
-
-
-#define PIN_INT0            (25)
-#define PIN_INT1            (26)
-#define PIN_TX0             (27)
-#define PIN_TX1             (28)
-#define PIN_SYNC_TIME       (29)
-
-
-#define DEBUG_RADIO         (0)
-
-#define PIN_RADIO_STATE_RX  (16)
-#define PIN_RADIO_STATE_TX  (17)
-#define PIN_RADIO_STATE_IDLE (18)
-
-#if DEBUG_RADIO
-    #define DEBUG_RADIO_SET_PIN(x) NRF_GPIO->OUTSET = (1 << (x))
-    #define DEBUG_RADIO_CLEAR_PIN(x) NRF_GPIO->OUTCLR = (1 << (x))
-#else
-    #define DEBUG_RADIO_SET_PIN(x)
-    #define DEBUG_RADIO_CLEAR_PIN(x)
-#endif
-
-
-#define PIN_BIT_H           (25)
-#define PIN_BIT_L           (28)
-
-#if RBC_MESH_DEBUG
-    #define PIN_OUT(val,bitcount)      for (uint8_t i = 0; i < (bitcount); ++i){ if (((val) >> ((bitcount) - 1 - i) & 0x01)) { TICK_PIN(PIN_BIT_H); } else { TICK_PIN(PIN_BIT_L); } }
-#else
-    #define PIN_OUT(val,bitcount)
-#endif
-
-#define CHECK_FP(fp) if ((uint32_t)fp < 0x18000UL || (uint32_t)fp > 0x20000000UL){APP_ERROR_CHECK(NRF_ERROR_INVALID_ADDR);}
-
 #endif /* _RBC_MESH_COMMON_H__ */
@@ -35,7 +35,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "toolchain.h"
 #include "mesh_aci.h"
 #include "dfu_types_mesh.h"
+#include "trace.h"
 
+/** Trace entries that fit in a command response, next to the count and drop counter. */
+#define SERIAL_EVT_TRACE_ENTRIES_MAX    ((RBC_MESH_VALUE_MAX_LEN + 2 - 3) / sizeof(trace_entry_t))
+/** Number of statistics words that fit in a STATS_GET response. */
+#define SERIAL_EVT_STATS_WORDS_MAX      ((RBC_MESH_VALUE_MAX_LEN + 2 - 2) / sizeof(uint32_t))
+/** Number of histogram buckets that fit in a LATENCY_GET response. */
+#define SERIAL_EVT_LATENCY_BUCKETS_MAX  ((RBC_MESH_VALUE_MAX_LEN + 2 - 3) / sizeof(uint32_t))
 
 typedef __packed_armcc enum
 {
@@ -99,6 +106,34 @@ typedef __packed_armcc struct
     uint16_t packet_type;
 } __packed_gcc serial_evt_cmd_rsp_params_dfu_t;
 
+typedef __packed_armcc struct
+{
+    uint32_t mesh_time;
+    uint8_t hops;
+} __packed_gcc serial_evt_cmd_rsp_params_time_get_t;
+
+typedef __packed_armcc struct
+{
+    uint8_t count;
+    uint16_t dropped;
+    trace_entry_t entries[SERIAL_EVT_TRACE_ENTRIES_MAX];
+} __packed_gcc serial_evt_cmd_rsp_params_trace_read_t;
+
+typedef __packed_armcc struct
+{
+    uint8_t offset;
+    uint8_t total_word_count;
+    uint32_t words[SERIAL_EVT_STATS_WORDS_MAX];
+} __packed_gcc serial_evt_cmd_rsp_params_stats_get_t;
+
+typedef __packed_armcc struct
+{
+    uint8_t stage;
+    uint8_t offset;
+    uint8_t bucket_count;
+    uint32_t buckets[SERIAL_EVT_LATENCY_BUCKETS_MAX];
+} __packed_gcc serial_evt_cmd_rsp_params_latency_get_t;
+
 /****** EVT PARAMS ******/
 typedef __packed_armcc struct
 {
@@ -118,6 +153,10 @@ typedef __packed_armcc struct
         serial_evt_cmd_rsp_params_int_min_t int_min;
         serial_evt_cmd_rsp_params_val_get_t val_get;
         serial_evt_cmd_rsp_params_dfu_t dfu;
+        serial_evt_cmd_rsp_params_time_get_t time_get;
+        serial_evt_cmd_rsp_params_trace_read_t trace_read;
+        serial_evt_cmd_rsp_params_stats_get_t stats_get;
+        serial_evt_cmd_rsp_params_latency_get_t latency_get;
     } __packed_gcc response;        
 } __packed_gcc serial_evt_params_cmd_rsp_t;
 
@@ -0,0 +1,65 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _SNAPSHOT_H__
+#define _SNAPSHOT_H__
+#include <stdint.h>
+
+/**
+* @file Flash snapshot of the persistent values. With RBC_MESH_SNAPSHOT, the
+*   handle, version and payload of every persistent value are kept in a log of
+*   records in one of two flash banks. The handle storage marks the handles
+*   that change, and a timer appends a record for each of them at most every
+*   RBC_MESH_SNAPSHOT_INTERVAL_MS, in batches. A handle that is no longer
+*   persistent gets a record with version 0. When the active bank is full, the
+*   other bank is erased, the current records of all persistent values are
+*   copied into it, and its header is written last, so the old bank stays in
+*   use until the new one is complete. When the framework is initialized, the
+*   records of the bank with the newest header are replayed into the handle
+*   storage in order. A record that was cut short by a reset ends the log, and
+*   has the next write go to a fresh bank.
+*/
+
+/** Snapshot counters. */
+typedef struct
+{
+    uint32_t records;               /**< Records written. */
+    uint32_t bank_erases;           /**< Banks erased to compact the snapshot into. */
+} snapshot_stats_t;
+
+/**
+* Restore the persistent values in the snapshot to the handle storage, and
+*   start writing the changes to them. Called by handle_storage_init().
+*/
+void snapshot_restore(void);
+
+void snapshot_stats_get(snapshot_stats_t* p_stats);
+
+#endif /* _SNAPSHOT_H__ */
@@ -0,0 +1,76 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _TIME_SYNC_H__
+#define _TIME_SYNC_H__
+#include "rbc_mesh.h"
+#include "mesh_packet.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* @file Mesh-wide time synchronization. The root runs the mesh clock off its
+*   local clock, and every synchronized device broadcasts beacons on
+*   MESH_TIME_SYNC_HANDLE with a trickle timer. Each beacon carries the mesh
+*   time at which the sender's previous beacon went on air, captured in
+*   hardware at its access address, and the delay of each of its copies on
+*   the other channels in the channel map. A receiver that got both beacons pairs
+*   that time with its own capture of the previous beacon, and steers its
+*   mesh clock to it. Devices only follow neighbors closer to the root, so
+*   the clock propagates outwards one hop at a time.
+*/
+
+void time_sync_init(void);
+
+uint32_t time_sync_root_set(bool is_root);
+
+/**
+* Convert a local timestamp to mesh time. Returns NRF_ERROR_INVALID_STATE if
+*   the device isn't synchronized.
+*/
+uint32_t time_sync_convert(uint32_t timestamp, uint32_t* p_mesh_time);
+
+void time_sync_status_get(rbc_mesh_time_sync_status_t* p_status);
+
+/**
+* Process a time synchronization beacon received on the given channel. The
+*   caller keeps its reference to the packet. MUST BE CALLED FROM EVENT
+*   HANDLER CONTEXT.
+*/
+void time_sync_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t channel);
+
+/**
+* Note the transmission of a packet on the given channel, to pick up the air
+*   time of the device's own beacons. Called from the radio callback, while
+*   the capture of the packet's access address is still in the radio timer.
+*/
+void time_sync_tx_cb(mesh_packet_t* p_packet, uint8_t channel);
+
+#endif /* _TIME_SYNC_H__ */
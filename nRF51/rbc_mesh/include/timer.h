@@ -34,11 +34,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 /**
 * @defgroup TIMER HF Timer module abstraction.
-* Allocates timers and schedules PPI signals in PPI channels 8-10. Can also do callbacks at timeout.
+* Allocates timers and schedules PPI signals in PPI channels 8-10. Can also do callbacks at timeout,
+* and capture the time of peripheral events through PPI channel 11.
 */
 
 /** First channel to use for timer PPI triggering */
 #define TIMER_PPI_CH_START  (8)
+/** Channel for capturing the time of peripheral events */
+#define TIMER_PPI_CH_CAPTURE  (TIMER_PPI_CH_START + 3)
 /** Invalid timestamp */
 #define TIMER_TIMEOUT_INVALID (0xFFFFFFFF)
 
@@ -46,7 +49,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define TIMER_INDEX_TS_END      (0)
 /** Timer index for scheduler timing */
 #define TIMER_INDEX_SCHEDULER   (1)
-/** Timer index for radio timing */
+/** Timer index for radio timing. Captures the address event of received packets. */
 #define TIMER_INDEX_RADIO       (2)
 /** Timer index for getting timestamps */
 #define TIMER_INDEX_TIMESTAMP   (3)
@@ -149,6 +152,33 @@ uint32_t timer_abort(uint8_t timer);
 */
 timestamp_t timer_now(void);
 
+/**
+* Capture the time of a peripheral event in a timer index through PPI, for
+*   the rest of the timeslot. Overrides any previous capture.
+*
+* @param[in] timer Timer index to capture the event in. Must not have any
+*   timeout ordered.
+* @param[in] p_event Peripheral event to capture the time of.
+*
+* @return NRF_SUCCESS The capture was successfully set up.
+* @return NRF_ERROR_NULL The event was NULL.
+* @return NRF_ERROR_INVALID_PARAM The timer parameter was outside the range of the timer capture registers.
+* @return NRF_ERROR_BUSY The timer has a timeout ordered.
+* @return NRF_ERROR_INVALID_STATE Not in a timeslot.
+*/
+uint32_t timer_capture_ppi(uint8_t timer, uint32_t* p_event);
+
+/**
+* Get the timestamp of the last event captured by @ref timer_capture_ppi.
+*   Outside timeslots, this is the end of the previous timeslot, as in
+*   @ref timer_now.
+*
+* @param[in] timer Timer index the event is captured in.
+*
+* @return 32bit timestamp relative to global epoch.
+*/
+timestamp_t timer_capture_get(uint8_t timer);
+
 /**
 * Initialize timer hardware. Must be called at the beginning of each
 *   SD granted timeslot. Flushes all timer slots.
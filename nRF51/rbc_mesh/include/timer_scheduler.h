@@ -36,7 +36,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 /**
  * @defgroup TIMER_SCHEDULER Asynchronous event scheduler.
- * Scalable event scheduling on the high frequency timer.
+ * Scalable event scheduling on the high frequency timer. Events are kept in a
+ * hierarchical timer wheel, which makes schedule, abort and reschedule
+ * constant time operations.
  * @{
  */
 
@@ -59,6 +61,8 @@ typedef struct timer_event
     timestamp_t         interval;  /**< Interval in us between each fire for periodic timers, or 0 if single-shot */
     void *              p_context; /**< Pointer to data passed on to the callback. */
     struct timer_event* p_next;    /**< Pointer to next event in linked list. Only for internal usage. */
+    struct timer_event* p_prev;    /**< Pointer to previous event in linked list. Only for internal usage. */
+    uint8_t             slot;      /**< Timer wheel slot the event is in, or 0. Only for internal usage. */
 } timer_event_t;
 
 /**
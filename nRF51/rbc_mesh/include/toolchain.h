@@ -42,6 +42,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     #define _DISABLE_IRQS(_was_masked) _was_masked = __disable_irq()
     #define _ENABLE_IRQS(_was_masked) if (!_was_masked) { __enable_irq(); }
 
+    #define _MEMORY_BARRIER() __dmb(0xF)
+
+    /* isolate the lowest bit, and count the leading zeros */
+    #define _LOWEST_SET_BIT(_word) (31 - __clz((_word) & (~(_word) + 1)))
+
+#elif defined(__linux__)
+
+/* Host builds (benchmarks and simulator). Interrupt handlers are run to
+   completion by the host, and never preempt the framework. */
+    #define __packed_armcc
+    #define __packed_gcc __attribute__((packed))
+
+    #define _DISABLE_IRQS(_was_masked) do { _was_masked = 1; } while (0)
+    #define _ENABLE_IRQS(_was_masked) (void) _was_masked
+
+    #define _MEMORY_BARRIER() __asm__ volatile ("" : : : "memory")
+
+    #define _LOWEST_SET_BIT(_word) __builtin_ctz(_word)
+
 #elif defined(__GNUC__)
 
     #define __packed_armcc
@@ -53,11 +72,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     } while(0)
 
     #define _ENABLE_IRQS(_was_masked) if (!_was_masked) { __enable_irq(); }
+
+    #define _MEMORY_BARRIER() __ASM volatile ("dmb" : : : "memory")
+
+    #define _LOWEST_SET_BIT(_word) __builtin_ctz(_word)
 #elif defined(__IAR_SYSTEMS_ICC__)
   #define __packed_gcc
   #define __packed_armcc __packed
   #define _DISABLE_IRQS(_was_masked) do { _was_masked = __get_PRIMASK(); __disable_irq(); } while (0)
   #define _ENABLE_IRQS(_was_masked) __set_PRIMASK(_was_masked)
+  #define _MEMORY_BARRIER() __DMB()
   #if defined(__cplusplus) && !defined(__STDC_LIMIT_MACROS)
     #error "Please define __STDC_LIMIT_MACROS in your project options!"
   #endif
@@ -65,4 +89,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     #warning "Unsupported toolchain"
 #endif
 
+#ifndef _LOWEST_SET_BIT
+/** Index of the lowest set bit in a non-zero word, for toolchains without a
+  suitable intrinsic. */
+static inline uint32_t _lowest_set_bit(uint32_t word)
+{
+    uint32_t index = 0;
+    while (!(word & 0x01))
+    {
+        word >>= 1;
+        index++;
+    }
+    return index;
+}
+    #define _LOWEST_SET_BIT(_word) _lowest_set_bit(_word)
+#endif
+
 #endif /* _TOOLCHAIN_H__ */
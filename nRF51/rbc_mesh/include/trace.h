@@ -0,0 +1,113 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _TRACE_H__
+#define _TRACE_H__
+#include "rbc_mesh.h"
+#include "toolchain.h"
+#include <stdint.h>
+
+/**
+* @file Binary trace of the framework's hot paths. Each trace point writes an
+*   8 byte entry with the current timer_now() timestamp, an event id and two
+*   arguments to a RAM ring, overwriting the oldest entry when it is full.
+*   The ring is drained over the serial interface (SERIAL_CMD_OPCODE_TRACE_READ)
+*   or, with RBC_MESH_TRACE_RTT, copied to an RTT up-buffer. The entries are
+*   decoded on the host by host/tools/trace_decode.py, which must be kept in
+*   sync with the ids below.
+*
+*   Outside timeslots, timer_now() holds the end of the previous timeslot, so
+*   entries logged between timeslots share its timestamp.
+*/
+
+/** Trace event ids. Start and end of a stage are logged as consecutive ids. */
+typedef enum
+{
+    TRACE_ID_RADIO_TX_START     = 0x01, /**< Radio ramps up for TX. arg0: channel. */
+    TRACE_ID_RADIO_RX_START     = 0x02, /**< Radio ramps up for RX. arg0: channel. */
+    TRACE_ID_RADIO_END          = 0x03, /**< Radio event ended. arg0: channel, arg1: 1 for RX with valid CRC, 2 for RX with invalid CRC, 0 for TX. */
+    TRACE_ID_RADIO_DISABLE      = 0x04, /**< Radio disabled from outside the radio ISR. */
+    TRACE_ID_TC_TX              = 0x10, /**< Packet queued for transmission. arg0: channels, arg1: length. */
+    TRACE_ID_RX_BATCH_START     = 0x11, /**< Transport starts processing received packets. arg0: packets. */
+    TRACE_ID_RX_BATCH_END       = 0x12, /**< Transport done with received packets. arg0: packets passed to the version handler. */
+    TRACE_ID_EVENT_START        = 0x20, /**< Internal event execution starts. arg0: event type, arg1: queue latency in us, 0xFFFF if unknown or longer. */
+    TRACE_ID_EVENT_END          = 0x21, /**< Internal event execution ends. arg0: event type. */
+    TRACE_ID_VH_TX_START        = 0x30, /**< Version handler transmission run starts. */
+    TRACE_ID_VH_TX_END          = 0x31, /**< Version handler transmission run ends. arg0: packets sent. */
+    TRACE_ID_VH_TX_VALUE        = 0x32, /**< Value sent. arg1: handle. */
+    TRACE_ID_TRICKLE_CONSISTENT = 0x33, /**< Consistent value received. */
+    TRACE_ID_TRICKLE_INCONSISTENT = 0x34, /**< Inconsistent value received. */
+    TRACE_ID_DATA_ENTRY_ALLOC   = 0x35, /**< Data cache entry allocated. arg0: 1 if a value was evicted for it, arg1: entry index. */
+    TRACE_ID_TIMER_SCH          = 0x40, /**< Timer scheduler operation. arg0: 0 schedule, 1 abort, 2 reschedule. */
+    TRACE_ID_TS_SIGNAL_START    = 0x50, /**< Timeslot signal callback entered. arg0: signal type. */
+    TRACE_ID_TS_SIGNAL_END      = 0x51, /**< Timeslot signal callback returns. arg0: callback action. */
+    TRACE_ID_TS_START           = 0x52, /**< Timeslot started. */
+    TRACE_ID_TS_END             = 0x53, /**< Timeslot ended. */
+} trace_id_t;
+
+/** A single trace entry, as stored in the ring and sent to the host. */
+typedef __packed_armcc struct
+{
+    uint32_t timestamp;     /**< timer_now() at the trace point. */
+    uint8_t  id;            /**< Event id, @ref trace_id_t. */
+    uint8_t  arg0;
+    uint16_t arg1;
+} __packed_gcc trace_entry_t;
+
+#if RBC_MESH_TRACE
+    #define TRACE(id, arg0, arg1) trace_log((id), (uint8_t) (arg0), (uint16_t) (arg1))
+#else
+    #define TRACE(id, arg0, arg1)
+#endif
+
+void trace_init(void);
+
+/**
+* Log an event. Safe to call from any context, use the @ref TRACE macro to
+*   compile out the trace points when tracing is disabled.
+*/
+void trace_log(uint8_t id, uint8_t arg0, uint16_t arg1);
+
+/**
+* Take the oldest entries out of the trace ring.
+*
+* @param[out] p_entries Buffer to copy the entries to.
+* @param[in,out] p_count The size of the buffer in, the number of entries
+*   copied out.
+* @param[out] p_dropped Number of entries overwritten before they were read
+*   since the last call, saturated. May be NULL.
+*
+* @return NRF_SUCCESS The entries were copied out, if there were any.
+* @return NRF_ERROR_NULL Null pointer supplied.
+* @return NRF_ERROR_NOT_SUPPORTED The framework is built without tracing.
+*/
+uint32_t trace_read(trace_entry_t* p_entries, uint32_t* p_count, uint16_t* p_dropped);
+
+#endif /* _TRACE_H__ */
@@ -39,6 +39,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "nrf.h"
 #endif
 #include "rbc_mesh.h"
+#include "event_handler.h"
 
 /**
 * @file This module takes care of all lower level packet processing and
@@ -71,6 +72,20 @@ void tc_radio_params_set(uint32_t access_address, uint8_t channel);
 
 void tc_on_ts_begin(void);
 
+/**
+* @brief Get the reception statistics of a channel the mesh runs on.
+*
+* @param[in] channel Radio channel to get the statistics of.
+* @param[out] p_stats Structure to copy the statistics to.
+*
+* @return NRF_SUCCESS The statistics were copied to the parameter.
+* @return NRF_ERROR_NOT_FOUND The mesh doesn't run on the given channel.
+*/
+uint32_t tc_channel_stats_get(uint8_t channel, rbc_mesh_channel_stats_t* p_stats);
+
+/** Get the reception statistics summed over all channels the mesh runs on. */
+void tc_rx_stats_get(rbc_mesh_channel_stats_t* p_stats);
+
 /**
 * @brief: Assemble a packet by getting data from server based on params,
 *   and place it on the radio queue.
@@ -83,7 +98,14 @@ void tc_on_ts_begin(void);
 */
 uint32_t tc_tx(mesh_packet_t* p_packet, const tc_tx_config_t* p_tx_config);
 
-void tc_packet_handler(uint8_t* data, uint32_t crc, uint32_t timestamp, uint8_t rssi);
+/**
+* @brief Process a batch of received packets. Executed in APP_LOW.
+*
+* @param[in] pp_packets Received packets, at most RBC_MESH_RX_BATCH_MAX. Each
+*   holds a reference to its packet, which is freed.
+* @param[in] count Number of packets.
+*/
+void tc_packet_batch_handler(packet_event_t** pp_packets, uint32_t count);
 
 /**
 * @brief Set packet peek function pointer. Every received packet will be
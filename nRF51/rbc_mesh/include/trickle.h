@@ -45,6 +45,23 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define TRICKLE_C_DISABLED  (0xFF)
 
+/** Longest interval a trickle instance may run with. Keeps all timeouts within
+  the range TIMER_OLDER_THAN can compare. */
+#define TRICKLE_INTERVAL_MAX_US     (1UL << 30)
+
+/** Profile every trickle instance starts out with. */
+#define TRICKLE_PROFILE_DEFAULT     (0)
+
+/**
+* @brief trickle parameter set, shared by all instances running with it.
+*/
+typedef struct
+{
+    uint32_t        i_min;          /* Shortest interval, in microseconds */
+    uint32_t        i_max;          /* Longest interval, in microseconds */
+    uint8_t         k;              /* Redundancy constant */
+} trickle_profile_t;
+
 /**
 * @brief trickle instance type. Contains all values necessary for maintaining
 *   an isolated version of the algorithm
@@ -55,15 +72,52 @@ typedef __packed_armcc struct
     uint32_t        i;              /* Absolute value of i. Equals g_trickle_time (at set time) + i_relative */
     uint32_t        i_relative;     /* Relative value of i. Represents the actual i value in IETF RFC6206 */
     uint8_t         c;              /* Consistent messages counter */
+    uint8_t         profile;        /* Index of the instance's parameter set */
 } __packed_gcc trickle_t;
 
+/**
+* @brief Transmit decisions of all trickle instances, counted since boot.
+*/
+typedef struct
+{
+    uint32_t        tx;             /* Timeouts that resulted in a transmission */
+    uint32_t        suppressed;     /* Timeouts where enough consistent transmissions were heard to stay silent */
+} trickle_stats_t;
+
 
 /** 
 * @brief Setup the algorithm. Is only called once, and before all other trickle
-*   related functions.
+*   related functions. Sets the default profile, with an i_max of i_min times
+*   the given i_max. Profiles that haven't been given their own parameters
+*   with trickle_profile_set() follow the default profile.
 */
 void trickle_setup(uint32_t i_min, uint32_t i_max, uint8_t k);
 
+/**
+* @brief Get the transmit decision counters of all trickle instances.
+*/
+void trickle_stats_get(trickle_stats_t* p_stats);
+
+/**
+* @brief Change the parameters of the given profile. Instances running with the
+*   profile pick up the new values at their next interval.
+*
+* @return NRF_ERROR_INVALID_PARAM if the profile doesn't exist, or the
+*   parameters are out of range.
+*/
+uint32_t trickle_profile_set(uint8_t profile, const trickle_profile_t* p_profile);
+
+/**
+* @brief Get the parameters of the given profile.
+*/
+uint32_t trickle_profile_get(uint8_t profile, trickle_profile_t* p_profile);
+
+/**
+* @brief Run the given trickle instance with a different profile, restarting
+*   its interval at the new i_min.
+*/
+void trickle_profile_assign(trickle_t* trickle, uint8_t profile, uint32_t time_now);
+
 /**
 * @brief Register a consistent RX on the given trickle algorithm instance.
 *   Increments the instance's C value.
@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rbc_mesh.h"
 #include "ble_gap.h"
 #include "mesh_packet.h"
+#include "transport_control.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -45,7 +46,25 @@ uint32_t vh_min_interval_set(uint32_t min_interval_us);
 
 void vh_tx_power_set(rbc_mesh_txpower_t tx_power);
 
-uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi);
+/** Get the transmit configuration values are sent with, for other packets
+  that should go out the same way. */
+void vh_tx_config_get(tc_tx_config_t* p_tx_config);
+
+/** A received mesh packet, for @ref vh_rx_batch. */
+typedef struct
+{
+    mesh_packet_t* p_packet;
+    uint32_t timestamp;
+    uint8_t rssi;
+} vh_rx_packet_t;
+
+/**
+* Process a batch of received value packets. The handles of all values are
+*   looked up in the handle storage in one pass, and the trickle timers are
+*   rescheduled once for the whole batch. The caller keeps its references to
+*   the packets. MUST BE CALLED FROM EVENT HANDLER CONTEXT.
+*/
+uint32_t vh_rx_batch(vh_rx_packet_t* p_packets, uint32_t count);
 
 uint32_t vh_local_update(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length);
 
@@ -70,5 +89,13 @@ uint32_t vh_value_persistence_set(rbc_mesh_value_handle_t handle, bool persisten
 
 uint32_t vh_value_persistence_get(rbc_mesh_value_handle_t handle, bool* p_persistent);
 
+uint32_t vh_trickle_profile_set(uint8_t profile, const rbc_mesh_trickle_profile_t* p_profile);
+
+uint32_t vh_trickle_profile_get(uint8_t profile, rbc_mesh_trickle_profile_t* p_profile);
+
+uint32_t vh_value_trickle_profile_set(rbc_mesh_value_handle_t handle, uint8_t profile);
+
+uint32_t vh_value_trickle_profile_get(rbc_mesh_value_handle_t handle, uint8_t* p_profile);
+
 #endif /* _VERSION_HANDLER_H__ */
 
@@ -44,13 +44,29 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define RBC_MESH_ACCESS_ADDRESS_BLE_ADV             (0x8E89BED6) /**< BLE spec defined access address. */
 #define RBC_MESH_INTERVAL_MIN_MIN_MS                (5) /**< Lowest min-interval allowed. */
 #define RBC_MESH_INTERVAL_MIN_MAX_MS                (60000) /**< Highest min-interval allowed. */
-#define RBC_MESH_VALUE_MAX_LEN                      (23) /**< Longest legal payload. */
+#define RBC_MESH_VALUE_SHORT_MAX_LEN                (23) /**< Longest payload that fits in a standard advertisement packet. */
 #define RBC_MESH_INVALID_HANDLE                     (0xFFFF) /**< Designated "invalid" handle, may never be used */
 #define RBC_MESH_APP_MAX_HANDLE                     (0xFFEF) /**< Upper limit to application defined handles. The last 16 handles are reserved for mesh-maintenance. */
 
 #define RBC_MESH_GPREGRET_CODE_GO_TO_APP            (0x00) /**< Retention register code for immediately starting application when entering bootloader. The default behavior. */
 #define RBC_MESH_GPREGRET_CODE_FORCED_REBOOT        (0x01) /**< Retention register code for telling the bootloader it's been started on purpose */
 
+/** @brief Allow values longer than RBC_MESH_VALUE_SHORT_MAX_LEN. They are sent
+  in long packets, on the mesh access address with its most significant byte
+  inverted, so that standard BLE devices and nodes without long packet support
+  never receive them. Shorter values are sent as before. All nodes that share
+  long values must have it set. Requires the nRF52 radio, and makes every
+  packet in the packet pool long enough for the longest value. */
+#ifndef RBC_MESH_LONG_VALUES
+    #define RBC_MESH_LONG_VALUES                    (0)
+#endif
+
+#if RBC_MESH_LONG_VALUES
+    #define RBC_MESH_VALUE_MAX_LEN                  (241) /**< Longest legal payload, fills a 255 byte long packet. */
+#else
+    #define RBC_MESH_VALUE_MAX_LEN                  (RBC_MESH_VALUE_SHORT_MAX_LEN) /**< Longest legal payload. */
+#endif
+
 /*
    There are two caches in the framework:
    - The handle cache keeps track of the latest version number for each handle.
@@ -62,29 +78,149 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 /** @brief Default value for the number of handle cache entries */
 #ifndef RBC_MESH_HANDLE_CACHE_ENTRIES
-    #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)
-          #define RBC_MESH_HANDLE_CACHE_ENTRIES           (105)
-    #else
-          #define RBC_MESH_HANDLE_CACHE_ENTRIES           (10)
-    #endif      
+    #define RBC_MESH_HANDLE_CACHE_ENTRIES           (10)
 #endif
 
 /** @brief Default value for the number of data cache entries */
 #ifndef RBC_MESH_DATA_CACHE_ENTRIES
-    #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)
-         #define RBC_MESH_DATA_CACHE_ENTRIES             (105)
-    #else
-         #define RBC_MESH_DATA_CACHE_ENTRIES             (10)
-    #endif
+    #define RBC_MESH_DATA_CACHE_ENTRIES             (10)
+#endif
+
+/** @brief Keep a hashed index of the handle cache for constant time handle
+  lookups. Costs two bytes of RAM per index slot, with the index sized to the
+  lowest power of two that is at least twice the number of handle cache
+  entries. Set to 0 to fall back to walking the handle cache list. */
+#ifndef RBC_MESH_HANDLE_CACHE_HASH_INDEX
+    #define RBC_MESH_HANDLE_CACHE_HASH_INDEX        (1)
+#endif
+
+/** @brief Number of trickle profiles values can be assigned to, including
+  the default profile 0, which follows the interval_min_ms given in
+  rbc_mesh_init(). At most 32. */
+#ifndef RBC_MESH_TRICKLE_PROFILE_COUNT
+    #define RBC_MESH_TRICKLE_PROFILE_COUNT          (4)
+#endif
+
+/** @brief Pack short values whose trickle timers expire at the same time into
+  one aggregated advertisement. Aggregated packets are always unpacked on
+  reception, but older firmware ignores them, so only enable this when every
+  node in the network can receive them. */
+#ifndef RBC_MESH_VALUE_AGGREGATION
+    #define RBC_MESH_VALUE_AGGREGATION              (0)
+#endif
+
+/** @brief Values whose trickle timers expire within this many microseconds
+  after a transmission are sent early, to share an aggregated packet. Only
+  used with RBC_MESH_VALUE_AGGREGATION. */
+#ifndef RBC_MESH_VALUE_AGGREGATION_WINDOW_US
+    #define RBC_MESH_VALUE_AGGREGATION_WINDOW_US    (5000)
+#endif
+
+/** @brief Trickle profile the time synchronization beacons are sent with. It
+  is set up in rbc_mesh_init() with the interval_min_ms given there and an
+  interval_max_ms of RBC_MESH_TIME_SYNC_INTERVAL_MAX_MS, and may be tuned with
+  rbc_mesh_trickle_profile_set(). Don't assign values to it. */
+#ifndef RBC_MESH_TIME_SYNC_TRICKLE_PROFILE
+    #define RBC_MESH_TIME_SYNC_TRICKLE_PROFILE      (RBC_MESH_TRICKLE_PROFILE_COUNT - 1)
+#endif
+
+/** @brief Longest interval between time synchronization beacons. The clock
+  drift accumulated over one interval bounds the sync error. */
+#ifndef RBC_MESH_TIME_SYNC_INTERVAL_MAX_MS
+    #define RBC_MESH_TIME_SYNC_INTERVAL_MAX_MS      (1000)
+#endif
+
+/** @brief Broadcast digests of the value versions in the handle cache on a
+  reserved handle. A device that hears a digest that differs from its own
+  resets the trickle timers of the values behind the difference, so a device
+  that has been out of range catches up at the pace of the digests, instead
+  of at the pace of each value's trickle interval. Assumes that the handle
+  cache holds every handle in use. */
+#ifndef RBC_MESH_DIGEST
+    #define RBC_MESH_DIGEST                         (0)
+#endif
+
+/** @brief Number of buckets the handles are hashed into for the digests,
+  at most 255. A difference in a bucket resets the trickle timers of all the
+  values in it. A digest beacon carries 10 buckets, or 119 with
+  RBC_MESH_LONG_VALUES, larger counts are spread over several beacons. */
+#ifndef RBC_MESH_DIGEST_BUCKETS
+    #define RBC_MESH_DIGEST_BUCKETS                 (10)
+#endif
+
+/** @brief Trickle profile the digest beacons are sent with, set up like the
+  time synchronization profile, with an interval_max_ms of
+  RBC_MESH_DIGEST_INTERVAL_MAX_MS. Don't assign values to it. */
+#ifndef RBC_MESH_DIGEST_TRICKLE_PROFILE
+    #define RBC_MESH_DIGEST_TRICKLE_PROFILE         (RBC_MESH_TRICKLE_PROFILE_COUNT - 2)
+#endif
+
+/** @brief Longest interval between digest beacons, which bounds the time it
+  takes to notice that a neighbor is out of date. */
+#ifndef RBC_MESH_DIGEST_INTERVAL_MAX_MS
+    #define RBC_MESH_DIGEST_INTERVAL_MAX_MS         (1000)
+#endif
+
+/** @brief Keep a snapshot of the persistent values in flash, and restore it
+  when the framework is initialized, so that a device comes back from a reset
+  with the values it had, instead of relearning them from its neighbors. The
+  snapshot is a log of the changes in two banks of
+  RBC_MESH_SNAPSHOT_BANK_PAGES pages at RBC_MESH_SNAPSHOT_FLASH_ADDR, written
+  through the mesh_flash module inside the timeslots. */
+#ifndef RBC_MESH_SNAPSHOT
+    #define RBC_MESH_SNAPSHOT                       (0)
+#endif
+
+/* RBC_MESH_SNAPSHOT_FLASH_ADDR: Page aligned address of the two snapshot
+   banks, which must be left alone by the application, the bootloader and the
+   DFU banks. No default, must be given along with RBC_MESH_SNAPSHOT. */
+
+/** @brief Number of flash pages in each of the two snapshot banks. A bank
+  must hold a record of every persistent value, 8 bytes plus the value
+  rounded up to a whole word each. Values that don't fit are left out. */
+#ifndef RBC_MESH_SNAPSHOT_BANK_PAGES
+    #define RBC_MESH_SNAPSHOT_BANK_PAGES            (1)
+#endif
+
+/** @brief Shortest time between two writes of changes to the snapshot. All
+  changes of a value within the interval end up in one record, which bounds
+  the flash wear: a bank is erased at most once every
+  (bank size / record size) intervals, no matter how often the values change. */
+#ifndef RBC_MESH_SNAPSHOT_INTERVAL_MS
+    #define RBC_MESH_SNAPSHOT_INTERVAL_MS           (10000)
+#endif
+
+/** @brief Size of the RAM buffer a batch of snapshot records is written
+  from, in bytes. Must be a multiple of 4, and hold the record of the longest
+  value. */
+#ifndef RBC_MESH_SNAPSHOT_BATCH_SIZE
+    #define RBC_MESH_SNAPSHOT_BATCH_SIZE            (256)
+#endif
+
+/** @brief Advertisement channels to run the mesh on, one bit per channel:
+  bit 0 is channel 37, bit 1 is 38 and bit 2 is 39. Every packet is sent on all
+  the channels in the map, while the receiver rotates between them. 0 runs the
+  mesh on the single channel given to rbc_mesh_init(). */
+#ifndef RBC_MESH_ADV_CHANNEL_MAP
+    #define RBC_MESH_ADV_CHANNEL_MAP                (0)
+#endif
+
+/** @brief Time the receiver listens on each channel in the
+  RBC_MESH_ADV_CHANNEL_MAP before moving on to the next one. */
+#ifndef RBC_MESH_SCAN_CHANNEL_INTERVAL_US
+    #define RBC_MESH_SCAN_CHANNEL_INTERVAL_US       (20000)
 #endif
 
 /** @brief Length of app-event FIFO. Must be power of two. */
 #ifndef RBC_MESH_APP_EVENT_QUEUE_LENGTH
-    #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)
-         #define RBC_MESH_APP_EVENT_QUEUE_LENGTH         (64)
-    #else
-         #define RBC_MESH_APP_EVENT_QUEUE_LENGTH         (8)
-    #endif
+    #define RBC_MESH_APP_EVENT_QUEUE_LENGTH         (8)
+#endif
+
+/** @brief Send the copies of a packet on consecutive channels back to back.
+  The radio is restarted on the next channel as soon as it has disabled after
+  a copy, before the copy's callback runs and without the full event setup. */
+#ifndef RBC_MESH_RADIO_TX_CHAIN
+    #define RBC_MESH_RADIO_TX_CHAIN                 (1)
 #endif
 
 /** @brief Length of low level radio event FIFO. Must be power of two. */
@@ -92,18 +228,139 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     #define RBC_MESH_RADIO_QUEUE_LENGTH             (8)
 #endif
 
-/** @brief Length of internal async-event FIFO. Must be power of two. */
+/** @brief Default length of each internal async-event FIFO. Must be power of two. */
 #ifndef RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH
     #define RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH    (8)
 #endif
 
+/** @brief Length of the internal FIFO for generic callbacks and flag changes. Must be power of two. */
+#ifndef RBC_MESH_GENERIC_EVENT_QUEUE_LENGTH
+    #define RBC_MESH_GENERIC_EVENT_QUEUE_LENGTH     (RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH)
+#endif
+
+/** @brief Length of the internal FIFO for timer scheduler callbacks, including trickle transmissions. Must be power of two. */
+#ifndef RBC_MESH_TIMER_EVENT_QUEUE_LENGTH
+    #define RBC_MESH_TIMER_EVENT_QUEUE_LENGTH       (RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH)
+#endif
+
+/** @brief Length of the internal FIFO for received packets. Must be power of two. */
+#ifndef RBC_MESH_PACKET_EVENT_QUEUE_LENGTH
+    #define RBC_MESH_PACKET_EVENT_QUEUE_LENGTH      (RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH)
+#endif
+
+/** @brief Length of the internal FIFO for timer callbacks that must run inside the timeslot. Must be power of two. */
+#ifndef RBC_MESH_TIMESLOT_EVENT_QUEUE_LENGTH
+    #define RBC_MESH_TIMESLOT_EVENT_QUEUE_LENGTH    (RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH)
+#endif
+
+/** @brief Number of events the event dispatcher handles from each internal
+  FIFO per round. The FIFOs are visited in the order generic, timer, packet,
+  timeslot, so a burst in one FIFO can't hold back the others for longer than
+  one round. */
+#ifndef RBC_MESH_GENERIC_EVENT_BUDGET
+    #define RBC_MESH_GENERIC_EVENT_BUDGET           (1)
+#endif
+#ifndef RBC_MESH_TIMER_EVENT_BUDGET
+    #define RBC_MESH_TIMER_EVENT_BUDGET             (1)
+#endif
+#ifndef RBC_MESH_PACKET_EVENT_BUDGET
+    #define RBC_MESH_PACKET_EVENT_BUDGET            (1)
+#endif
+#ifndef RBC_MESH_TIMESLOT_EVENT_BUDGET
+    #define RBC_MESH_TIMESLOT_EVENT_BUDGET          (1)
+#endif
+
+/** @brief Max number of received packets the event dispatcher hands to the
+  mesh at once. The handles of a batch are looked up in the handle storage in
+  one pass, and the batch causes at most one trickle reschedule. A batch counts
+  as one event against RBC_MESH_PACKET_EVENT_BUDGET. */
+#ifndef RBC_MESH_RX_BATCH_MAX
+    #define RBC_MESH_RX_BATCH_MAX                   (RBC_MESH_PACKET_EVENT_QUEUE_LENGTH)
+#endif
+
+/** @brief Number of packets the packet pool needs on top of one per data
+  cache entry, for the packets held by the event and radio queues. */
+#define RBC_MESH_PACKET_POOL_QUEUED_PACKETS         (RBC_MESH_APP_EVENT_QUEUE_LENGTH + \
+                                                     RBC_MESH_RADIO_QUEUE_LENGTH + \
+                                                     RBC_MESH_PACKET_EVENT_QUEUE_LENGTH +\
+                                                     3)
+
 /** @brief Size of packet pool. Only accounts for one packet in the app-space at a time. */
 #ifndef RBC_MESH_PACKET_POOL_SIZE
     #define RBC_MESH_PACKET_POOL_SIZE               (RBC_MESH_DATA_CACHE_ENTRIES +\
-                                                     RBC_MESH_APP_EVENT_QUEUE_LENGTH + \
-                                                     RBC_MESH_RADIO_QUEUE_LENGTH + \
-                                                     RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH +\
-                                                     3)
+                                                     RBC_MESH_PACKET_POOL_QUEUED_PACKETS)
+#endif
+
+/** @brief Keep static memory for the handle cache, data cache and packet pool
+  in their default sizes, used when rbc_mesh_init gets no memory arena. Set to
+  0 to save the RAM when the application always supplies an arena. */
+#ifndef RBC_MESH_STATIC_ARENA
+    #define RBC_MESH_STATIC_ARENA                   (1)
+#endif
+
+/** @brief Record timestamped trace events from the framework's hot paths in
+  a RAM ring buffer, readable over the serial interface and RTT. */
+#ifndef RBC_MESH_TRACE
+    #define RBC_MESH_TRACE                          (0)
+#endif
+
+/** @brief Number of entries in the trace ring. The oldest entries are
+  overwritten when it is full. Must be power of two. */
+#ifndef RBC_MESH_TRACE_ENTRIES
+    #define RBC_MESH_TRACE_ENTRIES                  (256)
+#endif
+
+/** @brief Copy the trace to the RTT up-buffer RBC_MESH_TRACE_RTT_CHANNEL
+  every RBC_MESH_TRACE_RTT_INTERVAL_US, instead of keeping it for the serial
+  interface. */
+#ifndef RBC_MESH_TRACE_RTT
+    #define RBC_MESH_TRACE_RTT                      (0)
+#endif
+#ifndef RBC_MESH_TRACE_RTT_CHANNEL
+    #define RBC_MESH_TRACE_RTT_CHANNEL              (1)
+#endif
+#ifndef RBC_MESH_TRACE_RTT_INTERVAL_US
+    #define RBC_MESH_TRACE_RTT_INTERVAL_US          (10000)
+#endif
+
+/** @brief Count the latency of every received value at each stage of the
+  receive path, from the radio to the application, in log2 histograms
+  readable over the serial interface. */
+#ifndef RBC_MESH_LATENCY_HISTOGRAMS
+    #define RBC_MESH_LATENCY_HISTOGRAMS             (0)
+#endif
+
+#if (RBC_MESH_TRICKLE_PROFILE_COUNT < 1 || RBC_MESH_TRICKLE_PROFILE_COUNT > 32)
+    #error "The number of trickle profiles must be between 1 and 32"
+#endif
+
+#if (RBC_MESH_ADV_CHANNEL_MAP > 0x07)
+    #error "The advertisement channel map can only hold channels 37, 38 and 39"
+#endif
+
+#if (RBC_MESH_TIME_SYNC_TRICKLE_PROFILE < 1 || RBC_MESH_TIME_SYNC_TRICKLE_PROFILE >= RBC_MESH_TRICKLE_PROFILE_COUNT)
+    #error "The time synchronization trickle profile must be one of the trickle profiles, other than the default profile 0"
+#endif
+
+#if (RBC_MESH_DIGEST && (RBC_MESH_DIGEST_TRICKLE_PROFILE < 1 || RBC_MESH_DIGEST_TRICKLE_PROFILE >= RBC_MESH_TRICKLE_PROFILE_COUNT || \
+                         RBC_MESH_DIGEST_TRICKLE_PROFILE == RBC_MESH_TIME_SYNC_TRICKLE_PROFILE))
+    #error "The digest trickle profile must be one of the trickle profiles, other than the default profile 0 and the time synchronization profile"
+#endif
+
+#if (RBC_MESH_DIGEST && (RBC_MESH_DIGEST_BUCKETS < 1 || RBC_MESH_DIGEST_BUCKETS > 255))
+    #error "The number of digest buckets must be between 1 and 255"
+#endif
+
+#if (RBC_MESH_SNAPSHOT && !defined(RBC_MESH_SNAPSHOT_FLASH_ADDR))
+    #error "RBC_MESH_SNAPSHOT_FLASH_ADDR must be set to the flash pages of the snapshot"
+#endif
+
+#if (RBC_MESH_SNAPSHOT && (RBC_MESH_SNAPSHOT_BATCH_SIZE % 4 != 0 || RBC_MESH_SNAPSHOT_BATCH_SIZE < 8 + ((RBC_MESH_VALUE_MAX_LEN + 3) & ~3)))
+    #error "The snapshot batch size must be a multiple of 4 bytes, and hold the record of the longest value"
+#endif
+
+#if (RBC_MESH_TRACE && (RBC_MESH_TRACE_ENTRIES & (RBC_MESH_TRACE_ENTRIES - 1)))
+    #error "The number of trace entries must be a power of two"
 #endif
 
 #if (RBC_MESH_HANDLE_CACHE_ENTRIES < RBC_MESH_DATA_CACHE_ENTRIES)
@@ -156,7 +413,7 @@ typedef struct
             int8_t rssi;                            /**< RSSI of received data, in range of -100dBm to ~-40dBm. */
             ble_gap_addr_t ble_adv_addr;            /**< Advertisement address of the device we got the update from. */
             uint16_t version_delta;                 /**< Version number increase since last update. */
-            uint32_t timestamp_us;                  /**< Timestamp of the received packet. */
+            uint32_t timestamp_us;                  /**< Timestamp of the received packet, captured in hardware at the end of its access address. */
         } rx;
         struct
         {
@@ -222,6 +479,100 @@ typedef enum
     RBC_MESH_TXPOWER_Neg4dBm  = 0xFCUL, /**< -4dBm. */
 } rbc_mesh_txpower_t;
 
+/** Radio PHY enum */
+typedef enum
+{
+    RBC_MESH_PHY_1MBIT = 0, /**< BLE 1 Mbit, the default. */
+    RBC_MESH_PHY_2MBIT,     /**< BLE 2 Mbit, nRF52 only. Halves the airtime of every packet, but all nodes in the mesh must use it. */
+} rbc_mesh_phy_t;
+
+/**
+* @brief Trickle parameters for a group of values.
+*
+* @detailed Values with a short interval_min_ms converge quickly after an
+*   update, at the cost of more traffic. Values whose updates are rarely
+*   urgent can use a longer interval to leave airtime for the others.
+*/
+typedef struct
+{
+    uint32_t interval_min_ms;       /**< Shortest retransmit interval, used right after an update. Between RBC_MESH_INTERVAL_MIN_MIN_MS and RBC_MESH_INTERVAL_MIN_MAX_MS. */
+    uint32_t interval_max_ms;       /**< Longest retransmit interval, reached by doubling interval_min_ms while the network is consistent. At least interval_min_ms. */
+    uint8_t redundancy_constant;    /**< Number of consistent transmissions from neighbors that suppress a transmission in an interval. At least 1. */
+} rbc_mesh_trickle_profile_t;
+
+/**
+* @brief Reception statistics for a single radio channel.
+*/
+typedef struct
+{
+    uint32_t rx_ok;                 /**< Packets received with a valid CRC. */
+    uint32_t rx_crc_fail;           /**< Packets received with an invalid CRC. */
+} rbc_mesh_channel_stats_t;
+
+/**
+* @brief Framework statistics, for monitoring a device in the field.
+*
+* @detailed All members are 32 bit words, so the structure can be read as an
+*   array of RBC_MESH_STATS_WORD_COUNT words, in the order listed. New
+*   members are only ever added at the end. Counters run from the framework
+*   initialization, except the reception counters, which are reset along with
+*   the channel statistics.
+*/
+typedef struct
+{
+    uint32_t rx_ok;                         /**< Packets received with a valid CRC, on all channels. */
+    uint32_t rx_crc_fail;                   /**< Packets received with an invalid CRC, on all channels. */
+    uint32_t rx_queue_drop;                 /**< Valid packets dropped because the packet event queue was full. */
+    uint32_t events_timer;                  /**< Timeslot timer events executed. */
+    uint32_t events_timer_sch;              /**< Scheduled timer events executed. */
+    uint32_t events_generic;                /**< Generic callback events executed. */
+    uint32_t events_packet;                 /**< Received packets processed. */
+    uint32_t events_set_flag;               /**< Asynchronous handle flag changes executed. */
+    uint32_t events_set_trickle_profile;    /**< Asynchronous trickle profile changes executed. */
+    uint32_t event_queue_drop;              /**< Internal events of all kinds that didn't fit in their queue. */
+    uint32_t event_queue_max_depth_generic; /**< High-water mark of the generic event queue. */
+    uint32_t event_queue_max_depth_timer;   /**< High-water mark of the timer event queue. */
+    uint32_t event_queue_max_depth_packet;  /**< High-water mark of the packet event queue. */
+    uint32_t event_queue_max_depth_timeslot;/**< High-water mark of the timeslot event queue. */
+    uint32_t event_max_latency_us;          /**< Longest time an internal event waited in its queue, inside a timeslot. */
+    uint32_t event_coalesced;               /**< Internal event pushes folded into an event that was already queued. */
+    uint32_t app_events_new_val;            /**< RBC_MESH_EVENT_TYPE_NEW_VAL events queued for the application. */
+    uint32_t app_events_update_val;         /**< RBC_MESH_EVENT_TYPE_UPDATE_VAL events queued for the application. */
+    uint32_t app_events_conflicting_val;    /**< RBC_MESH_EVENT_TYPE_CONFLICTING_VAL events queued for the application. */
+    uint32_t app_events_tx;                 /**< RBC_MESH_EVENT_TYPE_TX events queued for the application. */
+    uint32_t app_event_queue_drop;          /**< Application events that didn't fit in the application event queue. */
+    uint32_t app_event_queue_max_depth;     /**< High-water mark of the application event queue. */
+    uint32_t packet_pool_in_use;            /**< Packets currently taken from the packet pool. */
+    uint32_t packet_pool_max_in_use;        /**< High-water mark of the packet pool. */
+    uint32_t packet_pool_exhausted;         /**< Packet allocations that found the pool empty. */
+    uint32_t data_cache_in_use;             /**< Data cache entries holding a value. */
+    uint32_t data_cache_evictions;          /**< Values dropped from a full data cache to make room for another. */
+    uint32_t trickle_tx;                    /**< Trickle timeouts that resulted in a transmission. */
+    uint32_t trickle_suppressed;            /**< Trickle timeouts suppressed by consistent transmissions from neighbors. */
+    uint32_t digest_tx;                     /**< Digest beacons sent, with RBC_MESH_DIGEST. */
+    uint32_t digest_bucket_resets;          /**< Digest buckets found to differ from a neighbor's, resetting the trickle timers of their values. */
+    uint32_t snapshot_records;              /**< Records written to the flash snapshot, with RBC_MESH_SNAPSHOT. */
+    uint32_t snapshot_bank_erases;          /**< Snapshot banks erased to compact the snapshot into. */
+} rbc_mesh_stats_t;
+
+/** Number of 32 bit words in @ref rbc_mesh_stats_t. */
+#define RBC_MESH_STATS_WORD_COUNT   (sizeof(rbc_mesh_stats_t) / sizeof(uint32_t))
+
+/**
+* @brief State of the mesh time synchronization on this device.
+*
+* @detailed The mesh clock follows the clock of the time synchronization
+*   root, one hop at a time. Every hop adds its own sync error, so devices
+*   far from the root are the least accurate.
+*/
+typedef struct
+{
+    bool is_root;                   /**< This device is the time synchronization root. */
+    bool is_synced;                 /**< The mesh clock is running, either as root or from a neighbor closer to the root. */
+    uint8_t hops;                   /**< Number of hops to the root, 0 on the root. Only valid if is_synced. */
+    int32_t drift_ppb;              /**< Estimated rate of the mesh clock relative to the local clock, in parts per billion. */
+} rbc_mesh_time_sync_status_t;
+
 /**
 * @brief Initialization parameter struct for the rbc_mesh_init() function.
 *
@@ -243,6 +594,21 @@ typedef enum
 * @param[in] lfclksrc The LF-clock source parameter supplied to the
 *    softdevice_enable function.
 * @param[in] tx_power The transmit power used in the mesh. See @rbc_mesh_tx_power_t.
+* @param[in] phy The radio PHY used in the mesh. See @rbc_mesh_phy_t.
+*    RBC_MESH_PHY_2MBIT is only available on nRF52.
+* @param[in] p_arena Memory to place the handle cache, data cache and packet
+*    pool in, or NULL to use static memory sized by RBC_MESH_HANDLE_CACHE_ENTRIES,
+*    RBC_MESH_DATA_CACHE_ENTRIES and RBC_MESH_PACKET_POOL_SIZE. Must be
+*    pointer aligned, and must not be used by the application after the call.
+*    Use rbc_mesh_arena_size_get() to find the required size.
+* @param[in] arena_size Size of p_arena in bytes.
+* @param[in] handle_cache_entries Number of handle cache entries in the arena,
+*    or 0 for RBC_MESH_HANDLE_CACHE_ENTRIES. Must be between
+*    data_cache_entries and 32767.
+* @param[in] data_cache_entries Number of data cache entries in the arena, or 0
+*    for RBC_MESH_DATA_CACHE_ENTRIES.
+* @param[in] packet_pool_size Number of packets in the arena, or 0 for one
+*    per data cache entry plus RBC_MESH_PACKET_POOL_QUEUED_PACKETS.
 */
 typedef struct
 {
@@ -255,6 +621,12 @@ typedef struct
 	nrf_clock_lfclksrc_t lfclksrc;
 #endif
     rbc_mesh_txpower_t tx_power;
+    rbc_mesh_phy_t phy;
+    void* p_arena;
+    uint32_t arena_size;
+    uint16_t handle_cache_entries;
+    uint16_t data_cache_entries;
+    uint16_t packet_pool_size;
 } rbc_mesh_init_params_t;
 
 typedef enum
@@ -277,7 +649,7 @@ typedef struct
     uint8_t payload_len;            /**< Length of p_payload. */
     uint8_t* p_payload;             /**< Advertisement packet payload (not including advertisement address) */
     uint32_t crc;                   /**< CRC value of the received packet. */
-    uint64_t timestamp;             /**< Timestamp of the received packet. */
+    uint64_t timestamp;             /**< Timestamp of the received packet, captured in hardware at the end of its access address. */
 } rbc_mesh_packet_peek_params_t;
 
 /** @brief Function pointer type for packet peek callback. */
@@ -297,11 +669,28 @@ typedef void (*rbc_mesh_packet_peek_cb_t)(rbc_mesh_packet_peek_params_t* p_peek_
 *
 * @return NRF_SUCCESS the initialization is successful
 * @return NRF_ERROR_INVALID_PARAM a parameter does not meet its required range.
+* @return NRF_ERROR_INVALID_ADDR the memory arena is not pointer aligned.
+* @return NRF_ERROR_NO_MEM the memory arena is too small for the requested
+*    cache and pool sizes.
+* @return NRF_ERROR_NOT_SUPPORTED the PHY is not available on this chip.
 * @return NRF_ERROR_INVALID_STATE the framework has already been initialized.
 * @return NRF_ERROR_SOFTDEVICE_NOT_ENABLED the Softdevice has not been enabled.
 */
 uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params);
 
+/**
+* @brief Get the size of the memory arena needed to run the framework with
+*   the given cache and pool sizes. Zero sizes are replaced with their
+*   defaults, as in rbc_mesh_init().
+*
+* @param[in] handle_cache_entries Number of handle cache entries.
+* @param[in] data_cache_entries Number of data cache entries.
+* @param[in] packet_pool_size Number of packets in the packet pool.
+*
+* @return The number of bytes the arena must hold.
+*/
+uint32_t rbc_mesh_arena_size_get(uint16_t handle_cache_entries, uint16_t data_cache_entries, uint16_t packet_pool_size);
+
 /**
 * @brief Get the current state of the mesh.
 *
@@ -510,6 +899,129 @@ uint32_t rbc_mesh_persistence_get(rbc_mesh_value_handle_t handle, bool* is_persi
 */
 uint32_t rbc_mesh_tx_event_flag_get(rbc_mesh_value_handle_t handle, bool* is_doing_tx_event);
 
+/**
+* @brief Set the trickle parameters of one of the RBC_MESH_TRICKLE_PROFILE_COUNT
+*   trickle profiles.
+*
+* @note Profile 0 is the default profile for all values. It is set up from
+*   the interval_min_ms given in @ref rbc_mesh_init, and profiles that have
+*   not been set with this function use the same parameters. Values already
+*   running with the profile pick up the new parameters at their next
+*   interval.
+*
+* @param[in] profile The profile to set, below RBC_MESH_TRICKLE_PROFILE_COUNT.
+* @param[in] p_profile The new parameters of the profile.
+*
+* @return NRF_SUCCESS The profile was successfully set.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+* @return NRF_ERROR_NULL p_profile is NULL.
+* @return NRF_ERROR_INVALID_PARAM The profile does not exist, or a parameter
+*   is out of range.
+*/
+uint32_t rbc_mesh_trickle_profile_set(uint8_t profile, const rbc_mesh_trickle_profile_t* p_profile);
+
+/**
+* @brief Get the trickle parameters of the given profile.
+*
+* @param[in] profile The profile to get, below RBC_MESH_TRICKLE_PROFILE_COUNT.
+* @param[out] p_profile Structure to copy the parameters of the profile to.
+*
+* @return NRF_SUCCESS The parameters were successfully copied.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+* @return NRF_ERROR_NULL p_profile is NULL.
+* @return NRF_ERROR_INVALID_PARAM The profile does not exist.
+*/
+uint32_t rbc_mesh_trickle_profile_get(uint8_t profile, rbc_mesh_trickle_profile_t* p_profile);
+
+/**
+* @brief Set which trickle profile the given handle is retransmitted with.
+*
+* @note Like the persistence and TX event flags, the profile is kept in the
+*   handle cache, and is reset to the default profile 0 if the handle falls
+*   out of it. Use @ref rbc_mesh_persistence_set to keep it.
+*
+* @param[in] handle Handle to change the trickle profile for.
+* @param[in] profile Trickle profile to retransmit the value with.
+*
+* @return NRF_SUCCESS The profile change has been scheduled.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+* @return NRF_ERROR_INVALID_ADDR The handle is invalid.
+* @return NRF_ERROR_INVALID_PARAM The profile does not exist.
+*/
+uint32_t rbc_mesh_value_trickle_profile_set(rbc_mesh_value_handle_t handle, uint8_t profile);
+
+/**
+* @brief Get which trickle profile the given handle is retransmitted with.
+*
+* @param[in] handle The handle whose profile should be checked.
+* @param[out] p_profile Pointer to copy the profile to.
+*
+* @return NRF_SUCCESS The profile was successfully copied to the parameter.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+* @return NRF_ERROR_NOT_FOUND The given handle is not present in the cache.
+* @return NRF_ERROR_INVALID_ADDR The given handle is invalid.
+*/
+uint32_t rbc_mesh_value_trickle_profile_get(rbc_mesh_value_handle_t handle, uint8_t* p_profile);
+
+/**
+* @brief Make this device the time synchronization root, or stop being it.
+*
+* @details The root runs the mesh clock off its own clock, and starts
+*   broadcasting time synchronization beacons. Devices that hear the beacons
+*   synchronize to it, and relay the mesh clock further. Only one device in
+*   the network should be root. Without a root, no device has a mesh clock.
+*
+* @param[in] is_root Whether this device should be the root.
+*
+* @return NRF_SUCCESS The root state was changed.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_time_sync_root_set(bool is_root);
+
+/**
+* @brief Get the current mesh time.
+*
+* @note Like the timestamps of the framework events, the time only advances
+*   while the framework is in a timeslot. Between timeslots, the mesh time at
+*   the end of the last timeslot is returned.
+*
+* @param[out] p_mesh_time_us Pointer to copy the mesh time to, in
+*   microseconds. Wraps around after 2^32 microseconds.
+*
+* @return NRF_SUCCESS The mesh time was copied to the parameter.
+* @return NRF_ERROR_NULL p_mesh_time_us is NULL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized, or
+*   the device isn't synchronized to the mesh clock.
+*/
+uint32_t rbc_mesh_time_get(uint32_t* p_mesh_time_us);
+
+/**
+* @brief Convert a framework timestamp to mesh time.
+*
+* @details Use this on the timestamp_us of received and transmitted values to
+*   get times that can be compared between devices.
+*
+* @param[in] timestamp_us Timestamp from a framework event, in local time.
+* @param[out] p_mesh_time_us Pointer to copy the mesh time to.
+*
+* @return NRF_SUCCESS The timestamp was converted.
+* @return NRF_ERROR_NULL p_mesh_time_us is NULL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized, or
+*   the device isn't synchronized to the mesh clock.
+*/
+uint32_t rbc_mesh_time_convert(uint32_t timestamp_us, uint32_t* p_mesh_time_us);
+
+/**
+* @brief Get the state of the mesh time synchronization.
+*
+* @param[out] p_status Structure to copy the state to.
+*
+* @return NRF_SUCCESS The state was copied to the parameter.
+* @return NRF_ERROR_NULL p_status is NULL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_time_sync_status_get(rbc_mesh_time_sync_status_t* p_status);
+
 /**
 * @brief Set TX power for mesh packets.
 *
@@ -594,6 +1106,39 @@ uint32_t rbc_mesh_event_peek(rbc_mesh_event_t* p_evt);
 */
 void rbc_mesh_event_release(rbc_mesh_event_t* p_evt);
 
+/**
+* @brief Get the reception statistics of one of the channels the mesh runs on.
+*
+* @details Use this to compare the channels in the RBC_MESH_ADV_CHANNEL_MAP,
+*   and drop the ones with the most interference. The statistics are reset
+*   when the mesh access address or channel is changed.
+*
+* @param[in] channel Radio channel to get the statistics of.
+* @param[out] p_stats Structure to copy the statistics to.
+*
+* @return NRF_SUCCESS The statistics were copied to the parameter.
+* @return NRF_ERROR_NULL p_stats is NULL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+* @return NRF_ERROR_NOT_FOUND The mesh doesn't run on the given channel.
+*/
+uint32_t rbc_mesh_channel_stats_get(uint8_t channel, rbc_mesh_channel_stats_t* p_stats);
+
+/**
+* @brief Get a snapshot of the framework statistics.
+*
+* @details Collects the counters of the transport, the event queues, the
+*   packet pool, the data cache and the trickle instances in one structure.
+*   Gateways can read the same structure over the serial interface with
+*   SERIAL_CMD_OPCODE_STATS_GET.
+*
+* @param[out] p_stats Structure to copy the statistics to.
+*
+* @return NRF_SUCCESS The statistics were copied to the parameter.
+* @return NRF_ERROR_NULL p_stats is NULL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_stats_get(rbc_mesh_stats_t* p_stats);
+
 /**
 * @brief Set packet peek function pointer. Every received packet will be
 *   passed to the peek function before being processed by the stack -
@@ -0,0 +1,239 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "digest.h"
+
+#include "handle_storage.h"
+#include "transport_control.h"
+#include "version_handler.h"
+#include "timer.h"
+#include "timer_scheduler.h"
+#include "event_handler.h"
+#include "trickle.h"
+#include "toolchain.h"
+#include "rbc_mesh.h"
+#include "mesh_packet.h"
+
+#include "nrf_error.h"
+#include "app_error.h"
+#include <string.h>
+
+#if RBC_MESH_DIGEST
+
+#define DIGEST_BEACON_OVERHEAD          (2)                 /**< Bytes in front of the digests */
+#define DIGEST_BEACON_BUCKETS_MAX       ((RBC_MESH_VALUE_MAX_LEN - DIGEST_BEACON_OVERHEAD) / sizeof(uint16_t))
+#define DIGEST_TIMER_MARGIN_US          (1000)              /**< Beacons this close to their trickle timeout are due, the scheduler fires a little early */
+
+/******************************************************************************
+* Local typedefs
+******************************************************************************/
+/** Payload of a digest beacon. The beacon sequence number is carried in the
+  version field. */
+typedef __packed_armcc struct
+{
+    uint8_t  bucket_count;          /**< Sender's RBC_MESH_DIGEST_BUCKETS, beacons with another count are ignored. */
+    uint8_t  first_bucket;          /**< Bucket of the first digest. */
+    uint16_t digests[DIGEST_BEACON_BUCKETS_MAX]; /**< Digests of consecutive buckets, as many as the length says. */
+} __packed_gcc digest_beacon_t;
+
+/******************************************************************************
+* Static globals
+******************************************************************************/
+static trickle_t            m_trickle;
+static timer_event_t        m_timer_evt;
+static uint16_t             m_seq;              /**< Sequence number of the last beacon sent */
+static uint8_t              m_next_bucket;      /**< First bucket of the next beacon */
+static digest_stats_t       m_stats;
+
+/******************************************************************************
+* Static functions
+******************************************************************************/
+static void beacon_timeout(uint32_t timestamp, void* p_context);
+
+static void beacon_schedule(uint32_t time_now)
+{
+    if (timer_sch_reschedule(&m_timer_evt, m_trickle.t) != NRF_SUCCESS)
+    {
+        /* run the timeout from the event queue, it will try again */
+        async_event_t evt;
+        evt.type = EVENT_TYPE_TIMER_SCH;
+        evt.callback.timer_sch.cb = beacon_timeout;
+        evt.callback.timer_sch.timestamp = time_now;
+        evt.callback.timer_sch.p_context = NULL;
+        event_handler_push_coalesced(&evt);
+    }
+}
+
+static void beacon_tx(void)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return;
+    }
+
+    uint16_t digests[DIGEST_BEACON_BUCKETS_MAX];
+    uint32_t count = RBC_MESH_DIGEST_BUCKETS - m_next_bucket;
+    if (count > DIGEST_BEACON_BUCKETS_MAX)
+    {
+        count = DIGEST_BEACON_BUCKETS_MAX;
+    }
+    APP_ERROR_CHECK(handle_storage_digest_get(m_next_bucket, digests, count));
+
+    digest_beacon_t beacon;
+    beacon.bucket_count = RBC_MESH_DIGEST_BUCKETS;
+    beacon.first_bucket = m_next_bucket;
+    memcpy(beacon.digests, digests, count * sizeof(uint16_t));
+
+    tc_tx_config_t tx_config;
+    vh_tx_config_get(&tx_config);
+    if (mesh_packet_build(p_packet, MESH_DIGEST_HANDLE, m_seq + 1, (uint8_t*) &beacon,
+                          DIGEST_BEACON_OVERHEAD + count * sizeof(uint16_t)) == NRF_SUCCESS &&
+        tc_tx(p_packet, &tx_config) == NRF_SUCCESS)
+    {
+        m_seq++;
+        m_next_bucket = (m_next_bucket + count < RBC_MESH_DIGEST_BUCKETS) ? m_next_bucket + count : 0;
+        m_stats.tx++;
+    }
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+static void beacon_timeout(uint32_t timestamp, void* p_context)
+{
+    if (!TIMER_OLDER_THAN(timestamp + DIGEST_TIMER_MARGIN_US, m_trickle.t))
+    {
+        bool do_tx = false;
+        trickle_tx_timeout(&m_trickle, &do_tx, timestamp);
+        if (do_tx)
+        {
+            beacon_tx();
+            trickle_tx_register(&m_trickle, timestamp);
+        }
+    }
+    beacon_schedule(timestamp);
+}
+
+/******************************************************************************
+* Interface functions
+******************************************************************************/
+void digest_init(void)
+{
+    m_seq = 0;
+    m_next_bucket = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    /* beacons start at the default pace, and keep coming at i_max */
+    trickle_profile_t profile;
+    APP_ERROR_CHECK(trickle_profile_get(TRICKLE_PROFILE_DEFAULT, &profile));
+    profile.i_max = RBC_MESH_DIGEST_INTERVAL_MAX_MS * 1000; /* ms -> us */
+    if (profile.i_max < profile.i_min)
+    {
+        profile.i_max = profile.i_min;
+    }
+    APP_ERROR_CHECK(trickle_profile_set(RBC_MESH_DIGEST_TRICKLE_PROFILE, &profile));
+
+    memset(&m_trickle, 0, sizeof(m_trickle));
+    m_trickle.profile = RBC_MESH_DIGEST_TRICKLE_PROFILE;
+
+    m_timer_evt.p_next = NULL;
+    m_timer_evt.cb = beacon_timeout;
+    m_timer_evt.interval = 0;
+    m_timer_evt.p_context = NULL;
+
+    uint32_t time_now = timer_now();
+    trickle_timer_reset(&m_trickle, time_now);
+    beacon_schedule(time_now);
+}
+
+void digest_rx(mesh_packet_t* p_packet, uint32_t timestamp)
+{
+    mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packet);
+    if (p_adv_data == NULL ||
+        p_adv_data->adv_data_length < MESH_PACKET_ADV_OVERHEAD + DIGEST_BEACON_OVERHEAD + sizeof(uint16_t) ||
+        p_adv_data->adv_data_length > MESH_PACKET_ADV_OVERHEAD + sizeof(digest_beacon_t))
+    {
+        return;
+    }
+
+    digest_beacon_t beacon;
+    uint32_t length = p_adv_data->adv_data_length - MESH_PACKET_ADV_OVERHEAD;
+    memcpy(&beacon, p_adv_data->data, length);
+    uint32_t count = (length - DIGEST_BEACON_OVERHEAD) / sizeof(uint16_t);
+    if (beacon.bucket_count != RBC_MESH_DIGEST_BUCKETS ||
+        beacon.first_bucket + count > RBC_MESH_DIGEST_BUCKETS)
+    {
+        return;
+    }
+
+    uint16_t digests[DIGEST_BEACON_BUCKETS_MAX];
+    APP_ERROR_CHECK(handle_storage_digest_get(beacon.first_bucket, digests, count));
+    bool consistent = true;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (digests[i] != beacon.digests[i])
+        {
+            handle_storage_digest_bucket_reset(beacon.first_bucket + i, timestamp);
+            m_stats.bucket_resets++;
+            consistent = false;
+        }
+    }
+
+    if (consistent)
+    {
+        trickle_rx_consistent(&m_trickle, timestamp);
+    }
+    else
+    {
+        /* the reset values are due before the pending transmission */
+        vh_order_update(timestamp);
+    }
+}
+
+void digest_stats_get(digest_stats_t* p_stats)
+{
+    memcpy(p_stats, &m_stats, sizeof(digest_stats_t));
+}
+
+#else /* RBC_MESH_DIGEST */
+
+void digest_init(void)
+{
+}
+
+void digest_rx(mesh_packet_t* p_packet, uint32_t timestamp)
+{
+}
+
+void digest_stats_get(digest_stats_t* p_stats)
+{
+    memset(p_stats, 0, sizeof(digest_stats_t));
+}
+
+#endif /* RBC_MESH_DIGEST */
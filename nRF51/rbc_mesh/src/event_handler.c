@@ -37,133 +37,232 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "nrf_soc.h"
 #include "toolchain.h"
 #include "handle_storage.h"
+#include "trace.h"
+#include "latency.h"
 #include <string.h>
 #include "rbc_mesh.h"
 
 
 #define EVENT_HANDLER_IRQ       (QDEC_IRQn)
+#define COALESCE_SLOTS          (2)
+#define COALESCE_SLOT_NONE      (0xFF)
 
 
 
-static fifo_t g_async_evt_fifo;
+/** Queue entry, with the time of the push for latency tracking. */
+typedef struct
+{
+    async_event_t evt;
+    timestamp_t timestamp;
+    bool pushed_in_ts;
+    uint8_t coalesce_slot; /* COALESCE_SLOT_NONE if not coalescable */
+} queued_event_t;
 
-static async_event_t g_async_evt_fifo_buffer[RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH];
-static fifo_t g_async_evt_fifo_ts;
+/** A coalescable timer scheduler callback with an event in the queue. */
+typedef struct
+{
+    bool pending;
+    timer_sch_callback_t cb;
+    void* p_context;
+    timestamp_t timestamp; /* earliest of the coalesced requests */
+} coalesce_slot_t;
 
-static async_event_t g_async_evt_fifo_buffer_ts[RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH];
+typedef struct
+{
+    fifo_t fifo;
+    uint32_t budget; /* events to dispatch per round */
+    uint32_t flush_count; /* number of flushes, for events executed in place */
+    event_handler_stats_t stats;
+} event_queue_t;
+
+static queued_event_t g_generic_evt_buffer[RBC_MESH_GENERIC_EVENT_QUEUE_LENGTH];
+static queued_event_t g_timer_evt_buffer[RBC_MESH_TIMER_EVENT_QUEUE_LENGTH];
+static queued_event_t g_packet_evt_buffer[RBC_MESH_PACKET_EVENT_QUEUE_LENGTH];
+static queued_event_t g_timeslot_evt_buffer[RBC_MESH_TIMESLOT_EVENT_QUEUE_LENGTH];
+
+static event_queue_t g_evt_queues[EVENT_CLASS__COUNT];
+static coalesce_slot_t g_coalesce_slots[COALESCE_SLOTS];
 static bool g_is_initialized;
 static uint32_t g_critical = 0;
 
-
-#if defined(WITH_ACK_MASTER)
-static uint32_t event_handler_counter[5] __attribute__((at(0x200031D0)))={0};
-#endif
-
-#if defined(WITHOUT_ACK_MASTER)
-static uint32_t event_handler_counter[5]__attribute__((at(0x200028B8)))={0};
-#endif
-
-#if defined(WITH_ACK_SLAVE)
-static uint32_t event_handler_counter[5] __attribute__((at(0x200028CC))) ={0};
-#endif
-
-#if defined(WITHOUT_ACK_SLAVE)
-static uint32_t event_handler_counter[5] __attribute__((at(0x200028B4)))={0};
-#endif
+static uint32_t g_executed_count[EVENT_TYPE__COUNT]; /**< Only touched by the dispatcher */
 
 /**
 * @brief execute asynchronous event, based on type
 */
 static void async_event_execute(async_event_t* p_evt)
 {
-
     switch (p_evt->type)
     {
         case EVENT_TYPE_TIMER:
             CHECK_FP(p_evt->callback.timer.cb);
             p_evt->callback.timer.cb(p_evt->callback.timer.timestamp);
-        
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-		    event_handler_counter[0]++;
-            #endif
             break;
         case EVENT_TYPE_GENERIC:
             CHECK_FP(p_evt->callback.generic.cb);
             p_evt->callback.generic.cb(p_evt->callback.generic.p_context);
-        
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-		    event_handler_counter[1]++;
-            #endif
-        
-            break;
-        case EVENT_TYPE_PACKET:
-            tc_packet_handler(p_evt->callback.packet.payload,
-                              p_evt->callback.packet.crc,
-                              p_evt->callback.packet.timestamp,
-                              p_evt->callback.packet.rssi);
-        
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-		    event_handler_counter[2]++;
-            #endif
-        
             break;
         case EVENT_TYPE_SET_FLAG:
             handle_storage_flag_set(p_evt->callback.set_flag.handle,
                                     (handle_flag_t) p_evt->callback.set_flag.flag,
                                     p_evt->callback.set_flag.value);
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-			event_handler_counter[3]++;
-            #endif
-        
+            break;
+        case EVENT_TYPE_SET_TRICKLE_PROFILE:
+            handle_storage_trickle_profile_set(p_evt->callback.set_trickle_profile.handle,
+                                               p_evt->callback.set_trickle_profile.profile);
             break;
         case EVENT_TYPE_TIMER_SCH:
             CHECK_FP(p_evt->callback.timer_sch.cb);
             p_evt->callback.timer_sch.cb(p_evt->callback.timer_sch.timestamp,
                                          p_evt->callback.timer_sch.p_context);
-        
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-		    event_handler_counter[4]++;
-            #endif
             break;
         default:
             break;
     }
 }
 
-static bool event_fifo_pop(fifo_t* evt_fifo)
+/** Free the slots of events executed in place, unless the queue was flushed under them. */
+static void event_queue_release(event_queue_t* p_queue, uint32_t flush_count, uint32_t count)
 {
-    SET_PIN(PIN_SWI0);
-    async_event_t evt;
-    uint32_t error_code = fifo_pop(evt_fifo, &evt);
-    if (error_code == NRF_SUCCESS)
+    if (p_queue->fifo.mode == FIFO_MODE_SPSC)
     {
-        async_event_execute(&evt);
-        CLEAR_PIN(PIN_SWI0);
-        return true;
+        /* only the consumer flushes an SPSC queue */
+        fifo_pop_n(&p_queue->fifo, NULL, &count);
+    }
+    else
+    {
+        uint32_t was_masked;
+        _DISABLE_IRQS(was_masked);
+        if (p_queue->flush_count == flush_count)
+        {
+            fifo_pop_n(&p_queue->fifo, NULL, &count);
+        }
+        _ENABLE_IRQS(was_masked);
     }
-    CLEAR_PIN(PIN_SWI0);
-    return false;
 }
 
-/**
-* @brief Async event dispatcher, works in APP LOW
-*/
-void QDEC_IRQHandler(void)
+static void event_latency_record(event_queue_t* p_queue, queued_event_t* p_queued_evt)
 {
-    while (true)
+    if (p_queued_evt->pushed_in_ts && timeslot_is_in_ts())
     {
-        bool got_evt = false;
+        uint32_t latency = timer_now() - p_queued_evt->timestamp;
+        if (latency > p_queue->stats.max_latency_us)
+        {
+            p_queue->stats.max_latency_us = latency;
+        }
+    }
+}
 
-        got_evt |= event_fifo_pop(&g_async_evt_fifo);
+/** Queue latency of an event for the trace, saturated. Only known for events
+  pushed in the current timeslot. */
+static inline uint16_t event_trace_latency(const queued_event_t* p_queued_evt)
+{
+    if (p_queued_evt->pushed_in_ts && timeslot_is_in_ts())
+    {
+        uint32_t latency = timer_now() - p_queued_evt->timestamp;
+        return (latency < UINT16_MAX ? latency : UINT16_MAX);
+    }
+    return UINT16_MAX;
+}
 
-        if (timeslot_is_in_ts()) /* in timeslot */
+static bool event_queue_pop(event_queue_t* p_queue)
+{
+    /* the event is executed in its queue slot, which is freed afterwards */
+    queued_event_t* p_queued_evt = fifo_peek_ptr(&p_queue->fifo, 0);
+    if (p_queued_evt != NULL)
+    {
+        uint32_t flush_count = p_queue->flush_count;
+        if (p_queued_evt->coalesce_slot != COALESCE_SLOT_NONE)
         {
-            got_evt |= event_fifo_pop(&g_async_evt_fifo_ts);
+            /* release the slot before executing, so the callback can be requested again */
+            uint32_t was_masked;
+            _DISABLE_IRQS(was_masked);
+            coalesce_slot_t* p_slot = &g_coalesce_slots[p_queued_evt->coalesce_slot];
+            p_queued_evt->evt.callback.timer_sch.timestamp = p_slot->timestamp;
+            p_slot->pending = false;
+            _ENABLE_IRQS(was_masked);
         }
+        event_latency_record(p_queue, p_queued_evt);
+        TRACE(TRACE_ID_EVENT_START, p_queued_evt->evt.type, event_trace_latency(p_queued_evt));
+        async_event_execute(&p_queued_evt->evt);
+        g_executed_count[p_queued_evt->evt.type]++;
+        TRACE(TRACE_ID_EVENT_END, p_queued_evt->evt.type, 0);
+        event_queue_release(p_queue, flush_count, 1);
+        return true;
+    }
+    return false;
+}
+
+/** Hand all pending packets, up to the batch size, to the transport in one
+  call. The packets are processed in their queue slots. */
+static bool event_queue_pop_packets(event_queue_t* p_queue)
+{
+    packet_event_t* p_packets[RBC_MESH_RX_BATCH_MAX];
+    uint32_t count = 0;
+    uint32_t flush_count = p_queue->flush_count;
+    queued_event_t* p_queued_evt;
+    while (count < RBC_MESH_RX_BATCH_MAX &&
+           (p_queued_evt = fifo_peek_ptr(&p_queue->fifo, count)) != NULL)
+    {
+        event_latency_record(p_queue, p_queued_evt);
+        LATENCY_RECORD(LATENCY_STAGE_DISPATCH, p_queued_evt->evt.callback.packet.timestamp);
+        p_packets[count++] = &p_queued_evt->evt.callback.packet;
+    }
+
+    if (count > 0)
+    {
+        TRACE(TRACE_ID_EVENT_START, EVENT_TYPE_PACKET, event_trace_latency(fifo_peek_ptr(&p_queue->fifo, 0)));
+        tc_packet_batch_handler(p_packets, count);
+        TRACE(TRACE_ID_EVENT_END, EVENT_TYPE_PACKET, 0);
+        g_executed_count[EVENT_TYPE_PACKET] += count;
+        event_queue_release(p_queue, flush_count, count);
+    }
+    return (count > 0);
+}
 
-        if (!got_evt)
+static void event_queue_init(event_class_t event_class, queued_event_t* p_buffer, uint32_t length, uint32_t budget, fifo_mode_t mode)
+{
+    event_queue_t* p_queue = &g_evt_queues[event_class];
+    p_queue->fifo.array_len = length;
+    p_queue->fifo.elem_array = p_buffer;
+    p_queue->fifo.elem_size = sizeof(queued_event_t);
+    p_queue->fifo.memcpy_fptr = NULL;
+    p_queue->fifo.mode = mode;
+    fifo_init(&p_queue->fifo);
+    p_queue->budget = budget;
+    p_queue->flush_count = 0;
+    memset(&p_queue->stats, 0, sizeof(event_handler_stats_t));
+}
+
+/**
+* @brief Async event dispatcher, works in APP LOW. Visits the queues in class
+*   order, and dispatches up to the class budget from each queue per round,
+*   until all queues are empty. Packets are dispatched in batches, where each
+*   batch counts as one event against the budget.
+*/
+void QDEC_IRQHandler(void)
+{
+    bool got_evt = true;
+    while (got_evt)
+    {
+        got_evt = false;
+        for (uint32_t i = 0; i < EVENT_CLASS__COUNT; ++i)
         {
-            break;
+            if (i == EVENT_CLASS_TIMESLOT && !timeslot_is_in_ts())
+            {
+                continue;
+            }
+            for (uint32_t j = 0; j < g_evt_queues[i].budget; ++j)
+            {
+                bool popped = (i == EVENT_CLASS_PACKET) ?
+                    event_queue_pop_packets(&g_evt_queues[i]) :
+                    event_queue_pop(&g_evt_queues[i]);
+                if (!popped)
+                {
+                    break;
+                }
+                got_evt = true;
+            }
         }
     }
 }
@@ -175,20 +274,16 @@ void event_handler_init(void)
         /* may be called twice when in serial mode, can safely skip the second time */
         return;
     }
-    /* init event queues */
-  
-     g_async_evt_fifo.array_len =RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH ;
-    g_async_evt_fifo.elem_array = g_async_evt_fifo_buffer;
-    g_async_evt_fifo.elem_size = sizeof(async_event_t);
-    g_async_evt_fifo.memcpy_fptr = NULL;
-    fifo_init(&g_async_evt_fifo);
-
- 
-    g_async_evt_fifo_ts.array_len = RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH; 
-    g_async_evt_fifo_ts.elem_array = g_async_evt_fifo_buffer_ts;
-    g_async_evt_fifo_ts.elem_size = sizeof(async_event_t);
-    g_async_evt_fifo_ts.memcpy_fptr = NULL;
-    fifo_init(&g_async_evt_fifo_ts);
+    /* init event queues. Packets are only pushed by the radio ISR, and need no locking. */
+    event_queue_init(EVENT_CLASS_GENERIC, g_generic_evt_buffer,
+            RBC_MESH_GENERIC_EVENT_QUEUE_LENGTH, RBC_MESH_GENERIC_EVENT_BUDGET, FIFO_MODE_LOCKED);
+    event_queue_init(EVENT_CLASS_TIMER, g_timer_evt_buffer,
+            RBC_MESH_TIMER_EVENT_QUEUE_LENGTH, RBC_MESH_TIMER_EVENT_BUDGET, FIFO_MODE_LOCKED);
+    event_queue_init(EVENT_CLASS_PACKET, g_packet_evt_buffer,
+            RBC_MESH_PACKET_EVENT_QUEUE_LENGTH, RBC_MESH_PACKET_EVENT_BUDGET, FIFO_MODE_SPSC);
+    event_queue_init(EVENT_CLASS_TIMESLOT, g_timeslot_evt_buffer,
+            RBC_MESH_TIMESLOT_EVENT_QUEUE_LENGTH, RBC_MESH_TIMESLOT_EVENT_BUDGET, FIFO_MODE_LOCKED);
+    memset(g_coalesce_slots, 0, sizeof(g_coalesce_slots));
 
     NVIC_EnableIRQ(EVENT_HANDLER_IRQ);
 #ifdef NRF51
@@ -200,28 +295,65 @@ void event_handler_init(void)
 }
 
 
-uint32_t event_handler_push(async_event_t* p_evt)
+static event_queue_t* event_queue_get(event_type_t type)
 {
-    if (p_evt == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
-    fifo_t* p_fifo = NULL;
-    switch (p_evt->type)
+    switch (type)
     {
     case EVENT_TYPE_GENERIC:
-    case EVENT_TYPE_PACKET:
     case EVENT_TYPE_SET_FLAG:
+    case EVENT_TYPE_SET_TRICKLE_PROFILE:
+        return &g_evt_queues[EVENT_CLASS_GENERIC];
     case EVENT_TYPE_TIMER_SCH:
-        p_fifo = &g_async_evt_fifo;
-        break;
+        return &g_evt_queues[EVENT_CLASS_TIMER];
+    case EVENT_TYPE_PACKET:
+        return &g_evt_queues[EVENT_CLASS_PACKET];
     case EVENT_TYPE_TIMER:
-        p_fifo = &g_async_evt_fifo_ts;
-        break;
+        return &g_evt_queues[EVENT_CLASS_TIMESLOT];
     default:
-        return NRF_ERROR_INVALID_PARAM;
+        return NULL;
+    }
+}
+
+static uint32_t event_queue_push(event_queue_t* p_queue, async_event_t* p_evt, uint8_t coalesce_slot)
+{
+    bool pushed_in_ts = timeslot_is_in_ts();
+    timestamp_t timestamp = (pushed_in_ts ? timer_now() : 0);
+
+    /* the push counters of an SPSC queue are only touched by its producer */
+    bool locked = (p_queue->fifo.mode == FIFO_MODE_LOCKED);
+    uint32_t was_masked = 0;
+    if (locked)
+    {
+        _DISABLE_IRQS(was_masked);
+    }
+    /* fill the queue slot in place */
+    uint32_t result = NRF_ERROR_NO_MEM;
+    queued_event_t* p_queued_evt = fifo_push_reserve(&p_queue->fifo);
+    if (p_queued_evt != NULL)
+    {
+        p_queued_evt->evt = *p_evt;
+        p_queued_evt->timestamp = timestamp;
+        p_queued_evt->pushed_in_ts = pushed_in_ts;
+        p_queued_evt->coalesce_slot = coalesce_slot;
+        fifo_push_commit(&p_queue->fifo);
+        result = NRF_SUCCESS;
+
+        p_queue->stats.pushed++;
+        uint32_t depth = fifo_get_len(&p_queue->fifo);
+        if (depth > p_queue->stats.max_depth)
+        {
+            p_queue->stats.max_depth = depth;
+        }
+    }
+    else
+    {
+        p_queue->stats.dropped++;
+    }
+    if (locked)
+    {
+        _ENABLE_IRQS(was_masked);
     }
-    uint32_t result = fifo_push(p_fifo, p_evt);
+
     if (result != NRF_SUCCESS)
     {
         return result;
@@ -233,20 +365,126 @@ uint32_t event_handler_push(async_event_t* p_evt)
     return NRF_SUCCESS;
 }
 
+uint32_t event_handler_push(async_event_t* p_evt)
+{
+    if (p_evt == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    event_queue_t* p_queue = event_queue_get(p_evt->type);
+    if (p_queue == NULL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return event_queue_push(p_queue, p_evt, COALESCE_SLOT_NONE);
+}
+
+uint32_t event_handler_push_coalesced(async_event_t* p_evt)
+{
+    if (p_evt == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (p_evt->type != EVENT_TYPE_TIMER_SCH)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    event_queue_t* p_queue = &g_evt_queues[EVENT_CLASS_TIMER];
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    uint8_t free_slot = COALESCE_SLOT_NONE;
+    for (uint32_t i = 0; i < COALESCE_SLOTS; ++i)
+    {
+        coalesce_slot_t* p_slot = &g_coalesce_slots[i];
+        if (!p_slot->pending)
+        {
+            if (free_slot == COALESCE_SLOT_NONE)
+            {
+                free_slot = i;
+            }
+        }
+        else if (p_slot->cb == p_evt->callback.timer_sch.cb &&
+                 p_slot->p_context == p_evt->callback.timer_sch.p_context)
+        {
+            /* already queued, fold this request into it */
+            if (TIMER_OLDER_THAN(p_evt->callback.timer_sch.timestamp, p_slot->timestamp))
+            {
+                p_slot->timestamp = p_evt->callback.timer_sch.timestamp;
+            }
+            p_queue->stats.coalesced++;
+            _ENABLE_IRQS(was_masked);
+            return NRF_SUCCESS;
+        }
+    }
+    if (free_slot != COALESCE_SLOT_NONE)
+    {
+        g_coalesce_slots[free_slot].pending = true;
+        g_coalesce_slots[free_slot].cb = p_evt->callback.timer_sch.cb;
+        g_coalesce_slots[free_slot].p_context = p_evt->callback.timer_sch.p_context;
+        g_coalesce_slots[free_slot].timestamp = p_evt->callback.timer_sch.timestamp;
+    }
 
+    /* with all slots taken, the event is queued without coalescing */
+    uint32_t error_code = event_queue_push(p_queue, p_evt, free_slot);
+    if (error_code != NRF_SUCCESS && free_slot != COALESCE_SLOT_NONE)
+    {
+        g_coalesce_slots[free_slot].pending = false;
+    }
+    _ENABLE_IRQS(was_masked);
+    return error_code;
+}
 
 void event_handler_on_ts_end(void)
 {
-    fifo_flush(&g_async_evt_fifo_ts);
+    event_queue_t* p_queue = &g_evt_queues[EVENT_CLASS_TIMESLOT];
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    p_queue->stats.flushed += fifo_get_len(&p_queue->fifo);
+    fifo_flush(&p_queue->fifo);
+    p_queue->flush_count++;
+    _ENABLE_IRQS(was_masked);
 }
 
 void event_handler_on_ts_begin(void)
 {
-    if (!fifo_is_empty(&g_async_evt_fifo) ||
-        !fifo_is_empty(&g_async_evt_fifo_ts))
+    for (uint32_t i = 0; i < EVENT_CLASS__COUNT; ++i)
+    {
+        if (!fifo_is_empty(&g_evt_queues[i].fifo))
+        {
+            NVIC_SetPendingIRQ(EVENT_HANDLER_IRQ);
+            break;
+        }
+    }
+}
+
+uint32_t event_handler_stats_get(event_class_t event_class, event_handler_stats_t* p_stats)
+{
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (event_class >= EVENT_CLASS__COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(p_stats, &g_evt_queues[event_class].stats, sizeof(event_handler_stats_t));
+    p_stats->depth = fifo_get_len(&g_evt_queues[event_class].fifo);
+    _ENABLE_IRQS(was_masked);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t event_handler_executed_count_get(event_type_t event_type)
+{
+    if (event_type >= EVENT_TYPE__COUNT)
     {
-        NVIC_SetPendingIRQ(EVENT_HANDLER_IRQ);
+        return 0;
     }
+    return g_executed_count[event_type];
 }
 
 void event_handler_critical_section_begin(void)
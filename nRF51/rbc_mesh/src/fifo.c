@@ -38,6 +38,40 @@
 #define FIFO_ELEM_AT(p_fifo, index) ((uint8_t*) ((uint8_t*) p_fifo->elem_array) + (p_fifo->elem_size) * (index))
 #define FIFO_IS_FULL(p_fifo) (p_fifo->tail + p_fifo->array_len == p_fifo->head)
 #define FIFO_IS_EMPTY(p_fifo) (p_fifo->tail == p_fifo->head)
+
+/* SPSC fifos rely on the ordering of the head and tail updates alone */
+#define FIFO_LOCK(p_fifo, was_masked) do { if (p_fifo->mode == FIFO_MODE_LOCKED) { _DISABLE_IRQS(was_masked); } } while (0)
+#define FIFO_UNLOCK(p_fifo, was_masked) do { if (p_fifo->mode == FIFO_MODE_LOCKED) { _ENABLE_IRQS(was_masked); } } while (0)
+
+static void elems_copy_in(fifo_t* p_fifo, uint32_t index, const uint8_t* p_src, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        void* p_dest = FIFO_ELEM_AT(p_fifo, (index + i) & (p_fifo->array_len - 1));
+
+        if (p_fifo->memcpy_fptr)
+            p_fifo->memcpy_fptr(p_dest, p_src);
+        else
+            memcpy(p_dest, p_src, p_fifo->elem_size);
+
+        p_src += p_fifo->elem_size;
+    }
+}
+
+static void elems_copy_out(fifo_t* p_fifo, uint32_t index, uint8_t* p_dest, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        void* p_src = FIFO_ELEM_AT(p_fifo, (index + i) & (p_fifo->array_len - 1));
+
+        if (p_fifo->memcpy_fptr)
+            p_fifo->memcpy_fptr(p_dest, p_src);
+        else
+            memcpy(p_dest, p_src, p_fifo->elem_size);
+
+        p_dest += p_fifo->elem_size;
+    }
+}
 /*****************************************************************************
  * Interface functions
  *****************************************************************************/
@@ -54,57 +88,72 @@ void fifo_init(fifo_t* p_fifo)
 
 uint32_t fifo_push(fifo_t* p_fifo, const void* p_elem)
 {
-    if (p_elem == NULL)
+    return fifo_push_n(p_fifo, p_elem, 1);
+}
+
+uint32_t fifo_pop(fifo_t* p_fifo, void* p_elem)
+{
+    uint32_t count = 1;
+    return fifo_pop_n(p_fifo, p_elem, &count);
+}
+
+uint32_t fifo_push_n(fifo_t* p_fifo, const void* p_elems, uint32_t count)
+{
+    if (p_elems == NULL)
     {
         return NRF_ERROR_NULL;
     }
-    uint32_t was_masked;
-    _DISABLE_IRQS(was_masked);
-    if (FIFO_IS_FULL(p_fifo))
+    uint32_t was_masked = 0;
+    FIFO_LOCK(p_fifo, was_masked);
+    /* only the producer moves the head */
+    uint32_t head = p_fifo->head;
+    if (p_fifo->array_len - (head - p_fifo->tail) < count)
     {
-        _ENABLE_IRQS(was_masked);
+        FIFO_UNLOCK(p_fifo, was_masked);
         return NRF_ERROR_NO_MEM;
     }
 
-    void* p_dest = FIFO_ELEM_AT(p_fifo, p_fifo->head & (p_fifo->array_len - 1));
-
-    if (p_fifo->memcpy_fptr)
-        p_fifo->memcpy_fptr(p_dest, p_elem);
-    else
-        memcpy(p_dest, p_elem, p_fifo->elem_size);
+    elems_copy_in(p_fifo, head, (const uint8_t*) p_elems, count);
 
-    ++p_fifo->head;
-    _ENABLE_IRQS(was_masked);
+    /* the elements must be in place before the consumer can see them */
+    _MEMORY_BARRIER();
+    p_fifo->head = head + count;
+    FIFO_UNLOCK(p_fifo, was_masked);
     return NRF_SUCCESS;
 }
 
-uint32_t fifo_pop(fifo_t* p_fifo, void* p_elem)
+uint32_t fifo_pop_n(fifo_t* p_fifo, void* p_elems, uint32_t* p_count)
 {
-    uint32_t was_masked;
-    _DISABLE_IRQS(was_masked);
-    if (FIFO_IS_EMPTY(p_fifo))
+    if (p_count == NULL)
     {
-        _ENABLE_IRQS(was_masked);
         return NRF_ERROR_NULL;
     }
-
-    if (p_elem != NULL)
+    uint32_t was_masked = 0;
+    FIFO_LOCK(p_fifo, was_masked);
+    /* only the consumer moves the tail */
+    uint32_t tail = p_fifo->tail;
+    uint32_t len = p_fifo->head - tail;
+    if (len == 0)
     {
-        void* p_src = FIFO_ELEM_AT(p_fifo, p_fifo->tail & (p_fifo->array_len - 1));
-
-        if (p_fifo->memcpy_fptr)
-        {
-            p_fifo->memcpy_fptr(p_elem, p_src);
-        }
-        else
-        {
-            memcpy(p_elem, p_src, p_fifo->elem_size);
-        }
+        FIFO_UNLOCK(p_fifo, was_masked);
+        *p_count = 0;
+        return NRF_ERROR_NULL;
+    }
+    if (*p_count > len)
+    {
+        *p_count = len;
     }
 
-    ++p_fifo->tail;
+    if (p_elems != NULL)
+    {
+        _MEMORY_BARRIER();
+        elems_copy_out(p_fifo, tail, (uint8_t*) p_elems, *p_count);
+    }
 
-    _ENABLE_IRQS(was_masked);
+    /* the elements must be copied out before the producer can reuse their slots */
+    _MEMORY_BARRIER();
+    p_fifo->tail = tail + *p_count;
+    FIFO_UNLOCK(p_fifo, was_masked);
     return NRF_SUCCESS;
 }
 
@@ -114,25 +163,47 @@ uint32_t fifo_peek_at(fifo_t* p_fifo, void* p_elem, uint32_t elem)
     {
         return NRF_ERROR_NULL;
     }
-    uint32_t was_masked;
-    _DISABLE_IRQS(was_masked);
+    uint32_t was_masked = 0;
+    FIFO_LOCK(p_fifo, was_masked);
     if (fifo_get_len(p_fifo) <= elem)
     {
-        _ENABLE_IRQS(was_masked);
+        FIFO_UNLOCK(p_fifo, was_masked);
         return NRF_ERROR_NULL;
     }
 
-    void* p_src = FIFO_ELEM_AT(p_fifo, (p_fifo->tail + elem) & (p_fifo->array_len - 1));
+    _MEMORY_BARRIER();
+    elems_copy_out(p_fifo, p_fifo->tail + elem, (uint8_t*) p_elem, 1);
 
-    if (p_fifo->memcpy_fptr)
-        p_fifo->memcpy_fptr(p_elem, p_src);
-    else
-        memcpy(p_elem, p_src, p_fifo->elem_size);
-
-    _ENABLE_IRQS(was_masked);
+    FIFO_UNLOCK(p_fifo, was_masked);
     return NRF_SUCCESS;
 }
 
+void* fifo_push_reserve(fifo_t* p_fifo)
+{
+    if (FIFO_IS_FULL(p_fifo))
+    {
+        return NULL;
+    }
+    return FIFO_ELEM_AT(p_fifo, p_fifo->head & (p_fifo->array_len - 1));
+}
+
+void fifo_push_commit(fifo_t* p_fifo)
+{
+    /* the element must be in place before the consumer can see it */
+    _MEMORY_BARRIER();
+    ++p_fifo->head;
+}
+
+void* fifo_peek_ptr(fifo_t* p_fifo, uint32_t elem)
+{
+    if (fifo_get_len(p_fifo) <= elem)
+    {
+        return NULL;
+    }
+    _MEMORY_BARRIER();
+    return FIFO_ELEM_AT(p_fifo, (p_fifo->tail + elem) & (p_fifo->array_len - 1));
+}
+
 uint32_t fifo_peek(fifo_t* p_fifo, void* p_elem)
 {
     return fifo_peek_at(p_fifo, p_elem, 0);
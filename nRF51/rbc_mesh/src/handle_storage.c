@@ -32,25 +32,67 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 
 #include "handle_storage.h"
+#include "snapshot.h"
 #include "trickle.h"
 #include "event_handler.h"
 #include "fifo.h"
 #include "rbc_mesh_common.h"
 #include "timer.h"
+#include "trace.h"
 #include "app_error.h"
 
 #define MESH_TRICKLE_I_MAX              (2048)
 #define MESH_TRICKLE_K                  (3)
 
 
-#define HANDLE_CACHE_ENTRY_INVALID      (RBC_MESH_HANDLE_CACHE_ENTRIES)
-#define DATA_CACHE_ENTRY_INVALID        (RBC_MESH_DATA_CACHE_ENTRIES)
+#define HANDLE_CACHE_ENTRY_INVALID      (m_handle_cache_entries)
+#define DATA_CACHE_ENTRY_INVALID        (m_data_cache_entries)
+
+/* The index links of the handle cache are 15 bits wide, and the invalid
+   marker has to fit as well. */
+#define HANDLE_CACHE_ENTRIES_MAX        (0x7FFF)
 
 #define CACHE_TASK_FIFO_SIZE            (8)
 
+#define TX_HEAP_POS_NONE                (m_data_cache_entries)
+#define TX_HEAP_PARENT(pos)             (((pos) - 1) >> 1)
+#define TX_HEAP_CHILD_LEFT(pos)         (((pos) << 1) + 1)
+#define TX_EXPIRED_WORDS(entries)       (((entries) + 31) / 32)
+
 #define HANDLE_CACHE_ITERATE(index)     do { index = m_handle_cache[index].index_next; } while (0)
 #define HANDLE_CACHE_ITERATE_BACK(index)     do { index = m_handle_cache[index].index_prev; } while (0)
 
+#if RBC_MESH_HANDLE_CACHE_HASH_INDEX
+/* Round up to the nearest power of two by smearing the highest set bit downwards */
+#define HANDLE_HASH_SMEAR_1(x)          ((x) | ((x) >> 1))
+#define HANDLE_HASH_SMEAR_2(x)          (HANDLE_HASH_SMEAR_1(x) | (HANDLE_HASH_SMEAR_1(x) >> 2))
+#define HANDLE_HASH_SMEAR_4(x)          (HANDLE_HASH_SMEAR_2(x) | (HANDLE_HASH_SMEAR_2(x) >> 4))
+#define HANDLE_HASH_SMEAR_8(x)          (HANDLE_HASH_SMEAR_4(x) | (HANDLE_HASH_SMEAR_4(x) >> 8))
+#define HANDLE_HASH_SMEAR_16(x)         (HANDLE_HASH_SMEAR_8(x) | (HANDLE_HASH_SMEAR_8(x) >> 16))
+
+/* Keep the load factor of the index at or below 50% to keep probe sequences short */
+#define HANDLE_HASH_SIZE(entries)       (HANDLE_HASH_SMEAR_16(2UL * (entries) - 1) + 1)
+#define HANDLE_HASH_MASK                (m_handle_hash_mask)
+#define HANDLE_HASH_SLOT_EMPTY          (HANDLE_CACHE_ENTRY_INVALID)
+
+/* Fibonacci hashing, takes the upper half of the 32 bit product */
+#define HANDLE_HASH(handle)             (((((uint32_t) (handle)) * 2654435769UL) >> 16) & HANDLE_HASH_MASK)
+#define HANDLE_HASH_NEXT(slot)          (((slot) + 1) & HANDLE_HASH_MASK)
+#endif
+
+#if RBC_MESH_DIGEST
+/* Fibonacci hashing as in the hash index, spread over the digest buckets */
+#define DIGEST_BUCKET(handle)           (((((uint32_t) (handle)) * 2654435769UL) >> 16) % RBC_MESH_DIGEST_BUCKETS)
+#endif
+
+#if RBC_MESH_SNAPSHOT
+/* A handle that changed since the snapshot last got it stays in the cache
+   until the snapshot has it, so that a cleared persistent flag gets written */
+#define HANDLE_ENTRY_PINNED(index)      (m_handle_cache[index].persistent || m_handle_cache[index].snapshot_dirty)
+#else
+#define HANDLE_ENTRY_PINNED(index)      (m_handle_cache[index].persistent)
+#endif
+
 /*****************************************************************************
 * Local Typedefs
 *****************************************************************************/
@@ -63,6 +105,10 @@ typedef struct
     uint16_t                index_prev : 15;    /** linked list index prev */
     uint16_t                persistent : 1;     /** Persistent flag */
     uint16_t                data_entry;         /** index of the associated data entry */
+    uint8_t                 trickle_profile;    /** trickle profile of the handle's data entry */
+#if RBC_MESH_SNAPSHOT
+    uint8_t                 snapshot_dirty : 1; /** Changed since last written to the snapshot */
+#endif
 } handle_entry_t;
 
 typedef struct
@@ -71,13 +117,51 @@ typedef struct
     mesh_packet_t* p_packet;
 } data_entry_t;
 
+#if RBC_MESH_HANDLE_CACHE_HASH_INDEX
+#define HANDLE_HASH_MEMORY_SIZE(handle_entries) (HANDLE_HASH_SIZE(handle_entries) * sizeof(uint16_t))
+#else
+#define HANDLE_HASH_MEMORY_SIZE(handle_entries) (0)
+#endif
+
+/* Bytes of memory needed for the given cache sizes. The members are laid out
+   in order of decreasing alignment, starting with the data cache. */
+#define HANDLE_STORAGE_MEMORY_SIZE(handle_entries, data_entries)   \
+    ((data_entries) * sizeof(data_entry_t) +                       \
+     TX_EXPIRED_WORDS(data_entries) * sizeof(uint32_t) +           \
+     (handle_entries) * sizeof(handle_entry_t) +                   \
+     2 * (data_entries) * sizeof(uint16_t) +                       \
+     HANDLE_HASH_MEMORY_SIZE(handle_entries))
+
 /******************************************************************************
 * Static globals
 ******************************************************************************/
-static handle_entry_t   m_handle_cache[RBC_MESH_HANDLE_CACHE_ENTRIES];
-static data_entry_t     m_data_cache[RBC_MESH_DATA_CACHE_ENTRIES];
+static handle_entry_t*  m_handle_cache;
+static data_entry_t*    m_data_cache;
+static uint16_t         m_handle_cache_entries;
+static uint16_t         m_data_cache_entries;
 static uint32_t         m_handle_cache_head;
 static uint32_t         m_handle_cache_tail;
+static handle_storage_stats_t m_stats;
+#if RBC_MESH_DIGEST
+static uint32_t         m_digests[RBC_MESH_DIGEST_BUCKETS]; /**< Sum of the digest terms of the values in each bucket */
+#endif
+
+/* Data entries with an active trickle instance and a packet, in a min-heap
+   ordered by their next trickle timeout. */
+static uint16_t*        m_tx_heap;
+static uint16_t*        m_tx_heap_pos; /**< Heap position of each data entry */
+static uint16_t         m_tx_heap_size;
+static uint32_t*        m_tx_expired; /**< Scratch set of expired data entries */
+#if RBC_MESH_HANDLE_CACHE_HASH_INDEX
+static uint16_t*        m_handle_hash; /**< Open addressing index into the handle cache */
+static uint32_t         m_handle_hash_mask;
+#endif
+
+#if RBC_MESH_STATIC_ARENA
+/* Storage for the default cache sizes, used when no other memory is given. */
+static void*            m_static_memory[(HANDLE_STORAGE_MEMORY_SIZE(RBC_MESH_HANDLE_CACHE_ENTRIES, RBC_MESH_DATA_CACHE_ENTRIES) + sizeof(void*) - 1) / sizeof(void*)];
+#endif
+static void*            mp_memory;
 
 /*****************************************************************************
 * Static Functions
@@ -94,6 +178,122 @@ static void version_increment(uint16_t* version)
     }
 }
 
+#if RBC_MESH_DIGEST
+/** Contribution of a handle version to the digest of its bucket. Version 0
+  marks a handle without a value, which doesn't count. */
+static uint32_t digest_term(rbc_mesh_value_handle_t handle, uint16_t version)
+{
+    if (version == 0)
+    {
+        return 0;
+    }
+    uint32_t x = ((uint32_t) handle << 16) | version;
+    x *= 2654435769UL;
+    x ^= x >> 15;
+    x *= 2246822519UL;
+    x ^= x >> 13;
+    return x;
+}
+
+/** Move the contribution of a handle to the digests from one version to
+  another. The digests are sums, so this is constant time. */
+static void digest_version_change(rbc_mesh_value_handle_t handle, uint16_t old_version, uint16_t new_version)
+{
+    m_digests[DIGEST_BUCKET(handle)] += digest_term(handle, new_version) - digest_term(handle, old_version);
+}
+#endif
+
+static bool tx_heap_earlier(uint32_t pos_a, uint32_t pos_b)
+{
+    return TIMER_OLDER_THAN(m_data_cache[m_tx_heap[pos_a]].trickle.t,
+                            m_data_cache[m_tx_heap[pos_b]].trickle.t);
+}
+
+static void tx_heap_swap(uint32_t pos_a, uint32_t pos_b)
+{
+    uint16_t temp = m_tx_heap[pos_a];
+    m_tx_heap[pos_a] = m_tx_heap[pos_b];
+    m_tx_heap[pos_b] = temp;
+    m_tx_heap_pos[m_tx_heap[pos_a]] = pos_a;
+    m_tx_heap_pos[m_tx_heap[pos_b]] = pos_b;
+}
+
+static void tx_heap_sift_up(uint32_t pos)
+{
+    while (pos > 0 && tx_heap_earlier(pos, TX_HEAP_PARENT(pos)))
+    {
+        tx_heap_swap(pos, TX_HEAP_PARENT(pos));
+        pos = TX_HEAP_PARENT(pos);
+    }
+}
+
+static void tx_heap_sift_down(uint32_t pos)
+{
+    while (true)
+    {
+        uint32_t earliest = pos;
+        uint32_t child = TX_HEAP_CHILD_LEFT(pos);
+        if (child < m_tx_heap_size && tx_heap_earlier(child, earliest))
+        {
+            earliest = child;
+        }
+        child++;
+        if (child < m_tx_heap_size && tx_heap_earlier(child, earliest))
+        {
+            earliest = child;
+        }
+        if (earliest == pos)
+        {
+            return;
+        }
+        tx_heap_swap(pos, earliest);
+        pos = earliest;
+    }
+}
+
+static void tx_heap_remove(uint16_t data_index)
+{
+    uint32_t pos = m_tx_heap_pos[data_index];
+    m_tx_heap_pos[data_index] = TX_HEAP_POS_NONE;
+    m_tx_heap_size--;
+    if (pos != m_tx_heap_size)
+    {
+        /* fill the hole with the last element, and restore the heap property */
+        uint16_t moved = m_tx_heap[m_tx_heap_size];
+        m_tx_heap[pos] = moved;
+        m_tx_heap_pos[moved] = pos;
+        tx_heap_sift_up(pos);
+        tx_heap_sift_down(m_tx_heap_pos[moved]);
+    }
+}
+
+/** Place the given data entry correctly in the TX schedule. Must be called
+  whenever the entry's trickle timeout, trickle state or packet changes. */
+static void tx_schedule_update(uint16_t data_index)
+{
+    bool schedule = (m_data_cache[data_index].p_packet != NULL &&
+                     trickle_is_enabled(&m_data_cache[data_index].trickle));
+
+    if (m_tx_heap_pos[data_index] == TX_HEAP_POS_NONE)
+    {
+        if (schedule)
+        {
+            m_tx_heap[m_tx_heap_size] = data_index;
+            m_tx_heap_pos[data_index] = m_tx_heap_size;
+            tx_heap_sift_up(m_tx_heap_size++);
+        }
+    }
+    else if (schedule)
+    {
+        tx_heap_sift_up(m_tx_heap_pos[data_index]);
+        tx_heap_sift_down(m_tx_heap_pos[data_index]);
+    }
+    else
+    {
+        tx_heap_remove(data_index);
+    }
+}
+
 static void data_entry_free(data_entry_t* p_data_entry)
 {
     if (p_data_entry == NULL)
@@ -106,21 +306,24 @@ static void data_entry_free(data_entry_t* p_data_entry)
     }
     /* reset trickle params */
     trickle_enable(&p_data_entry->trickle);
+    tx_schedule_update(p_data_entry - &m_data_cache[0]);
 }
 
-/** Allocate a new data entry. Will take the least recently updated entry if all are allocated.
-  Returns the index of the resulting entry. */
-static uint16_t data_entry_allocate(void)
+/** Allocate a new data entry, running with the given trickle profile. Will
+  take the least recently updated entry if all are allocated. Returns the
+  index of the resulting entry. */
+static uint16_t data_entry_allocate(uint8_t trickle_profile)
 {
     static uint16_t allocated = 0;
-    TICK_PIN(7);
 
-    for (uint32_t i = allocated; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
+    for (uint32_t i = allocated; i < m_data_cache_entries; ++i)
     {
         if (m_data_cache[i].p_packet == NULL)
         {
+            m_data_cache[i].trickle.profile = trickle_profile;
             trickle_timer_reset(&m_data_cache[i].trickle, 0);
             allocated++;
+            TRACE(TRACE_ID_DATA_ENTRY_ALLOC, 0, i);
             return i;
         }
     }
@@ -139,21 +342,89 @@ static uint16_t data_entry_allocate(void)
     }
 
     uint32_t data_index = m_handle_cache[handle_index].data_entry;
-    APP_ERROR_CHECK_BOOL(data_index < RBC_MESH_DATA_CACHE_ENTRIES);
+    APP_ERROR_CHECK_BOOL(data_index < m_data_cache_entries);
 
     /* cleanup */
     m_handle_cache[handle_index].data_entry = DATA_CACHE_ENTRY_INVALID;
 
     data_entry_free(&m_data_cache[data_index]);
+    m_data_cache[data_index].trickle.profile = trickle_profile;
     trickle_timer_reset(&m_data_cache[data_index].trickle, 0);
+    m_stats.data_entry_evictions++;
+    TRACE(TRACE_ID_DATA_ENTRY_ALLOC, 1, data_index);
     return data_index;
 }
 
+#if RBC_MESH_HANDLE_CACHE_HASH_INDEX
+/** Get the handle cache index of the given handle from the hash index.
+  Returns HANDLE_CACHE_ENTRY_INVALID if not found. */
+static uint16_t handle_hash_find(rbc_mesh_value_handle_t handle)
+{
+    uint32_t slot = HANDLE_HASH(handle);
+    while (m_handle_hash[slot] != HANDLE_HASH_SLOT_EMPTY)
+    {
+        if (m_handle_cache[m_handle_hash[slot]].handle == handle)
+        {
+            return m_handle_hash[slot];
+        }
+        slot = HANDLE_HASH_NEXT(slot);
+    }
+    return HANDLE_CACHE_ENTRY_INVALID;
+}
+
+/** Add the given handle cache entry to the hash index. The entry's handle
+  must be set, and must not be in the index already. */
+static void handle_hash_insert(uint16_t handle_index)
+{
+    uint32_t slot = HANDLE_HASH(m_handle_cache[handle_index].handle);
+    while (m_handle_hash[slot] != HANDLE_HASH_SLOT_EMPTY)
+    {
+        slot = HANDLE_HASH_NEXT(slot);
+    }
+    m_handle_hash[slot] = handle_index;
+}
+
+/** Remove the given handle from the hash index. Shifts the following entries
+  in the probe sequence back, so that no tombstones are needed. */
+static void handle_hash_remove(rbc_mesh_value_handle_t handle)
+{
+    uint32_t slot = HANDLE_HASH(handle);
+    while (m_handle_hash[slot] != HANDLE_HASH_SLOT_EMPTY &&
+           m_handle_cache[m_handle_hash[slot]].handle != handle)
+    {
+        slot = HANDLE_HASH_NEXT(slot);
+    }
+
+    if (m_handle_hash[slot] == HANDLE_HASH_SLOT_EMPTY)
+    {
+        return; /* not in the index */
+    }
+
+    uint32_t next = slot;
+    while (true)
+    {
+        next = HANDLE_HASH_NEXT(next);
+        if (m_handle_hash[next] == HANDLE_HASH_SLOT_EMPTY)
+        {
+            break;
+        }
+        uint32_t home = HANDLE_HASH(m_handle_cache[m_handle_hash[next]].handle);
+        /* only move the entry if the hole is on its probe sequence */
+        if (((next - home) & HANDLE_HASH_MASK) >= ((next - slot) & HANDLE_HASH_MASK))
+        {
+            m_handle_hash[slot] = m_handle_hash[next];
+            slot = next;
+        }
+    }
+    m_handle_hash[slot] = HANDLE_HASH_SLOT_EMPTY;
+}
+#endif
+
 /** Get the index of the handle entry representing the given handle.
   Returns HANDLE_CACHE_ENTRY_INVALID if not found */
 static uint16_t handle_entry_get(rbc_mesh_value_handle_t handle, bool shortcut)
 {
-    static uint16_t prev_index = HANDLE_CACHE_ENTRY_INVALID;
+    static uint16_t prev_index = UINT16_MAX;
     static uint16_t prev_handle = RBC_MESH_INVALID_HANDLE;
 
     event_handler_critical_section_begin();
@@ -162,7 +433,7 @@ static uint16_t handle_entry_get(rbc_mesh_value_handle_t handle, bool shortcut)
     {
         /* shortcut when accessing the same element in succession. */
         if (prev_handle == handle &&
-            prev_index < RBC_MESH_HANDLE_CACHE_ENTRIES &&
+            prev_index < m_handle_cache_entries &&
             m_handle_cache[prev_index].handle == handle)
         {
             event_handler_critical_section_end();
@@ -170,6 +441,14 @@ static uint16_t handle_entry_get(rbc_mesh_value_handle_t handle, bool shortcut)
         }
     }
 
+#if RBC_MESH_HANDLE_CACHE_HASH_INDEX
+    uint16_t i = handle_hash_find(handle);
+    if (i == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        event_handler_critical_section_end();
+        return HANDLE_CACHE_ENTRY_INVALID;
+    }
+#else
     uint16_t i = m_handle_cache_head;
 
     while (m_handle_cache[i].handle != handle)
@@ -181,6 +460,7 @@ static uint16_t handle_entry_get(rbc_mesh_value_handle_t handle, bool shortcut)
         }
         HANDLE_CACHE_ITERATE(i);
     }
+#endif
 
     if (shortcut)
     {
@@ -202,7 +482,7 @@ static uint16_t handle_entry_to_head(rbc_mesh_value_handle_t handle)
     if (i == HANDLE_CACHE_ENTRY_INVALID)
     {
         i = m_handle_cache_tail;
-        while (m_handle_cache[i].persistent)
+        while (HANDLE_ENTRY_PINNED(i))
         {
             HANDLE_CACHE_ITERATE_BACK(i);
             if (i == HANDLE_CACHE_ENTRY_INVALID)
@@ -211,8 +491,24 @@ static uint16_t handle_entry_to_head(rbc_mesh_value_handle_t handle)
             }
         }
         /* clean up old data */
+#if RBC_MESH_DIGEST
+        if (m_handle_cache[i].handle != RBC_MESH_INVALID_HANDLE)
+        {
+            digest_version_change(m_handle_cache[i].handle, m_handle_cache[i].version, 0);
+        }
+#endif
+#if RBC_MESH_HANDLE_CACHE_HASH_INDEX
+        if (m_handle_cache[i].handle != RBC_MESH_INVALID_HANDLE)
+        {
+            handle_hash_remove(m_handle_cache[i].handle);
+        }
+        m_handle_cache[i].handle = handle;
+        handle_hash_insert(i);
+#else
         m_handle_cache[i].handle = handle;
+#endif
         m_handle_cache[i].tx_event = 0;
+        m_handle_cache[i].trickle_profile = TRICKLE_PROFILE_DEFAULT;
         m_handle_cache[i].version = 0;
         if (m_handle_cache[i].data_entry != DATA_CACHE_ENTRY_INVALID)
         {
@@ -253,6 +549,28 @@ static uint16_t handle_entry_to_head(rbc_mesh_value_handle_t handle)
     return i;
 }
 
+/** Fill in the version and packet of a handle, with a reference to the
+  packet. Call in a critical section. Returns false if the handle isn't in the
+  storage. */
+static bool handle_info_fetch(uint16_t handle, handle_info_t* p_info)
+{
+    uint16_t handle_index = handle_entry_get(handle, false);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        return false;
+    }
+
+    p_info->version = m_handle_cache[handle_index].version;
+    if (m_handle_cache[handle_index].data_entry != DATA_CACHE_ENTRY_INVALID)
+    {
+        if (mesh_packet_ref_count_inc(m_data_cache[m_handle_cache[handle_index].data_entry].p_packet))
+        {
+            p_info->p_packet = m_data_cache[m_handle_cache[handle_index].data_entry].p_packet;
+        }
+    }
+    return true;
+}
+
 void local_packet_push(void* p_context)
 {
     mesh_packet_t* p_packet = (mesh_packet_t*) p_context;
@@ -280,8 +598,47 @@ void local_packet_push(void* p_context)
 /*****************************************************************************
 * Interface Functions
 *****************************************************************************/
+uint32_t handle_storage_memory_size_get(uint32_t handle_cache_entries, uint32_t data_cache_entries)
+{
+    return HANDLE_STORAGE_MEMORY_SIZE(handle_cache_entries, data_cache_entries);
+}
+
+uint32_t handle_storage_memory_set(void* p_memory, uint32_t memory_size, uint16_t handle_cache_entries, uint16_t data_cache_entries)
+{
+    if (data_cache_entries == 0 ||
+        handle_cache_entries < data_cache_entries ||
+        handle_cache_entries > HANDLE_CACHE_ENTRIES_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_memory == NULL || ((uintptr_t) p_memory & (sizeof(void*) - 1)))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (memory_size < HANDLE_STORAGE_MEMORY_SIZE(handle_cache_entries, data_cache_entries))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    mp_memory = p_memory;
+    m_handle_cache_entries = handle_cache_entries;
+    m_data_cache_entries = data_cache_entries;
+    return NRF_SUCCESS;
+}
+
 uint32_t handle_storage_init(uint32_t min_interval_us)
 {
+    if (mp_memory == NULL)
+    {
+#if RBC_MESH_STATIC_ARENA
+        mp_memory = m_static_memory;
+        m_handle_cache_entries = RBC_MESH_HANDLE_CACHE_ENTRIES;
+        m_data_cache_entries = RBC_MESH_DATA_CACHE_ENTRIES;
+#else
+        return NRF_ERROR_INVALID_STATE;
+#endif
+    }
+
     event_handler_critical_section_begin();
     uint32_t error_code = handle_storage_min_interval_set(min_interval_us);
     if (error_code != NRF_SUCCESS)
@@ -290,28 +647,72 @@ uint32_t handle_storage_init(uint32_t min_interval_us)
         return error_code;
     }
 
-    for (uint32_t i = 0; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
+    /* carve the caches out of the memory, most aligned members first */
+    uint8_t* p_next = (uint8_t*) mp_memory;
+    m_data_cache = (data_entry_t*) p_next;
+    p_next += m_data_cache_entries * sizeof(data_entry_t);
+    m_tx_expired = (uint32_t*) p_next;
+    p_next += TX_EXPIRED_WORDS(m_data_cache_entries) * sizeof(uint32_t);
+    m_handle_cache = (handle_entry_t*) p_next;
+    p_next += m_handle_cache_entries * sizeof(handle_entry_t);
+    m_tx_heap = (uint16_t*) p_next;
+    p_next += m_data_cache_entries * sizeof(uint16_t);
+    m_tx_heap_pos = (uint16_t*) p_next;
+    p_next += m_data_cache_entries * sizeof(uint16_t);
+#if RBC_MESH_HANDLE_CACHE_HASH_INDEX
+    m_handle_hash = (uint16_t*) p_next;
+    m_handle_hash_mask = HANDLE_HASH_SIZE(m_handle_cache_entries) - 1;
+#endif
+
+    for (uint32_t i = 0; i < m_data_cache_entries; ++i)
     {
         m_data_cache[i].p_packet = NULL;
+        m_data_cache[i].trickle.profile = TRICKLE_PROFILE_DEFAULT;
+        m_tx_heap_pos[i] = TX_HEAP_POS_NONE;
     }
-
-    for (uint32_t i = 0; i < RBC_MESH_HANDLE_CACHE_ENTRIES; ++i)
+    m_tx_heap_size = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+#if RBC_MESH_DIGEST
+    memset(m_digests, 0, sizeof(m_digests));
+#endif
+    memset(m_tx_expired, 0, TX_EXPIRED_WORDS(m_data_cache_entries) * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < m_handle_cache_entries; ++i)
     {
         m_handle_cache[i].handle = RBC_MESH_INVALID_HANDLE;
         m_handle_cache[i].version = 0;
         m_handle_cache[i].persistent = 0;
         m_handle_cache[i].tx_event = 0;
+#if RBC_MESH_SNAPSHOT
+        m_handle_cache[i].snapshot_dirty = 0;
+#endif
+        m_handle_cache[i].trickle_profile = TRICKLE_PROFILE_DEFAULT;
         m_handle_cache[i].data_entry = DATA_CACHE_ENTRY_INVALID;
         m_handle_cache[i].index_prev = i - 1;
         m_handle_cache[i].index_next = i + 1;
     }
 
     m_handle_cache_head = 0;
-    m_handle_cache_tail = RBC_MESH_HANDLE_CACHE_ENTRIES - 1;
+    m_handle_cache_tail = m_handle_cache_entries - 1;
     m_handle_cache[m_handle_cache_head].index_prev = HANDLE_CACHE_ENTRY_INVALID;
     m_handle_cache[m_handle_cache_tail].index_next = HANDLE_CACHE_ENTRY_INVALID;
 
+#if RBC_MESH_HANDLE_CACHE_HASH_INDEX
+    for (uint32_t i = 0; i <= m_handle_hash_mask; ++i)
+    {
+        m_handle_hash[i] = HANDLE_HASH_SLOT_EMPTY;
+    }
+#endif
+
     event_handler_critical_section_end();
+
+#if RBC_MESH_SNAPSHOT
+    snapshot_restore();
+    for (uint32_t i = 0; i < m_handle_cache_entries; ++i)
+    {
+        m_handle_cache[i].snapshot_dirty = 0; /* the snapshot already has the restored values */
+    }
+#endif
     return NRF_SUCCESS;
 }
 
@@ -339,23 +740,48 @@ uint32_t handle_storage_info_get(uint16_t handle, handle_info_t* p_info)
         return NRF_ERROR_INVALID_ADDR;
     }
     event_handler_critical_section_begin();
+    bool found = handle_info_fetch(handle, p_info);
+    event_handler_critical_section_end();
 
-    uint16_t handle_index = handle_entry_get(handle, false);
-    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    return (found ? NRF_SUCCESS : NRF_ERROR_NOT_FOUND);
+}
+
+uint32_t handle_storage_info_get_n(const uint16_t* p_handles, handle_info_t* p_infos, bool* p_found, uint32_t count)
+{
+    if (p_handles == NULL || p_infos == NULL || p_found == NULL)
     {
-        event_handler_critical_section_end();
-        return NRF_ERROR_NOT_FOUND;
+        return NRF_ERROR_NULL;
     }
-
-    p_info->version = m_handle_cache[handle_index].version;
-    if (m_handle_cache[handle_index].data_entry != DATA_CACHE_ENTRY_INVALID)
+    memset(p_infos, 0, count * sizeof(handle_info_t));
+    event_handler_critical_section_begin();
+    for (uint32_t i = 0; i < count; ++i)
     {
-        if (mesh_packet_ref_count_inc(m_data_cache[m_handle_cache[handle_index].data_entry].p_packet))
+        p_found[i] = false;
+        if (p_handles[i] == RBC_MESH_INVALID_HANDLE)
         {
-            p_info->p_packet = m_data_cache[m_handle_cache[handle_index].data_entry].p_packet;
+            continue;
         }
-    }
 
+        /* values often come in from several neighbors at once */
+        uint32_t j = 0;
+        while (j < i && p_handles[j] != p_handles[i])
+        {
+            j++;
+        }
+        if (j < i)
+        {
+            p_found[i] = p_found[j];
+            p_infos[i].version = p_infos[j].version;
+            if (mesh_packet_ref_count_inc(p_infos[j].p_packet))
+            {
+                p_infos[i].p_packet = p_infos[j].p_packet;
+            }
+        }
+        else
+        {
+            p_found[i] = handle_info_fetch(p_handles[i], &p_infos[i]);
+        }
+    }
     event_handler_critical_section_end();
     return NRF_SUCCESS;
 }
@@ -366,6 +792,22 @@ uint32_t handle_storage_info_set(uint16_t handle, handle_info_t* p_info)
     {
         return NRF_ERROR_NULL;
     }
+
+    handle_storage_slot_t slot;
+    uint32_t error_code = handle_storage_info_reserve(handle, &slot);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    return handle_storage_info_commit(&slot, p_info);
+}
+
+uint32_t handle_storage_info_reserve(uint16_t handle, handle_storage_slot_t* p_slot)
+{
+    if (p_slot == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
     if (handle == RBC_MESH_INVALID_HANDLE)
     {
         return NRF_ERROR_INVALID_ADDR;
@@ -386,16 +828,45 @@ uint32_t handle_storage_info_set(uint16_t handle, handle_info_t* p_info)
 
     if (data_index == DATA_CACHE_ENTRY_INVALID)
     {
-        data_index = data_entry_allocate();
+        data_index = data_entry_allocate(m_handle_cache[handle_index].trickle_profile);
         if (data_index == DATA_CACHE_ENTRY_INVALID)
         {
             return NRF_ERROR_NO_MEM;
         }
         m_handle_cache[handle_index].data_entry = data_index;
     }
+
+    p_slot->handle_index = handle_index;
+    p_slot->data_index = data_index;
+    return NRF_SUCCESS;
+}
+
+uint32_t handle_storage_info_commit(const handle_storage_slot_t* p_slot, handle_info_t* p_info)
+{
+    if (p_slot == NULL || p_info == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    uint16_t handle_index = p_slot->handle_index;
+    uint16_t data_index = p_slot->data_index;
+    if (handle_index >= m_handle_cache_entries ||
+        m_handle_cache[handle_index].data_entry != data_index)
+    {
+        return NRF_ERROR_INVALID_STATE; /* the slot was taken by another handle */
+    }
+
     trickle_timer_reset(&m_data_cache[data_index].trickle, timer_now());
 
+#if RBC_MESH_DIGEST
+    digest_version_change(m_handle_cache[handle_index].handle, m_handle_cache[handle_index].version, p_info->version);
+#endif
     m_handle_cache[handle_index].version = p_info->version;
+#if RBC_MESH_SNAPSHOT
+    if (m_handle_cache[handle_index].persistent)
+    {
+        m_handle_cache[handle_index].snapshot_dirty = 1;
+    }
+#endif
     if (m_data_cache[data_index].p_packet != NULL)
     {
         mesh_packet_ref_count_dec(m_data_cache[data_index].p_packet);
@@ -403,7 +874,8 @@ uint32_t handle_storage_info_set(uint16_t handle, handle_info_t* p_info)
 
     /* reference for the cache */
     mesh_packet_ref_count_inc(p_info->p_packet);
-    m_data_cache[m_handle_cache[handle_index].data_entry].p_packet = p_info->p_packet;
+    m_data_cache[data_index].p_packet = p_info->p_packet;
+    tx_schedule_update(data_index);
     return NRF_SUCCESS;
 }
 
@@ -452,6 +924,12 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
                     return NRF_ERROR_NO_MEM;
                 }
             }
+#if RBC_MESH_SNAPSHOT
+            if (m_handle_cache[handle_index].persistent != value)
+            {
+                m_handle_cache[handle_index].snapshot_dirty = 1;
+            }
+#endif
             m_handle_cache[handle_index].persistent = value;
             break;
 
@@ -480,6 +958,7 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
                     return NRF_SUCCESS; /* the value is already disabled */
                 }
                 trickle_disable(&m_data_cache[m_handle_cache[handle_index].data_entry].trickle);
+                tx_schedule_update(m_handle_cache[handle_index].data_entry);
             }
             else
             {
@@ -511,7 +990,7 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
                 {
                     if (m_handle_cache[handle_index].data_entry == DATA_CACHE_ENTRY_INVALID)
                     {
-                        m_handle_cache[handle_index].data_entry = data_entry_allocate();
+                        m_handle_cache[handle_index].data_entry = data_entry_allocate(m_handle_cache[handle_index].trickle_profile);
                         if (m_handle_cache[handle_index].data_entry == DATA_CACHE_ENTRY_INVALID)
                         {
                             return NRF_ERROR_NO_MEM;
@@ -527,6 +1006,7 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
                         m_data_cache[m_handle_cache[handle_index].data_entry].p_packet = p_packet;
                     }
                     trickle_enable(&m_data_cache[m_handle_cache[handle_index].data_entry].trickle);
+                    tx_schedule_update(m_handle_cache[handle_index].data_entry);
                 }
             }
             break;
@@ -588,6 +1068,75 @@ uint32_t handle_storage_flag_get(uint16_t handle, handle_flag_t flag, bool* p_va
     return NRF_SUCCESS;
 }
 
+uint32_t handle_storage_trickle_profile_set(uint16_t handle, uint8_t profile)
+{
+    if (profile >= RBC_MESH_TRICKLE_PROFILE_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    uint16_t handle_index = handle_entry_get(handle, true);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        handle_index = handle_entry_to_head(handle);
+        if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+    }
+
+    if (m_handle_cache[handle_index].trickle_profile != profile)
+    {
+        m_handle_cache[handle_index].trickle_profile = profile;
+        uint16_t data_index = m_handle_cache[handle_index].data_entry;
+        if (data_index != DATA_CACHE_ENTRY_INVALID)
+        {
+            trickle_profile_assign(&m_data_cache[data_index].trickle, profile, timer_now());
+            tx_schedule_update(data_index);
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t handle_storage_trickle_profile_set_async(uint16_t handle, uint8_t profile)
+{
+    async_event_t evt;
+    evt.type = EVENT_TYPE_SET_TRICKLE_PROFILE;
+    evt.callback.set_trickle_profile.handle = handle;
+    evt.callback.set_trickle_profile.profile = profile;
+    return event_handler_push(&evt);
+}
+
+uint32_t handle_storage_trickle_profile_get(uint16_t handle, uint8_t* p_profile)
+{
+    if (p_profile == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    event_handler_critical_section_begin();
+
+    uint16_t handle_index = handle_entry_get(handle, false);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        event_handler_critical_section_end();
+        return NRF_ERROR_NOT_FOUND;
+    }
+    *p_profile = m_handle_cache[handle_index].trickle_profile;
+
+    event_handler_critical_section_end();
+    return NRF_SUCCESS;
+}
+
 uint32_t handle_storage_rx_consistent(uint16_t handle, uint32_t timestamp)
 {
     if (handle == RBC_MESH_INVALID_HANDLE)
@@ -634,57 +1183,82 @@ uint32_t handle_storage_rx_inconsistent(uint16_t handle, uint32_t timestamp)
     }
 
     trickle_rx_inconsistent(&m_data_cache[data_index].trickle, timestamp);
+    tx_schedule_update(data_index);
 
     return NRF_SUCCESS;
 }
 uint32_t handle_storage_next_timeout_get(bool* p_found_value)
 {
-    uint32_t time_earliest = 0;
-    *p_found_value = false;
-    for (uint32_t i = 0; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
+    if (m_tx_heap_size == 0)
     {
-        if (trickle_is_enabled(&m_data_cache[i].trickle) &&
-            m_data_cache[i].p_packet != NULL &&
-            (!(*p_found_value) || TIMER_OLDER_THAN(m_data_cache[i].trickle.t, time_earliest)))
-        {
-            *p_found_value = true;
-            time_earliest = m_data_cache[i].trickle.t;
-        }
+        *p_found_value = false;
+        return 0;
     }
-    return time_earliest;
+    *p_found_value = true;
+    return m_data_cache[m_tx_heap[0]].trickle.t;
 }
 
-uint32_t handle_storage_tx_packets_get(uint32_t time_now, mesh_packet_t** pp_packets, uint32_t* p_count)
+uint32_t handle_storage_tx_packets_get(uint32_t time_now, uint32_t horizon, mesh_packet_t** pp_packets, uint32_t* p_count)
 {
     /* Continue where we left off */
     static uint16_t data_index = 0;
 
     uint32_t count = 0;
+    uint32_t expired_count = 0;
 
-    for (uint32_t i = 0; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
+    /* take all expired entries out of the schedule */
+    while (m_tx_heap_size > 0 &&
+           !TIMER_OLDER_THAN(horizon, m_data_cache[m_tx_heap[0]].trickle.t))
     {
-        while (data_index >= RBC_MESH_DATA_CACHE_ENTRIES)
-            data_index -= RBC_MESH_DATA_CACHE_ENTRIES;
+        uint16_t expired_index = m_tx_heap[0];
+        tx_heap_remove(expired_index);
+        m_tx_expired[expired_index >> 5] |= (1UL << (expired_index & 0x1F));
+        expired_count++;
+    }
 
-        if ((m_data_cache[data_index].p_packet != NULL) &&
-            (trickle_is_enabled(&m_data_cache[data_index].trickle)) &&
-            !TIMER_OLDER_THAN(time_now, m_data_cache[data_index].trickle.t))
+    /* handle the expired entries in round-robin order */
+    uint16_t index = data_index;
+    while (expired_count > 0)
+    {
+        if (index >= m_data_cache_entries)
         {
-            bool do_tx = false;
-            trickle_tx_timeout(&m_data_cache[data_index].trickle, &do_tx, time_now);
-            if (do_tx)
+            index = 0;
+        }
+        if (m_tx_expired[index >> 5] == 0)
+        {
+            index = (index | 0x1F) + 1; /* skip to next word */
+            continue;
+        }
+        if (m_tx_expired[index >> 5] & (1UL << (index & 0x1F)))
+        {
+            m_tx_expired[index >> 5] &= ~(1UL << (index & 0x1F));
+            expired_count--;
+
+            /* when the packet array is full, the remaining entries are put
+               back in the schedule untouched, and will be handled next time */
+            if (count < *p_count)
             {
-                mesh_packet_ref_count_inc(m_data_cache[data_index].p_packet); /* return the packet with an additional reference */
-                pp_packets[count++] = m_data_cache[data_index].p_packet;
-                if (count == *p_count)
+                bool do_tx = false;
+                trickle_tx_timeout(&m_data_cache[index].trickle, &do_tx, time_now);
+                if (do_tx)
                 {
-                    /* packet array is full */
-                    data_index++;
-                    return NRF_SUCCESS;
+                    mesh_packet_ref_count_inc(m_data_cache[index].p_packet); /* return the packet with an additional reference */
+                    pp_packets[count++] = m_data_cache[index].p_packet;
+                    if (count == *p_count)
+                    {
+                        /* packet array is full */
+                        data_index = index + 1;
+                    }
                 }
             }
+            tx_schedule_update(index);
         }
-        data_index++;
+        index++;
+    }
+
+    if (data_index >= m_data_cache_entries)
+    {
+        data_index = 0;
     }
     *p_count = count;
 
@@ -710,6 +1284,112 @@ uint32_t handle_storage_transmitted(uint16_t handle, uint32_t timestamp)
         return NRF_ERROR_NOT_FOUND;
     }
     trickle_tx_register(&m_data_cache[data_index].trickle, timestamp);
+    tx_schedule_update(data_index);
+
+    return NRF_SUCCESS;
+}
+
+void handle_storage_stats_get(handle_storage_stats_t* p_stats)
+{
+    memcpy(p_stats, &m_stats, sizeof(handle_storage_stats_t));
+    /* counted on demand, as entries are freed from several places */
+    p_stats->data_entries_in_use = 0;
+    for (uint32_t i = 0; i < m_data_cache_entries; ++i)
+    {
+        if (m_data_cache[i].p_packet != NULL)
+        {
+            p_stats->data_entries_in_use++;
+        }
+    }
+}
+
+#if RBC_MESH_DIGEST
+uint32_t handle_storage_digest_get(uint32_t first_bucket, uint16_t* p_digests, uint32_t count)
+{
+    if (p_digests == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (first_bucket + count > RBC_MESH_DIGEST_BUCKETS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
 
+    event_handler_critical_section_begin();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        /* fold the sum, so that the high bits of the terms count as well */
+        uint32_t digest = m_digests[first_bucket + i];
+        p_digests[i] = (uint16_t) (digest ^ (digest >> 16));
+    }
+    event_handler_critical_section_end();
     return NRF_SUCCESS;
 }
+
+uint32_t handle_storage_digest_bucket_reset(uint32_t bucket, uint32_t timestamp)
+{
+    uint32_t reset_count = 0;
+    for (uint32_t i = m_handle_cache_head; i != HANDLE_CACHE_ENTRY_INVALID; i = m_handle_cache[i].index_next)
+    {
+        uint16_t data_index = m_handle_cache[i].data_entry;
+        if (m_handle_cache[i].handle != RBC_MESH_INVALID_HANDLE &&
+            data_index != DATA_CACHE_ENTRY_INVALID &&
+            DIGEST_BUCKET(m_handle_cache[i].handle) == bucket)
+        {
+            trickle_rx_inconsistent(&m_data_cache[data_index].trickle, timestamp);
+            tx_schedule_update(data_index);
+            reset_count++;
+        }
+    }
+    return reset_count;
+}
+#endif
+
+#if RBC_MESH_SNAPSHOT
+uint32_t handle_storage_snapshot_next(uint32_t* p_index, bool all, rbc_mesh_value_handle_t* p_handle, handle_info_t* p_info, bool* p_persistent)
+{
+    if (p_index == NULL || p_handle == NULL || p_info == NULL || p_persistent == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    event_handler_critical_section_begin();
+    for (uint32_t i = *p_index; i < m_handle_cache_entries; ++i)
+    {
+        if (m_handle_cache[i].handle == RBC_MESH_INVALID_HANDLE ||
+            !(m_handle_cache[i].snapshot_dirty || (all && m_handle_cache[i].persistent)))
+        {
+            continue;
+        }
+
+        *p_index = i;
+        *p_handle = m_handle_cache[i].handle;
+        *p_persistent = m_handle_cache[i].persistent;
+        uint16_t data_index = m_handle_cache[i].data_entry;
+        if (data_index == DATA_CACHE_ENTRY_INVALID || m_data_cache[data_index].p_packet == NULL)
+        {
+            p_info->version = 0;
+            p_info->p_packet = NULL;
+        }
+        else
+        {
+            p_info->version = m_handle_cache[i].version;
+            p_info->p_packet = m_data_cache[data_index].p_packet;
+            mesh_packet_ref_count_inc(p_info->p_packet); /* reference for the caller */
+        }
+        event_handler_critical_section_end();
+        return NRF_SUCCESS;
+    }
+    event_handler_critical_section_end();
+    *p_index = m_handle_cache_entries;
+    return NRF_ERROR_NOT_FOUND;
+}
+
+void handle_storage_snapshot_written(uint32_t index)
+{
+    if (index < m_handle_cache_entries)
+    {
+        m_handle_cache[index].snapshot_dirty = 0;
+    }
+}
+#endif
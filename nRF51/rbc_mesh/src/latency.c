@@ -0,0 +1,100 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "latency.h"
+
+#include "rbc_mesh.h"
+#include "timer.h"
+#include "timeslot.h"
+
+#include "nrf_error.h"
+#include <string.h>
+
+#if RBC_MESH_LATENCY_HISTOGRAMS
+/******************************************************************************
+* Static globals
+******************************************************************************/
+static uint32_t m_histograms[LATENCY_STAGE__COUNT][LATENCY_BUCKET_COUNT];
+
+/******************************************************************************
+* Interface functions
+******************************************************************************/
+void latency_init(void)
+{
+    memset(m_histograms, 0, sizeof(m_histograms));
+}
+
+void latency_record(latency_stage_t stage, uint32_t timestamp)
+{
+    if (!timeslot_is_in_ts())
+    {
+        return;
+    }
+
+    uint32_t latency = timer_now() - timestamp;
+    uint32_t bucket = 0;
+    while (latency != 0 && bucket < LATENCY_BUCKET_COUNT - 1)
+    {
+        latency >>= 1;
+        bucket++;
+    }
+    m_histograms[stage][bucket]++;
+}
+
+uint32_t latency_histogram_get(latency_stage_t stage, uint32_t* p_buckets)
+{
+    if (p_buckets == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (stage >= LATENCY_STAGE__COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    memcpy(p_buckets, m_histograms[stage], sizeof(m_histograms[stage]));
+    return NRF_SUCCESS;
+}
+
+#else /* RBC_MESH_LATENCY_HISTOGRAMS */
+
+void latency_init(void)
+{
+}
+
+void latency_record(latency_stage_t stage, uint32_t timestamp)
+{
+}
+
+uint32_t latency_histogram_get(latency_stage_t stage, uint32_t* p_buckets)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+#endif /* RBC_MESH_LATENCY_HISTOGRAMS */
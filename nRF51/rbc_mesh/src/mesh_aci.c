@@ -35,6 +35,8 @@
 #include "event_handler.h"
 #include "version.h"
 #include "mesh_packet.h"
+#include "trace.h"
+#include "latency.h"
 #include "rtt_log.h"
 
 #ifdef BOOTLOADER
@@ -155,6 +157,7 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
             else
             {
                 rbc_mesh_init_params_t init_params;
+                memset(&init_params, 0, sizeof(init_params));
                 init_params.access_addr = p_serial_cmd->params.init.access_addr;
                 init_params.channel = p_serial_cmd->params.init.channel;
                 init_params.interval_min_ms = p_serial_cmd->params.init.interval_min;
@@ -399,6 +402,177 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
             serial_handler_event_send(&serial_evt);
             break;
 
+        case SERIAL_CMD_OPCODE_TRICKLE_PROFILE_SET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_trickle_profile_set_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                rbc_mesh_trickle_profile_t profile;
+                profile.interval_min_ms = p_serial_cmd->params.trickle_profile_set.interval_min_ms;
+                profile.interval_max_ms = p_serial_cmd->params.trickle_profile_set.interval_max_ms;
+                profile.redundancy_constant = p_serial_cmd->params.trickle_profile_set.redundancy_constant;
+                error_code = rbc_mesh_trickle_profile_set(p_serial_cmd->params.trickle_profile_set.profile, &profile);
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_TIME_SYNC_ROOT_SET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_time_sync_root_set_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                error_code = rbc_mesh_time_sync_root_set(p_serial_cmd->params.time_sync_root_set.is_root != 0);
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_TIME_GET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 8;
+
+            if (p_serial_cmd->length != 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                uint32_t mesh_time = 0;
+                rbc_mesh_time_sync_status_t status;
+                error_code = rbc_mesh_time_sync_status_get(&status);
+                if (error_code == NRF_SUCCESS)
+                {
+                    error_code = rbc_mesh_time_get(&mesh_time);
+                }
+                serial_evt.params.cmd_rsp.response.time_get.mesh_time = mesh_time;
+                serial_evt.params.cmd_rsp.response.time_get.hops = (error_code == NRF_SUCCESS ? status.hops : 0xFF);
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_TRACE_READ:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                uint32_t count = SERIAL_EVT_TRACE_ENTRIES_MAX;
+                uint16_t dropped = 0;
+                error_code = trace_read(serial_evt.params.cmd_rsp.response.trace_read.entries, &count, &dropped);
+                if (error_code == NRF_SUCCESS)
+                {
+                    serial_evt.params.cmd_rsp.response.trace_read.count = count;
+                    serial_evt.params.cmd_rsp.response.trace_read.dropped = dropped;
+                    serial_evt.length += 3 + count * sizeof(trace_entry_t);
+                }
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_STATS_GET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_stats_get_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else if (p_serial_cmd->params.stats_get.offset > RBC_MESH_STATS_WORD_COUNT)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_PARAMETER;
+            }
+            else
+            {
+                rbc_mesh_stats_t stats;
+                error_code = rbc_mesh_stats_get(&stats);
+                if (error_code == NRF_SUCCESS)
+                {
+                    /* the words past the offset, as many as fit in the response */
+                    uint32_t offset = p_serial_cmd->params.stats_get.offset;
+                    uint32_t count = RBC_MESH_STATS_WORD_COUNT - offset;
+                    if (count > SERIAL_EVT_STATS_WORDS_MAX)
+                    {
+                        count = SERIAL_EVT_STATS_WORDS_MAX;
+                    }
+                    memcpy(serial_evt.params.cmd_rsp.response.stats_get.words,
+                           &((uint32_t*) &stats)[offset],
+                           count * sizeof(uint32_t));
+                    serial_evt.params.cmd_rsp.response.stats_get.offset = offset;
+                    serial_evt.params.cmd_rsp.response.stats_get.total_word_count = RBC_MESH_STATS_WORD_COUNT;
+                    serial_evt.length += 2 + count * sizeof(uint32_t);
+                }
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_LATENCY_GET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_latency_get_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else if (p_serial_cmd->params.latency_get.offset > LATENCY_BUCKET_COUNT)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_PARAMETER;
+            }
+            else
+            {
+                uint32_t buckets[LATENCY_BUCKET_COUNT];
+                error_code = latency_histogram_get((latency_stage_t) p_serial_cmd->params.latency_get.stage, buckets);
+                if (error_code == NRF_SUCCESS)
+                {
+                    /* the buckets past the offset, as many as fit in the response */
+                    uint32_t offset = p_serial_cmd->params.latency_get.offset;
+                    uint32_t count = LATENCY_BUCKET_COUNT - offset;
+                    if (count > SERIAL_EVT_LATENCY_BUCKETS_MAX)
+                    {
+                        count = SERIAL_EVT_LATENCY_BUCKETS_MAX;
+                    }
+                    memcpy(serial_evt.params.cmd_rsp.response.latency_get.buckets,
+                           &buckets[offset],
+                           count * sizeof(uint32_t));
+                    serial_evt.params.cmd_rsp.response.latency_get.stage = p_serial_cmd->params.latency_get.stage;
+                    serial_evt.params.cmd_rsp.response.latency_get.offset = offset;
+                    serial_evt.params.cmd_rsp.response.latency_get.bucket_count = LATENCY_BUCKET_COUNT;
+                    serial_evt.length += 3 + count * sizeof(uint32_t);
+                }
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
 #endif /* BOOTLOADER */
 
         case SERIAL_CMD_OPCODE_FLAG_SET:
@@ -437,6 +611,15 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
 #endif
                         }
                         break;
+
+                    case ACI_FLAG_TRICKLE_PROFILE:
+#ifdef BOOTLOADER
+                        error_code = NRF_ERROR_INVALID_PARAM;
+#else
+                        error_code = rbc_mesh_value_trickle_profile_set(p_serial_cmd->params.flag_set.handle,
+                                p_serial_cmd->params.flag_set.value);
+#endif
+                        break;
                     default:
                         error_code = NRF_ERROR_INVALID_PARAM;
                 }
@@ -458,6 +641,7 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
             {
                 uint32_t error_code;
                 bool flag_status = false;
+                uint8_t trickle_profile = 0;
                 switch ((aci_flag_t) p_serial_cmd->params.flag_set.flag)
                 {
                     case ACI_FLAG_PERSISTENT:
@@ -477,6 +661,15 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
 #else
                         error_code = rbc_mesh_tx_event_flag_get(p_serial_cmd->params.flag_get.handle,
                                 &flag_status);
+#endif
+                        break;
+
+                    case ACI_FLAG_TRICKLE_PROFILE:
+#ifdef BOOTLOADER
+                        error_code = NRF_ERROR_INVALID_PARAM;
+#else
+                        error_code = rbc_mesh_value_trickle_profile_get(p_serial_cmd->params.flag_get.handle,
+                                &trickle_profile);
 #endif
                         break;
                     default:
@@ -485,7 +678,14 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
                 }
                 serial_evt.params.cmd_rsp.response.flag.handle = p_serial_cmd->params.flag_get.handle;
                 serial_evt.params.cmd_rsp.response.flag.flag = p_serial_cmd->params.flag_get.flag;
-                serial_evt.params.cmd_rsp.response.flag.value = flag_status;
+                if (p_serial_cmd->params.flag_get.flag == ACI_FLAG_TRICKLE_PROFILE)
+                {
+                    serial_evt.params.cmd_rsp.response.flag.value = trickle_profile;
+                }
+                else
+                {
+                    serial_evt.params.cmd_rsp.response.flag.value = flag_status;
+                }
                 serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
             }
             serial_handler_event_send(&serial_evt);
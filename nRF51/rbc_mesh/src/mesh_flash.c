@@ -78,6 +78,7 @@ typedef struct
 {
     flash_op_type_t type;     /**< Type of flash operation. */
     flash_op_t operation;     /**< Operation parameters. */
+    bool report;              /**< Report the end of the operation to the callback. */
 } operation_t;
 
 /*****************************************************************************
@@ -98,6 +99,7 @@ static bool                 m_suspended;                               /**< Susp
  */
 static uint32_t             m_operation_count;                         /**< Number of flash operations executed since bootup. */
 static uint32_t             m_operations_reported;                     /**< Number of flash operations reported to app as ended since bootup. */
+static uint32_t             m_operations_pushed;                       /**< Number of flash operations to report pushed since bootup. */
 /*****************************************************************************
 * Static functions
 *****************************************************************************/
@@ -192,7 +194,8 @@ static void erase_as_much_as_possible(flash_op_t* p_erase_op, timestamp_t* p_ava
 
 static inline bool all_operations_ended(void)
 {
-    return (fifo_is_empty(&m_flash_op_fifo) && (m_operations_reported == m_operation_count));
+    /* unreported operations may still be queued */
+    return (m_operations_reported == m_operations_pushed);
 }
 
 static void write_operation_ended(void* p_location)
@@ -217,7 +220,7 @@ static void erase_operation_ended(void* p_source)
 
 static bool send_end_evt(void)
 {
-    if (m_operation_count == 0 || m_curr_op.type == FLASH_OP_TYPE_NONE)
+    if (m_operation_count == 0 || m_curr_op.type == FLASH_OP_TYPE_NONE || !m_curr_op.report)
     {
         return true; /* no events to send */
     }
@@ -251,7 +254,10 @@ static bool next_operation_get(void)
     }
     APP_ERROR_CHECK_BOOL(m_curr_op.type != FLASH_OP_TYPE_NONE);
 
-    m_operation_count++;
+    if (m_curr_op.report)
+    {
+        m_operation_count++;
+    }
     /* Save initial start address for the end-event */
     if (m_curr_op.type == FLASH_OP_TYPE_WRITE)
     {
@@ -263,32 +269,22 @@ static bool next_operation_get(void)
     }
     return true;
 }
-/*****************************************************************************
-* Interface functions
-*****************************************************************************/
 
-uint32_t mesh_flash_init(mesh_flash_op_cb_t cb)
+/** Set up the operation queue, once for all users. */
+static void queue_init(void)
 {
-    if (cb == NULL)
+    if (m_flash_op_fifo.elem_array == NULL)
     {
-        return NRF_ERROR_NULL;
+        m_flash_op_fifo.elem_array = m_flash_op_fifo_queue;
+        m_flash_op_fifo.elem_size = sizeof(operation_t);
+        m_flash_op_fifo.array_len = FLASH_OP_QUEUE_LEN;
+        fifo_init(&m_flash_op_fifo);
+        m_curr_op.type = FLASH_OP_TYPE_NONE;
     }
-    m_flash_op_fifo.elem_array = m_flash_op_fifo_queue;
-    m_flash_op_fifo.elem_size = sizeof(operation_t);
-    m_flash_op_fifo.array_len = FLASH_OP_QUEUE_LEN;
-    fifo_init(&m_flash_op_fifo);
-    mp_cb = cb;
-    m_curr_op.type = FLASH_OP_TYPE_NONE;
-
-    return NRF_SUCCESS;
 }
 
-uint32_t mesh_flash_op_push(flash_op_type_t type, const flash_op_t* p_op)
+static uint32_t op_push(flash_op_type_t type, const flash_op_t* p_op, bool report)
 {
-    if (mp_cb == NULL)
-    {
-        return NRF_ERROR_INVALID_STATE;
-    }
     if (p_op == NULL)
     {
         return NRF_ERROR_NULL;
@@ -322,14 +318,51 @@ uint32_t mesh_flash_op_push(flash_op_type_t type, const flash_op_t* p_op)
         return NRF_ERROR_INVALID_PARAM;
     }
 
+    queue_init();
     operation_t op;
     op.type = type;
+    op.report = report;
     memcpy(&op.operation, p_op, sizeof(flash_op_t));
-    return fifo_push(&m_flash_op_fifo, &op);
+    uint32_t error_code = fifo_push(&m_flash_op_fifo, &op);
+    if (error_code == NRF_SUCCESS && report)
+    {
+        m_operations_pushed++;
+    }
+    return error_code;
+}
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+
+uint32_t mesh_flash_init(mesh_flash_op_cb_t cb)
+{
+    if (cb == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    queue_init();
+    mp_cb = cb;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_flash_op_push(flash_op_type_t type, const flash_op_t* p_op)
+{
+    if (mp_cb == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return op_push(type, p_op, true);
+}
+
+uint32_t mesh_flash_op_push_unreported(flash_op_type_t type, const flash_op_t* p_op)
+{
+    return op_push(type, p_op, false);
 }
 
 uint32_t mesh_flash_op_available_slots(void)
 {
+    queue_init();
     return FLASH_OP_QUEUE_LEN - fifo_get_len(&m_flash_op_fifo);
 }
 
@@ -101,7 +101,7 @@ typedef __packed_armcc struct
 {
     rbc_mesh_value_handle_t handle;
     uint8_t data_len;
-    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t data[RBC_MESH_VALUE_SHORT_MAX_LEN];
 } __packed_gcc gatt_evt_data_update_t;
 
 typedef __packed_armcc struct
@@ -387,7 +387,8 @@ uint32_t mesh_gatt_init(uint32_t access_address, uint8_t channel, uint32_t inter
 
 uint32_t mesh_gatt_value_set(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
 {
-    if (length > RBC_MESH_VALUE_MAX_LEN)
+    /* long values don't fit the GATT event, and aren't mirrored */
+    if (length > RBC_MESH_VALUE_SHORT_MAX_LEN)
     {
         return NRF_ERROR_INVALID_LENGTH;
     }
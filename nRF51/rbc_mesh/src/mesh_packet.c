@@ -32,47 +32,133 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "app_error.h"
 #include <string.h>
 
-#define PACKET_INDEX(p_packet) ((((uint32_t) p_packet) - ((uint32_t) &g_packet_pool[0])) / sizeof(mesh_packet_t))
+#define PACKET_OFFSET(p_packet) (((uintptr_t) (p_packet)) - ((uintptr_t) &g_packet_pool[0]))
+#define PACKET_INDEX(p_packet) ((PACKET_OFFSET(p_packet) < g_packet_pool_size * sizeof(mesh_packet_t)) ? \
+                                (uint32_t) (PACKET_OFFSET(p_packet) / sizeof(mesh_packet_t)) : \
+                                g_packet_pool_size)
+
+#define PACKET_FREE_MASK_WORDS(pool_size)   (((pool_size) + 31) / 32)
+#define PACKET_FREE_MASK_SET(index)     (g_packet_free_mask[(index) >> 5] |= (1UL << ((index) & 0x1F)))
+#define PACKET_FREE_MASK_CLEAR(index)   (g_packet_free_mask[(index) >> 5] &= ~(1UL << ((index) & 0x1F)))
+
+/* Bytes of memory needed for a pool of the given size: the free mask, then the
+   reference counts, then the packets. */
+#define PACKET_POOL_MEMORY_SIZE(pool_size)  (PACKET_FREE_MASK_WORDS(pool_size) * sizeof(uint32_t) + \
+                                             (pool_size) * (sizeof(uint8_t) + sizeof(mesh_packet_t)))
 /******************************************************************************
 * Static globals
 ******************************************************************************/
-static mesh_packet_t g_packet_pool[RBC_MESH_PACKET_POOL_SIZE];
-static uint8_t g_packet_refs[RBC_MESH_PACKET_POOL_SIZE];
+#if RBC_MESH_STATIC_ARENA
+/* Storage for the default pool size, used when no other memory is given. */
+static uint32_t g_static_memory[(PACKET_POOL_MEMORY_SIZE(RBC_MESH_PACKET_POOL_SIZE) + 3) / 4];
+#endif
+static void* gp_memory;
+static uint16_t g_memory_pool_size;
+
+static mesh_packet_t* g_packet_pool;
+static uint8_t* g_packet_refs;
+static uint32_t* g_packet_free_mask; /**< One bit per packet without references */
+static uint16_t g_packet_pool_size;
+static mesh_packet_stats_t g_packet_stats;
 /******************************************************************************
 * Interface functions
 ******************************************************************************/
+uint32_t mesh_packet_pool_memory_size_get(uint32_t pool_size)
+{
+    return PACKET_POOL_MEMORY_SIZE(pool_size);
+}
+
+uint32_t mesh_packet_pool_memory_set(void* p_memory, uint32_t memory_size, uint16_t pool_size)
+{
+    if (pool_size == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_memory == NULL || ((uintptr_t) p_memory & 0x03))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (memory_size < PACKET_POOL_MEMORY_SIZE(pool_size))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    gp_memory = p_memory;
+    g_memory_pool_size = pool_size;
+    return NRF_SUCCESS;
+}
+
 void mesh_packet_init(void)
 {
-    for (uint32_t i = 0; i < RBC_MESH_PACKET_POOL_SIZE; ++i)
+    if (gp_memory == NULL)
+    {
+#if RBC_MESH_STATIC_ARENA
+        gp_memory = g_static_memory;
+        g_memory_pool_size = RBC_MESH_PACKET_POOL_SIZE;
+#else
+        APP_ERROR_CHECK(NRF_ERROR_INVALID_STATE);
+        return;
+#endif
+    }
+
+    g_packet_pool_size = g_memory_pool_size;
+    g_packet_free_mask = (uint32_t*) gp_memory;
+    g_packet_refs = (uint8_t*) &g_packet_free_mask[PACKET_FREE_MASK_WORDS(g_packet_pool_size)];
+    g_packet_pool = (mesh_packet_t*) &g_packet_refs[g_packet_pool_size];
+
+    for (uint32_t i = 0; i < g_packet_pool_size; ++i)
     {
         /* reset ref count field */
         g_packet_refs[i] = 0;
     }
+    memset(g_packet_free_mask, 0, PACKET_FREE_MASK_WORDS(g_packet_pool_size) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < g_packet_pool_size; ++i)
+    {
+        PACKET_FREE_MASK_SET(i);
+    }
+    memset(&g_packet_stats, 0, sizeof(g_packet_stats));
 }
 
 bool mesh_packet_acquire(mesh_packet_t** pp_packet)
 {
     uint32_t was_masked;
-    for (uint32_t i = 0; i < RBC_MESH_PACKET_POOL_SIZE; ++i)
+    _DISABLE_IRQS(was_masked);
+    for (uint32_t i = 0; i < PACKET_FREE_MASK_WORDS(g_packet_pool_size); ++i)
     {
-        _DISABLE_IRQS(was_masked);
-        if (g_packet_refs[i] == 0) /* no refs, free to use */
+        if (g_packet_free_mask[i] != 0)
         {
-            g_packet_refs[i] = 1;
-            *pp_packet = &g_packet_pool[i];
+            uint32_t index = (i << 5) + _LOWEST_SET_BIT(g_packet_free_mask[i]);
+            PACKET_FREE_MASK_CLEAR(index);
+            g_packet_refs[index] = 1;
+            *pp_packet = &g_packet_pool[index];
+
+            g_packet_stats.acquired++;
+            if (++g_packet_stats.in_use > g_packet_stats.high_water_mark)
+            {
+                g_packet_stats.high_water_mark = g_packet_stats.in_use;
+            }
             _ENABLE_IRQS(was_masked);
             return true;
         }
-        _ENABLE_IRQS(was_masked);
     }
-    APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
+    /* all callers are expected to handle an empty pool */
+    g_packet_stats.exhausted++;
+    _ENABLE_IRQS(was_masked);
     return false;
 }
 
+void mesh_packet_stats_get(mesh_packet_stats_t* p_stats)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(p_stats, &g_packet_stats, sizeof(mesh_packet_stats_t));
+    _ENABLE_IRQS(was_masked);
+}
+
 mesh_packet_t* mesh_packet_get_aligned(void* p_buf_pointer)
 {
     uint32_t index = PACKET_INDEX(p_buf_pointer);
-    if (index < RBC_MESH_PACKET_POOL_SIZE)
+    if (index < g_packet_pool_size)
     {
         return &g_packet_pool[index];
     }
@@ -86,7 +172,7 @@ bool mesh_packet_ref_count_inc(mesh_packet_t* p_packet)
 {
     /* the given pointer may not be aligned, have to force alignment with index */
     uint32_t index = PACKET_INDEX(p_packet);
-    if (index >= RBC_MESH_PACKET_POOL_SIZE)
+    if (index >= g_packet_pool_size)
     {
         return false;
     }
@@ -105,7 +191,7 @@ bool mesh_packet_ref_count_inc(mesh_packet_t* p_packet)
 bool mesh_packet_ref_count_dec(mesh_packet_t* p_packet)
 {
     uint32_t index = PACKET_INDEX(p_packet);
-    if (index >= RBC_MESH_PACKET_POOL_SIZE)
+    if (index >= g_packet_pool_size)
     {
         return false;
     }
@@ -120,15 +206,21 @@ bool mesh_packet_ref_count_dec(mesh_packet_t* p_packet)
         return false;
     }
     g_packet_refs[index]--;
+    bool has_refs = (g_packet_refs[index] > 0);
+    if (!has_refs)
+    {
+        PACKET_FREE_MASK_SET(index);
+        g_packet_stats.in_use--;
+    }
     _ENABLE_IRQS(was_masked);
 
-    return (g_packet_refs[index] > 0);
+    return has_refs;
 }
 
 uint8_t mesh_packet_ref_count_get(mesh_packet_t* p_packet)
 {
     uint32_t index = PACKET_INDEX(p_packet);
-    if (index >= RBC_MESH_PACKET_POOL_SIZE)
+    if (index >= g_packet_pool_size)
     {
         return 0;
     }
@@ -236,7 +328,7 @@ mesh_adv_data_t* mesh_packet_adv_data_get(mesh_packet_t* p_packet)
 
     mesh_adv_data_t* p_mesh_adv_data = (mesh_adv_data_t*) &p_packet->payload[0];
     if (p_packet->header.length <= MESH_PACKET_BLE_OVERHEAD ||
-        p_packet->header.length > MESH_PACKET_BLE_OVERHEAD + BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH)
+        p_packet->header.length > MESH_PACKET_BLE_OVERHEAD + MESH_PACKET_PAYLOAD_MAX_LENGTH)
     {
         return NULL;
     }
@@ -245,7 +337,7 @@ mesh_adv_data_t* mesh_packet_adv_data_get(mesh_packet_t* p_packet)
     while (p_mesh_adv_data->adv_data_type != MESH_ADV_DATA_TYPE ||
            p_mesh_adv_data->mesh_uuid != MESH_UUID)
     {
-        if (p_mesh_adv_data->adv_data_length + ((uint32_t) p_mesh_adv_data - (uint32_t) (p_packet->payload))
+        if (p_mesh_adv_data->adv_data_length + (uint32_t) ((uint8_t*) p_mesh_adv_data - p_packet->payload)
                > p_packet->header.length - MESH_PACKET_BLE_OVERHEAD)
         {
             /* invalid ad length */
@@ -300,10 +392,109 @@ void mesh_packet_take_ownership(mesh_packet_t* p_packet)
     mesh_packet_set_local_addr(p_packet);
 }
 
+uint32_t mesh_packet_aggregate_build(mesh_packet_t* p_packet)
+{
+    if (p_packet == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    /* place aggregated adv data at beginning of adv payload */
+    mesh_aggregate_adv_data_t* p_aggr_adv_data = (mesh_aggregate_adv_data_t*) &p_packet->payload[0];
+
+    mesh_packet_set_local_addr(p_packet);
+
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + 1 + MESH_AGGREGATE_ADV_OVERHEAD;
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    p_aggr_adv_data->adv_data_length = MESH_AGGREGATE_ADV_OVERHEAD;
+    p_aggr_adv_data->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_aggr_adv_data->mesh_uuid = MESH_UUID;
+    p_aggr_adv_data->handle = MESH_AGGREGATE_HANDLE;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_packet_aggregate_add(mesh_packet_t* p_packet,
+        rbc_mesh_value_handle_t handle,
+        uint16_t version,
+        uint8_t* data,
+        uint8_t length)
+{
+    if (p_packet == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    mesh_aggregate_adv_data_t* p_aggr_adv_data = (mesh_aggregate_adv_data_t*) &p_packet->payload[0];
+    if (p_aggr_adv_data->handle != MESH_AGGREGATE_HANDLE)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (length > RBC_MESH_VALUE_MAX_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_aggr_adv_data->adv_data_length + MESH_AGGREGATE_VALUE_OVERHEAD + length >
+        MESH_AGGREGATE_ADV_OVERHEAD + MESH_AGGREGATE_VALUES_MAX_LEN)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    mesh_aggregate_value_t* p_value = (mesh_aggregate_value_t*)
+        &p_aggr_adv_data->values[p_aggr_adv_data->adv_data_length - MESH_AGGREGATE_ADV_OVERHEAD];
+
+    p_value->handle = handle;
+    p_value->version = version;
+    p_value->length = length;
+    if (length > 0 && data != NULL)
+    {
+        memcpy(p_value->data, data, length);
+    }
+
+    p_aggr_adv_data->adv_data_length += MESH_AGGREGATE_VALUE_OVERHEAD + length;
+    p_packet->header.length += MESH_AGGREGATE_VALUE_OVERHEAD + length;
+
+    return NRF_SUCCESS;
+}
+
+mesh_aggregate_value_t* mesh_packet_aggregate_value_next(mesh_packet_t* p_packet, mesh_aggregate_value_t* p_value)
+{
+    mesh_aggregate_adv_data_t* p_aggr_adv_data =
+        (mesh_aggregate_adv_data_t*) mesh_packet_adv_data_get(p_packet);
+
+    if (p_aggr_adv_data == NULL ||
+        p_aggr_adv_data->handle != MESH_AGGREGATE_HANDLE ||
+        p_aggr_adv_data->adv_data_length < MESH_AGGREGATE_ADV_OVERHEAD)
+    {
+        return NULL;
+    }
+
+    /* the values must end inside both the adv data and the packet */
+    const uint8_t* p_end = &p_aggr_adv_data->values[p_aggr_adv_data->adv_data_length - MESH_AGGREGATE_ADV_OVERHEAD];
+    if (p_end > &p_packet->payload[p_packet->header.length - MESH_PACKET_BLE_OVERHEAD])
+    {
+        return NULL;
+    }
+
+    uint8_t* p_next = (p_value == NULL) ? &p_aggr_adv_data->values[0] : &p_value->data[p_value->length];
+    if (p_next + MESH_AGGREGATE_VALUE_OVERHEAD > p_end)
+    {
+        return NULL;
+    }
+
+    mesh_aggregate_value_t* p_next_value = (mesh_aggregate_value_t*) p_next;
+    if (p_next_value->length > RBC_MESH_VALUE_MAX_LEN ||
+        &p_next_value->data[p_next_value->length] > p_end)
+    {
+        return NULL;
+    }
+
+    return p_next_value;
+}
+
 mesh_packet_t* mesh_packet_get_start_pointer(void* p_content)
 {
-    uint32_t index = ((((uint32_t) p_content) - ((uint32_t) &g_packet_pool[0])) / sizeof(mesh_packet_t));
-    if (index < RBC_MESH_PACKET_POOL_SIZE)
+    uint32_t index = PACKET_INDEX(p_content);
+    if (index < g_packet_pool_size)
     {
         return &g_packet_pool[index];
     }
@@ -39,6 +39,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "toolchain.h"
 #include "rbc_mesh.h"
 #include "mesh_packet.h"
+#include "trace.h"
 
 #include <stdbool.h>
 #include <string.h>
@@ -48,19 +49,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define LIGHTWEIGHT_RADIO               (1)
 
-#define RADIO_RX_TIMEOUT                (150 + 80)
+#if RBC_MESH_LONG_VALUES
+    #ifndef RADIO_PCNF0_S1INCL_Pos
+        #error "RBC_MESH_LONG_VALUES requires the nRF52 radio"
+    #endif
+    #define RADIO_ACCESS_ADDRESS_MAX    (RADIO_ACCESS_ADDRESS_LONG)
+#else
+    #define RADIO_ACCESS_ADDRESS_MAX    (1)
+#endif
 
 #define RADIO_EVENT(evt)                (NRF_RADIO->evt == 1)
 
 #define PPI_CH_STOP_RX_ABORT            (TIMER_PPI_CH_START + 4)
 
-#define DEBUG_RADIO_SET_STATE(state) do {\
-    DEBUG_RADIO_CLEAR_PIN(PIN_RADIO_STATE_TX);\
-    DEBUG_RADIO_CLEAR_PIN(PIN_RADIO_STATE_RX);\
-    DEBUG_RADIO_CLEAR_PIN(PIN_RADIO_STATE_IDLE);\
-    DEBUG_RADIO_SET_PIN(state);\
-    }while (0)
-
 /**
 * Internal enum denoting radio state.
 */
@@ -85,6 +86,9 @@ static radio_idle_cb_t  m_idle_cb;
 static radio_rx_cb_t    m_rx_cb;
 static radio_tx_cb_t    m_tx_cb;
 static uint32_t         m_alt_aa = RADIO_DEFAULT_ADDRESS;
+static rbc_mesh_phy_t   m_phy = RBC_MESH_PHY_1MBIT;
+/** Copies of the packet on air that are yet to be started, see RBC_MESH_RADIO_TX_CHAIN. */
+static uint32_t         m_tx_chain_left;
 /*****************************************************************************
 * Static functions
 *****************************************************************************/
@@ -93,11 +97,13 @@ static void purge_preemptable(void)
     uint32_t events_in_queue = fifo_get_len(&m_radio_fifo);
     while (events_in_queue > 1)
     {
-        radio_event_t current_evt;
-        if (fifo_peek(&m_radio_fifo, &current_evt) == NRF_SUCCESS &&
-            current_evt.event_type == RADIO_EVENT_TYPE_RX_PREEMPTABLE)
+        radio_event_t* p_current_evt = fifo_peek_ptr(&m_radio_fifo, 0);
+        if (p_current_evt != NULL &&
+            p_current_evt->event_type == RADIO_EVENT_TYPE_RX_PREEMPTABLE)
         {
             /* event is preemptable, stop it */
+            uint8_t* p_packet = p_current_evt->packet_ptr;
+            uint8_t channel = p_current_evt->channel;
             fifo_pop(&m_radio_fifo, NULL);
 
             radio_disable();
@@ -105,7 +111,7 @@ static void purge_preemptable(void)
             NRF_RADIO->EVENTS_END = 0;
 
             /* propagate failed rx event */
-            m_rx_cb(current_evt.packet_ptr, false, 0xFFFFFFFF, 100);
+            m_rx_cb(p_packet, false, 0xFFFFFFFF, 100, channel);
             --events_in_queue;
         }
         else
@@ -135,19 +141,99 @@ static void radio_channel_set(uint8_t ch)
 
 }
 
+/** Set the radio mode and preamble for the current PHY. Must be called after PCNF0 is set. */
+static void radio_phy_apply(void)
+{
+#ifdef RADIO_MODE_MODE_Ble_2Mbit
+    if (m_phy == RBC_MESH_PHY_2MBIT)
+    {
+        /* BLE 2 Mbit has a two byte preamble */
+        NRF_RADIO->MODE = ((RADIO_MODE_MODE_Ble_2Mbit << RADIO_MODE_MODE_Pos) & RADIO_MODE_MODE_Msk);
+        NRF_RADIO->PCNF0 |= ((RADIO_PCNF0_PLEN_16bit << RADIO_PCNF0_PLEN_Pos) & RADIO_PCNF0_PLEN_Msk);
+        return;
+    }
+#endif
+    NRF_RADIO->MODE = ((RADIO_MODE_MODE_Ble_1Mbit << RADIO_MODE_MODE_Pos) & RADIO_MODE_MODE_Msk);
+}
+
+#if RBC_MESH_RADIO_TX_CHAIN
+/** Number of events following the given TX event in the queue that send the
+  same packet in the same way, only on other channels. */
+static uint32_t tx_chain_length_get(radio_event_t* p_evt)
+{
+    uint32_t length = 0;
+    radio_event_t* p_next;
+    while ((p_next = fifo_peek_ptr(&m_radio_fifo, length + 1)) != NULL &&
+           p_next->event_type == RADIO_EVENT_TYPE_TX &&
+           p_next->packet_ptr == p_evt->packet_ptr &&
+           p_next->access_address == p_evt->access_address &&
+           p_next->tx_power == p_evt->tx_power)
+    {
+        length++;
+    }
+    return length;
+}
+
+/** Start the next copy of a chained packet. Executed on the DISABLED event
+  of the previous copy, which is still first in the queue. */
+static void tx_chain_continue(void)
+{
+    NRF_RADIO->EVENTS_DISABLED = 0;
+    NRF_RADIO->EVENTS_END = 0;
+
+    radio_event_t* p_prev_evt = fifo_peek_ptr(&m_radio_fifo, 0);
+    uint8_t* p_packet = p_prev_evt->packet_ptr;
+    uint8_t channel = p_prev_evt->channel;
+    fifo_pop(&m_radio_fifo, NULL);
+
+    /* get the radio ramping up before anything else */
+    radio_event_t* p_evt = fifo_peek_ptr(&m_radio_fifo, 0);
+    radio_channel_set(p_evt->channel);
+    NRF_RADIO->TASKS_TXEN = 1;
+    TRACE(TRACE_ID_RADIO_END, channel, 0);
+    TRACE(TRACE_ID_RADIO_TX_START, p_evt->channel, 0);
+
+    if (--m_tx_chain_left == 0)
+    {
+        /* the last copy ends like any other event */
+        NRF_RADIO->INTENCLR = RADIO_INTENCLR_DISABLED_Msk;
+        NRF_RADIO->INTENSET = RADIO_INTENSET_END_Msk;
+    }
+
+    m_tx_cb(p_packet, channel);
+}
+#endif
+
 static void setup_event(radio_event_t* p_evt)
 {
     NRF_RADIO->SHORTS = RADIO_SHORTS_READY_START_Msk | RADIO_SHORTS_END_DISABLE_Msk | RADIO_SHORTS_ADDRESS_RSSISTART_Msk;
     radio_channel_set(p_evt->channel);
     NRF_RADIO->PACKETPTR = (uint32_t) p_evt->packet_ptr;
-    NRF_RADIO->INTENSET = RADIO_INTENSET_END_Msk;
     NRF_RADIO->EVENTS_END = 0;
+#if RBC_MESH_RADIO_TX_CHAIN
+    m_tx_chain_left = (p_evt->event_type == RADIO_EVENT_TYPE_TX) ? tx_chain_length_get(p_evt) : 0;
+    if (m_tx_chain_left > 0)
+    {
+        /* only the DISABLED event of each copy needs handling */
+        NRF_RADIO->EVENTS_DISABLED = 0;
+        NRF_RADIO->INTENCLR = RADIO_INTENCLR_END_Msk;
+        NRF_RADIO->INTENSET = RADIO_INTENSET_DISABLED_Msk;
+    }
+    else
+#endif
+    {
+        NRF_RADIO->INTENSET = RADIO_INTENSET_END_Msk;
+    }
     NRF_RADIO->PREFIX1	= ((m_alt_aa >> 24) & 0x000000FF);
     NRF_RADIO->BASE1    = ((m_alt_aa <<  8) & 0xFFFFFF00);
+#if RBC_MESH_LONG_VALUES
+    NRF_RADIO->PREFIX0  = ((RADIO_DEFAULT_ADDRESS >> 24) & 0x000000FF) |
+                          ((~m_alt_aa >> 8) & 0x00FF0000);
+#endif
 
     if (p_evt->event_type == RADIO_EVENT_TYPE_TX)
     {
-        DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_TX);
+        TRACE(TRACE_ID_RADIO_TX_START, p_evt->channel, 0);
         NRF_RADIO->TXADDRESS = p_evt->access_address;
         NRF_RADIO->TXPOWER  = p_evt->tx_power;
         NRF_RADIO->TASKS_TXEN = 1;
@@ -156,7 +242,7 @@ static void setup_event(radio_event_t* p_evt)
     }
     else
     {
-        DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_RX);
+        TRACE(TRACE_ID_RADIO_RX_START, p_evt->channel, 0);
         if (m_alt_aa != RADIO_DEFAULT_ADDRESS)
         {
             /* only enable alt-addr if it's different */
@@ -166,6 +252,9 @@ static void setup_event(radio_event_t* p_evt)
         {
             NRF_RADIO->RXADDRESSES = 0x01;
         }
+#if RBC_MESH_LONG_VALUES
+        NRF_RADIO->RXADDRESSES |= (1 << RADIO_ACCESS_ADDRESS_LONG);
+#endif
         NRF_RADIO->TASKS_RXEN = 1;
         m_radio_state = RADIO_STATE_RX;
     }
@@ -185,7 +274,6 @@ void radio_init(radio_idle_cb_t idle_cb,
 
     /* Set radio configuration parameters */
     NRF_RADIO->TXPOWER      = ((RADIO_TXPOWER_TXPOWER_0dBm << RADIO_TXPOWER_TXPOWER_Pos) & RADIO_TXPOWER_TXPOWER_Msk);
-    NRF_RADIO->MODE 	    = ((RADIO_MODE_MODE_Ble_1Mbit << RADIO_MODE_MODE_Pos) & RADIO_MODE_MODE_Msk);
 
     NRF_RADIO->FREQUENCY 	    = 2;					// Frequency bin 2, 2402MHz, channel 37.
     NRF_RADIO->DATAWHITEIV      = 37;					// NOTE: This value needs to correspond to the frequency being used
@@ -200,15 +288,28 @@ void radio_init(radio_idle_cb_t idle_cb,
     NRF_RADIO->RXADDRESSES  = 0x01;				// Enable reception on logical address 0 (PREFIX0 + BASE0)
 
     /* PCNF-> Packet Configuration. Now we need to configure the sizes S0, S1 and length field to match the datapacket format of the advertisement packets. */
+#if RBC_MESH_LONG_VALUES
+    /* An 8 bit length field reads the length of standard advertisement packets
+       along with their two zero RFU bits. S1 is kept in RAM, for the same
+       packet layout. */
+    NRF_RADIO->PCNF0 =  (
+                          (((1UL) << RADIO_PCNF0_S0LEN_Pos) & RADIO_PCNF0_S0LEN_Msk)
+                        | (((0UL) << RADIO_PCNF0_S1LEN_Pos) & RADIO_PCNF0_S1LEN_Msk)
+                        | (((RADIO_PCNF0_S1INCL_Include) << RADIO_PCNF0_S1INCL_Pos) & RADIO_PCNF0_S1INCL_Msk)
+                        | (((8UL) << RADIO_PCNF0_LFLEN_Pos) & RADIO_PCNF0_LFLEN_Msk)
+                      );
+#else
     NRF_RADIO->PCNF0 =  (
                           (((1UL) << RADIO_PCNF0_S0LEN_Pos) & RADIO_PCNF0_S0LEN_Msk)    // length of S0 field in bytes 0-1.
                         | (((2UL) << RADIO_PCNF0_S1LEN_Pos) & RADIO_PCNF0_S1LEN_Msk)    // length of S1 field in bits 0-8.
                         | (((6UL) << RADIO_PCNF0_LFLEN_Pos) & RADIO_PCNF0_LFLEN_Msk)    // length of length field in bits 0-8.
                       );
+#endif
+    radio_phy_apply();
 
     /* Packet configuration */
     NRF_RADIO->PCNF1 =  (
-                          (((37UL)                          << RADIO_PCNF1_MAXLEN_Pos)  & RADIO_PCNF1_MAXLEN_Msk)   // maximum length of payload in bytes [0-255]
+                          (((MESH_PACKET_BLE_OVERHEAD + MESH_PACKET_PAYLOAD_MAX_LENGTH) << RADIO_PCNF1_MAXLEN_Pos) & RADIO_PCNF1_MAXLEN_Msk)   // maximum length of payload in bytes [0-255]
                         | (((0UL)                           << RADIO_PCNF1_STATLEN_Pos) & RADIO_PCNF1_STATLEN_Msk)	// expand the payload with N bytes in addition to LENGTH [0-255]
                         | (((3UL)                           << RADIO_PCNF1_BALEN_Pos)   & RADIO_PCNF1_BALEN_Msk)    // base address length in number of bytes.
                         | (((RADIO_PCNF1_ENDIAN_Little)     << RADIO_PCNF1_ENDIAN_Pos)  & RADIO_PCNF1_ENDIAN_Msk)   // endianess of the S0, LENGTH, S1 and PAYLOAD fields.
@@ -221,7 +322,8 @@ void radio_init(radio_idle_cb_t idle_cb,
                       | (((RADIO_CRCCNF_LEN_Three)      << RADIO_CRCCNF_LEN_Pos)       & RADIO_CRCCNF_LEN_Msk);
 
     NRF_RADIO->CRCINIT = ((0x555555 << RADIO_CRCINIT_CRCINIT_Pos) & RADIO_CRCINIT_CRCINIT_Msk);    // Initial value of CRC
-    /* Lock interframe spacing, so that the radio won't send too soon / start RX too early */
+    /* Lock interframe spacing, so that the radio won't send too soon / start RX too early.
+       The interframe space is the same on both BLE PHYs. */
     NRF_RADIO->TIFS = 148;
 
     /* init radio packet fifo */
@@ -236,6 +338,7 @@ void radio_init(radio_idle_cb_t idle_cb,
     }
 
     m_radio_state = RADIO_STATE_DISABLED;
+    m_tx_chain_left = 0;
     NRF_RADIO->EVENTS_END = 0;
 
     NVIC_ClearPendingIRQ(RADIO_IRQn);
@@ -244,9 +347,6 @@ void radio_init(radio_idle_cb_t idle_cb,
     m_rx_cb = rx_cb;
     m_tx_cb = tx_cb;
 
-    DEBUG_RADIO_CLEAR_PIN(PIN_RADIO_STATE_RX);
-    DEBUG_RADIO_CLEAR_PIN(PIN_RADIO_STATE_TX);
-
     if (fifo_is_empty(&m_radio_fifo))
     {
         m_idle_cb();
@@ -265,6 +365,24 @@ void radio_alt_aa_set(uint32_t access_address)
     m_alt_aa = access_address;
 }
 
+uint32_t radio_phy_set(rbc_mesh_phy_t phy)
+{
+    switch (phy)
+    {
+        case RBC_MESH_PHY_1MBIT:
+            break;
+#ifdef RADIO_MODE_MODE_Ble_2Mbit
+        /* nRF52 only */
+        case RBC_MESH_PHY_2MBIT:
+            break;
+#endif
+        default:
+            return NRF_ERROR_NOT_SUPPORTED;
+    }
+    m_phy = phy;
+    return NRF_SUCCESS;
+}
+
 uint32_t radio_order(radio_event_t* p_radio_event)
 {
     if (p_radio_event == NULL)
@@ -273,7 +391,7 @@ uint32_t radio_order(radio_event_t* p_radio_event)
     }
 
     if (p_radio_event->event_type == RADIO_EVENT_TYPE_TX &&
-        p_radio_event->access_address > 1)
+        p_radio_event->access_address > RADIO_ACCESS_ADDRESS_MAX)
     {
         return NRF_ERROR_INVALID_ADDR;
     }
@@ -300,7 +418,8 @@ void radio_disable(void)
     NRF_RADIO->INTENCLR = 0xFFFFFFFF;
     NRF_RADIO->TASKS_DISABLE = 1;
     m_radio_state = RADIO_STATE_DISABLED;
-    DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_IDLE);
+    m_tx_chain_left = 0;
+    TRACE(TRACE_ID_RADIO_DISABLE, 0, 0);
 }
 
 /**
@@ -308,6 +427,26 @@ void radio_disable(void)
 */
 void radio_event_handler(void)
 {
+#if RBC_MESH_RADIO_TX_CHAIN
+    if (m_tx_chain_left > 0)
+    {
+        if (NRF_RADIO->EVENTS_DISABLED)
+        {
+            if (NRF_RADIO->EVENTS_END)
+            {
+                tx_chain_continue();
+            }
+            else
+            {
+                /* left over from disabling the radio before the chain started */
+                NRF_RADIO->EVENTS_DISABLED = 0;
+            }
+        }
+        /* the chain isn't done, any other reason to be here can wait */
+        return;
+    }
+#endif
+
     if (NRF_RADIO->EVENTS_END)
     {
         bool crc_status = NRF_RADIO->CRCSTATUS;
@@ -320,25 +459,33 @@ void radio_event_handler(void)
             rssi = NRF_RADIO->RSSISAMPLE;
         }
 
-        radio_event_t prev_evt;
         NRF_RADIO->EVENTS_END = 0;
 
-        /* pop the event that just finished */
-        uint32_t error_code = fifo_pop(&m_radio_fifo, &prev_evt);
-        APP_ERROR_CHECK(error_code);
+        /* pop the event that just finished. The callbacks may order new
+           events into its slot, so only its packet, type and channel are kept. */
+        radio_event_t* p_prev_evt = fifo_peek_ptr(&m_radio_fifo, 0);
+        if (p_prev_evt == NULL)
+        {
+            APP_ERROR_CHECK(NRF_ERROR_NULL);
+            return;
+        }
+        uint8_t* p_packet = p_prev_evt->packet_ptr;
+        uint8_t channel = p_prev_evt->channel;
+        bool is_rx = (p_prev_evt->event_type == RADIO_EVENT_TYPE_RX ||
+                      p_prev_evt->event_type == RADIO_EVENT_TYPE_RX_PREEMPTABLE);
+        fifo_pop(&m_radio_fifo, NULL);
+        TRACE(TRACE_ID_RADIO_END, channel, (is_rx ? (crc_status ? 1 : 2) : 0));
 
         /* send to super space */
-        if (prev_evt.event_type == RADIO_EVENT_TYPE_RX ||
-            prev_evt.event_type == RADIO_EVENT_TYPE_RX_PREEMPTABLE)
+        if (is_rx)
         {
-            m_rx_cb(prev_evt.packet_ptr, crc_status, crc, rssi);
+            m_rx_cb(p_packet, crc_status, crc, rssi, channel);
         }
         else
         {
-            m_tx_cb(prev_evt.packet_ptr);
+            m_tx_cb(p_packet, channel);
         }
 
-        DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_IDLE);
         m_radio_state = RADIO_STATE_DISABLED;
     }
     else
@@ -349,10 +496,11 @@ void radio_event_handler(void)
     if (m_radio_state == RADIO_STATE_DISABLED ||
         m_radio_state == RADIO_STATE_NEVER_USED)
     {
-        radio_event_t evt;
-        if (fifo_peek(&m_radio_fifo, &evt) == NRF_SUCCESS)
+        /* the event stays in its slot until it ends */
+        radio_event_t* p_evt = fifo_peek_ptr(&m_radio_fifo, 0);
+        if (p_evt != NULL)
         {
-            setup_event(&evt);
+            setup_event(p_evt);
         }
         else
         {
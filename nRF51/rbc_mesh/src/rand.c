@@ -31,7 +31,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <nrf_error.h>
 
-#ifndef __linux__
+/* Host builds running against a simulated softdevice use its RNG, other
+   host builds read the OS entropy pool. */
+#if !defined(__linux__) || defined(SOFTDEVICE_PRESENT)
 #include <nrf_soc.h>
 #else
 #include <fcntl.h>
@@ -83,7 +85,7 @@ uint32_t rand_prng_get(prng_t* p_prng)
     return p_prng->d;
 }
 
-#ifndef __linux__ /* TODO: Add Windows random generator for software testing on windows */
+#if !defined(__linux__) || defined(SOFTDEVICE_PRESENT) /* TODO: Add Windows random generator for software testing on windows */
 
 uint32_t rand_hw_rng_get(uint8_t* p_result, uint16_t len)
 {
@@ -31,11 +31,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rbc_mesh.h"
 #include "rbc_mesh_common.h"
 #include "timeslot.h"
+#include "timer.h"
 #include "timer_scheduler.h"
 #include "event_handler.h"
 #include "version_handler.h"
+#include "time_sync.h"
+#include "digest.h"
+#include "snapshot.h"
 #include "transport_control.h"
+#include "radio_control.h"
 #include "mesh_packet.h"
+#include "handle_storage.h"
+#include "trickle.h"
+#include "trace.h"
+#include "latency.h"
 #include "mesh_gatt.h"
 #include "dfu_app.h"
 #include "fifo.h"
@@ -45,6 +54,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <string.h>
 
+/* Pad the caches in the arena, to keep the packet pool that follows aligned */
+#define ARENA_ALIGN(size)   (((size) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
 /*****************************************************************************
 * Static globals
 *****************************************************************************/
@@ -54,29 +66,77 @@ static uint8_t          m_channel;
 static uint32_t         m_interval_min_ms;
 static fifo_t           m_rbc_event_fifo;
 static rbc_mesh_event_t m_rbc_event_buffer[RBC_MESH_APP_EVENT_QUEUE_LENGTH];
+static struct
+{
+    uint32_t new_val;
+    uint32_t update_val;
+    uint32_t conflicting_val;
+    uint32_t tx;
+    uint32_t drop;
+    uint32_t max_depth;
+} m_app_event_stats;
 
 /*****************************************************************************
 * Static Functions
 *****************************************************************************/
-#if defined(WITH_ACK_MASTER) 
-static uint32_t top_queue_counter[4] __attribute__((at(0x20002F98)))={0};
-static uint32_t top_queue_drop __attribute__((at(0x20002FA8))) =0;
-#endif
+/** Replace zero cache and pool sizes with their defaults. */
+static void arena_sizes_default(uint16_t* p_handle_cache_entries, uint16_t* p_data_cache_entries, uint16_t* p_packet_pool_size)
+{
+    if (*p_handle_cache_entries == 0)
+    {
+        *p_handle_cache_entries = RBC_MESH_HANDLE_CACHE_ENTRIES;
+    }
+    if (*p_data_cache_entries == 0)
+    {
+        *p_data_cache_entries = RBC_MESH_DATA_CACHE_ENTRIES;
+    }
+    if (*p_packet_pool_size == 0)
+    {
+        *p_packet_pool_size = *p_data_cache_entries + RBC_MESH_PACKET_POOL_QUEUED_PACKETS;
+    }
+}
 
-#if defined (WITHOUT_ACK_MASTER)
-static uint32_t top_queue_counter[4] __attribute__((at(0x200026B4))) ={0};
-static uint32_t top_queue_drop __attribute__((at(0x200026C4))) =0;
-#endif
+/** Split the application supplied arena between the caches and the packet pool. */
+static uint32_t arena_setup(rbc_mesh_init_params_t* p_init_params)
+{
+    if (p_init_params->p_arena == NULL)
+    {
+        /* only the static memory is available without an arena */
+        if (!RBC_MESH_STATIC_ARENA ||
+            p_init_params->handle_cache_entries != 0 ||
+            p_init_params->data_cache_entries != 0 ||
+            p_init_params->packet_pool_size != 0)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+        return NRF_SUCCESS;
+    }
 
-#if defined(WITH_ACK_SLAVE)
-static uint32_t top_queue_counter[4] __attribute__((at(0x200026A0)))  ={0};
-static uint32_t top_queue_drop __attribute__((at(0x200026B0)))  =0;
-#endif
+    uint16_t handle_cache_entries = p_init_params->handle_cache_entries;
+    uint16_t data_cache_entries = p_init_params->data_cache_entries;
+    uint16_t packet_pool_size = p_init_params->packet_pool_size;
+    arena_sizes_default(&handle_cache_entries, &data_cache_entries, &packet_pool_size);
+
+    uint32_t cache_size = ARENA_ALIGN(handle_storage_memory_size_get(handle_cache_entries, data_cache_entries));
+    if (p_init_params->arena_size < cache_size)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    uint32_t error_code = handle_storage_memory_set(p_init_params->p_arena,
+                                                    cache_size,
+                                                    handle_cache_entries,
+                                                    data_cache_entries);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    return mesh_packet_pool_memory_set((uint8_t*) p_init_params->p_arena + cache_size,
+                                       p_init_params->arena_size - cache_size,
+                                       packet_pool_size);
+}
 
-#if defined(WITHOUT_ACK_SLAVE)
-static uint32_t top_queue_counter[4] __attribute__((at(0x200026A0)))  ={0};
-static uint32_t top_queue_drop __attribute__((at(0x200026B0))) =0;
-#endif
 /*****************************************************************************
 * Interface Functions
 *****************************************************************************/
@@ -102,13 +162,31 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
         return NRF_ERROR_INVALID_PARAM;
     }
 
+    if (init_params.phy > RBC_MESH_PHY_2MBIT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t error_code = radio_phy_set(init_params.phy);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    error_code = arena_setup(&init_params);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
     timer_sch_init();
+    latency_init();
     event_handler_init();
+    trace_init(); /* the RTT flush timer is scheduled through the event queue */
     mesh_packet_init();
     tc_init(init_params.access_addr, init_params.channel);
 
 
-    uint32_t error_code;
     error_code = vh_init(init_params.interval_min_ms * 1000, /* ms -> us */
                          init_params.access_addr,
                          init_params.channel, 
@@ -117,6 +195,8 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
     {
         return error_code;
     }
+    time_sync_init();
+    digest_init();
 
     ble_enable_params_t ble_enable;
     memset(&ble_enable, 0, sizeof(ble_enable));
@@ -155,6 +235,7 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
     m_rbc_event_fifo.elem_size = sizeof(rbc_mesh_event_t);
     m_rbc_event_fifo.memcpy_fptr = NULL;
     fifo_init(&m_rbc_event_fifo);
+    memset(&m_app_event_stats, 0, sizeof(m_app_event_stats));
     timeslot_resume();
 
 #ifdef MESH_DFU
@@ -164,6 +245,13 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
 #endif
 }
 
+uint32_t rbc_mesh_arena_size_get(uint16_t handle_cache_entries, uint16_t data_cache_entries, uint16_t packet_pool_size)
+{
+    arena_sizes_default(&handle_cache_entries, &data_cache_entries, &packet_pool_size);
+    return ARENA_ALIGN(handle_storage_memory_size_get(handle_cache_entries, data_cache_entries)) +
+           mesh_packet_pool_memory_size_get(packet_pool_size);
+}
+
 rbc_mesh_state_t rbc_mesh_state_get(void)
 {
     return m_mesh_state;
@@ -324,6 +412,202 @@ uint32_t rbc_mesh_tx_event_flag_get(rbc_mesh_value_handle_t handle, bool* is_doi
     return vh_tx_event_flag_get(handle, is_doing_tx_event);
 }
 
+uint32_t rbc_mesh_trickle_profile_set(uint8_t profile, const rbc_mesh_trickle_profile_t* p_profile)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_profile == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return vh_trickle_profile_set(profile, p_profile);
+}
+
+uint32_t rbc_mesh_trickle_profile_get(uint8_t profile, rbc_mesh_trickle_profile_t* p_profile)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_profile == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return vh_trickle_profile_get(profile, p_profile);
+}
+
+uint32_t rbc_mesh_value_trickle_profile_set(rbc_mesh_value_handle_t handle, uint8_t profile)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return vh_value_trickle_profile_set(handle, profile);
+}
+
+uint32_t rbc_mesh_value_trickle_profile_get(rbc_mesh_value_handle_t handle, uint8_t* p_profile)
+{
+    if (handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return vh_value_trickle_profile_get(handle, p_profile);
+}
+
+uint32_t rbc_mesh_time_sync_root_set(bool is_root)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return time_sync_root_set(is_root);
+}
+
+uint32_t rbc_mesh_time_get(uint32_t* p_mesh_time_us)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_mesh_time_us == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return time_sync_convert(timer_now(), p_mesh_time_us);
+}
+
+uint32_t rbc_mesh_time_convert(uint32_t timestamp_us, uint32_t* p_mesh_time_us)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_mesh_time_us == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return time_sync_convert(timestamp_us, p_mesh_time_us);
+}
+
+uint32_t rbc_mesh_time_sync_status_get(rbc_mesh_time_sync_status_t* p_status)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_status == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    time_sync_status_get(p_status);
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_channel_stats_get(uint8_t channel, rbc_mesh_channel_stats_t* p_stats)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return tc_channel_stats_get(channel, p_stats);
+}
+
+uint32_t rbc_mesh_stats_get(rbc_mesh_stats_t* p_stats)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    rbc_mesh_channel_stats_t rx_stats;
+    tc_rx_stats_get(&rx_stats);
+    p_stats->rx_ok = rx_stats.rx_ok;
+    p_stats->rx_crc_fail = rx_stats.rx_crc_fail;
+
+    p_stats->events_timer = event_handler_executed_count_get(EVENT_TYPE_TIMER);
+    p_stats->events_timer_sch = event_handler_executed_count_get(EVENT_TYPE_TIMER_SCH);
+    p_stats->events_generic = event_handler_executed_count_get(EVENT_TYPE_GENERIC);
+    p_stats->events_packet = event_handler_executed_count_get(EVENT_TYPE_PACKET);
+    p_stats->events_set_flag = event_handler_executed_count_get(EVENT_TYPE_SET_FLAG);
+    p_stats->events_set_trickle_profile = event_handler_executed_count_get(EVENT_TYPE_SET_TRICKLE_PROFILE);
+
+    uint32_t* p_max_depth[EVENT_CLASS__COUNT] =
+    {
+        &p_stats->event_queue_max_depth_generic,
+        &p_stats->event_queue_max_depth_timer,
+        &p_stats->event_queue_max_depth_packet,
+        &p_stats->event_queue_max_depth_timeslot,
+    };
+    p_stats->event_queue_drop = 0;
+    p_stats->event_max_latency_us = 0;
+    p_stats->event_coalesced = 0;
+    for (uint32_t i = 0; i < EVENT_CLASS__COUNT; ++i)
+    {
+        event_handler_stats_t evt_stats;
+        event_handler_stats_get((event_class_t) i, &evt_stats);
+        *p_max_depth[i] = evt_stats.max_depth;
+        p_stats->event_queue_drop += evt_stats.dropped;
+        p_stats->event_coalesced += evt_stats.coalesced;
+        if (evt_stats.max_latency_us > p_stats->event_max_latency_us)
+        {
+            p_stats->event_max_latency_us = evt_stats.max_latency_us;
+        }
+        if (i == EVENT_CLASS_PACKET)
+        {
+            p_stats->rx_queue_drop = evt_stats.dropped;
+        }
+    }
+
+    p_stats->app_events_new_val = m_app_event_stats.new_val;
+    p_stats->app_events_update_val = m_app_event_stats.update_val;
+    p_stats->app_events_conflicting_val = m_app_event_stats.conflicting_val;
+    p_stats->app_events_tx = m_app_event_stats.tx;
+    p_stats->app_event_queue_drop = m_app_event_stats.drop;
+    p_stats->app_event_queue_max_depth = m_app_event_stats.max_depth;
+
+    mesh_packet_stats_t pool_stats;
+    mesh_packet_stats_get(&pool_stats);
+    p_stats->packet_pool_in_use = pool_stats.in_use;
+    p_stats->packet_pool_max_in_use = pool_stats.high_water_mark;
+    p_stats->packet_pool_exhausted = pool_stats.exhausted;
+
+    handle_storage_stats_t storage_stats;
+    handle_storage_stats_get(&storage_stats);
+    p_stats->data_cache_in_use = storage_stats.data_entries_in_use;
+    p_stats->data_cache_evictions = storage_stats.data_entry_evictions;
+
+    trickle_stats_t trickle_stats;
+    trickle_stats_get(&trickle_stats);
+    p_stats->trickle_tx = trickle_stats.tx;
+    p_stats->trickle_suppressed = trickle_stats.suppressed;
+
+    digest_stats_t digest_stats;
+    digest_stats_get(&digest_stats);
+    p_stats->digest_tx = digest_stats.tx;
+    p_stats->digest_bucket_resets = digest_stats.bucket_resets;
+
+    snapshot_stats_t snapshot_stats;
+    snapshot_stats_get(&snapshot_stats);
+    p_stats->snapshot_records = snapshot_stats.records;
+    p_stats->snapshot_bank_erases = snapshot_stats.bank_erases;
+
+    return NRF_SUCCESS;
+}
+
 void rbc_mesh_tx_power_set(rbc_mesh_txpower_t tx_power)
 {
     vh_tx_power_set(tx_power);
@@ -358,37 +642,38 @@ uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_event)
     }
     
     uint32_t error_code = fifo_push(&m_rbc_event_fifo, p_event);
-    
-    #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)|| defined (WITH_ACK_SLAVE)|| defined (WITHOUT_ACK_SLAVE)
-    
-    
-		
-		if (error_code != NRF_SUCCESS)
-			   top_queue_drop++;
-		
-		 switch (p_event->type)
-         {
+    if (error_code != NRF_SUCCESS)
+    {
+        m_app_event_stats.drop++;
+    }
+    else
+    {
+        uint32_t depth = fifo_get_len(&m_rbc_event_fifo);
+        if (depth > m_app_event_stats.max_depth)
+        {
+            m_app_event_stats.max_depth = depth;
+        }
+        switch (p_event->type)
+        {
             case RBC_MESH_EVENT_TYPE_NEW_VAL:
-					top_queue_counter[0]++;
-				    break;
-						
+                m_app_event_stats.new_val++;
+                LATENCY_RECORD(LATENCY_STAGE_EVENT_PUSH, p_event->params.rx.timestamp_us);
+                break;
             case RBC_MESH_EVENT_TYPE_UPDATE_VAL:
-					top_queue_counter[1]++;
-					break;
+                m_app_event_stats.update_val++;
+                LATENCY_RECORD(LATENCY_STAGE_EVENT_PUSH, p_event->params.rx.timestamp_us);
+                break;
             case RBC_MESH_EVENT_TYPE_CONFLICTING_VAL:
-					top_queue_counter[2]++;
-				    break;
-			case RBC_MESH_EVENT_TYPE_TX:
-					top_queue_counter[3]++;
-					break;
-						
-			default:
-					break;
-		}
-         
-      #endif
-        
-    
+                m_app_event_stats.conflicting_val++;
+                LATENCY_RECORD(LATENCY_STAGE_EVENT_PUSH, p_event->params.rx.timestamp_us);
+                break;
+            case RBC_MESH_EVENT_TYPE_TX:
+                m_app_event_stats.tx++;
+                break;
+            default:
+                break;
+        }
+    }
 
     if (error_code == NRF_SUCCESS && p_event->params.rx.p_data != NULL)
     {
@@ -425,6 +710,14 @@ uint32_t rbc_mesh_event_get(rbc_mesh_event_t* p_evt)
     {
         return NRF_ERROR_NOT_FOUND;
     }
+#if RBC_MESH_LATENCY_HISTOGRAMS
+    if (p_evt->type == RBC_MESH_EVENT_TYPE_NEW_VAL ||
+        p_evt->type == RBC_MESH_EVENT_TYPE_UPDATE_VAL ||
+        p_evt->type == RBC_MESH_EVENT_TYPE_CONFLICTING_VAL)
+    {
+        latency_record(LATENCY_STAGE_EVENT_GET, p_evt->params.rx.timestamp_us);
+    }
+#endif
 
     return NRF_SUCCESS;
 }
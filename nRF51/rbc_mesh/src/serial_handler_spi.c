@@ -288,6 +288,7 @@ void serial_handler_init(void)
     rx_fifo.elem_array = rx_fifo_buffer;
     rx_fifo.elem_size = sizeof(serial_data_t);
     rx_fifo.memcpy_fptr = NULL;
+    rx_fifo.mode = FIFO_MODE_SPSC; /* filled by the serial ISR, emptied by the ACI handler */
     fifo_init(&rx_fifo);
 
     nrf_gpio_cfg_output(PIN_RDYN);
@@ -210,6 +210,7 @@ void serial_handler_init(void)
     m_rx_fifo.elem_array = m_rx_fifo_buffer;
     m_rx_fifo.elem_size = sizeof(serial_data_t);
     m_rx_fifo.memcpy_fptr = NULL;
+    m_rx_fifo.mode = FIFO_MODE_SPSC; /* filled by the serial ISR, emptied by the ACI handler */
     fifo_init(&m_rx_fifo);
 
     m_suspend = false;
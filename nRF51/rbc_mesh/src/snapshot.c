@@ -0,0 +1,439 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "snapshot.h"
+
+#include "handle_storage.h"
+#include "mesh_flash.h"
+#include "mesh_packet.h"
+#include "timer.h"
+#include "timer_scheduler.h"
+#include "event_handler.h"
+#include "rbc_mesh.h"
+
+#include "nrf_error.h"
+#include "app_error.h"
+#include <string.h>
+
+#if RBC_MESH_SNAPSHOT
+
+#define SNAPSHOT_MAGIC                  (0x50414E53)        /**< "SNAP", marks a complete bank */
+#define SNAPSHOT_BANK_COUNT             (2)
+#define SNAPSHOT_BANK_NONE              (SNAPSHOT_BANK_COUNT)
+#define SNAPSHOT_BANK_SIZE              (RBC_MESH_SNAPSHOT_BANK_PAGES * PAGE_SIZE)
+#define SNAPSHOT_BANK_ADDR(bank)        (RBC_MESH_SNAPSHOT_FLASH_ADDR + (bank) * SNAPSHOT_BANK_SIZE)
+#define SNAPSHOT_RECORD_SIZE(length)    (sizeof(snapshot_record_t) + (((length) + WORD_SIZE - 1) & ~(WORD_SIZE - 1)))
+#define SNAPSHOT_STEP_INTERVAL_US       (50000)             /**< Time between the steps of a compaction, and between checks for the end of a flash operation */
+
+/******************************************************************************
+* Local typedefs
+******************************************************************************/
+/** Header at the start of a bank, written when the bank is complete. */
+typedef struct
+{
+    uint32_t sequence;              /**< Incremented by every compaction, the bank with the highest one is in use. */
+    uint32_t magic;                 /**< SNAPSHOT_MAGIC if the bank is complete. */
+} snapshot_bank_header_t;
+
+/** Record of a value, followed by its payload, padded to a whole word. An
+  erased handle and version mark the end of the log. */
+typedef struct
+{
+    uint16_t handle;
+    uint16_t version;               /**< Version of the value, or 0 for a handle that is no longer persistent. */
+    uint16_t length;                /**< Payload length. */
+    uint16_t check;                 /**< Fletcher-16 checksum of the other fields and the payload, never 0xFFFF. */
+} snapshot_record_t;
+
+typedef enum
+{
+    SNAPSHOT_STATE_APPEND,          /**< Appending changes to the active bank. */
+    SNAPSHOT_STATE_ERASE,           /**< Erasing the other bank for a compaction. */
+    SNAPSHOT_STATE_COPY,            /**< Copying the persistent values to the other bank. */
+    SNAPSHOT_STATE_HEADER           /**< Writing the header that puts the other bank in use. */
+} snapshot_state_t;
+
+/******************************************************************************
+* Static globals
+******************************************************************************/
+static timer_event_t            m_timer_evt;
+static snapshot_state_t         m_state;
+static uint32_t                 m_bank;             /**< Bank in use, or SNAPSHOT_BANK_NONE */
+static uint32_t                 m_sequence;         /**< Sequence number of the bank in use */
+static uint32_t                 m_write_offset;     /**< Offset of the next record in the bank being written */
+static uint32_t                 m_copy_index;       /**< Handle cache index a compaction continues from */
+static bool                     m_compacted;        /**< Nothing has been appended since the last compaction */
+static uint32_t                 m_buffer[RBC_MESH_SNAPSHOT_BATCH_SIZE / sizeof(uint32_t)]; /**< Records being written */
+static snapshot_bank_header_t   m_header;           /**< Header being written */
+static snapshot_stats_t         m_stats;
+
+/******************************************************************************
+* Static functions
+******************************************************************************/
+static void snapshot_timeout(uint32_t timestamp, void* p_context);
+
+static void check_add(uint32_t* p_sums, const uint8_t* p_data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        p_sums[0] = (p_sums[0] + p_data[i]) % 255;
+        p_sums[1] = (p_sums[1] + p_sums[0]) % 255;
+    }
+}
+
+static uint16_t record_check(const snapshot_record_t* p_record, const uint8_t* p_data)
+{
+    snapshot_record_t fields = *p_record;
+    fields.check = 0;
+    uint32_t sums[2] = {0, 0};
+    check_add(sums, (const uint8_t*) &fields, sizeof(fields));
+    check_add(sums, p_data, p_record->length);
+    return (uint16_t) ((sums[1] << 8) | sums[0]);
+}
+
+static void record_restore(const snapshot_record_t* p_record, const uint8_t* p_data)
+{
+    bool persistent;
+    if (p_record->version == 0)
+    {
+        if (handle_storage_flag_get(p_record->handle, HANDLE_FLAG_PERSISTENT, &persistent) == NRF_SUCCESS &&
+            persistent)
+        {
+            (void) handle_storage_flag_set(p_record->handle, HANDLE_FLAG_PERSISTENT, false);
+        }
+        return;
+    }
+
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return;
+    }
+    if (mesh_packet_build(p_packet, p_record->handle, p_record->version,
+                          (uint8_t*) p_data, p_record->length) == NRF_SUCCESS &&
+        handle_storage_flag_set(p_record->handle, HANDLE_FLAG_PERSISTENT, true) == NRF_SUCCESS)
+    {
+        handle_info_t info;
+        info.version = p_record->version;
+        info.p_packet = p_packet;
+        (void) handle_storage_info_set(p_record->handle, &info);
+    }
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+/** Replay the records of a bank in order. Returns the offset of the end of
+  the log, or the bank size if the log ends in a broken record. */
+static uint32_t records_replay(uint32_t bank)
+{
+    const uint8_t* p_bank = (const uint8_t*) SNAPSHOT_BANK_ADDR(bank);
+    uint32_t offset = sizeof(snapshot_bank_header_t);
+    while (offset + sizeof(snapshot_record_t) <= SNAPSHOT_BANK_SIZE)
+    {
+        snapshot_record_t record;
+        memcpy(&record, &p_bank[offset], sizeof(record));
+        if (record.handle == 0xFFFF && record.version == 0xFFFF)
+        {
+            break; /* erased */
+        }
+        const uint8_t* p_data = &p_bank[offset + sizeof(snapshot_record_t)];
+        if (record.length > RBC_MESH_VALUE_MAX_LEN ||
+            offset + SNAPSHOT_RECORD_SIZE(record.length) > SNAPSHOT_BANK_SIZE ||
+            record.check != record_check(&record, p_data))
+        {
+            return SNAPSHOT_BANK_SIZE; /* cut short by a reset, the next write compacts */
+        }
+        record_restore(&record, p_data);
+        offset += SNAPSHOT_RECORD_SIZE(record.length);
+    }
+    return offset;
+}
+
+/** Fill the buffer with the records of the changed handles, or of all
+  persistent handles with all set, starting at the given handle cache index.
+  Handles are marked written as their records are added, or left out if they
+  need none. Records that don't fit in room are left out with drop set.
+  Returns true if all handles were gathered, false if the buffer or the room
+  filled up first. */
+static bool records_gather(uint32_t* p_index, bool all, uint32_t room, bool drop, uint32_t* p_length, uint32_t* p_count)
+{
+    uint8_t* p_buffer = (uint8_t*) m_buffer;
+    rbc_mesh_value_handle_t handle;
+    handle_info_t info;
+    bool persistent;
+    while (handle_storage_snapshot_next(p_index, all, &handle, &info, &persistent) == NRF_SUCCESS)
+    {
+        snapshot_record_t record;
+        record.handle = handle;
+        record.version = 0;
+        record.length = 0;
+        const uint8_t* p_data = NULL;
+        if (info.p_packet != NULL)
+        {
+            mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(info.p_packet);
+            if (p_adv_data != NULL)
+            {
+                record.version = info.version;
+                record.length = p_adv_data->adv_data_length - MESH_PACKET_ADV_OVERHEAD;
+                p_data = p_adv_data->data;
+            }
+        }
+        /* a compacted bank needs no record of values that aren't persistent,
+           or of persistent handles without a value */
+        bool needs_record = (persistent ? (record.version != 0) : !all);
+        uint32_t size = (needs_record ? SNAPSHOT_RECORD_SIZE(record.length) : 0);
+
+        if (*p_length + size > sizeof(m_buffer) ||
+            (*p_length + size > room && !drop))
+        {
+            if (info.p_packet != NULL)
+            {
+                mesh_packet_ref_count_dec(info.p_packet);
+            }
+            return false;
+        }
+        if (needs_record && *p_length + size <= room)
+        {
+            if (!persistent)
+            {
+                record.version = 0;
+                record.length = 0;
+            }
+            record.check = record_check(&record, p_data);
+            memcpy(&p_buffer[*p_length], &record, sizeof(record));
+            memcpy(&p_buffer[*p_length + sizeof(record)], p_data, record.length);
+            memset(&p_buffer[*p_length + sizeof(record) + record.length], 0,
+                   size - sizeof(record) - record.length);
+            *p_length += size;
+            (*p_count)++;
+        }
+        if (info.p_packet != NULL)
+        {
+            mesh_packet_ref_count_dec(info.p_packet);
+        }
+        handle_storage_snapshot_written(*p_index);
+        (*p_index)++;
+    }
+    return true;
+}
+
+static bool buffer_write(uint32_t bank, uint32_t length)
+{
+    flash_op_t op;
+    op.write.start_addr = (uint32_t) (SNAPSHOT_BANK_ADDR(bank) + m_write_offset);
+    op.write.p_data = (uint8_t*) m_buffer;
+    op.write.length = length;
+    if (mesh_flash_op_push_unreported(FLASH_OP_TYPE_WRITE, &op) != NRF_SUCCESS)
+    {
+        return false;
+    }
+    m_write_offset += length;
+    return true;
+}
+
+static uint32_t target_bank_get(void)
+{
+    return (m_bank == 0) ? 1 : 0;
+}
+
+/** Append the changes to the bank in use. Returns the time until the next step. */
+static uint32_t changes_append(void)
+{
+    uint32_t index = 0;
+    uint32_t length = 0;
+    uint32_t count = 0;
+    bool done = records_gather(&index, false, SNAPSHOT_BANK_SIZE - m_write_offset, m_compacted, &length, &count);
+    if (length == 0)
+    {
+        if (!done)
+        {
+            m_state = SNAPSHOT_STATE_ERASE; /* out of room */
+            return SNAPSHOT_STEP_INTERVAL_US;
+        }
+    }
+    else if (buffer_write(m_bank, length))
+    {
+        m_stats.records += count;
+        m_compacted = false;
+    }
+    else
+    {
+        m_state = SNAPSHOT_STATE_ERASE; /* the gathered changes are lost, compact to get them back */
+        return SNAPSHOT_STEP_INTERVAL_US;
+    }
+    return (done ? RBC_MESH_SNAPSHOT_INTERVAL_MS * 1000 : SNAPSHOT_STEP_INTERVAL_US);
+}
+
+static void bank_erase(void)
+{
+    flash_op_t op;
+    op.erase.start_addr = (uint32_t) SNAPSHOT_BANK_ADDR(target_bank_get());
+    op.erase.length = SNAPSHOT_BANK_SIZE;
+    if (mesh_flash_op_push_unreported(FLASH_OP_TYPE_ERASE, &op) == NRF_SUCCESS)
+    {
+        m_stats.bank_erases++;
+        m_write_offset = sizeof(snapshot_bank_header_t);
+        m_copy_index = 0;
+        m_state = SNAPSHOT_STATE_COPY;
+    }
+}
+
+static void values_copy(void)
+{
+    uint32_t length = 0;
+    uint32_t count = 0;
+    bool done = records_gather(&m_copy_index, true, SNAPSHOT_BANK_SIZE - m_write_offset, true, &length, &count);
+    if (length > 0)
+    {
+        if (!buffer_write(target_bank_get(), length))
+        {
+            m_state = SNAPSHOT_STATE_ERASE; /* start over */
+            return;
+        }
+        m_stats.records += count;
+    }
+    if (done)
+    {
+        m_state = SNAPSHOT_STATE_HEADER;
+    }
+}
+
+static void header_write(void)
+{
+    uint32_t bank = target_bank_get();
+    m_header.sequence = m_sequence + 1;
+    m_header.magic = SNAPSHOT_MAGIC;
+
+    flash_op_t op;
+    op.write.start_addr = (uint32_t) SNAPSHOT_BANK_ADDR(bank);
+    op.write.p_data = (uint8_t*) &m_header;
+    op.write.length = sizeof(m_header);
+    if (mesh_flash_op_push_unreported(FLASH_OP_TYPE_WRITE, &op) == NRF_SUCCESS)
+    {
+        m_bank = bank;
+        m_sequence++;
+        m_compacted = true;
+        m_state = SNAPSHOT_STATE_APPEND;
+    }
+}
+
+static void timer_schedule(uint32_t time_now, uint32_t delay)
+{
+    if (timer_sch_reschedule(&m_timer_evt, time_now + delay) != NRF_SUCCESS)
+    {
+        /* run the timeout from the event queue, it will try again */
+        async_event_t evt;
+        evt.type = EVENT_TYPE_TIMER_SCH;
+        evt.callback.timer_sch.cb = snapshot_timeout;
+        evt.callback.timer_sch.timestamp = time_now;
+        evt.callback.timer_sch.p_context = NULL;
+        event_handler_push_coalesced(&evt);
+    }
+}
+
+static void snapshot_timeout(uint32_t timestamp, void* p_context)
+{
+    uint32_t next_step = SNAPSHOT_STEP_INTERVAL_US;
+    /* the buffer is in use until the flash operations have ended */
+    if (!mesh_flash_in_progress())
+    {
+        switch (m_state)
+        {
+            case SNAPSHOT_STATE_APPEND:
+                next_step = changes_append();
+                break;
+            case SNAPSHOT_STATE_ERASE:
+                bank_erase();
+                break;
+            case SNAPSHOT_STATE_COPY:
+                values_copy();
+                break;
+            case SNAPSHOT_STATE_HEADER:
+                header_write();
+                if (m_state == SNAPSHOT_STATE_APPEND)
+                {
+                    next_step = RBC_MESH_SNAPSHOT_INTERVAL_MS * 1000;
+                }
+                break;
+        }
+    }
+    timer_schedule(timestamp, next_step);
+}
+
+/******************************************************************************
+* Interface functions
+******************************************************************************/
+void snapshot_restore(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_state = SNAPSHOT_STATE_APPEND;
+    m_bank = SNAPSHOT_BANK_NONE;
+    m_sequence = 0;
+    m_write_offset = SNAPSHOT_BANK_SIZE; /* nothing to append to until the first compaction */
+    m_compacted = false;
+
+    for (uint32_t bank = 0; bank < SNAPSHOT_BANK_COUNT; ++bank)
+    {
+        const snapshot_bank_header_t* p_header = (const snapshot_bank_header_t*) SNAPSHOT_BANK_ADDR(bank);
+        if (p_header->magic == SNAPSHOT_MAGIC &&
+            (m_bank == SNAPSHOT_BANK_NONE || (int32_t) (p_header->sequence - m_sequence) > 0))
+        {
+            m_bank = bank;
+            m_sequence = p_header->sequence;
+        }
+    }
+    if (m_bank != SNAPSHOT_BANK_NONE)
+    {
+        m_write_offset = records_replay(m_bank);
+    }
+
+    m_timer_evt.p_next = NULL;
+    m_timer_evt.cb = snapshot_timeout;
+    m_timer_evt.interval = 0;
+    m_timer_evt.p_context = NULL;
+    timer_schedule(timer_now(), RBC_MESH_SNAPSHOT_INTERVAL_MS * 1000);
+}
+
+void snapshot_stats_get(snapshot_stats_t* p_stats)
+{
+    memcpy(p_stats, &m_stats, sizeof(snapshot_stats_t));
+}
+
+#else /* RBC_MESH_SNAPSHOT */
+
+void snapshot_restore(void)
+{
+}
+
+void snapshot_stats_get(snapshot_stats_t* p_stats)
+{
+    memset(p_stats, 0, sizeof(snapshot_stats_t));
+}
+
+#endif /* RBC_MESH_SNAPSHOT */
@@ -0,0 +1,476 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "time_sync.h"
+
+#include "transport_control.h"
+#include "version_handler.h"
+#include "timer.h"
+#include "timer_scheduler.h"
+#include "event_handler.h"
+#include "trickle.h"
+#include "toolchain.h"
+#include "rbc_mesh.h"
+#include "mesh_packet.h"
+
+#include "nrf_error.h"
+#include "app_error.h"
+#include <string.h>
+
+#define TIME_SYNC_HOPS_INVALID          (0xFF)
+#define TIME_SYNC_NEIGHBOR_COUNT        (8)                 /**< Beacon senders kept track of, least recently heard is replaced */
+#define TIME_SYNC_SKEW_SHIFT            (24)                /**< Fixed point position of the skew */
+#define TIME_SYNC_SKEW_MAX              ((1L << TIME_SYNC_SKEW_SHIFT) / 1000)   /**< 1000 ppm, twice the worst LF clock accuracy */
+#define TIME_SYNC_SKEW_BASELINE_US      (4000000)           /**< Shortest time between the two samples a skew is measured over */
+#define TIME_SYNC_SKEW_FILTER_SHIFT     (2)                 /**< Weight of a new skew measurement, as a power of two fraction */
+#define TIME_SYNC_TIMEOUT_INTERVALS     (10)                /**< Longest intervals without a sample before the sync is lost */
+#define TIME_SYNC_TIMER_MARGIN_US       (1000)              /**< Beacons this close to their trickle timeout are due, the scheduler fires a little early */
+#define TIME_SYNC_COPIES_MAX            (3)                 /**< Copies of a beacon, one per advertisement channel */
+#define TIME_SYNC_COPY_INVALID          (0xFF)
+#define TIME_SYNC_OFFSET_INVALID        (0xFFFF)
+
+/******************************************************************************
+* Local typedefs
+******************************************************************************/
+/** Payload of a time synchronization beacon. The beacon sequence number is
+  carried in the version field. */
+typedef __packed_armcc struct
+{
+    uint8_t  hops;                  /**< Sender's hops to the root. */
+    uint16_t prev_seq;              /**< Sequence number of the sender's previous beacon, or this beacon's if unknown. */
+    uint32_t prev_tx_time;          /**< Mesh time at the access address of the previous beacon's first copy. */
+    uint16_t prev_tx_offset[TIME_SYNC_COPIES_MAX - 1]; /**< Time from the first copy to each of the others, in us, or TIME_SYNC_OFFSET_INVALID. */
+} __packed_gcc time_sync_beacon_t;
+
+typedef struct
+{
+    uint8_t  addr[BLE_GAP_ADDR_LEN];
+    bool     used;
+    uint16_t seq;                   /**< Sequence number of the last beacon heard from the neighbor */
+    uint32_t rx_time;               /**< Local time of the last beacon's access address */
+    uint8_t  rx_copy;               /**< Copy of the last beacon that was heard */
+    uint32_t last_heard;            /**< Age counter, for replacement */
+} time_sync_neighbor_t;
+
+/******************************************************************************
+* Static globals
+******************************************************************************/
+static bool                 m_is_root;
+static uint8_t              m_hops;             /**< Hops to the root, or TIME_SYNC_HOPS_INVALID when not synced */
+static uint32_t             m_ref_local;        /**< Local time of the latest sample */
+static uint32_t             m_ref_mesh;         /**< Mesh time of the latest sample */
+static int32_t              m_skew;             /**< Mesh clock rate relative to the local clock, minus one */
+static bool                 m_skew_valid;
+static bool                 m_skew_ref_valid;
+static uint32_t             m_skew_ref_local;   /**< Sample the next skew is measured from */
+static uint32_t             m_skew_ref_mesh;
+static uint32_t             m_last_sample_time;
+static trickle_t            m_trickle;
+static timer_event_t        m_timer_evt;
+static uint16_t             m_seq;              /**< Sequence number of the last beacon sent */
+static time_sync_neighbor_t m_neighbors[TIME_SYNC_NEIGHBOR_COUNT];
+static uint32_t             m_neighbor_age;
+
+/** Air time of the last beacon sent, written in the radio callback. */
+static struct
+{
+    bool     valid;
+    uint16_t seq;
+    uint32_t time;                  /**< Capture of the first copy */
+    uint16_t offset[TIME_SYNC_COPIES_MAX - 1];
+} m_tx_record;
+
+/******************************************************************************
+* Static functions
+******************************************************************************/
+static void beacon_timeout(uint32_t timestamp, void* p_context);
+
+/** Index of the beacon copy sent on the given channel. The copies go out in
+  channel order, all devices share the channel map. */
+static uint8_t copy_index_get(uint8_t channel)
+{
+    tc_tx_config_t tx_config;
+    vh_tx_config_get(&tx_config);
+    uint32_t bit = channel - tx_config.first_channel;
+    if (channel < tx_config.first_channel || bit >= 8 || !(tx_config.channel_map & (1 << bit)))
+    {
+        return TIME_SYNC_COPY_INVALID;
+    }
+    uint8_t index = 0;
+    for (uint32_t i = 0; i < bit; ++i)
+    {
+        index += ((tx_config.channel_map >> i) & 0x01);
+    }
+    return (index < TIME_SYNC_COPIES_MAX ? index : TIME_SYNC_COPY_INVALID);
+}
+
+static uint32_t mesh_time_get(uint32_t local_time)
+{
+    int32_t elapsed = (int32_t) (local_time - m_ref_local);
+    int32_t correction = (int32_t) (((int64_t) elapsed * m_skew) >> TIME_SYNC_SKEW_SHIFT);
+    return m_ref_mesh + (uint32_t) elapsed + (uint32_t) correction;
+}
+
+static void sync_lose(void)
+{
+    m_hops = TIME_SYNC_HOPS_INVALID;
+    m_skew = 0;
+    m_skew_valid = false;
+    m_skew_ref_valid = false;
+}
+
+static void beacon_schedule(uint32_t time_now)
+{
+    if (timer_sch_reschedule(&m_timer_evt, m_trickle.t) != NRF_SUCCESS)
+    {
+        /* run the timeout from the event queue, it will try again */
+        async_event_t evt;
+        evt.type = EVENT_TYPE_TIMER_SCH;
+        evt.callback.timer_sch.cb = beacon_timeout;
+        evt.callback.timer_sch.timestamp = time_now;
+        evt.callback.timer_sch.p_context = NULL;
+        event_handler_push_coalesced(&evt);
+    }
+}
+
+static void beacon_tx(void)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return;
+    }
+
+    uint16_t seq = m_seq + 1;
+    time_sync_beacon_t beacon;
+    beacon.hops = m_hops;
+    beacon.prev_seq = seq;
+    beacon.prev_tx_time = 0;
+    memset(beacon.prev_tx_offset, 0xFF, sizeof(beacon.prev_tx_offset));
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    bool prev_sent = (m_tx_record.valid && m_tx_record.seq == m_seq);
+    uint32_t prev_tx_time = m_tx_record.time;
+    if (prev_sent)
+    {
+        memcpy(beacon.prev_tx_offset, m_tx_record.offset, sizeof(beacon.prev_tx_offset));
+    }
+    _ENABLE_IRQS(was_masked);
+
+    if (prev_sent)
+    {
+        beacon.prev_seq = m_seq;
+        beacon.prev_tx_time = mesh_time_get(prev_tx_time);
+    }
+
+    tc_tx_config_t tx_config;
+    vh_tx_config_get(&tx_config);
+    if (mesh_packet_build(p_packet, MESH_TIME_SYNC_HANDLE, seq, (uint8_t*) &beacon, sizeof(beacon)) == NRF_SUCCESS &&
+        tc_tx(p_packet, &tx_config) == NRF_SUCCESS)
+    {
+        m_seq = seq;
+    }
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+static void beacon_timeout(uint32_t timestamp, void* p_context)
+{
+    if (!m_is_root && m_hops != TIME_SYNC_HOPS_INVALID)
+    {
+        trickle_profile_t profile;
+        APP_ERROR_CHECK(trickle_profile_get(m_trickle.profile, &profile));
+        if (timestamp - m_last_sample_time > (uint64_t) profile.i_max * TIME_SYNC_TIMEOUT_INTERVALS)
+        {
+            sync_lose();
+        }
+    }
+
+    if (!m_is_root && m_hops == TIME_SYNC_HOPS_INVALID)
+    {
+        return; /* restarted by the next sample */
+    }
+
+    if (m_is_root)
+    {
+        /* keep the time since the reference within the signed range */
+        m_ref_mesh = mesh_time_get(timestamp);
+        m_ref_local = timestamp;
+    }
+
+    if (!TIMER_OLDER_THAN(timestamp + TIME_SYNC_TIMER_MARGIN_US, m_trickle.t))
+    {
+        bool do_tx = false;
+        trickle_tx_timeout(&m_trickle, &do_tx, timestamp);
+        if (do_tx)
+        {
+            beacon_tx();
+            trickle_tx_register(&m_trickle, timestamp);
+        }
+    }
+    beacon_schedule(timestamp);
+}
+
+/** Find the given beacon sender, or replace the least recently heard one. */
+static time_sync_neighbor_t* neighbor_get(const uint8_t* p_addr, bool* p_is_new)
+{
+    time_sync_neighbor_t* p_oldest = &m_neighbors[0];
+    for (uint32_t i = 0; i < TIME_SYNC_NEIGHBOR_COUNT; ++i)
+    {
+        if (!m_neighbors[i].used)
+        {
+            p_oldest = &m_neighbors[i];
+            break;
+        }
+        if (memcmp(m_neighbors[i].addr, p_addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            *p_is_new = false;
+            m_neighbors[i].last_heard = ++m_neighbor_age;
+            return &m_neighbors[i];
+        }
+        if (m_neighbor_age - m_neighbors[i].last_heard > m_neighbor_age - p_oldest->last_heard)
+        {
+            p_oldest = &m_neighbors[i];
+        }
+    }
+
+    *p_is_new = true;
+    memcpy(p_oldest->addr, p_addr, BLE_GAP_ADDR_LEN);
+    p_oldest->used = true;
+    p_oldest->last_heard = ++m_neighbor_age;
+    return p_oldest;
+}
+
+/** Steer the mesh clock to a sample from a neighbor with the given hops. */
+static void sample_apply(uint32_t local_time, uint32_t mesh_time, uint8_t parent_hops, uint32_t time_now)
+{
+    if (m_skew_ref_valid)
+    {
+        int32_t baseline = (int32_t) (local_time - m_skew_ref_local);
+        if (baseline >= TIME_SYNC_SKEW_BASELINE_US)
+        {
+            int32_t offset = (int32_t) (mesh_time - m_skew_ref_mesh - (uint32_t) baseline);
+            int32_t skew = (int32_t) (((int64_t) offset << TIME_SYNC_SKEW_SHIFT) / baseline);
+            if (skew > TIME_SYNC_SKEW_MAX)
+            {
+                skew = TIME_SYNC_SKEW_MAX;
+            }
+            else if (skew < -TIME_SYNC_SKEW_MAX)
+            {
+                skew = -TIME_SYNC_SKEW_MAX;
+            }
+            m_skew = (m_skew_valid ? m_skew + ((skew - m_skew) >> TIME_SYNC_SKEW_FILTER_SHIFT) : skew);
+            m_skew_valid = true;
+            m_skew_ref_local = local_time;
+            m_skew_ref_mesh = mesh_time;
+        }
+    }
+    else
+    {
+        m_skew_ref_valid = true;
+        m_skew_ref_local = local_time;
+        m_skew_ref_mesh = mesh_time;
+    }
+
+    m_ref_local = local_time;
+    m_ref_mesh = mesh_time;
+    m_last_sample_time = time_now;
+
+    if (m_hops != parent_hops + 1)
+    {
+        /* new distance to the root, advertise it quickly */
+        m_hops = parent_hops + 1;
+        trickle_timer_reset(&m_trickle, time_now);
+        beacon_schedule(time_now);
+    }
+}
+
+/******************************************************************************
+* Interface functions
+******************************************************************************/
+void time_sync_init(void)
+{
+    m_is_root = false;
+    sync_lose();
+    m_ref_local = 0;
+    m_ref_mesh = 0;
+    m_seq = 0;
+    m_tx_record.valid = false;
+    memset(m_neighbors, 0, sizeof(m_neighbors));
+    m_neighbor_age = 0;
+
+    /* beacons go out at the default pace, but keep coming at i_max */
+    trickle_profile_t profile;
+    APP_ERROR_CHECK(trickle_profile_get(TRICKLE_PROFILE_DEFAULT, &profile));
+    profile.i_max = RBC_MESH_TIME_SYNC_INTERVAL_MAX_MS * 1000; /* ms -> us */
+    if (profile.i_max < profile.i_min)
+    {
+        profile.i_max = profile.i_min;
+    }
+    APP_ERROR_CHECK(trickle_profile_set(RBC_MESH_TIME_SYNC_TRICKLE_PROFILE, &profile));
+
+    memset(&m_trickle, 0, sizeof(m_trickle));
+    m_trickle.profile = RBC_MESH_TIME_SYNC_TRICKLE_PROFILE;
+
+    m_timer_evt.p_next = NULL;
+    m_timer_evt.cb = beacon_timeout;
+    m_timer_evt.interval = 0;
+    m_timer_evt.p_context = NULL;
+}
+
+uint32_t time_sync_root_set(bool is_root)
+{
+    event_handler_critical_section_begin();
+    if (is_root != m_is_root)
+    {
+        uint32_t time_now = timer_now();
+        m_is_root = is_root;
+        if (is_root)
+        {
+            /* carry on from the current mesh time, at the local clock rate */
+            m_ref_mesh = (m_hops != TIME_SYNC_HOPS_INVALID) ? mesh_time_get(time_now) : time_now;
+            m_ref_local = time_now;
+            sync_lose();
+            m_hops = 0;
+            trickle_timer_reset(&m_trickle, time_now);
+            beacon_schedule(time_now);
+        }
+        else
+        {
+            sync_lose();
+        }
+    }
+    event_handler_critical_section_end();
+    return NRF_SUCCESS;
+}
+
+uint32_t time_sync_convert(uint32_t timestamp, uint32_t* p_mesh_time)
+{
+    uint32_t error_code = NRF_ERROR_INVALID_STATE;
+    event_handler_critical_section_begin();
+    if (m_hops != TIME_SYNC_HOPS_INVALID)
+    {
+        *p_mesh_time = mesh_time_get(timestamp);
+        error_code = NRF_SUCCESS;
+    }
+    event_handler_critical_section_end();
+    return error_code;
+}
+
+void time_sync_status_get(rbc_mesh_time_sync_status_t* p_status)
+{
+    event_handler_critical_section_begin();
+    p_status->is_root = m_is_root;
+    p_status->is_synced = (m_hops != TIME_SYNC_HOPS_INVALID);
+    p_status->hops = m_hops;
+    p_status->drift_ppb = (int32_t) (((int64_t) m_skew * 1000000000) >> TIME_SYNC_SKEW_SHIFT);
+    event_handler_critical_section_end();
+}
+
+void time_sync_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t channel)
+{
+    mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packet);
+    if (p_adv_data == NULL ||
+        p_adv_data->adv_data_length != MESH_PACKET_ADV_OVERHEAD + sizeof(time_sync_beacon_t))
+    {
+        return;
+    }
+
+    time_sync_beacon_t beacon;
+    memcpy(&beacon, p_adv_data->data, sizeof(beacon));
+    if (beacon.hops == TIME_SYNC_HOPS_INVALID)
+    {
+        return;
+    }
+
+    bool is_new;
+    time_sync_neighbor_t* p_neighbor = neighbor_get(p_packet->addr, &is_new);
+    if (!is_new && p_neighbor->seq == p_adv_data->version)
+    {
+        return; /* the same beacon on another channel, keep the first air time */
+    }
+    bool paired = (!is_new &&
+                   beacon.prev_seq != p_adv_data->version &&
+                   beacon.prev_seq == p_neighbor->seq &&
+                   p_neighbor->rx_copy != TIME_SYNC_COPY_INVALID);
+    uint32_t prev_rx_time = p_neighbor->rx_time;
+    uint32_t prev_tx_time = beacon.prev_tx_time;
+    if (paired && p_neighbor->rx_copy > 0)
+    {
+        /* the previous beacon was heard on another channel than the first copy */
+        uint16_t offset = beacon.prev_tx_offset[p_neighbor->rx_copy - 1];
+        paired = (offset != TIME_SYNC_OFFSET_INVALID);
+        prev_tx_time += offset;
+    }
+    p_neighbor->seq = p_adv_data->version;
+    p_neighbor->rx_time = timestamp;
+    p_neighbor->rx_copy = copy_index_get(channel);
+
+    if (m_is_root)
+    {
+        return;
+    }
+
+    if (beacon.hops == m_hops)
+    {
+        /* a neighbor at the same distance covers the same children */
+        trickle_rx_consistent(&m_trickle, timestamp);
+    }
+    else if (paired && beacon.hops < m_hops)
+    {
+        sample_apply(prev_rx_time, prev_tx_time, beacon.hops, timestamp);
+    }
+}
+
+void time_sync_tx_cb(mesh_packet_t* p_packet, uint8_t channel)
+{
+    mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packet);
+    if (p_adv_data == NULL || p_adv_data->handle != MESH_TIME_SYNC_HANDLE)
+    {
+        return;
+    }
+
+    uint32_t capture = timer_capture_get(TIMER_INDEX_RADIO);
+    uint8_t copy = copy_index_get(channel);
+    if (copy == 0)
+    {
+        m_tx_record.seq = p_adv_data->version;
+        m_tx_record.time = capture;
+        memset(m_tx_record.offset, 0xFF, sizeof(m_tx_record.offset));
+        m_tx_record.valid = true;
+    }
+    else if (copy != TIME_SYNC_COPY_INVALID &&
+             m_tx_record.valid &&
+             m_tx_record.seq == p_adv_data->version &&
+             capture - m_tx_record.time < TIME_SYNC_OFFSET_INVALID)
+    {
+        m_tx_record.offset[copy - 1] = capture - m_tx_record.time;
+    }
+}
@@ -249,6 +249,47 @@ uint32_t timer_abort(uint8_t timer)
     return NRF_SUCCESS;
 }
 
+uint32_t timer_capture_ppi(uint8_t timer, uint32_t* p_event)
+{
+    if (p_event == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (timer >= TIMER_COMPARE_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t error_code = NRF_SUCCESS;
+    timer_mut_lock();
+    if (m_callbacks[timer] != NULL || mp_ppi_tasks[timer] != NULL)
+    {
+        error_code = NRF_ERROR_BUSY;
+    }
+    else if (!m_is_in_ts)
+    {
+        error_code = NRF_ERROR_INVALID_STATE;
+    }
+    else
+    {
+        NRF_PPI->CH[TIMER_PPI_CH_CAPTURE].EEP = (uint32_t) p_event;
+        NRF_PPI->CH[TIMER_PPI_CH_CAPTURE].TEP = (uint32_t) &(NRF_TIMER0->TASKS_CAPTURE[timer]);
+        NRF_PPI->CHENSET                      = (1 << TIMER_PPI_CH_CAPTURE);
+    }
+    timer_mut_unlock();
+
+    return error_code;
+}
+
+timestamp_t timer_capture_get(uint8_t timer)
+{
+    APP_ERROR_CHECK_BOOL(timer < TIMER_COMPARE_COUNT);
+    timer_mut_lock();
+    timestamp_t time = (m_is_in_ts ? NRF_TIMER0->CC[timer] + m_reference_time : m_ts_end_time);
+    timer_mut_unlock();
+    return time;
+}
+
 timestamp_t timer_now(void)
 {
     timer_mut_lock();
@@ -332,6 +373,9 @@ void timer_on_ts_begin(timestamp_t timeslot_start_time)
 void timer_on_ts_end(timestamp_t timeslot_end_time)
 {
     /* executed in STACK_LOW */
+    /* TIMER0 belongs to the softdevice until the next timeslot */
+    NRF_PPI->CHENCLR = (1 << TIMER_PPI_CH_CAPTURE);
+
     /* purge ts-local timers */
     for (uint32_t i = 0; i < TIMER_COMPARE_COUNT; ++i)
     {
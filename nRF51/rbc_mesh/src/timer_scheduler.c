@@ -28,22 +28,41 @@ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ************************************************************************************/
 #include <stddef.h>
+#include <string.h>
 #include "timer_scheduler.h"
 #include "event_handler.h"
 #include "toolchain.h"
 #include "rbc_mesh_common.h"
+#include "trace.h"
 #include "nrf_error.h"
 #include <stdio.h>
 
 /** Time in us to regard as immidiate when firing several timers at once */
 #define TIMER_MARGIN    (100)
 
+/* The timer wheel splits timestamps in ticks of 2^WHEEL_TICK_BITS us, and
+   files each event in the lowest level where its tick only differs from the
+   current tick in that level's bits. Events cascade down one level each time
+   the current tick crosses into their slot. Buckets aren't sorted, the exact
+   timestamp decides when an event fires. */
+#define WHEEL_TICK_BITS     (12)
+#define WHEEL_SLOT_BITS     (4)
+#define WHEEL_SLOTS         (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK     (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS        ((32 - WHEEL_TICK_BITS + WHEEL_SLOT_BITS - 1) / WHEEL_SLOT_BITS)
+#define WHEEL_TICK_MASK     (0xFFFFFFFF >> WHEEL_TICK_BITS)
+#define WHEEL_SLOT_NONE     (0) /* event slots are 1-based, so zero-initialized events aren't in the wheel */
+
+#define TICK(_timestamp)    (((uint32_t) (_timestamp)) >> WHEEL_TICK_BITS)
+
 /*****************************************************************************
 * Local typedefs
 *****************************************************************************/
 typedef struct
 {
-    timer_event_t* p_head;
+    timer_event_t* p_buckets[WHEEL_LEVELS * WHEEL_SLOTS];
+    uint32_t occupied[WHEEL_LEVELS]; /* bitmap of non-empty buckets per level */
+    uint32_t tick; /* current tick, all earlier ticks have been handled */
     uint32_t pending_reschedules;
 } scheduler_t;
 
@@ -58,98 +77,251 @@ static void timer_cb(timestamp_t timestamp);
 
 static void add_evt(timer_event_t* p_evt)
 {
-    if (m_scheduler.p_head == NULL ||
-        TIMER_OLDER_THAN(p_evt->timestamp, m_scheduler.p_head->timestamp))
+    uint32_t level = 0;
+    uint32_t index;
+    if (TIMER_OLDER_THAN(p_evt->timestamp, m_scheduler.tick << WHEEL_TICK_BITS))
     {
-        p_evt->p_next = m_scheduler.p_head;
-        m_scheduler.p_head = p_evt;
-        return;
+        /* already expired, handle it with the current tick */
+        index = m_scheduler.tick & WHEEL_SLOT_MASK;
     }
-    timer_event_t* p_temp = m_scheduler.p_head;
-
-    while (p_temp->p_next &&
-         TIMER_OLDER_THAN(p_temp->p_next->timestamp, p_evt->timestamp))
+    else
     {
-        p_temp = p_temp->p_next;
+        const uint32_t tick = TICK(p_evt->timestamp);
+        while (level < WHEEL_LEVELS - 1 &&
+               (tick >> (WHEEL_SLOT_BITS * (level + 1))) != (m_scheduler.tick >> (WHEEL_SLOT_BITS * (level + 1))))
+        {
+            level++;
+        }
+        index = (tick >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
     }
 
-    p_evt->p_next = p_temp->p_next;
-    p_temp->p_next = p_evt;
+    const uint32_t bucket = level * WHEEL_SLOTS + index;
+    p_evt->slot = bucket + 1;
+    p_evt->p_prev = NULL;
+    p_evt->p_next = m_scheduler.p_buckets[bucket];
+    if (p_evt->p_next)
+    {
+        p_evt->p_next->p_prev = p_evt;
+    }
+    m_scheduler.p_buckets[bucket] = p_evt;
+    m_scheduler.occupied[level] |= (1UL << index);
 }
 
 static uint32_t remove_evt(timer_event_t* p_evt)
 {
-    if (p_evt == m_scheduler.p_head)
+    if (p_evt->slot == WHEEL_SLOT_NONE)
     {
-        m_scheduler.p_head = p_evt->p_next;
-        p_evt->p_next = NULL;
-        return NRF_SUCCESS;
+        return NRF_ERROR_NOT_FOUND;
     }
 
-    timer_event_t* p_temp = m_scheduler.p_head;
-    while (p_temp &&
-           p_temp->p_next &&
-           !TIMER_OLDER_THAN(p_evt->timestamp, p_temp->p_next->timestamp)
-          )
+    if (p_evt->p_prev)
+    {
+        p_evt->p_prev->p_next = p_evt->p_next;
+    }
+    else
     {
-        if (p_temp->p_next == p_evt)
+        const uint32_t bucket = p_evt->slot - 1;
+        m_scheduler.p_buckets[bucket] = p_evt->p_next;
+        if (p_evt->p_next == NULL)
         {
-            p_temp->p_next = p_evt->p_next;
-            p_evt->p_next = NULL;
-            return NRF_SUCCESS;
+            m_scheduler.occupied[bucket / WHEEL_SLOTS] &= ~(1UL << (bucket & WHEEL_SLOT_MASK));
         }
+    }
+    if (p_evt->p_next)
+    {
+        p_evt->p_next->p_prev = p_evt->p_prev;
+    }
+
+    p_evt->p_next = NULL;
+    p_evt->p_prev = NULL;
+    p_evt->slot = WHEEL_SLOT_NONE;
+    return NRF_SUCCESS;
+}
+
+/** Take all events out of a bucket, and return them as a list. */
+static timer_event_t* bucket_take(uint32_t level, uint32_t index)
+{
+    timer_event_t* p_list = m_scheduler.p_buckets[level * WHEEL_SLOTS + index];
+    m_scheduler.p_buckets[level * WHEEL_SLOTS + index] = NULL;
+    m_scheduler.occupied[level] &= ~(1UL << index);
+    return p_list;
+}
 
-        p_temp = p_temp->p_next;
+static void list_add(timer_event_t* p_list)
+{
+    while (p_list)
+    {
+        timer_event_t* p_next = p_list->p_next;
+        add_evt(p_list);
+        p_list = p_next;
     }
+}
 
-    return NRF_ERROR_NOT_FOUND;
+/** Move events down from the higher level buckets the current tick just
+  entered, highest level first. */
+static void cascade(void)
+{
+    for (uint32_t level = WHEEL_LEVELS - 1; level > 0; --level)
+    {
+        if ((m_scheduler.tick & ((1UL << (WHEEL_SLOT_BITS * level)) - 1)) == 0)
+        {
+            list_add(bucket_take(level, (m_scheduler.tick >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK));
+        }
+    }
 }
 
-static void fire_timers(timestamp_t time_now)
+/**
+* Find the next tick that needs attention: the first non-empty bucket on
+* level 0, or the start of the first non-empty bucket on a higher level.
+* Returns false if the wheel is empty.
+*/
+static bool next_work_get(bool include_current, uint32_t* p_ticks, uint32_t* p_level)
+{
+    for (uint32_t level = 0; level < WHEEL_LEVELS; ++level)
+    {
+        const uint32_t shift = WHEEL_SLOT_BITS * level;
+        const uint32_t index = (m_scheduler.tick >> shift) & WHEEL_SLOT_MASK;
+        uint32_t ahead = m_scheduler.occupied[level] & (0xFFFFFFFE << index);
+        if (level == 0 && include_current)
+        {
+            ahead |= m_scheduler.occupied[0] & (1UL << index);
+        }
+        if (ahead)
+        {
+            const uint32_t page = (m_scheduler.tick >> (shift + WHEEL_SLOT_BITS)) << (shift + WHEEL_SLOT_BITS);
+            const uint32_t tick = page | (_LOWEST_SET_BIT(ahead) << shift);
+            *p_ticks = (tick - m_scheduler.tick) & WHEEL_TICK_MASK;
+            *p_level = level;
+            return true;
+        }
+    }
+
+    /* the top level wraps around */
+    const uint32_t shift = WHEEL_SLOT_BITS * (WHEEL_LEVELS - 1);
+    if (m_scheduler.occupied[WHEEL_LEVELS - 1])
+    {
+        const uint32_t tick = _LOWEST_SET_BIT(m_scheduler.occupied[WHEEL_LEVELS - 1]) << shift;
+        *p_ticks = (tick - m_scheduler.tick) & WHEEL_TICK_MASK;
+        *p_level = WHEEL_LEVELS - 1;
+        return true;
+    }
+    return false;
+}
+
+/** Fire the expired events in the current level 0 bucket. Returns false if
+  the event queue ran full. */
+static bool bucket_fire(timestamp_t time_now)
 {
-   if (m_scheduler.pending_reschedules)
-   {
-       return;
-   }
-
-   while (m_scheduler.p_head &&
-       TIMER_OLDER_THAN(m_scheduler.p_head->timestamp, time_now + TIMER_MARGIN))
-   {
-       timer_event_t* p_evt = m_scheduler.p_head;
-       async_event_t evt;
-       evt.type = EVENT_TYPE_TIMER_SCH;
-       evt.callback.timer_sch.cb = p_evt->cb;
-       evt.callback.timer_sch.p_context = p_evt->p_context;
-       evt.callback.timer_sch.timestamp = time_now;
-       if (event_handler_push(&evt) != NRF_SUCCESS)
-       {
-           /* event queue full */
-           return;
-       }
-
-        /* iterate */
-        m_scheduler.p_head = p_evt->p_next;
-        p_evt->p_next = NULL;
-
-        if (p_evt->interval != 0)
+    timer_event_t* p_evt = bucket_take(0, m_scheduler.tick & WHEEL_SLOT_MASK);
+    while (p_evt)
+    {
+        timer_event_t* p_next = p_evt->p_next;
+        if (TIMER_OLDER_THAN(p_evt->timestamp, time_now + TIMER_MARGIN))
         {
-            do
+            async_event_t evt;
+            evt.type = EVENT_TYPE_TIMER_SCH;
+            evt.callback.timer_sch.cb = p_evt->cb;
+            evt.callback.timer_sch.p_context = p_evt->p_context;
+            evt.callback.timer_sch.timestamp = time_now;
+            if (event_handler_push(&evt) != NRF_SUCCESS)
             {
-                p_evt->timestamp += p_evt->interval;
-            } while (TIMER_OLDER_THAN(p_evt->timestamp, time_now + TIMER_MARGIN));
+                /* event queue full, put the rest back */
+                list_add(p_evt);
+                return false;
+            }
+            p_evt->slot = WHEEL_SLOT_NONE;
 
+            if (p_evt->interval != 0)
+            {
+                do
+                {
+                    p_evt->timestamp += p_evt->interval;
+                } while (TIMER_OLDER_THAN(p_evt->timestamp, time_now + TIMER_MARGIN));
+
+                add_evt(p_evt);
+            }
+            else
+            {
+                p_evt->p_next = NULL;
+                p_evt->p_prev = NULL;
+            }
+        }
+        else
+        {
             add_evt(p_evt);
         }
-   }
+        p_evt = p_next;
+    }
+    return true;
+}
+
+static void fire_timers(timestamp_t time_now)
+{
+    if (m_scheduler.pending_reschedules)
+    {
+        return;
+    }
+
+    uint32_t ticks_to_target = (TICK(time_now + TIMER_MARGIN) - m_scheduler.tick) & WHEEL_TICK_MASK;
+    if (ticks_to_target > WHEEL_TICK_MASK / 2)
+    {
+        /* never turn the wheel backwards */
+        ticks_to_target = 0;
+    }
+
+    while (bucket_fire(time_now) && ticks_to_target > 0)
+    {
+        /* skip straight to the next tick with work, or to the target */
+        uint32_t ticks;
+        uint32_t level;
+        if (!next_work_get(false, &ticks, &level) || ticks > ticks_to_target)
+        {
+            ticks = ticks_to_target;
+        }
+        m_scheduler.tick = (m_scheduler.tick + ticks) & WHEEL_TICK_MASK;
+        ticks_to_target -= ticks;
+        cascade();
+    }
+}
+
+/** Get the time of the first event in the wheel, or the time of the next
+  cascade if the first event is on a higher level. */
+static bool next_timeout_get(timestamp_t* p_timeout)
+{
+    uint32_t ticks;
+    uint32_t level;
+    if (!next_work_get(true, &ticks, &level))
+    {
+        return false;
+    }
+
+    const uint32_t tick = (m_scheduler.tick + ticks) & WHEEL_TICK_MASK;
+    if (level > 0)
+    {
+        *p_timeout = tick << WHEEL_TICK_BITS;
+        return true;
+    }
+
+    timer_event_t* p_evt = m_scheduler.p_buckets[tick & WHEEL_SLOT_MASK];
+    *p_timeout = p_evt->timestamp;
+    for (p_evt = p_evt->p_next; p_evt != NULL; p_evt = p_evt->p_next)
+    {
+        if (TIMER_OLDER_THAN(p_evt->timestamp, *p_timeout))
+        {
+            *p_timeout = p_evt->timestamp;
+        }
+    }
+    return true;
 }
 
 static void setup_timeout(timestamp_t time_now)
 {
-    if (m_scheduler.p_head)
+    timestamp_t timeout;
+    if (next_timeout_get(&timeout))
     {
-        if (TIMER_OLDER_THAN(time_now, m_scheduler.p_head->timestamp))
+        if (TIMER_OLDER_THAN(time_now, timeout))
         {
-            timer_order_cb(TIMER_INDEX_SCHEDULER, m_scheduler.p_head->timestamp, timer_cb, TIMER_ATTR_NONE);
+            timer_order_cb(TIMER_INDEX_SCHEDULER, timeout, timer_cb, TIMER_ATTR_NONE);
         }
         else
         {
@@ -158,11 +330,27 @@ static void setup_timeout(timestamp_t time_now)
     }
 }
 
+/** The wheel only turns when timers fire, bring it up to date before adding
+  events to an empty wheel. */
+static void idle_tick_update(timestamp_t time_now)
+{
+    for (uint32_t level = 0; level < WHEEL_LEVELS; ++level)
+    {
+        if (m_scheduler.occupied[level])
+        {
+            return;
+        }
+    }
+    m_scheduler.tick = TICK(time_now);
+}
+
 static void async_schedule(void* p_context)
 {
-    TICK_PIN(3);
+    TRACE(TRACE_ID_TIMER_SCH, 0, 0);
     timer_event_t* p_evt = (timer_event_t*) p_context;
     timestamp_t time_now = timer_now();
+    remove_evt(p_evt); /* scheduling a scheduled event moves it */
+    idle_tick_update(time_now);
     add_evt(p_evt);
 
     fire_timers(time_now);
@@ -171,7 +359,7 @@ static void async_schedule(void* p_context)
 
 static void async_remove(void* p_context)
 {
-    TICK_PIN(3);
+    TRACE(TRACE_ID_TIMER_SCH, 1, 0);
     timestamp_t time_now = timer_now();
     remove_evt(p_context);
     setup_timeout(time_now);
@@ -179,9 +367,10 @@ static void async_remove(void* p_context)
 
 static void async_reschedule(void* p_context)
 {
-    TICK_PIN(3);
+    TRACE(TRACE_ID_TIMER_SCH, 2, 0);
     timestamp_t time_now = timer_now();
     remove_evt(p_context);
+    idle_tick_update(time_now);
     add_evt(p_context);
 
     uint32_t was_masked;
@@ -205,7 +394,8 @@ static void timer_cb(timestamp_t timestamp)
 *****************************************************************************/
 uint32_t timer_sch_init(void)
 {
-    m_scheduler.p_head = NULL;
+    memset(&m_scheduler, 0, sizeof(m_scheduler));
+    m_scheduler.tick = TICK(timer_now());
     return NRF_SUCCESS;
 }
 
@@ -215,7 +405,6 @@ uint32_t timer_sch_schedule(timer_event_t* p_timer_evt)
     {
         return NRF_ERROR_NULL;
     }
-    p_timer_evt->p_next = NULL; /* sanitize linked list pointer */
     async_event_t evt;
     evt.type = EVENT_TYPE_GENERIC;
     evt.callback.generic.cb = async_schedule;
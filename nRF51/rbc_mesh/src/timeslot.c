@@ -39,9 +39,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "transport_control.h"
 #include "event_handler.h"
 #include "rbc_mesh_common.h"
+#include "trace.h"
 
 #ifdef MESH_DFU
 #include "dfu_app.h"
+#endif
+#if defined(MESH_DFU) || RBC_MESH_SNAPSHOT
 #include "mesh_flash.h"
 #endif
 
@@ -170,12 +173,12 @@ void start_time_update(void)
 static void timeslot_end(void)
 {
     radio_disable();
-    timer_on_ts_end(timeslot_end_time_get());
+    /* the length may already be set for the next request, use the actual end */
+    timer_on_ts_end(timer_now());
     m_is_in_timeslot = false;
     m_is_in_callback = false;
     m_end_timer_triggered = false;
-    CLEAR_PIN(PIN_IN_TS);
-    CLEAR_PIN(PIN_IN_CB);
+    TRACE(TRACE_ID_TS_END, 0, 0);
     
 #ifdef NRF52
     NRF_TIMER0->TASKS_STOP = 0;
@@ -245,7 +248,7 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
 {
     static uint32_t requested_extend_time = 0;
     static uint32_t successful_extensions = 0;
-    SET_PIN(PIN_IN_CB);
+    TRACE(TRACE_ID_TS_SIGNAL_START, sig, 0);
     m_is_in_callback = true;
 
     switch (m_timeslot_forced_command)
@@ -271,7 +274,6 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
     {
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_START:
         {
-            SET_PIN(PIN_IN_TS);
             m_is_in_timeslot = true;
             m_end_timer_triggered = false;
             successful_extensions = 0;
@@ -281,6 +283,7 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
             /* notify other modules */
             event_handler_on_ts_begin();
             timer_on_ts_begin(m_start_time);
+            TRACE(TRACE_ID_TS_START, 0, 0);
             tc_on_ts_begin();
 
             m_negotiate_timeslot_length = TIMESLOT_SLOT_EXTEND_LENGTH_US;
@@ -361,14 +364,14 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
     }
     else
     {
-#ifdef MESH_DFU
+#if defined(MESH_DFU) || RBC_MESH_SNAPSHOT
         mesh_flash_op_execute(timeslot_remaining_time_get());
 #endif
         requested_extend_time = 0;
     }
 
     m_is_in_callback = false;
-    CLEAR_PIN(PIN_IN_CB);
+    TRACE(TRACE_ID_TS_SIGNAL_END, m_ret_param.callback_action, 0);
     return &m_ret_param;
 }
 
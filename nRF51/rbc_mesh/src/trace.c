@@ -0,0 +1,197 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "trace.h"
+
+#include "rbc_mesh.h"
+#include "timer.h"
+#include "timer_scheduler.h"
+#include "toolchain.h"
+
+#include "nrf_error.h"
+#include "app_error.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#if RBC_MESH_TRACE_RTT
+#include "SEGGER_RTT.h"
+#endif
+
+#if RBC_MESH_TRACE
+/******************************************************************************
+* Static globals
+******************************************************************************/
+static trace_entry_t    m_ring[RBC_MESH_TRACE_ENTRIES];
+static uint32_t         m_head;     /**< Free running index of the next entry to write */
+static uint32_t         m_tail;     /**< Free running index of the oldest entry */
+static uint16_t         m_dropped;  /**< Entries overwritten since the last read */
+
+#if RBC_MESH_TRACE_RTT
+static uint8_t          m_rtt_buffer[RBC_MESH_TRACE_ENTRIES * sizeof(trace_entry_t)];
+static timer_event_t    m_rtt_timer_evt;
+#endif
+
+/******************************************************************************
+* Static functions
+******************************************************************************/
+/** Copy out the oldest entry, without taking it out of the ring. Returns
+  false if the ring is empty. */
+static bool entry_peek(trace_entry_t* p_entry, uint32_t* p_index)
+{
+    bool found = false;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (m_head != m_tail)
+    {
+        *p_entry = m_ring[m_tail & (RBC_MESH_TRACE_ENTRIES - 1)];
+        *p_index = m_tail;
+        found = true;
+    }
+    _ENABLE_IRQS(was_masked);
+    return found;
+}
+
+/** Take a peeked entry out of the ring, unless it has been overwritten since. */
+static void entry_release(uint32_t index)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (m_tail == index)
+    {
+        m_tail++;
+    }
+    _ENABLE_IRQS(was_masked);
+}
+
+#if RBC_MESH_TRACE_RTT
+static void rtt_flush(timestamp_t timestamp, void* p_context)
+{
+    trace_entry_t entry;
+    uint32_t index;
+    while (entry_peek(&entry, &index))
+    {
+        /* leave the rest in the ring until the host has made room */
+        if (SEGGER_RTT_Write(RBC_MESH_TRACE_RTT_CHANNEL, &entry, sizeof(entry)) == 0)
+        {
+            break;
+        }
+        entry_release(index);
+    }
+}
+#endif
+
+/******************************************************************************
+* Interface functions
+******************************************************************************/
+void trace_init(void)
+{
+    m_head = 0;
+    m_tail = 0;
+    m_dropped = 0;
+#if RBC_MESH_TRACE_RTT
+    SEGGER_RTT_ConfigUpBuffer(RBC_MESH_TRACE_RTT_CHANNEL, "Trace", m_rtt_buffer,
+            sizeof(m_rtt_buffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+
+    m_rtt_timer_evt.p_next = NULL;
+    m_rtt_timer_evt.cb = rtt_flush;
+    m_rtt_timer_evt.interval = RBC_MESH_TRACE_RTT_INTERVAL_US;
+    m_rtt_timer_evt.p_context = NULL;
+    m_rtt_timer_evt.timestamp = timer_now() + RBC_MESH_TRACE_RTT_INTERVAL_US;
+    APP_ERROR_CHECK(timer_sch_schedule(&m_rtt_timer_evt));
+#endif
+}
+
+void trace_log(uint8_t id, uint8_t arg0, uint16_t arg1)
+{
+    /* timer_now() has its own critical section */
+    timestamp_t timestamp = timer_now();
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (m_head - m_tail == RBC_MESH_TRACE_ENTRIES)
+    {
+        m_tail++;
+        if (m_dropped != UINT16_MAX)
+        {
+            m_dropped++;
+        }
+    }
+    trace_entry_t* p_entry = &m_ring[m_head & (RBC_MESH_TRACE_ENTRIES - 1)];
+    p_entry->timestamp = timestamp;
+    p_entry->id = id;
+    p_entry->arg0 = arg0;
+    p_entry->arg1 = arg1;
+    m_head++;
+    _ENABLE_IRQS(was_masked);
+}
+
+uint32_t trace_read(trace_entry_t* p_entries, uint32_t* p_count, uint16_t* p_dropped)
+{
+    if (p_entries == NULL || p_count == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    uint32_t count = 0;
+    uint32_t index;
+    /* one entry at a time, to keep the critical sections short */
+    while (count < *p_count && entry_peek(&p_entries[count], &index))
+    {
+        entry_release(index);
+        count++;
+    }
+    *p_count = count;
+
+    if (p_dropped != NULL)
+    {
+        uint32_t was_masked;
+        _DISABLE_IRQS(was_masked);
+        *p_dropped = m_dropped;
+        m_dropped = 0;
+        _ENABLE_IRQS(was_masked);
+    }
+    return NRF_SUCCESS;
+}
+
+#else /* RBC_MESH_TRACE */
+
+void trace_init(void)
+{
+}
+
+void trace_log(uint8_t id, uint8_t arg0, uint16_t arg1)
+{
+}
+
+uint32_t trace_read(trace_entry_t* p_entries, uint32_t* p_count, uint16_t* p_dropped)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+#endif /* RBC_MESH_TRACE */
@@ -40,24 +40,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "timer_scheduler.h"
 #include "rbc_mesh_common.h"
 #include "version_handler.h"
+#include "time_sync.h"
+#include "digest.h"
+#include "trace.h"
+#include "latency.h"
 #include "mesh_aci.h"
 #include "app_error.h"
 
-#if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)|| defined (WITH_ACK_SLAVE)
-
-#include "SEGGER_RTT.h"
-#include "nrf_gpio.h"
-#include "boards.h"
-#include <stdio.h>
-
-#endif
-
-#if defined(WITH_ACK_SLAVE)
-#include <handle.h>
-#endif
-
-
-
 #ifdef MESH_DFU
 #include "dfu_types_mesh.h"
 #include "dfu_app.h"
@@ -65,13 +54,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /* event push isn't present in the API header file. */
 extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
 
+/******************************************************************************
+* Local defines
+******************************************************************************/
+#define TC_CHANNEL_COUNT_MAX    (3) /**< Advertisement channels 37, 38 and 39. */
+
 /******************************************************************************
 * Local typedefs
 ******************************************************************************/
 typedef struct
 {
     uint32_t access_address;
-    uint8_t channel;
+    uint8_t channels[TC_CHANNEL_COUNT_MAX]; /* channels to scan, in order */
+    uint8_t channel_count;
+    uint8_t scan_index; /* index of the channel currently scanned */
     bool queue_saturation; /* flag indicating a full processing queue */
 } tc_state_t;
 
@@ -80,69 +76,54 @@ typedef struct
 ******************************************************************************/
 static tc_state_t m_state;
 static rbc_mesh_packet_peek_cb_t mp_packet_peek_cb;
+static rbc_mesh_channel_stats_t m_channel_stats[TC_CHANNEL_COUNT_MAX];
+static timer_event_t m_scan_timer_evt;
 
-/* STATS */
-#ifdef PACKET_STATS
-
-
-#if defined (WITH_ACK_MASTER) 
-static struct
-{
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats __attribute__((at(0x20003030)))  = {0};
-
-
-#elif defined(WITHOUT_ACK_MASTER) 
-static struct
-{
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats __attribute__((at(0x2000273C))) = {0};
-
-
-
-#elif defined(WITH_ACK_SLAVE)
-static struct
-{
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats __attribute__((at(0x20002750))) = {0};
+/******************************************************************************
+* Static functions
+******************************************************************************/
+static void rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi, uint8_t channel);
+static void tx_cb(uint8_t* p_data, uint8_t channel);
 
-#elif defined(WITHOUT_ACK_SLAVE)
-static struct
+static void channels_set(uint8_t channel)
 {
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats __attribute__((at(0x20002738))) = {0};
-
+#if RBC_MESH_ADV_CHANNEL_MAP
+    /* the channel map replaces the single channel */
+    (void) channel;
+    m_state.channel_count = 0;
+    for (uint32_t i = 0; i < TC_CHANNEL_COUNT_MAX; ++i)
+    {
+        if (RBC_MESH_ADV_CHANNEL_MAP & (1 << i))
+        {
+            m_state.channels[m_state.channel_count++] = 37 + i;
+        }
+    }
 #else
-static struct
-{
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats = {0};
-
+    m_state.channels[0] = channel;
+    m_state.channel_count = 1;
 #endif
+    m_state.scan_index = 0;
+    memset(m_channel_stats, 0, sizeof(m_channel_stats));
+}
 
-#endif
-/******************************************************************************
-* Static functions
-******************************************************************************/
-static void rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi);
-static void tx_cb(uint8_t* p_data);
+static rbc_mesh_channel_stats_t* channel_stats_get(uint8_t channel)
+{
+    for (uint32_t i = 0; i < m_state.channel_count; ++i)
+    {
+        if (m_state.channels[i] == channel)
+        {
+            return &m_channel_stats[i];
+        }
+    }
+    return NULL;
+}
 
 static void order_search(void)
 {
     radio_event_t evt;
 
     evt.event_type = RADIO_EVENT_TYPE_RX_PREEMPTABLE;
-    evt.channel = m_state.channel;
+    evt.channel = m_state.channels[m_state.scan_index];
 
     if (!mesh_packet_acquire((mesh_packet_t**) &evt.packet_ptr))
     {
@@ -157,40 +138,54 @@ static void order_search(void)
 }
 
 
+/* periodic timer callback, executed in APP_LOW */
+static void scan_timeout(timestamp_t timestamp, void* p_context)
+{
+    m_state.scan_index = (m_state.scan_index + 1) % m_state.channel_count;
+
+    /* the new search preempts the one on the previous channel. Outside the
+       timeslot, the next search will pick up the new channel by itself. */
+    if (timeslot_is_in_ts() && !m_state.queue_saturation)
+    {
+        order_search();
+    }
+}
+
 /* immediate radio callback, executed in STACK_LOW */
-static void rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi)
+static void rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi, uint8_t channel)
 {
-    if (success && ((mesh_packet_t*) p_data)->header.length <= MESH_PACKET_BLE_OVERHEAD + BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH)
+    rbc_mesh_channel_stats_t* p_stats = channel_stats_get(channel);
+    if (p_stats != NULL)
+    {
+        if (success)
+        {
+            p_stats->rx_ok++;
+        }
+        else if (crc < 0x1000000)
+        {
+            p_stats->rx_crc_fail++;
+        }
+    }
+
+    if (success && ((mesh_packet_t*) p_data)->header.length <= MESH_PACKET_BLE_OVERHEAD + MESH_PACKET_PAYLOAD_MAX_LENGTH)
     {
         async_event_t evt;
         evt.type = EVENT_TYPE_PACKET;
         evt.callback.packet.payload = p_data;
         evt.callback.packet.crc = crc;
-        evt.callback.packet.timestamp = timer_now();
+        /* the radio address event was captured in hardware, free of ISR latency */
+        evt.callback.packet.timestamp = timer_capture_get(TIMER_INDEX_RADIO);
+        LATENCY_RECORD(LATENCY_STAGE_RX_CB, evt.callback.packet.timestamp);
         evt.callback.packet.rssi = rssi;
+        evt.callback.packet.channel = channel;
         mesh_packet_ref_count_inc((mesh_packet_t*) p_data); /* event handler has a ref */
         
         if (event_handler_push(&evt) != NRF_SUCCESS)
         {
             mesh_packet_ref_count_dec((mesh_packet_t*) p_data);
             m_state.queue_saturation = true;
-#ifdef PACKET_STATS
-            m_packet_stats.queue_drop++;
-#endif
-        }
-        else
-        {
-#ifdef PACKET_STATS
-            m_packet_stats.queue_ok++;
-#endif
         }
     }
-    else if (crc < 0x1000000) /* don't want to trigger on artifical crc values */
-    {
-#ifdef PACKET_STATS
-        m_packet_stats.crc_fail++;
-#endif
-    }
 
     /* no longer needed in this context */
     mesh_packet_ref_count_dec((mesh_packet_t*) p_data);
@@ -227,8 +222,11 @@ static void async_tx_cb(void* p_context)
 }
 
 /* radio callback, executed in STACK_LOW */
-static void tx_cb(uint8_t* p_data)
+static void tx_cb(uint8_t* p_data, uint8_t channel)
 {
+    /* the access address capture of the packet is only valid until the next one */
+    time_sync_tx_cb((mesh_packet_t*) p_data, channel);
+
     /* have to defer tx-event handling to async context to avoid race
        conditions in the handle_storage */
     async_event_t tx_cb_evt =
@@ -253,8 +251,18 @@ static void radio_idle_callback(void)
         order_search();
 }
 
-static void mesh_framework_packet_handle(mesh_adv_data_t* p_adv_data, uint32_t timestamp)
+static void mesh_framework_packet_handle(mesh_packet_t* p_packet, mesh_adv_data_t* p_adv_data, uint32_t timestamp, uint8_t channel)
 {
+    if (p_adv_data->handle == MESH_TIME_SYNC_HANDLE)
+    {
+        time_sync_rx(p_packet, timestamp, channel);
+        return;
+    }
+    if (p_adv_data->handle == MESH_DIGEST_HANDLE)
+    {
+        digest_rx(p_packet, timestamp);
+        return;
+    }
 #ifdef MESH_DFU
     mesh_dfu_adv_data_t* p_dfu = (mesh_dfu_adv_data_t*) p_adv_data;
     /* Tell the shared BL about the packet */
@@ -273,6 +281,16 @@ void tc_init(uint32_t access_address, uint8_t channel)
 {
     mp_packet_peek_cb = NULL;
     tc_radio_params_set(access_address, channel);
+
+    if (m_state.channel_count > 1)
+    {
+        m_scan_timer_evt.p_next = NULL;
+        m_scan_timer_evt.cb = scan_timeout;
+        m_scan_timer_evt.interval = RBC_MESH_SCAN_CHANNEL_INTERVAL_US;
+        m_scan_timer_evt.p_context = NULL;
+        m_scan_timer_evt.timestamp = timer_now() + RBC_MESH_SCAN_CHANNEL_INTERVAL_US;
+        APP_ERROR_CHECK(timer_sch_schedule(&m_scan_timer_evt));
+    }
 }
 
 void tc_radio_params_set(uint32_t access_address, uint8_t channel)
@@ -280,20 +298,42 @@ void tc_radio_params_set(uint32_t access_address, uint8_t channel)
     if (channel < 40)
     {
         m_state.access_address = access_address;
-        m_state.channel = channel;
+        channels_set(channel);
         radio_alt_aa_set(access_address);
         timeslot_restart();
     }
 }
 
+uint32_t tc_channel_stats_get(uint8_t channel, rbc_mesh_channel_stats_t* p_stats)
+{
+    rbc_mesh_channel_stats_t* p_channel_stats = channel_stats_get(channel);
+    if (p_channel_stats == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    memcpy(p_stats, p_channel_stats, sizeof(rbc_mesh_channel_stats_t));
+    return NRF_SUCCESS;
+}
+
+void tc_rx_stats_get(rbc_mesh_channel_stats_t* p_stats)
+{
+    memset(p_stats, 0, sizeof(rbc_mesh_channel_stats_t));
+    for (uint32_t i = 0; i < m_state.channel_count; ++i)
+    {
+        p_stats->rx_ok += m_channel_stats[i].rx_ok;
+        p_stats->rx_crc_fail += m_channel_stats[i].rx_crc_fail;
+    }
+}
+
 void tc_on_ts_begin(void)
 {
+    APP_ERROR_CHECK(timer_capture_ppi(TIMER_INDEX_RADIO, (uint32_t*) &NRF_RADIO->EVENTS_ADDRESS));
     radio_init(radio_idle_callback, rx_cb, tx_cb);
 }
 
 uint32_t tc_tx(mesh_packet_t* p_packet, const tc_tx_config_t* p_config)
 {
-    TICK_PIN(PIN_MESH_TX);
+    TRACE(TRACE_ID_TC_TX, p_config->channel_map, p_packet->header.length);
     /* queue the packet for transmission */
     radio_event_t event;
     memset(&event, 0, sizeof(radio_event_t));
@@ -305,6 +345,12 @@ uint32_t tc_tx(mesh_packet_t* p_packet, const tc_tx_config_t* p_config)
 
     event.packet_ptr = (uint8_t*) p_packet;
     event.access_address = p_config->alt_access_address;
+#if RBC_MESH_LONG_VALUES
+    if (MESH_PACKET_IS_LONG(p_packet))
+    {
+        event.access_address = RADIO_ACCESS_ADDRESS_LONG;
+    }
+#endif
     event.channel = p_config->first_channel;
     event.event_type = RADIO_EVENT_TYPE_TX;
     event.tx_power = (uint8_t) p_config->tx_power;
@@ -333,65 +379,79 @@ uint32_t tc_tx(mesh_packet_t* p_packet, const tc_tx_config_t* p_config)
 }
 
 /* packet processing, executed in APP_LOW */
-void tc_packet_handler(uint8_t* data, uint32_t crc, uint32_t timestamp, uint8_t rssi)
+void tc_packet_batch_handler(packet_event_t** pp_packets, uint32_t count)
 {
-    APP_ERROR_CHECK_BOOL(data != NULL);
-    SET_PIN(PIN_RX);
-    mesh_packet_t* p_packet = (mesh_packet_t*) data;
+    APP_ERROR_CHECK_BOOL(pp_packets != NULL && count <= RBC_MESH_RX_BATCH_MAX);
+    TRACE(TRACE_ID_RX_BATCH_START, count, 0);
+    vh_rx_packet_t rx_packets[RBC_MESH_RX_BATCH_MAX];
+    uint32_t rx_count = 0;
 
-    if (p_packet->header.length > BLE_GAP_ADDR_LEN + BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH)
+    for (uint32_t i = 0; i < count; ++i)
     {
-        /* invalid packet, ignore */
-        CLEAR_PIN(PIN_RX);
-        mesh_packet_ref_count_dec(p_packet); /* from rx_cb */
-
-        return;
-    }
+        APP_ERROR_CHECK_BOOL(pp_packets[i]->payload != NULL);
+        mesh_packet_t* p_packet = (mesh_packet_t*) pp_packets[i]->payload;
+        LATENCY_RECORD(LATENCY_STAGE_TC, pp_packets[i]->timestamp);
 
-    /* Pass packet to packet peek function */
-    if (mp_packet_peek_cb)
-    {
-        rbc_mesh_packet_peek_params_t peek_params;
-        peek_params.rssi = rssi;
-        peek_params.p_payload = p_packet->payload;
-        peek_params.payload_len = p_packet->header.length - MESH_PACKET_BLE_OVERHEAD;
-        memcpy(peek_params.adv_addr.addr, p_packet->addr, BLE_GAP_ADDR_LEN);
-        peek_params.adv_addr.addr_type = p_packet->header.addr_type;
-        peek_params.crc = crc;
-        peek_params.packet_type = (ble_packet_type_t) p_packet->header.type;
-        peek_params.timestamp = timestamp;
-        mp_packet_peek_cb(&peek_params);
-    }
+        if (p_packet->header.length > MESH_PACKET_BLE_OVERHEAD + MESH_PACKET_PAYLOAD_MAX_LENGTH)
+        {
+            /* invalid packet, ignore */
+            mesh_packet_ref_count_dec(p_packet); /* from rx_cb */
+            continue;
+        }
 
-    ble_gap_addr_t addr;
-    memcpy(addr.addr, p_packet->addr, BLE_GAP_ADDR_LEN);
-    addr.addr_type = p_packet->header.addr_type;
+        /* Pass packet to packet peek function */
+        if (mp_packet_peek_cb)
+        {
+            rbc_mesh_packet_peek_params_t peek_params;
+            peek_params.rssi = pp_packets[i]->rssi;
+            peek_params.p_payload = p_packet->payload;
+            peek_params.payload_len = p_packet->header.length - MESH_PACKET_BLE_OVERHEAD;
+            memcpy(peek_params.adv_addr.addr, p_packet->addr, BLE_GAP_ADDR_LEN);
+            peek_params.adv_addr.addr_type = p_packet->header.addr_type;
+            peek_params.crc = pp_packets[i]->crc;
+            peek_params.packet_type = (ble_packet_type_t) p_packet->header.type;
+            peek_params.timestamp = pp_packets[i]->timestamp;
+            mp_packet_peek_cb(&peek_params);
+        }
 
-    mesh_adv_data_t* p_mesh_adv_data = mesh_packet_adv_data_get(p_packet);
+        mesh_adv_data_t* p_mesh_adv_data = mesh_packet_adv_data_get(p_packet);
 
-    if (p_mesh_adv_data != NULL)
-    {
-        /* filter mesh packets on handle range */
-        if (p_mesh_adv_data->handle <= RBC_MESH_APP_MAX_HANDLE)
+        if (p_mesh_adv_data != NULL)
         {
-            vh_rx(p_packet, timestamp, rssi);
+            /* filter mesh packets on handle range */
+            if (p_mesh_adv_data->handle <= RBC_MESH_APP_MAX_HANDLE ||
+                p_mesh_adv_data->handle == MESH_AGGREGATE_HANDLE)
+            {
+                /* the version handler takes the values in one batch, keeping the ref from rx_cb until then */
+                rx_packets[rx_count].p_packet = p_packet;
+                rx_packets[rx_count].timestamp = pp_packets[i]->timestamp;
+                rx_packets[rx_count].rssi = pp_packets[i]->rssi;
+                rx_count++;
+                continue;
+            }
+            mesh_framework_packet_handle(p_packet, p_mesh_adv_data, pp_packets[i]->timestamp, pp_packets[i]->channel);
         }
-        else
+
+        /* this packet is no longer needed in this context */
+        mesh_packet_ref_count_dec(p_packet); /* from rx_cb */
+    }
+
+    if (rx_count > 0)
+    {
+        vh_rx_batch(rx_packets, rx_count);
+        for (uint32_t i = 0; i < rx_count; ++i)
         {
-            mesh_framework_packet_handle(p_mesh_adv_data, timestamp);
+            mesh_packet_ref_count_dec(rx_packets[i].p_packet); /* from rx_cb */
         }
     }
 
-    /* this packet is no longer needed in this context */
-    mesh_packet_ref_count_dec(p_packet); /* from rx_cb */
-
     if (m_state.queue_saturation)
     {
         order_search();
         m_state.queue_saturation = false;
     }
 
-    CLEAR_PIN(PIN_RX);
+    TRACE(TRACE_ID_RX_BATCH_END, rx_count, 0);
 }
 
 void tc_packet_peek_cb_set(rbc_mesh_packet_peek_cb_t packet_peek_cb)
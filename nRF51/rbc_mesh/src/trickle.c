@@ -29,10 +29,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ************************************************************************************/
 
 #include "trickle.h"
+#include "rbc_mesh.h"
 #include "rbc_mesh_common.h"
 #include "app_error.h"
 #include "rand.h"
 #include "timer.h"
+#include "trace.h"
 
 #include "nrf_soc.h"
 #ifdef NRF51
@@ -43,15 +45,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 
 #define TIME_MARGIN (1000)
+
+#define PROFILE(trickle)    (&g_profiles[(trickle)->profile])
 /*****************************************************************************
 * Static Globals
 *****************************************************************************/
 
-/*global parameters for trickle behavior, set in trickle_setup() */
-static uint32_t g_i_min, g_i_max;
-static uint8_t g_k;
+/* parameters for trickle behavior, set in trickle_setup() and trickle_profile_set() */
+static trickle_profile_t g_profiles[RBC_MESH_TRICKLE_PROFILE_COUNT];
+static uint32_t g_profiles_custom; /**< Profiles with their own parameters, one bit each */
 
 static prng_t g_rand;
+static trickle_stats_t g_stats;
 
 /*****************************************************************************
 * Static Functions
@@ -89,10 +94,10 @@ static void check_interval(trickle_t* trickle, uint32_t time_now)
 {
     if (!TIMER_OLDER_THAN(time_now, trickle->i) && trickle_is_enabled(trickle))
     {
-        if (trickle->i_relative < g_i_max * g_i_min)
+        if (trickle->i_relative < (PROFILE(trickle)->i_max >> 1))
             trickle->i_relative <<= 1;
         else
-            trickle->i_relative = g_i_max * g_i_min;
+            trickle->i_relative = PROFILE(trickle)->i_max;
         /* we've started a new interval since we last touched this trickle */
         trickle->c = 0;
         trickle->i = trickle->i_relative + time_now;
@@ -104,18 +109,68 @@ static void check_interval(trickle_t* trickle, uint32_t time_now)
 *****************************************************************************/
 void trickle_setup(uint32_t i_min, uint32_t i_max, uint8_t k)
 {
-    g_i_min = i_min;
-    g_i_max = i_max;
-    g_k = k;
+    trickle_profile_t profile;
+    profile.i_min = i_min;
+    profile.i_max = (i_max > TRICKLE_INTERVAL_MAX_US / i_min) ? TRICKLE_INTERVAL_MAX_US : i_max * i_min;
+    profile.k = k;
+
+    for (uint32_t i = 0; i < RBC_MESH_TRICKLE_PROFILE_COUNT; ++i)
+    {
+        if (i == TRICKLE_PROFILE_DEFAULT || !(g_profiles_custom & (1UL << i)))
+        {
+            g_profiles[i] = profile;
+        }
+    }
 
     rand_prng_seed(&g_rand);
 }
 
+void trickle_stats_get(trickle_stats_t* p_stats)
+{
+    memcpy(p_stats, &g_stats, sizeof(trickle_stats_t));
+}
+
+uint32_t trickle_profile_set(uint8_t profile, const trickle_profile_t* p_profile)
+{
+    if (profile >= RBC_MESH_TRICKLE_PROFILE_COUNT ||
+        p_profile->i_min < 2 ||
+        p_profile->i_max < p_profile->i_min ||
+        p_profile->i_max > TRICKLE_INTERVAL_MAX_US ||
+        p_profile->k == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    g_profiles[profile] = *p_profile;
+    g_profiles_custom |= (1UL << profile);
+    return NRF_SUCCESS;
+}
+
+uint32_t trickle_profile_get(uint8_t profile, trickle_profile_t* p_profile)
+{
+    if (profile >= RBC_MESH_TRICKLE_PROFILE_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    *p_profile = g_profiles[profile];
+    return NRF_SUCCESS;
+}
+
+void trickle_profile_assign(trickle_t* trickle, uint8_t profile, uint32_t time_now)
+{
+    trickle->profile = profile;
+    if (trickle_is_enabled(trickle))
+    {
+        trickle_timer_reset(trickle, time_now);
+    }
+}
+
 void trickle_rx_consistent(trickle_t* trickle, uint32_t time_now)
 {
     if (trickle_is_enabled(trickle))
     {
-        TICK_PIN(PIN_CONSISTENT);
+        TRACE(TRACE_ID_TRICKLE_CONSISTENT, 0, 0);
         check_interval(trickle, time_now);
         if (trickle->c + 1 != TRICKLE_C_DISABLED)
         {
@@ -126,8 +181,8 @@ void trickle_rx_consistent(trickle_t* trickle, uint32_t time_now)
 
 void trickle_rx_inconsistent(trickle_t* trickle, uint32_t time_now)
 {
-    TICK_PIN(PIN_INCONSISTENT);
-    if (trickle->i_relative > g_i_min)
+    TRACE(TRACE_ID_TRICKLE_INCONSISTENT, 0, 0);
+    if (trickle->i_relative > PROFILE(trickle)->i_min)
     {
         trickle_timer_reset(trickle, time_now);
     }
@@ -136,7 +191,7 @@ void trickle_rx_inconsistent(trickle_t* trickle, uint32_t time_now)
 void trickle_timer_reset(trickle_t* trickle, uint32_t time_now)
 {
     trickle->i = time_now;
-    trickle->i_relative = g_i_min;
+    trickle->i_relative = PROFILE(trickle)->i_min;
 
     refresh_t(trickle, time_now);
     trickle_interval_begin(trickle);
@@ -159,10 +214,15 @@ void trickle_tx_timeout(trickle_t* trickle, bool* out_do_tx, uint32_t time_now)
     }
     else
     {
-        *out_do_tx = (trickle->c < g_k);
+        *out_do_tx = (trickle->c < PROFILE(trickle)->k);
         check_interval(trickle, time_now);
-        if (!(*out_do_tx))
+        if (*out_do_tx)
+        {
+            g_stats.tx++;
+        }
+        else
         {
+            g_stats.suppressed++;
             /* will never get a call to tx_register, order next t manually */
             refresh_t(trickle, time_now);
         }
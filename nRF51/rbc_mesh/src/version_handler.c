@@ -42,6 +42,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mesh_packet.h"
 #include "mesh_gatt.h"
 #include "mesh_aci.h"
+#include "trace.h"
+#include "latency.h"
 
 #include "nrf_error.h"
 #include "app_error.h"
@@ -53,6 +55,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define TIMESLOT_STARTUP_DELAY_US       (100)
 
+#if RBC_MESH_ADV_CHANNEL_MAP
+#define VH_TX_CHANNEL_COUNT             (((RBC_MESH_ADV_CHANNEL_MAP >> 0) & 0x01) + \
+                                         ((RBC_MESH_ADV_CHANNEL_MAP >> 1) & 0x01) + \
+                                         ((RBC_MESH_ADV_CHANNEL_MAP >> 2) & 0x01))
+#else
+#define VH_TX_CHANNEL_COUNT             (1)
+#endif
+
 /* event push isn't present in the API header file. */
 extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
 
@@ -63,6 +73,8 @@ extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
 static bool             m_is_initialized = false;
 static timer_event_t    m_tx_timer_evt;
 static tc_tx_config_t   m_tx_config;
+static bool             m_rx_order_pending; /**< A received packet changed the trickle timers */
+static uint32_t         m_rx_order_time; /**< Earliest timestamp of the changes */
 /******************************************************************************
 * Static functions
 ******************************************************************************/
@@ -141,86 +153,162 @@ static void order_next_transmission(uint32_t time_now)
     }
 }
 
-static void transmit_all_instances(uint32_t timestamp, void* p_context)
+#if RBC_MESH_VALUE_AGGREGATION
+/** Send the collected aggregate, or give back its only value to be sent on
+  its own. Returns the new number of packets in the individual list. */
+static uint32_t aggregate_flush(mesh_packet_t* p_aggregate,
+        mesh_packet_t** pp_members,
+        uint32_t member_count,
+        mesh_packet_t** pp_individual,
+        uint32_t individual_count,
+        uint32_t timestamp)
 {
-    SET_PIN(8);
-    mesh_packet_t* pp_tx_packets[RBC_MESH_RADIO_QUEUE_LENGTH - 1];
-    uint32_t count = RBC_MESH_RADIO_QUEUE_LENGTH - 1;
+    if (member_count == 1)
+    {
+        pp_individual[individual_count++] = pp_members[0];
+        return individual_count;
+    }
 
-    uint32_t error_code = handle_storage_tx_packets_get(timestamp, pp_tx_packets, &count);
-    if (error_code == NRF_SUCCESS)
+    if (member_count > 0)
     {
-        for (uint32_t i = 0; i < count; ++i)
-        {
-            error_code = tc_tx(pp_tx_packets[i], &m_tx_config);
-            if (error_code == NRF_SUCCESS)
-            {
-                mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(pp_tx_packets[i]);
-                if (p_adv)
-                {
-                    PIN_OUT(p_adv->handle, 8);
-                    APP_ERROR_CHECK(handle_storage_transmitted(p_adv->handle, timestamp));
-                }
-                else
-                {
-                    APP_ERROR_CHECK(NRF_ERROR_INVALID_DATA);
-                }
-            }
-            mesh_packet_ref_count_dec(pp_tx_packets[i]);
-        }
+        /* on a full radio queue, the values wait for their next timeout */
+        (void) tc_tx(p_aggregate, &m_tx_config);
     }
-    CLEAR_PIN(8);
-    order_next_transmission(timestamp);
+    for (uint32_t i = 0; i < member_count; ++i)
+    {
+        APP_ERROR_CHECK(handle_storage_transmitted(mesh_packet_handle_get(pp_members[i]), timestamp));
+        mesh_packet_ref_count_dec(pp_members[i]);
+    }
+    return individual_count;
 }
 
-/******************************************************************************
-* Interface functions
-******************************************************************************/
-uint32_t vh_init(uint32_t min_interval_us,
-                 uint32_t access_address,
-                 uint8_t channel,
-                 rbc_mesh_txpower_t tx_power)
+/** Pack the short values among the given packets into aggregated packets, and
+  transmit them. Values that don't qualify are moved to the front of the
+  list, and must be transmitted individually by the caller.
+
+  @return The number of packets left for individual transmission. */
+static uint32_t transmit_aggregated(mesh_packet_t** pp_packets, uint32_t count, uint32_t timestamp)
 {
-    uint32_t error_code = handle_storage_init(min_interval_us);
-    if (error_code != NRF_SUCCESS)
+    mesh_packet_t* pp_members[RBC_MESH_RADIO_QUEUE_LENGTH - 1];
+    uint32_t member_count = 0;
+    uint32_t individual_count = 0;
+    mesh_packet_t* p_aggregate = NULL;
+
+    if (count < 2 || !mesh_packet_acquire(&p_aggregate))
     {
-        return error_code;
+        return count;
     }
+    APP_ERROR_CHECK(mesh_packet_aggregate_build(p_aggregate));
 
-    m_tx_timer_evt.p_next = NULL;
-    m_tx_timer_evt.cb = transmit_all_instances;
-    m_tx_timer_evt.interval = 0;
-    m_tx_timer_evt.p_context = NULL;
-
-    m_tx_config.alt_access_address = (access_address != RBC_MESH_ACCESS_ADDRESS_BLE_ADV);
-    m_tx_config.first_channel = channel;
-    m_tx_config.channel_map = 1; /* Only the first channel */
-    m_tx_config.tx_power = tx_power;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(pp_packets[i]);
+        bool tx_event = false;
+        if (p_adv == NULL ||
+            p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD > MESH_AGGREGATE_VALUE_MAX_LEN ||
+            handle_storage_flag_get(p_adv->handle, HANDLE_FLAG_TX_EVENT, &tx_event) != NRF_SUCCESS ||
+            tx_event)
+        {
+            /* the TX event must point to a packet with the value in it. */
+            pp_packets[individual_count++] = pp_packets[i];
+            continue;
+        }
 
-    m_is_initialized = true;
-    return NRF_SUCCESS;
-}
+        uint32_t error_code = mesh_packet_aggregate_add(p_aggregate,
+                p_adv->handle,
+                p_adv->version,
+                p_adv->data,
+                p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD);
+        if (error_code == NRF_ERROR_NO_MEM)
+        {
+            /* full, start a new one. The old one is still owned by the radio queue if it got sent. */
+            individual_count = aggregate_flush(p_aggregate, pp_members, member_count, pp_packets, individual_count, timestamp);
+            member_count = 0;
+            mesh_packet_ref_count_dec(p_aggregate);
+            if (!mesh_packet_acquire(&p_aggregate))
+            {
+                /* leave the rest for individual transmission */
+                for (; i < count; ++i)
+                {
+                    pp_packets[individual_count++] = pp_packets[i];
+                }
+                return individual_count;
+            }
+            APP_ERROR_CHECK(mesh_packet_aggregate_build(p_aggregate));
+            error_code = mesh_packet_aggregate_add(p_aggregate,
+                    p_adv->handle,
+                    p_adv->version,
+                    p_adv->data,
+                    p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD);
+        }
+        APP_ERROR_CHECK(error_code);
+        pp_members[member_count++] = pp_packets[i];
+    }
 
-uint32_t vh_min_interval_set(uint32_t min_interval_us)
-{
-    return handle_storage_min_interval_set(min_interval_us);
+    individual_count = aggregate_flush(p_aggregate, pp_members, member_count, pp_packets, individual_count, timestamp);
+    mesh_packet_ref_count_dec(p_aggregate);
+    return individual_count;
 }
+#endif /* RBC_MESH_VALUE_AGGREGATION */
 
-void vh_tx_power_set(rbc_mesh_txpower_t tx_power)
+static void transmit_all_instances(uint32_t timestamp, void* p_context)
 {
-    m_tx_config.tx_power = tx_power;
+    TRACE(TRACE_ID_VH_TX_START, 0, 0);
+    mesh_packet_t* pp_tx_packets[RBC_MESH_RADIO_QUEUE_LENGTH - 1];
+    /* every packet takes a radio queue slot per channel */
+    uint32_t count = (RBC_MESH_RADIO_QUEUE_LENGTH - 1) / VH_TX_CHANNEL_COUNT;
+
+#if RBC_MESH_VALUE_AGGREGATION
+    /* values due shortly after this one go out early, to share its packet. */
+    uint32_t error_code = handle_storage_tx_packets_get(timestamp, timestamp + RBC_MESH_VALUE_AGGREGATION_WINDOW_US, pp_tx_packets, &count);
+#else
+    uint32_t error_code = handle_storage_tx_packets_get(timestamp, timestamp, pp_tx_packets, &count);
+#endif
+    if (error_code == NRF_SUCCESS)
+    {
+#if RBC_MESH_VALUE_AGGREGATION
+        count = transmit_aggregated(pp_tx_packets, count, timestamp);
+#endif
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            /* A value that doesn't fit in the radio queue waits for its next
+               timeout. Retrying it right away would spin until the radio
+               makes room. */
+            (void) tc_tx(pp_tx_packets[i], &m_tx_config);
+            mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(pp_tx_packets[i]);
+            if (p_adv)
+            {
+                TRACE(TRACE_ID_VH_TX_VALUE, 0, p_adv->handle);
+                APP_ERROR_CHECK(handle_storage_transmitted(p_adv->handle, timestamp));
+            }
+            else
+            {
+                APP_ERROR_CHECK(NRF_ERROR_INVALID_DATA);
+            }
+            mesh_packet_ref_count_dec(pp_tx_packets[i]);
+        }
+    }
+    TRACE(TRACE_ID_VH_TX_END, (error_code == NRF_SUCCESS ? count : 0), 0);
+    order_next_transmission(timestamp);
 }
 
-uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
+/** Defer rescheduling of the transmissions to the end of the rx batch. */
+static void rx_order_update(uint32_t timestamp)
 {
-    mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packet);
-    if (p_adv_data == NULL)
+    if (!m_rx_order_pending || TIMER_OLDER_THAN(timestamp, m_rx_order_time))
     {
-        return NRF_ERROR_INVALID_DATA;
+        m_rx_order_time = timestamp;
     }
+    m_rx_order_pending = true;
+}
 
-    handle_info_t info;
-    uint32_t error_code = handle_storage_info_get(p_adv_data->handle, &info);
+/** Process a single value packet. The given info is the stored state of the
+  value's handle, and the reference to its packet is released. */
+static uint32_t value_rx(mesh_packet_t* p_packet, mesh_adv_data_t* p_adv_data, handle_info_t* p_info, bool found, uint32_t timestamp, uint8_t rssi)
+{
+    handle_info_t info = *p_info;
+    uint32_t error_code;
+    LATENCY_RECORD(LATENCY_STAGE_VH_RX, timestamp);
 
     int16_t delta = version_delta(info.version, p_adv_data->version);
 
@@ -235,14 +323,15 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
     evt.params.rx.value_handle = p_adv_data->handle;
     evt.params.rx.timestamp_us = timestamp;
 
-    if (error_code == NRF_ERROR_NOT_FOUND)
+    if (!found)
     {
         /* couldn't find the handle in the handle storage */
         evt.type = RBC_MESH_EVENT_TYPE_NEW_VAL;
         evt.params.rx.version_delta = delta;
 
         /* First allocate an element in the storage to ensure that we're not out of memory. */
-        error_code = handle_storage_info_set(p_adv_data->handle, &info);
+        handle_storage_slot_t slot;
+        error_code = handle_storage_info_reserve(p_adv_data->handle, &slot);
         if (error_code != NRF_SUCCESS)
         {
             mesh_packet_ref_count_dec(info.p_packet);
@@ -259,14 +348,14 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
         if (rbc_mesh_event_push(&evt) == NRF_SUCCESS)
         {
             /* assert if this doesn't work. The empty allocation above should have prevented any errors this time. */
-            APP_ERROR_CHECK(handle_storage_info_set(p_adv_data->handle, &new_info));
+            APP_ERROR_CHECK(handle_storage_info_commit(&slot, &new_info));
 
             mesh_gatt_value_set(p_adv_data->handle,
                 p_adv_data->data,
                 p_adv_data->adv_data_length - MESH_PACKET_ADV_OVERHEAD);
         }
 
-        vh_order_update(timestamp);
+        rx_order_update(timestamp);
 
 #ifdef RBC_MESH_SERIAL
         mesh_aci_rbc_event_handler(&evt);
@@ -275,7 +364,7 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
     else if (delta < 0)
     {
         handle_storage_rx_inconsistent(p_adv_data->handle, timestamp);
-        vh_order_update(timestamp);
+        rx_order_update(timestamp);
     }
     else if (delta == 0)
     {
@@ -304,7 +393,8 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
         evt.params.rx.version_delta = delta;
 
         /* First allocate an element in the storage to ensure that we're not out of memory. */
-        error_code = handle_storage_info_set(p_adv_data->handle, &info);
+        handle_storage_slot_t slot;
+        error_code = handle_storage_info_reserve(p_adv_data->handle, &slot);
         if (error_code != NRF_SUCCESS)
         {
             mesh_packet_ref_count_dec(info.p_packet);
@@ -321,14 +411,14 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
         if (rbc_mesh_event_push(&evt) == NRF_SUCCESS)
         {
             /* assert if this doesn't work. The empty allocation above should have prevented any errors this time. */
-            APP_ERROR_CHECK(handle_storage_info_set(p_adv_data->handle, &new_info));
+            APP_ERROR_CHECK(handle_storage_info_commit(&slot, &new_info));
 
             mesh_gatt_value_set(p_adv_data->handle,
                 p_adv_data->data,
                 p_adv_data->adv_data_length - MESH_PACKET_ADV_OVERHEAD);
         }
 
-        vh_order_update(timestamp);
+        rx_order_update(timestamp);
 
 #ifdef RBC_MESH_SERIAL
         mesh_aci_rbc_event_handler(&evt);
@@ -339,6 +429,200 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
     return NRF_SUCCESS;
 }
 
+/** Unpack each value in an aggregated packet to a packet of its own, and
+  process it as if it was received on its own. */
+static uint32_t aggregate_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
+{
+    mesh_aggregate_value_t* p_value = mesh_packet_aggregate_value_next(p_packet, NULL);
+    if (p_value == NULL)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    for (; p_value != NULL; p_value = mesh_packet_aggregate_value_next(p_packet, p_value))
+    {
+        if (p_value->handle > RBC_MESH_APP_MAX_HANDLE)
+        {
+            continue;
+        }
+
+        mesh_packet_t* p_value_packet = NULL;
+        if (!mesh_packet_acquire(&p_value_packet))
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+
+        uint32_t error_code = mesh_packet_build(p_value_packet,
+                p_value->handle,
+                p_value->version,
+                p_value->data,
+                p_value->length);
+        if (error_code == NRF_SUCCESS)
+        {
+            /* keep the sender's address for the app event */
+            p_value_packet->header.addr_type = p_packet->header.addr_type;
+            memcpy(p_value_packet->addr, p_packet->addr, BLE_GAP_ADDR_LEN);
+
+            handle_info_t info;
+            bool found = (handle_storage_info_get(p_value->handle, &info) == NRF_SUCCESS);
+            error_code = value_rx(p_value_packet, mesh_packet_adv_data_get(p_value_packet), &info, found, timestamp, rssi);
+        }
+
+        mesh_packet_ref_count_dec(p_value_packet);
+        if (error_code != NRF_SUCCESS)
+        {
+            return error_code;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+/******************************************************************************
+* Interface functions
+******************************************************************************/
+uint32_t vh_init(uint32_t min_interval_us,
+                 uint32_t access_address,
+                 uint8_t channel,
+                 rbc_mesh_txpower_t tx_power)
+{
+    uint32_t error_code = handle_storage_init(min_interval_us);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    m_tx_timer_evt.p_next = NULL;
+    m_tx_timer_evt.cb = transmit_all_instances;
+    m_tx_timer_evt.interval = 0;
+    m_tx_timer_evt.p_context = NULL;
+
+    m_tx_config.alt_access_address = (access_address != RBC_MESH_ACCESS_ADDRESS_BLE_ADV);
+#if RBC_MESH_ADV_CHANNEL_MAP
+    m_tx_config.first_channel = 37;
+    m_tx_config.channel_map = RBC_MESH_ADV_CHANNEL_MAP;
+#else
+    m_tx_config.first_channel = channel;
+    m_tx_config.channel_map = 1; /* Only the first channel */
+#endif
+    m_tx_config.tx_power = tx_power;
+
+    m_is_initialized = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t vh_min_interval_set(uint32_t min_interval_us)
+{
+    return handle_storage_min_interval_set(min_interval_us);
+}
+
+void vh_tx_power_set(rbc_mesh_txpower_t tx_power)
+{
+    m_tx_config.tx_power = tx_power;
+}
+
+void vh_tx_config_get(tc_tx_config_t* p_tx_config)
+{
+    *p_tx_config = m_tx_config;
+}
+
+uint32_t vh_rx_batch(vh_rx_packet_t* p_packets, uint32_t count)
+{
+    if (p_packets == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (count == 0)
+    {
+        return NRF_SUCCESS;
+    }
+    if (count > RBC_MESH_RX_BATCH_MAX)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    uint16_t handles[RBC_MESH_RX_BATCH_MAX];
+    handle_info_t infos[RBC_MESH_RX_BATCH_MAX];
+    bool found[RBC_MESH_RX_BATCH_MAX];
+    bool stale[RBC_MESH_RX_BATCH_MAX];
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packets[i].p_packet);
+        if (p_adv_data == NULL || p_adv_data->handle == MESH_AGGREGATE_HANDLE)
+        {
+            handles[i] = RBC_MESH_INVALID_HANDLE;
+        }
+        else
+        {
+            handles[i] = p_adv_data->handle;
+        }
+        stale[i] = false;
+    }
+
+    uint32_t error_code = handle_storage_info_get_n(handles, infos, found, count);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t result;
+        mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packets[i].p_packet);
+        if (p_adv_data == NULL)
+        {
+            result = NRF_ERROR_INVALID_DATA;
+        }
+        else if (p_adv_data->handle == MESH_AGGREGATE_HANDLE)
+        {
+            result = aggregate_rx(p_packets[i].p_packet, p_packets[i].timestamp, p_packets[i].rssi);
+
+            /* the aggregate may have updated any of the values later in the batch */
+            for (uint32_t j = i + 1; j < count; ++j)
+            {
+                stale[j] = true;
+            }
+        }
+        else
+        {
+            if (stale[i])
+            {
+                mesh_packet_ref_count_dec(infos[i].p_packet);
+                found[i] = (handle_storage_info_get(handles[i], &infos[i]) == NRF_SUCCESS);
+            }
+
+            bool is_update = (!found[i] || version_delta(infos[i].version, p_adv_data->version) > 0);
+
+            result = value_rx(p_packets[i].p_packet, p_adv_data, &infos[i], found[i], p_packets[i].timestamp, p_packets[i].rssi);
+
+            if (is_update)
+            {
+                for (uint32_t j = i + 1; j < count; ++j)
+                {
+                    if (handles[j] == handles[i])
+                    {
+                        stale[j] = true;
+                    }
+                }
+            }
+        }
+
+        if (result != NRF_SUCCESS)
+        {
+            error_code = result;
+        }
+    }
+
+    if (m_rx_order_pending)
+    {
+        m_rx_order_pending = false;
+        vh_order_update(m_rx_order_time);
+    }
+
+    return error_code;
+}
+
 uint32_t vh_local_update(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
 {
     if (!m_is_initialized)
@@ -388,7 +672,7 @@ uint32_t vh_order_update(uint32_t time_now)
     tx_event.callback.timer_sch.cb = transmit_all_instances;
     tx_event.callback.timer_sch.timestamp = time_now;
     tx_event.callback.timer_sch.p_context = NULL;
-    return event_handler_push(&tx_event);
+    return event_handler_push_coalesced(&tx_event);
 }
 
 uint32_t vh_value_get(rbc_mesh_value_handle_t handle, uint8_t* data, uint16_t* length)
@@ -564,3 +848,99 @@ uint32_t vh_value_persistence_get(rbc_mesh_value_handle_t handle, bool* p_persis
     event_handler_critical_section_end();
     return error_code;
 }
+
+uint32_t vh_trickle_profile_set(uint8_t profile, const rbc_mesh_trickle_profile_t* p_profile)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (p_profile->interval_min_ms < RBC_MESH_INTERVAL_MIN_MIN_MS ||
+        p_profile->interval_min_ms > RBC_MESH_INTERVAL_MIN_MAX_MS ||
+        p_profile->interval_max_ms > TRICKLE_INTERVAL_MAX_US / 1000)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    trickle_profile_t trickle_profile;
+    trickle_profile.i_min = p_profile->interval_min_ms * 1000; /* ms -> us */
+    trickle_profile.i_max = p_profile->interval_max_ms * 1000;
+    trickle_profile.k = p_profile->redundancy_constant;
+
+    event_handler_critical_section_begin();
+
+    uint32_t error_code = trickle_profile_set(profile, &trickle_profile);
+
+    event_handler_critical_section_end();
+    return error_code;
+}
+
+uint32_t vh_trickle_profile_get(uint8_t profile, rbc_mesh_trickle_profile_t* p_profile)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    trickle_profile_t trickle_profile;
+
+    event_handler_critical_section_begin();
+
+    uint32_t error_code = trickle_profile_get(profile, &trickle_profile);
+
+    event_handler_critical_section_end();
+
+    if (error_code == NRF_SUCCESS)
+    {
+        p_profile->interval_min_ms = trickle_profile.i_min / 1000; /* us -> ms */
+        p_profile->interval_max_ms = trickle_profile.i_max / 1000;
+        p_profile->redundancy_constant = trickle_profile.k;
+    }
+    return error_code;
+}
+
+uint32_t vh_value_trickle_profile_set(rbc_mesh_value_handle_t handle, uint8_t profile)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    if (profile >= RBC_MESH_TRICKLE_PROFILE_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    event_handler_critical_section_begin();
+
+    uint32_t error_code = handle_storage_trickle_profile_set_async(handle, profile);
+
+    event_handler_critical_section_end();
+    return error_code;
+}
+
+uint32_t vh_value_trickle_profile_get(rbc_mesh_value_handle_t handle, uint8_t* p_profile)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    event_handler_critical_section_begin();
+
+    uint32_t error_code = handle_storage_trickle_profile_get(handle, p_profile);
+
+    event_handler_critical_section_end();
+    return error_code;
+}